@@ -0,0 +1,108 @@
+// circle_table.h
+// Compile-time unit-circle tables shared by drawCircle, drawRoundedRect and the
+// retained renderer. A circle becomes a scaled copy of a table row instead of
+// a cosf/sinf pair per segment.
+//
+// unitCircle(n) returns the table for an n-segment circle: n+1 points with the
+// last equal to the first so fans close exactly. Counts used by the drawing
+// code are generated at compile time; any other count is built once on first
+// use and cached.
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace circle_detail {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Taylor series on [-pi, pi]; accurate to double rounding for our angles.
+constexpr double sinReduced(double x) {
+    double term = x, sum = x;
+    for(int n=1;n<16;n++){
+        term *= -x * x / ((2.0*n) * (2.0*n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double constexprSin(double x) {
+    while(x > kPi) x -= 2.0 * kPi;
+    while(x < -kPi) x += 2.0 * kPi;
+    return sinReduced(x);
+}
+
+constexpr double constexprCos(double x) {
+    return constexprSin(x + kPi / 2.0);
+}
+
+} // namespace circle_detail
+
+// Fewer segments are raised to this; callers clamp too, so their loops and
+// vertex counts match the table they index.
+const int kMinCircleSegments = 3;
+
+struct UnitCircleTable {
+    int segments;
+    const float* cosv;   // segments + 1 entries
+    const float* sinv;
+};
+
+template<int Segments>
+struct UnitCircle {
+    float cosv[Segments + 1] = {};
+    float sinv[Segments + 1] = {};
+
+    constexpr UnitCircle() {
+        for(int i=0;i<Segments;i++){
+            double a = 2.0 * circle_detail::kPi * i / Segments;
+            cosv[i] = (float)circle_detail::constexprCos(a);
+            sinv[i] = (float)circle_detail::constexprSin(a);
+        }
+        cosv[Segments] = cosv[0];
+        sinv[Segments] = sinv[0];
+    }
+};
+
+template<int Segments>
+inline constexpr UnitCircle<Segments> kUnitCircle{};
+
+template<int Segments>
+inline UnitCircleTable unitCircleFor() {
+    return { Segments, kUnitCircle<Segments>.cosv, kUnitCircle<Segments>.sinv };
+}
+
+// Rounded rectangles use 4*segments so every corner is an exact quarter of the table.
+inline UnitCircleTable unitCircle(int segments) {
+    switch(segments) {
+        case 12: return unitCircleFor<12>();
+        case 16: return unitCircleFor<16>();
+        case 20: return unitCircleFor<20>();
+        case 22: return unitCircleFor<22>();
+        case 24: return unitCircleFor<24>();
+        case 32: return unitCircleFor<32>();
+        case 48: return unitCircleFor<48>();
+        case 64: return unitCircleFor<64>();
+        default: break;
+    }
+    // Uncommon counts: generate once with the same series, keep for the process lifetime.
+    struct Dynamic { std::unique_ptr<float[]> cosv, sinv; };
+    static std::map<int, Dynamic> cache;
+    static std::mutex cacheMutex;
+    if(segments < kMinCircleSegments) segments = kMinCircleSegments;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    Dynamic& d = cache[segments];
+    if(!d.cosv) {
+        d.cosv.reset(new float[segments + 1]);
+        d.sinv.reset(new float[segments + 1]);
+        for(int i=0;i<segments;i++){
+            double a = 2.0 * circle_detail::kPi * i / segments;
+            d.cosv[i] = (float)circle_detail::constexprCos(a);
+            d.sinv[i] = (float)circle_detail::constexprSin(a);
+        }
+        d.cosv[segments] = d.cosv[0];
+        d.sinv[segments] = d.sinv[0];
+    }
+    return { segments, d.cosv.get(), d.sinv.get() };
+}
@@ -0,0 +1,39 @@
+// command_list.cpp
+// Recording backend (see command_list.h).
+
+#include "command_list.h"
+
+void CommandList::begin() {
+    cmds.clear();
+    resetState();
+}
+
+RasterCmd& CommandList::push(RasterCmdKind kind) {
+    cmds.emplace_back();
+    RasterCmd& c = cmds.back();
+    c.kind = kind;
+    c.blend = blending;
+    c.col[0] = col[0]; c.col[1] = col[1]; c.col[2] = col[2]; c.col[3] = col[3];
+    return c;
+}
+
+void CommandList::emitClear(const uint8_t c[4]) {
+    RasterCmd& cmd = push(RASTER_CLEAR);
+    cmd.blend = false;
+    cmd.col[0] = c[0]; cmd.col[1] = c[1]; cmd.col[2] = c[2]; cmd.col[3] = c[3];
+}
+
+void CommandList::emitTriangle(float x0, float y0, float x1, float y1, float x2, float y2) {
+    RasterCmd& cmd = push(RASTER_TRIANGLE);
+    cmd.v[0] = x0; cmd.v[1] = y0;
+    cmd.v[2] = x1; cmd.v[3] = y1;
+    cmd.v[4] = x2; cmd.v[5] = y2;
+}
+
+void CommandList::emitPixelRect(int x0, int y0, int x1, int y1) {
+    if(x0 >= x1 || y0 >= y1) return;
+    RasterCmd& cmd = push(RASTER_PIXEL_RECT);
+    // pixel coordinates are far below 2^24, so they round-trip through float
+    cmd.v[0] = (float)x0; cmd.v[1] = (float)y0;
+    cmd.v[2] = (float)x1; cmd.v[3] = (float)y1;
+}
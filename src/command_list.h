@@ -0,0 +1,39 @@
+// command_list.h
+// Recording RenderBackend: the scene is drawn once into a flat list of
+// window-space raster commands that can be replayed per screen tile
+// (tile_renderer.h). Each command carries its own colour and blend flag, so
+// replaying a tile's commands in submission order reproduces GL's blending
+// order exactly.
+#pragma once
+
+#include "soft_raster.h"
+#include <cstdint>
+#include <vector>
+
+enum RasterCmdKind : uint8_t { RASTER_CLEAR, RASTER_TRIANGLE, RASTER_PIXEL_RECT };
+
+struct RasterCmd {
+    RasterCmdKind kind;
+    bool blend;
+    uint8_t col[4];
+    float v[6];          // triangle: x0 y0 x1 y1 x2 y2; pixel rect: x0 y0 x1 y1
+};
+
+class CommandList : public SoftGeometry {
+public:
+    // Starts a new frame: drops the previous commands (keeping their storage)
+    // and resets colour, blend, line width and transform state.
+    void begin();
+
+    const std::vector<RasterCmd>& commands() const { return cmds; }
+
+protected:
+    void emitClear(const uint8_t c[4]) override;
+    void emitTriangle(float x0, float y0, float x1, float y1, float x2, float y2) override;
+    void emitPixelRect(int x0, int y0, int x1, int y1) override;
+
+private:
+    RasterCmd& push(RasterCmdKind kind);
+
+    std::vector<RasterCmd> cmds;
+};
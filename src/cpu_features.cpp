@@ -0,0 +1,35 @@
+// cpu_features.cpp
+// Runtime CPU feature detection (see cpu_features.h).
+
+#include "cpu_features.h"
+
+#if defined(ENGINE_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static bool detectAVX2() {
+#if !defined(ENGINE_X86)
+    return false;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if(!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAVX2() {
+    static const bool avx2 = detectAVX2();
+    return avx2;
+}
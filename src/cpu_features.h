@@ -0,0 +1,24 @@
+// cpu_features.h
+// Target detection shared by the SIMD kernels (span_kernels, piston_kernels).
+// x86-64 builds compile AVX2 bodies per function and pick them at runtime;
+// AArch64 always has NEON. 32-bit x86 is not guaranteed SSE2, so it builds
+// the scalar kernels only.
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define ENGINE_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define ENGINE_NEON 1
+#endif
+
+// GCC / Clang compile the AVX2 body for that target only; MSVC needs no attribute.
+#if defined(ENGINE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ENGINE_TARGET_AVX2
+#endif
+
+// Running CPU (and OS) support AVX2; detected once.
+bool cpuHasAVX2();
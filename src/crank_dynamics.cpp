@@ -0,0 +1,231 @@
+// crank_dynamics.cpp
+// Crank speed integration for an engine fleet (see crank_dynamics.h).
+
+#include "crank_dynamics.h"
+#include "crank_kinematics.h"
+#include "engine_batch.h"
+#include "sim_snapshot.h"
+#include "thermo_model.h"
+#include <algorithm>
+#include <cmath>
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+CrankDynamics::CrankDynamics(const ThermoModel& model, const EngineBatch& engines, const DynamicsSpec& spec)
+    : sp(spec) {
+    cylCount = engines.cylinders();
+    stride = engines.stride();
+    n = model.samples();
+    samplesPerDeg = n / 720.0f;
+    const ThermoSpec& ts = model.spec();
+    SliderCrank crank = { (float)(ts.stroke * 0.5), (float)ts.rodLength };
+    double m = sp.reciprocatingMass;
+    table.resize(n + 1);
+    for(int k=0;k<=n;k++){
+        int kk = k % n;
+        double theta = kk * (720.0 / n) * M_PI / 180.0;
+        double v = sliderCrankVelocity(crank, theta);
+        double a = sliderCrankAcceleration(crank, theta);
+        float g0 = model.torque(kk, model.steadyPressure(kk, 0.0f));
+        Sample& s = table[k];
+        s.gas0 = g0;
+        s.gas1 = model.torque(kk, model.steadyPressure(kk, 1.0f)) - g0;
+        s.inertia = (float)(m * v * v);
+        s.coupling = (float)(m * v * a);
+    }
+    load0.assign(stride, (float)sp.load0);
+    load1.assign(stride, (float)sp.load1);
+    load2.assign(stride, (float)sp.load2);
+    torque.assign(stride, 0.0f);
+}
+
+void CrankDynamics::setLoad(int e, float l0, float l1, float l2) {
+    load0[e] = l0;
+    load1[e] = l1;
+    load2[e] = l2;
+}
+
+// Maps crank angle plus phase offset to [0, 720); inputs stay within [-720, 2160).
+static inline float cycleAngle(float a) {
+    a += 720.0f * (float)(a < 0.0f);
+    a -= 720.0f * (float)(a >= 720.0f);
+    a -= 720.0f * (float)(a >= 720.0f);
+    return a;
+}
+
+void CrankDynamics::evaluate(const EngineBatch& engines, const ThermoBatch& thermo, int e0, const float* theta,
+                             const float* w, float* acc, float* net) const {
+    const float f0 = (float)sp.friction0, f1 = (float)sp.friction1, f2 = (float)sp.friction2;
+    const float* l0 = load0.data() + e0;
+    const float* l1 = load1.data() + e0;
+    const float* l2 = load2.data() + e0;
+    float num[kBatchLane], den[kBatchLane];
+    for(int j=0;j<kBatchLane;j++){
+        float moving = (float)(w[j] > 0.0f);
+        num[j] = -moving * (f0 + w[j] * (f1 + w[j] * f2));
+        den[j] = (float)sp.crankInertia;
+    }
+    for(int c=0;c<cylCount;c++){
+        const float* off = engines.phaseOffsets(c) + e0;
+        const float* fuel = thermo.latchedFuels(c) + e0;
+        for(int j=0;j<kBatchLane;j++){
+            float x = cycleAngle(theta[j] + off[j]) * samplesPerDeg;
+            int i = std::min((int)x, n - 1);
+            float t = x - (float)i;
+            const Sample& a = table[i];
+            const Sample& b = table[i + 1];
+            float gas0 = a.gas0 + t * (b.gas0 - a.gas0);
+            float gas1 = a.gas1 + t * (b.gas1 - a.gas1);
+            float inertia = a.inertia + t * (b.inertia - a.inertia);
+            float coupling = a.coupling + t * (b.coupling - a.coupling);
+            num[j] += gas0 + fuel[j] * gas1 - coupling * w[j] * w[j];
+            den[j] += inertia;
+        }
+    }
+    if(net) for(int j=0;j<kBatchLane;j++) net[j] = num[j];
+    for(int j=0;j<kBatchLane;j++){
+        float moving = (float)(w[j] > 0.0f);
+        float load = moving * (l0[j] + w[j] * (l1[j] + w[j] * l2[j]));
+        acc[j] = (num[j] - load) / den[j];
+    }
+}
+
+// Wraps a crank angle in [-720, 1440) to [0, 720).
+static inline double wrapCycle(double a) {
+    a += 720.0 * (double)(a < 0.0);
+    a -= 720.0 * (double)(a >= 720.0);
+    return a;
+}
+
+template<CrankIntegrator Scheme>
+void CrankDynamics::advanceBlock(EngineBatch& engines, const ThermoBatch& thermo, int e0, float dtSec,
+                                 uint64_t& steps) {
+    float* angle = engines.crankAngles() + e0;
+    float* speed = engines.crankSpeeds() + e0;
+    const float windowStart = (float)sp.firingWindowStartDeg;
+    const float windowLen = (float)(sp.firingWindowEndDeg - sp.firingWindowStartDeg);
+    const double toDeg = 180.0 / M_PI;
+    // State is carried in double within the interval: at fine steps the
+    // per-step speed change is close to a float ulp of the speed itself.
+    double theta[kBatchLane], w[kBatchLane], h[kBatchLane];
+    float sweep[kBatchLane], ft[kBatchLane], fw[kBatchLane];
+    int count[kBatchLane];
+    bool firing[kBatchLane];
+
+    // Step count per engine: the angle it will sweep at its current speed,
+    // in fine steps if that range touches any cylinder's firing window.
+    for(int j=0;j<kBatchLane;j++){
+        theta[j] = angle[j];
+        w[j] = speed[j] * (M_PI / 180.0);
+        sweep[j] = std::max(speed[j], 0.0f) * dtSec;
+        firing[j] = false;
+    }
+    for(int c=0;c<cylCount;c++){
+        const float* off = engines.phaseOffsets(c) + e0;
+        for(int j=0;j<kBatchLane;j++){
+            float d = cycleAngle(angle[j] + off[j] - windowStart);
+            firing[j] = firing[j] || d < windowLen || 720.0f - d < sweep[j];
+        }
+    }
+    int maxCount = 1;
+    for(int j=0;j<kBatchLane;j++){
+        bool fine = firing[j] || Scheme == CrankIntegrator::SemiImplicitEuler;
+        float limit = (float)(fine ? sp.fineStepDeg : sp.coarseStepDeg);
+        count[j] = std::max(1, (int)ceilf(sweep[j] / limit));
+        h[j] = (double)dtSec / count[j];
+        maxCount = std::max(maxCount, count[j]);
+    }
+
+    float acc[kBatchLane];
+    double hs[kBatchLane];
+    for(int i=0;i<maxCount;i++){
+        for(int j=0;j<kBatchLane;j++) hs[j] = i < count[j] ? h[j] : 0.0;
+        if(Scheme == CrankIntegrator::SemiImplicitEuler) {
+            for(int j=0;j<kBatchLane;j++){
+                ft[j] = (float)theta[j];
+                fw[j] = (float)w[j];
+            }
+            evaluate(engines, thermo, e0, ft, fw, acc, nullptr);
+            for(int j=0;j<kBatchLane;j++){
+                w[j] = std::max(w[j] + hs[j] * acc[j], 0.0);
+                theta[j] = wrapCycle(theta[j] + hs[j] * w[j] * toDeg);
+            }
+        } else {
+            // Classic RK4 on (theta, w); the theta slopes are the stage speeds.
+            float k1[kBatchLane], k2[kBatchLane], k3[kBatchLane];
+            double w2[kBatchLane], w3[kBatchLane], w4[kBatchLane];
+            for(int j=0;j<kBatchLane;j++){
+                ft[j] = (float)theta[j];
+                fw[j] = (float)w[j];
+            }
+            evaluate(engines, thermo, e0, ft, fw, k1, nullptr);
+            for(int j=0;j<kBatchLane;j++){
+                w2[j] = w[j] + 0.5 * hs[j] * k1[j];
+                ft[j] = (float)(theta[j] + 0.5 * hs[j] * w[j] * toDeg);
+                fw[j] = (float)w2[j];
+            }
+            evaluate(engines, thermo, e0, ft, fw, k2, nullptr);
+            for(int j=0;j<kBatchLane;j++){
+                w3[j] = w[j] + 0.5 * hs[j] * k2[j];
+                ft[j] = (float)(theta[j] + 0.5 * hs[j] * w2[j] * toDeg);
+                fw[j] = (float)w3[j];
+            }
+            evaluate(engines, thermo, e0, ft, fw, k3, nullptr);
+            for(int j=0;j<kBatchLane;j++){
+                w4[j] = w[j] + hs[j] * k3[j];
+                ft[j] = (float)(theta[j] + hs[j] * w3[j] * toDeg);
+                fw[j] = (float)w4[j];
+            }
+            evaluate(engines, thermo, e0, ft, fw, acc, nullptr);
+            for(int j=0;j<kBatchLane;j++){
+                double dTheta = w[j] + 2.0 * (w2[j] + w3[j]) + w4[j];
+                double dW = k1[j] + 2.0 * ((double)k2[j] + k3[j]) + acc[j];
+                theta[j] = wrapCycle(theta[j] + hs[j] * (1.0 / 6.0) * dTheta * toDeg);
+                w[j] = std::max(w[j] + hs[j] * (1.0 / 6.0) * dW, 0.0);
+            }
+        }
+    }
+
+    for(int j=0;j<kBatchLane;j++){
+        float a = (float)theta[j];
+        angle[j] = a >= 720.0f ? 0.0f : a;
+        speed[j] = (float)(w[j] * toDeg);
+        ft[j] = angle[j];
+        fw[j] = (float)w[j];
+    }
+    evaluate(engines, thermo, e0, ft, fw, acc, torque.data() + e0);
+    int real = std::min(kBatchLane, engines.size() - e0);
+    for(int j=0;j<real;j++) steps += (uint64_t)count[j];
+}
+
+uint64_t CrankDynamics::advance(EngineBatch& engines, const ThermoBatch& thermo, float dtSec, CrankIntegrator scheme) {
+    uint64_t steps = 0;
+    for(int e0=0;e0<stride;e0+=kBatchLane){
+        if(scheme == CrankIntegrator::RK4) advanceBlock<CrankIntegrator::RK4>(engines, thermo, e0, dtSec, steps);
+        else advanceBlock<CrankIntegrator::SemiImplicitEuler>(engines, thermo, e0, dtSec, steps);
+    }
+    engines.updateKinematics();
+    return steps;
+}
+
+float CrankDynamics::acceleration(const EngineBatch& engines, const ThermoBatch& thermo, int e,
+                                  float crankAngleDeg, float speedRadPerSec) const {
+    int e0 = e / kBatchLane * kBatchLane;
+    float theta[kBatchLane], w[kBatchLane], acc[kBatchLane];
+    for(int j=0;j<kBatchLane;j++){
+        theta[j] = crankAngleDeg;
+        w[j] = speedRadPerSec;
+    }
+    evaluate(engines, thermo, e0, theta, w, acc, nullptr);
+    return acc[e - e0];
+}
+
+void CrankDynamics::stateArrays(std::vector<StateArray>& out) {
+    out.push_back({ "dyn.load0", load0.data(), load0.size() * sizeof(float) });
+    out.push_back({ "dyn.load1", load1.data(), load1.size() * sizeof(float) });
+    out.push_back({ "dyn.load2", load2.data(), load2.size() * sizeof(float) });
+    out.push_back({ "dyn.torque", torque.data(), torque.size() * sizeof(float) });
+}
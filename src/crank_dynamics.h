@@ -0,0 +1,103 @@
+// crank_dynamics.h
+// Crankshaft speed from the torques acting on it, for every engine of an
+// EngineBatch. With crank angle theta (radians), speed w and the piston
+// displacement s(theta) of each cylinder, the equation of motion of a
+// single-cylinder-plane crank train with reciprocating mass m is
+//     (J + sum m s'^2) dw/dt = sum (Tgas - m s' s'' w^2) - Tfriction(w) - Tload(w)
+// J is the rotating inertia (crank, flywheel, big-end share of the rods),
+// m s'^2 the angle-dependent inertia of the pistons, and m s' s'' w^2 the
+// torque the pistons take back while they accelerate. Gas torque comes from
+// the ThermoModel's steady cycle for each cylinder's latched fuel, friction
+// and load are quadratics in speed.
+//
+// Two schemes: semi-implicit (symplectic) Euler, one evaluation per step,
+// and classic RK4, four. Steps are limited in crank angle rather than time:
+// fineStepDeg while any cylinder is inside its firing window (where gas
+// torque changes fastest), coarseStepDeg elsewhere, so the step adapts to
+// both speed and combustion events (see DynamicsSpec for semi-implicit
+// Euler). Engines are processed kBatchLane at a time with one step count
+// per engine; lanes that finish early take steps of zero length, which
+// leaves them unchanged, so the inner loops have no per-engine branches.
+// Torque terms are evaluated in float from per-sample tables; angle and
+// speed are carried in double within an advance() call.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class EngineBatch;
+class ThermoBatch;
+class ThermoModel;
+struct StateArray;
+
+enum class CrankIntegrator { SemiImplicitEuler, RK4 };
+
+struct DynamicsSpec {
+    double crankInertia = 0.15;          // kg m^2, rotating parts and flywheel
+    double reciprocatingMass = 0.45;     // kg per cylinder: piston, rings, pin, small-end share of the rod
+    // Friction torque f0 + f1 w + f2 w^2, N m with w in rad/s (zero when stopped).
+    double friction0 = 3.0;
+    double friction1 = 0.005;
+    double friction2 = 2.0e-5;
+    // Default load torque l0 + l1 w + l2 w^2 (fan / propeller law for l2); per engine with setLoad().
+    double load0 = 0.0;
+    double load1 = 0.0;
+    double load2 = 1.0e-3;
+    // Crank-angle step limits. Semi-implicit Euler relies on errors
+    // cancelling between compression and expansion, which needs equal steps
+    // on both sides, so it takes fineStepDeg everywhere (coarseStepDeg is
+    // used by RK4 only).
+    double fineStepDeg = 2.0;
+    double coarseStepDeg = 8.0;
+    // Firing window in cycle angle (thermo_model.h convention, 360 = firing
+    // TDC). Centred on TDC so compression and expansion get the same steps.
+    double firingWindowStartDeg = 300.0;
+    double firingWindowEndDeg = 420.0;
+};
+
+class CrankDynamics {
+public:
+    // Gas torque and piston geometry come from model (its ThermoSpec); per
+    // engine state from engines, which must be the batch later advanced.
+    CrankDynamics(const ThermoModel& model, const EngineBatch& engines, const DynamicsSpec& spec = DynamicsSpec());
+
+    const DynamicsSpec& spec() const { return sp; }
+    void setLoad(int e, float l0, float l1, float l2);
+
+    // Integrates every engine's crank angle and speed over dtSec with each
+    // cylinder's fuel as latched by thermo, then refreshes the batch's piston
+    // positions and phases. Call thermo.advance(engines) afterwards to latch
+    // new charges. Returns the number of integration steps over all engines.
+    uint64_t advance(EngineBatch& engines, const ThermoBatch& thermo, float dtSec, CrankIntegrator scheme);
+
+    // Angular acceleration of engine e at the given state, rad/s^2.
+    float acceleration(const EngineBatch& engines, const ThermoBatch& thermo, int e, float crankAngleDeg,
+                       float speedRadPerSec) const;
+    // Crank torque of the last advance() before load, N m: gas minus piston
+    // inertia and friction at the end of the interval.
+    const float* netTorques() const { return torque.data(); }
+
+    // Every array of state, for snapshots (sim_snapshot.h).
+    void stateArrays(std::vector<StateArray>& out);
+
+private:
+    struct Sample {
+        float gas0, gas1;   // gas torque = gas0 + fuel * gas1
+        float inertia;      // m s'^2
+        float coupling;     // m s' s''
+    };
+
+    // dw/dt for the kBatchLane engines from e0 at angles theta (degrees) and
+    // speeds w (rad/s); net, if given, receives the torque before load.
+    void evaluate(const EngineBatch& engines, const ThermoBatch& thermo, int e0, const float* theta, const float* w,
+                  float* acc, float* net) const;
+    template<CrankIntegrator Scheme>
+    void advanceBlock(EngineBatch& engines, const ThermoBatch& thermo, int e0, float dtSec, uint64_t& steps);
+
+    DynamicsSpec sp;
+    int cylCount, stride, n;
+    float samplesPerDeg;
+    std::vector<Sample> table;                     // n + 1 per 720 degrees
+    std::vector<float> load0, load1, load2;        // [stride]
+    std::vector<float> torque;                     // [stride]
+};
@@ -0,0 +1,149 @@
+// crank_kinematics.cpp
+// Slider-crank reference and lookup table (see crank_kinematics.h).
+
+#include "crank_kinematics.h"
+#include <cmath>
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// q = L^2 - R^2 sin^2 theta, the squared vertical extent of the rod.
+static double rodSpanSq(const SliderCrank& g, double s) {
+    double R = g.crankRadius, L = g.rodLength;
+    double q = L*L - R*R*s*s;
+    return q > 0.0 ? q : 0.0;
+}
+
+double sliderCrankDisplacement(const SliderCrank& g, double theta) {
+    double R = g.crankRadius, L = g.rodLength;
+    return R * (1.0 - cos(theta)) + L - sqrt(rodSpanSq(g, sin(theta)));
+}
+
+double sliderCrankVelocity(const SliderCrank& g, double theta) {
+    double R = g.crankRadius;
+    double s = sin(theta), c = cos(theta);
+    double q = rodSpanSq(g, s);
+    return R*s + (q > 0.0 ? R*R*s*c / sqrt(q) : 0.0);
+}
+
+double sliderCrankAcceleration(const SliderCrank& g, double theta) {
+    // s'' = R cos + R^2 cos 2theta / sqrt(q) + (R^2 sin cos)^2 / q^(3/2)
+    double R = g.crankRadius;
+    double s = sin(theta), c = cos(theta);
+    double q = rodSpanSq(g, s);
+    if(q <= 0.0) return R*c;
+    double f = R*R*s*c;
+    double rq = sqrt(q);
+    return R*c + R*R*(c*c - s*s) / rq + f*f / (q * rq);
+}
+
+static int tableSize(int size) {
+    int n = 16;
+    while(n < size) n <<= 1;
+    return n;
+}
+
+KinematicsTable::KinematicsTable(const SliderCrank& geometry, int size) : geom(geometry) {
+    n = tableSize(size);
+    samplesPerDeg = n / 360.0f;
+    double step = 2.0 * M_PI / n;
+    h = (float)step;
+
+    owned.resize(sampleCount(n));
+    float* p = owned.data();
+    float* dp = p + (n + 1);
+    float* ddp = dp + (n + 1);
+    float* px = ddp + (n + 1);
+    float* py = px + (n + 1);
+    for(int i=0;i<=n;i++){
+        double theta = (i % n) * step;
+        p[i] = (float)sliderCrankDisplacement(geom, theta);
+        dp[i] = (float)sliderCrankVelocity(geom, theta);
+        ddp[i] = (float)sliderCrankAcceleration(geom, theta);
+        px[i] = (float)(geom.crankRadius * sin(theta));
+        py[i] = (float)(geom.crankRadius * cos(theta));
+    }
+    bind(p);
+}
+
+KinematicsTable::KinematicsTable(const SliderCrank& geometry, int size, const float* samples) : geom(geometry) {
+    n = tableSize(size);
+    samplesPerDeg = n / 360.0f;
+    h = (float)(2.0 * M_PI / n);
+    bind(samples);
+}
+
+KinematicsTable::KinematicsTable(const KinematicsTable& other)
+    : geom(other.geom), n(other.n), samplesPerDeg(other.samplesPerDeg), h(other.h), owned(other.owned) {
+    bind(owned.empty() ? other.pos : owned.data());
+}
+
+KinematicsTable& KinematicsTable::operator=(const KinematicsTable& other) {
+    if(this == &other) return *this;
+    geom = other.geom;
+    n = other.n;
+    samplesPerDeg = other.samplesPerDeg;
+    h = other.h;
+    owned = other.owned;
+    bind(owned.empty() ? other.pos : owned.data());
+    return *this;
+}
+
+void KinematicsTable::bind(const float* samples) {
+    pos = samples;
+    dpos = pos + (n + 1);
+    ddpos = dpos + (n + 1);
+    pinX = ddpos + (n + 1);
+    pinY = pinX + (n + 1);
+}
+
+void KinematicsTable::locate(float angleDeg, int& i, float& t) const {
+    float u = angleDeg * samplesPerDeg;
+    float fl = floorf(u);
+    t = u - fl;
+    i = (int)fl & (n - 1);   // two's complement masking also wraps negative angles
+}
+
+// Cubic Hermite on [0, 1] from end values and end slopes (slopes already
+// scaled by the sample spacing).
+static inline float hermite(float p0, float p1, float m0, float m1, float t) {
+    float t2 = t*t, t3 = t2*t;
+    return (2*t3 - 3*t2 + 1) * p0 + (t3 - 2*t2 + t) * m0 + (-2*t3 + 3*t2) * p1 + (t3 - t2) * m1;
+}
+
+float KinematicsTable::displacement(float angleDeg) const {
+    int i; float t;
+    locate(angleDeg, i, t);
+    return hermite(pos[i], pos[i+1], dpos[i] * h, dpos[i+1] * h, t);
+}
+
+void KinematicsTable::displacements(const float* angleDeg, float* out, int count) const {
+    const float* p = pos;
+    const float* d = dpos;
+    for(int k=0;k<count;k++){
+        int i; float t;
+        locate(angleDeg[k], i, t);
+        out[k] = hermite(p[i], p[i+1], d[i] * h, d[i+1] * h, t);
+    }
+}
+
+PistonKinematics KinematicsTable::evaluate(float angleDeg, float crankSpeedDegPerSec) const {
+    int i; float t;
+    locate(angleDeg, i, t);
+    float w = crankSpeedDegPerSec * (float)(M_PI / 180.0);
+    PistonKinematics k;
+    k.pos = hermite(pos[i], pos[i+1], dpos[i] * h, dpos[i+1] * h, t);
+    k.vel = hermite(dpos[i], dpos[i+1], ddpos[i] * h, ddpos[i+1] * h, t) * w;
+    k.acc = (ddpos[i] + (ddpos[i+1] - ddpos[i]) * t) * w * w;
+    return k;
+}
+
+void KinematicsTable::crankPin(float angleDeg, float& x, float& y) const {
+    int i; float t;
+    locate(angleDeg, i, t);
+    // d/dtheta (R sin, R cos) = (R cos, -R sin)
+    x = hermite(pinX[i], pinX[i+1], pinY[i] * h, pinY[i+1] * h, t);
+    y = hermite(pinY[i], pinY[i+1], -pinX[i] * h, -pinX[i+1] * h, t);
+}
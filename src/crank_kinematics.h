@@ -0,0 +1,75 @@
+// crank_kinematics.h
+// Exact slider-crank kinematics and a per-geometry lookup table.
+// With crank radius R, rod length L and crank angle theta measured from top
+// dead centre, the piston's distance below TDC is
+//     s(theta) = R(1 - cos theta) + L - sqrt(L^2 - R^2 sin^2 theta)
+// The exact functions are the reference; KinematicsTable samples s and its
+// first two derivatives once per geometry and evaluates them by cubic Hermite
+// interpolation, so per-cylinder work is a lookup and a few multiply-adds
+// instead of trig and a square root.
+//
+// A table either owns its samples or views ones stored elsewhere (a compiled
+// engine pack mapped from disk, see engine_pack.h); the layout is the same.
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct SliderCrank {
+    float crankRadius;
+    float rodLength;     // must exceed crankRadius
+    float rodRatio() const { return crankRadius / rodLength; }
+};
+
+// Exact reference, angle in radians; derivatives are per radian.
+double sliderCrankDisplacement(const SliderCrank& g, double theta);
+double sliderCrankVelocity(const SliderCrank& g, double theta);       // ds/dtheta
+double sliderCrankAcceleration(const SliderCrank& g, double theta);   // d2s/dtheta2
+
+struct PistonKinematics {
+    float pos;   // distance below TDC
+    float vel;   // per second, positive moving away from TDC
+    float acc;   // per second^2, at constant crank speed
+};
+
+class KinematicsTable {
+public:
+    // size is rounded up to a power of two (>= 16) samples per revolution.
+    explicit KinematicsTable(const SliderCrank& geometry, int size = 1024);
+    // Views sampleCount(size) floats built by an owning table of the same
+    // geometry and size (see samples()); they must outlive this table.
+    KinematicsTable(const SliderCrank& geometry, int size, const float* samples);
+    KinematicsTable(const KinematicsTable& other);
+    KinematicsTable& operator=(const KinematicsTable& other);
+
+    const SliderCrank& geometry() const { return geom; }
+    int size() const { return n; }
+    // Sample block: pos, dpos, ddpos, pinX, pinY, size + 1 floats each.
+    static size_t sampleCount(int size) { return (size_t)5 * (size + 1); }
+    const float* samples() const { return pos; }
+
+    // Any angle in degrees; the table wraps every 360.
+    float displacement(float angleDeg) const;
+    // Batch form for structure-of-arrays loops; out may alias angleDeg.
+    void displacements(const float* angleDeg, float* out, int count) const;
+    PistonKinematics evaluate(float angleDeg, float crankSpeedDegPerSec) const;
+    // Crank-pin offset from the crank centre: x = R sin theta, y = R cos theta
+    // (y points towards the cylinder).
+    void crankPin(float angleDeg, float& x, float& y) const;
+
+private:
+    void locate(float angleDeg, int& i, float& t) const;
+    void bind(const float* samples);
+
+    SliderCrank geom;
+    int n = 0;
+    float samplesPerDeg = 0.0f;
+    float h = 0.0f;            // sample spacing in radians
+    std::vector<float> owned;  // empty when viewing external samples
+    // size + 1 entries each, so sample i + 1 never needs wrapping.
+    const float* pos = nullptr;
+    const float* dpos = nullptr;
+    const float* ddpos = nullptr;
+    const float* pinX = nullptr;
+    const float* pinY = nullptr;
+};
@@ -0,0 +1,75 @@
+// engine_batch.cpp
+// Structure-of-arrays engine fleet (see engine_batch.h).
+
+#include "engine_batch.h"
+#include "crank_kinematics.h"
+#include "engine_config.h"
+#include "piston_kernels.h"
+#include "sim_snapshot.h"
+#include <cmath>
+
+EngineBatch::EngineBatch(int engines, int cylinders, const KinematicsTable& kinematics)
+    : kin(kinematics) {
+    engineCount = engines > 0 ? engines : 0;
+    cylCount = cylinders > 0 ? cylinders : 1;
+    rowStride = (engineCount + kBatchLane - 1) / kBatchLane * kBatchLane;
+    angle.assign(rowStride, 0.0f);
+    speed.assign(rowStride, 0.0f);
+    phase.resize((size_t)cylCount * rowStride);
+    pistonPos.assign((size_t)cylCount * rowStride, 0.0f);
+    kind.assign((size_t)cylCount * rowStride, 0);
+    for(int c=0;c<cylCount;c++){
+        float offset = c * 720.0f / cylCount;
+        for(int e=0;e<rowStride;e++) phase[(size_t)c * rowStride + e] = offset;
+    }
+    updateKinematics();
+}
+
+EngineBatch::EngineBatch(int engines, const EngineConfig& cfg, const KinematicsTable& kinematics)
+    : EngineBatch(engines, cfg.cylinders, kinematics) {
+    for(int c=0;c<cylCount && c<kMaxCylinders;c++)
+        for(int e=0;e<rowStride;e++) setPhaseOffset(e, c, cfg.phaseOffsetDeg[c]);
+    updateKinematics();
+}
+
+void EngineBatch::setEngine(int e, float crankAngleDeg, float crankSpeedDegPerSec) {
+    float a = fmodf(crankAngleDeg, 720.0f);
+    angle[e] = a < 0.0f ? a + 720.0f : a;
+    speed[e] = crankSpeedDegPerSec;
+}
+
+void EngineBatch::setPhaseOffset(int e, int cylinder, float offsetDeg) {
+    float a = fmodf(offsetDeg, 720.0f);
+    phase[(size_t)cylinder * rowStride + e] = a < 0.0f ? a + 720.0f : a;
+}
+
+void EngineBatch::step(float dtSec) {
+    float* __restrict a = angle.data();
+    const float* __restrict w = speed.data();
+    // Branch-free wrap; valid while one step moves less than 720 degrees.
+    for(int e=0;e<rowStride;e++){
+        float v = a[e] + w[e] * dtSec;
+        v -= 720.0f * (float)(v >= 720.0f);
+        v += 720.0f * (float)(v < 0.0f);
+        a[e] = v;
+    }
+    updateKinematics();
+}
+
+void EngineBatch::updateKinematics() {
+    const PistonKernels& k = pistonKernels();
+    const SliderCrank& g = kin.geometry();
+    for(int c=0;c<cylCount;c++){
+        size_t row = (size_t)c * rowStride;
+        k.evaluate(angle.data(), phase.data() + row, rowStride, g.crankRadius, g.rodLength,
+                   pistonPos.data() + row, kind.data() + row);
+    }
+}
+
+void EngineBatch::stateArrays(std::vector<StateArray>& out) {
+    out.push_back({ "batch.angle", angle.data(), angle.size() * sizeof(float) });
+    out.push_back({ "batch.speed", speed.data(), speed.size() * sizeof(float) });
+    out.push_back({ "batch.phase", phase.data(), phase.size() * sizeof(float) });
+    out.push_back({ "batch.piston", pistonPos.data(), pistonPos.size() * sizeof(float) });
+    out.push_back({ "batch.kind", kind.data(), kind.size() });
+}
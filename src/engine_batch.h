@@ -0,0 +1,71 @@
+// engine_batch.h
+// Many engines of one geometry in structure-of-arrays layout, for fleet
+// simulation without GL. Per-engine values (crank angle, speed) are one
+// contiguous array each; per-cylinder values (phase offset, piston position,
+// stroke phase) are stored cylinder-major, so row c holds cylinder c of every
+// engine back to back and each update is one piston_kernels pass per row.
+//
+// Rows are padded to a multiple of kBatchLane engines. Padding engines have
+// zero speed and are updated like the others, so loops never need a tail.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class KinematicsTable;
+struct EngineConfig;
+struct StateArray;
+
+const int kBatchLane = 16;
+
+class EngineBatch {
+public:
+    // cylinders per engine; phase offsets default to an even firing order
+    // (cylinder c at c * 720 / cylinders degrees). The batch keeps a
+    // reference to kinematics, which must outlive it; temporaries are
+    // rejected.
+    EngineBatch(int engines, int cylinders, const KinematicsTable& kinematics);
+    EngineBatch(int engines, int cylinders, KinematicsTable&&) = delete;
+    // Cylinder count and phase offsets from an engine description.
+    EngineBatch(int engines, const EngineConfig& cfg, const KinematicsTable& kinematics);
+    EngineBatch(int engines, const EngineConfig& cfg, KinematicsTable&&) = delete;
+
+    int size() const { return engineCount; }
+    int cylinders() const { return cylCount; }
+    int stride() const { return rowStride; }   // engines per row, including padding
+    const KinematicsTable& kinematics() const { return kin; }
+
+    void setEngine(int e, float crankAngleDeg, float crankSpeedDegPerSec);
+    void setPhaseOffset(int e, int cylinder, float offsetDeg);
+
+    // Advances every crank angle by speed * dt (wrapped to [0, 720)), then
+    // refreshes piston positions and stroke phases.
+    void step(float dtSec);
+    // Recomputes piston positions and phases from the current angles.
+    void updateKinematics();
+
+    // Raw rows for bulk consumers (telemetry, sweeps): index engine + row * stride().
+    float* crankAngles() { return angle.data(); }
+    float* crankSpeeds() { return speed.data(); }
+    const float* crankAngles() const { return angle.data(); }
+    const float* crankSpeeds() const { return speed.data(); }
+    const float* phaseOffsets(int cylinder) const { return phase.data() + (size_t)cylinder * rowStride; }
+    // Piston distance below TDC.
+    const float* pistonPositions(int cylinder) const { return pistonPos.data() + (size_t)cylinder * rowStride; }
+    // 0 intake, 1 compression, 2 power, 3 exhaust (as getPhaseKindForCylinder).
+    const uint8_t* phaseKinds(int cylinder) const { return kind.data() + (size_t)cylinder * rowStride; }
+
+    float pistonPosition(int e, int cylinder) const { return pistonPositions(cylinder)[e]; }
+    int phaseKind(int e, int cylinder) const { return phaseKinds(cylinder)[e]; }
+
+    // Every array of state, for snapshots (sim_snapshot.h).
+    void stateArrays(std::vector<StateArray>& out);
+
+private:
+    const KinematicsTable& kin;
+    int engineCount, cylCount, rowStride;
+    std::vector<float> angle, speed;              // [stride]
+    std::vector<float> phase, pistonPos;          // [cylinders * stride]
+    std::vector<uint8_t> kind;                    // [cylinders * stride]
+};
@@ -0,0 +1,1204 @@
+// engine_bench.cpp
+// Micro-benchmarks for the engine simulation helpers (no GL required).
+// Without arguments: the full exploratory report below. With --suite: the
+// fixed baseline set (kinematics, phase lookup, circle and rounded-rect
+// vertex generation, a display() frame and the landing page recorded into
+// a CommandList), each timed as repeated calibrated samples and summarised
+// as min / median / mean / stddev / MAD / p90 ns per op, optionally as JSON:
+//   engine_bench --suite [--json FILE|-] [--samples N] [--sample-ms MS] [--filter TEXT]
+// Compile (Linux / MinGW):
+//   g++ -O2 src/engine_bench.cpp src/engine_scene.cpp src/engine_config.cpp src/engine_pack.cpp src/mapped_file.cpp src/telemetry_stream.cpp src/telemetry_log.cpp src/telemetry_codec.cpp src/crank_kinematics.cpp src/engine_batch.cpp src/thermo_model.cpp src/crank_dynamics.cpp src/sim_snapshot.cpp src/piston_kernels.cpp src/cpu_features.cpp src/soft_raster.cpp src/span_kernels.cpp src/command_list.cpp src/tile_renderer.cpp src/thread_pool.cpp src/frame_profiler.cpp src/trace_export.cpp src/render_queue.cpp -o engine_bench -pthread
+// Windows MSVC:
+//   cl /EHsc /O2 /std:c++17 src\engine_bench.cpp src\engine_scene.cpp src\engine_config.cpp src\engine_pack.cpp src\mapped_file.cpp src\telemetry_stream.cpp src\telemetry_log.cpp src\telemetry_codec.cpp src\crank_kinematics.cpp src\engine_batch.cpp src\thermo_model.cpp src\crank_dynamics.cpp src\sim_snapshot.cpp src\piston_kernels.cpp src\cpu_features.cpp src\soft_raster.cpp src\span_kernels.cpp src\command_list.cpp src\tile_renderer.cpp src\thread_pool.cpp src\frame_profiler.cpp src\trace_export.cpp src\render_queue.cpp /Fe:engine_bench.exe
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "circle_table.h"
+#include "command_list.h"
+#include "crank_dynamics.h"
+#include "crank_kinematics.h"
+#include "engine_batch.h"
+#include "engine_config.h"
+#include "engine_geometry.h"
+#include "engine_pack.h"
+#include "engine_scene.h"
+#include "piston_kernels.h"
+#include "render_queue.h"
+#include "sim_snapshot.h"
+#include "soft_raster.h"
+#include "span_kernels.h"
+#include "telemetry_codec.h"
+#include "telemetry_log.h"
+#include "thermo_model.h"
+#include "thread_pool.h"
+#include "tile_renderer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifndef M_PI_2
+#define M_PI_2 1.57079632679489661923
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Timing helpers
+//////////////////////////////////////////////////////////////////////////
+using BenchClock = std::chrono::steady_clock;
+
+static double nsSince(BenchClock::time_point t0) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - t0).count();
+}
+
+// Keeps results observable so the optimizer cannot drop the work.
+static volatile float benchSink = 0.0f;
+
+//////////////////////////////////////////////////////////////////////////
+// Circle vertex generation: per-segment trig vs unit-circle tables
+//////////////////////////////////////////////////////////////////////////
+static long long trigCalls = 0;
+static float countedCos(float a) { ++trigCalls; return cosf(a); }
+static float countedSin(float a) { ++trigCalls; return sinf(a); }
+
+struct VertexSink {
+    std::vector<float> xy;
+    size_t n = 0;
+    void put(float x, float y) { xy[n++] = x; xy[n++] = y; }
+};
+
+// The pre-table drawCircle / drawRoundedRect corner loops.
+static void legacyCircle(VertexSink& out, float cx, float cy, float r, int segments) {
+    out.put(cx, cy);
+    for(int i=0;i<=segments;i++){
+        float a = (float)i/segments * 2.0f * M_PI;
+        out.put(cx + countedCos(a)*r, cy + countedSin(a)*r);
+    }
+}
+
+static void legacyCorner(VertexSink& out, float cx, float cy, float radius, int segments) {
+    out.put(cx, cy);
+    for(int i=0;i<=segments;i++){
+        float a = (float)i/segments * M_PI_2;
+        out.put(cx - countedCos(a) * radius, cy - countedSin(a) * radius);
+    }
+}
+
+static void tableCircle(VertexSink& out, float cx, float cy, float r, int segments) {
+    UnitCircleTable t = unitCircle(segments);
+    out.put(cx, cy);
+    for(int i=0;i<=t.segments;i++) out.put(cx + t.cosv[i]*r, cy + t.sinv[i]*r);
+}
+
+static void tableCorner(VertexSink& out, float cx, float cy, float radius, int segments) {
+    UnitCircleTable t = unitCircle(4 * segments);
+    out.put(cx, cy);
+    for(int i=0;i<=segments;i++){
+        int k = 2*segments + i;
+        out.put(cx + t.cosv[k] * radius, cy + t.sinv[k] * radius);
+    }
+}
+
+// One frame of circle work as issued by display() and drawLandingPage():
+// 4 cylinders x 6 combustion layers (22 segs), 4 crank pins (20), 4 crank
+// webs (24) and two rounded rects (4 corners x 12 segs each).
+template<class CircleFn, class CornerFn>
+static void frameCircles(VertexSink& out, CircleFn circle, CornerFn corner) {
+    out.n = 0;
+    for(int c=0;c<4;c++){
+        for(int l=0;l<6;l++) circle(out, 100.0f + c*170.0f + l*2.0f, 200.0f + l*4.0f, 18.0f + l*2.4f, 22);
+        circle(out, 100.0f + c*170.0f, 260.0f, 8.0f, 20);
+        circle(out, 100.0f + c*170.0f, 260.0f, 12.0f, 24);
+    }
+    for(int rr=0;rr<2;rr++)
+        for(int k=0;k<4;k++) corner(out, 300.0f + k*10.0f, 180.0f, 12.0f, 12);
+}
+
+static void benchCircleTables() {
+    VertexSink legacy, table;
+    legacy.xy.resize(8192);
+    table.xy.resize(8192);
+
+    trigCalls = 0;
+    frameCircles(legacy, legacyCircle, legacyCorner);
+    long long trigPerFrameLegacy = trigCalls;
+    trigCalls = 0;
+    frameCircles(table, tableCircle, tableCorner);
+    long long trigPerFrameTable = trigCalls;
+
+    float maxErr = 0.0f;
+    for(size_t i=0;i<legacy.n;i++) maxErr = std::max(maxErr, fabsf(legacy.xy[i] - table.xy[i]));
+
+    const int iters = 20000;
+    auto t0 = BenchClock::now();
+    for(int it=0;it<iters;it++){
+        frameCircles(legacy, legacyCircle, legacyCorner);
+        benchSink = benchSink + legacy.xy[legacy.n - 1];
+    }
+    double legacyNs = nsSince(t0) / iters;
+
+    t0 = BenchClock::now();
+    for(int it=0;it<iters;it++){
+        frameCircles(table, tableCircle, tableCorner);
+        benchSink = benchSink + table.xy[table.n - 1];
+    }
+    double tableNs = nsSince(t0) / iters;
+
+    printf("circle vertex generation (%zu vertices/frame)\n", legacy.n / 2);
+    printf("  per-segment trig : %8.0f ns/frame  %5lld trig calls/frame\n", legacyNs, trigPerFrameLegacy);
+    printf("  unit-circle table: %8.0f ns/frame  %5lld trig calls/frame\n", tableNs, trigPerFrameTable);
+    printf("  max vertex difference: %.2e px\n", maxErr);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Slider-crank kinematics: table accuracy and cost per evaluation
+//////////////////////////////////////////////////////////////////////////
+// The pre-table pistonPositionForCrank displacement (ignores the rod).
+static float legacyDisplacement(float angleDeg) {
+    float a = angleDeg * M_PI / 180.0f;
+    float R = crankRadius;
+    return R - R * cosf(a) + (1.0f - cosf(a)) * (R*0.15f);
+}
+
+static void benchKinematics() {
+    const SliderCrank geom = { crankRadius, conRodLen };
+    const double toRad = M_PI / 180.0;
+    const float speed = 3000.0f * 6.0f;   // 3000 rpm in deg/s
+    const double w = speed * toRad;
+    const int probes = 100000;
+
+    printf("slider-crank kinematics (R %.0f, L %.0f, rod ratio %.3f; errors at 3000 rpm over %d angles)\n",
+           geom.crankRadius, geom.rodLength, geom.rodRatio(), probes);
+    double legacyErr = 0.0;
+    for(int p=0;p<probes;p++){
+        double deg = p * 720.0 / probes;
+        legacyErr = std::max(legacyErr, fabs(legacyDisplacement((float)deg) - sliderCrankDisplacement(geom, deg * toRad)));
+    }
+    printf("  legacy formula      : max |pos err| %.3e\n", legacyErr);
+
+    const int sizes[] = { 64, 128, 256, 512, 1024, 2048, 4096 };
+    for(int size: sizes){
+        KinematicsTable table(geom, size);
+        double posErr = 0.0, velErr = 0.0, accErr = 0.0;
+        for(int p=0;p<probes;p++){
+            double deg = p * 720.0 / probes + 0.123;
+            PistonKinematics k = table.evaluate((float)deg, speed);
+            posErr = std::max(posErr, fabs(k.pos - sliderCrankDisplacement(geom, deg * toRad)));
+            velErr = std::max(velErr, fabs(k.vel - sliderCrankVelocity(geom, deg * toRad) * w));
+            accErr = std::max(accErr, fabs(k.acc - sliderCrankAcceleration(geom, deg * toRad) * w * w));
+        }
+        double accPeak = fabs(sliderCrankAcceleration(geom, 0.0)) * w * w;
+        printf("  table %5d (%3zu KB): max |pos err| %.3e  |vel err| %.3e  |acc err| %.3e (%.4f%% of peak)\n",
+               size, (size_t)(size + 1) * 5 * sizeof(float) / 1024, posErr, velErr, accErr, 100.0 * accErr / accPeak);
+    }
+
+    // ns per evaluation over a sweep of 4 cylinders at 180 degree offsets.
+    const int iters = 2000000;
+    KinematicsTable table(geom);
+    float acc = 0.0f;
+    auto t0 = BenchClock::now();
+    for(int it=0;it<iters;it++) acc += legacyDisplacement(it * 0.37f + (it & 3) * 180.0f);
+    double legacyNs = nsSince(t0) / iters;
+    t0 = BenchClock::now();
+    for(int it=0;it<iters;it++) acc += (float)sliderCrankDisplacement(geom, (it * 0.37 + (it & 3) * 180.0) * toRad);
+    double exactNs = nsSince(t0) / iters;
+    t0 = BenchClock::now();
+    for(int it=0;it<iters;it++) acc += table.displacement(it * 0.37f + (it & 3) * 180.0f);
+    double tableNs = nsSince(t0) / iters;
+    t0 = BenchClock::now();
+    for(int it=0;it<iters;it++){
+        PistonKinematics k = table.evaluate(it * 0.37f + (it & 3) * 180.0f, speed);
+        acc += k.pos + k.vel + k.acc;
+    }
+    double fullNs = nsSince(t0) / iters;
+    benchSink = benchSink + acc;
+    printf("  legacy position     : %6.2f ns/eval\n", legacyNs);
+    printf("  exact position (f64): %6.2f ns/eval\n", exactNs);
+    printf("  table position      : %6.2f ns/eval  (%d samples)\n", tableNs, table.size());
+    printf("  table pos+vel+acc   : %6.2f ns/eval\n", fullNs);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Piston position + phase kernels vs the per-cylinder scalar functions
+//////////////////////////////////////////////////////////////////////////
+static void benchPistonKernels() {
+    const int n = 1 << 16;
+    const SliderCrank geom = { crankRadius, conRodLen };
+    std::vector<float> crank(n), offset(n), pos(n);
+    std::vector<uint8_t> kind(n);
+    std::vector<int> refKind(n);
+    for(int i=0;i<n;i++){
+        crank[i] = fmodf(i * 0.731f, 720.0f);
+        offset[i] = (i & 3) * 180.0f;
+    }
+    for(int i=0;i<n;i++) refKind[i] = getPhaseKindForCylinder(crank[i], offset[i]);
+
+    printf("piston position + phase kernels (%d cylinders per pass)\n", n);
+    const int iters = 200;
+    auto t0 = BenchClock::now();
+    for(int it=0;it<iters;it++){
+        for(int i=0;i<n;i++){
+            pos[i] = pistonPositionForCrank(0.0f, crank[i], offset[i]);
+            kind[i] = (uint8_t)getPhaseKindForCylinder(crank[i], offset[i]);
+        }
+        benchSink = benchSink + pos[it & (n - 1)];
+    }
+    double scalarNs = nsSince(t0) / iters;
+    printf("  per-cylinder functions: %8.1f M cyl/s\n", n / scalarNs * 1e3);
+
+    const PistonIsa isas[3] = { PistonIsa::Scalar, PistonIsa::AVX2, PistonIsa::NEON };
+    for(PistonIsa isa: isas){
+        if(!pistonIsaSupported(isa)) {
+            printf("  %-6s kernel         : not supported on this target\n", pistonIsaName(isa));
+            continue;
+        }
+        const PistonKernels& k = pistonKernelsFor(isa);
+        k.evaluate(crank.data(), offset.data(), n, geom.crankRadius, geom.rodLength, pos.data(), kind.data());
+        double maxErr = 0.0;
+        int mismatches = 0;
+        for(int i=0;i<n;i++){
+            double a = fmod((double)crank[i] + offset[i], 720.0) * (M_PI / 180.0);
+            maxErr = std::max(maxErr, fabs(pos[i] - sliderCrankDisplacement(geom, a)));
+            mismatches += kind[i] != refKind[i];
+        }
+        t0 = BenchClock::now();
+        for(int it=0;it<iters;it++){
+            k.evaluate(crank.data(), offset.data(), n, geom.crankRadius, geom.rodLength, pos.data(), kind.data());
+            benchSink = benchSink + pos[it & (n - 1)];
+        }
+        double ns = nsSince(t0) / iters;
+        printf("  %-6s kernel         : %8.1f M cyl/s  x%.2f  (max |pos err| %.1e, %d phase mismatches)\n",
+               pistonIsaName(isa), n / ns * 1e3, scalarNs / ns, maxErr, mismatches);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Engine fleets: SoA EngineBatch vs one engine at a time
+//////////////////////////////////////////////////////////////////////////
+struct ScalarEngine {
+    float angle, speed;
+    float pistonPos[kMaxCylinders];      // distance below TDC
+    int kind[kMaxCylinders];
+};
+
+static void benchEngineBatch(const char* preset) {
+    EngineConfig cfg;
+    engineConfigPreset(preset, cfg);
+    const int numCyl = cfg.cylinders;
+    const float* phase = cfg.phaseOffsetDeg;
+    printf("engine fleet update (%s, %d cylinders, one 10 kHz step per iteration)\n", preset, numCyl);
+    KinematicsTable kin(engineSliderCrank(cfg));
+    const float dt = 1.0f / 10000.0f;
+    const int counts[] = { 1000, 4096, 16384 };
+    for(int engines: counts){
+        std::vector<ScalarEngine> scalar(engines);
+        EngineBatch batch(engines, cfg, kin);
+        for(int e=0;e<engines;e++){
+            float a0 = (e * 37) % 720, w = 600.0f + (e % 97) * 60.0f;
+            scalar[e].angle = a0;
+            scalar[e].speed = w;
+            batch.setEngine(e, a0, w);
+        }
+
+        const int iters = std::max(20, 4000000 / (engines * numCyl));
+        auto t0 = BenchClock::now();
+        for(int it=0;it<iters;it++){
+            for(ScalarEngine& s: scalar){
+                s.angle += s.speed * dt;
+                if(s.angle > 720.0f) s.angle = fmodf(s.angle, 720.0f);
+                for(int c=0;c<numCyl;c++){
+                    s.pistonPos[c] = kin.displacement(s.angle + phase[c]);
+                    s.kind[c] = getPhaseKindForCylinder(s.angle, phase[c]);
+                }
+            }
+        }
+        double scalarNs = nsSince(t0) / iters;
+
+        t0 = BenchClock::now();
+        for(int it=0;it<iters;it++) batch.step(dt);
+        double batchNs = nsSince(t0) / iters;
+
+        float maxDiff = 0.0f;
+        int kindMismatch = 0;
+        for(int e=0;e<engines;e++)
+            for(int c=0;c<numCyl;c++){
+                maxDiff = std::max(maxDiff, fabsf(scalar[e].pistonPos[c] - batch.pistonPosition(e, c)));
+                kindMismatch += scalar[e].kind[c] != batch.phaseKind(e, c);
+            }
+        double cyl = (double)engines * numCyl;
+        printf("  %6d engines: per-engine %7.1f M cyl/s  EngineBatch %7.1f M cyl/s  x%.2f"
+               "  (max pos diff %.1e, %d phase mismatches)\n",
+               engines, cyl / scalarNs * 1e3, cyl / batchNs * 1e3, scalarNs / batchNs, maxDiff, kindMismatch);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Crank dynamics: integration schemes at a fixed accuracy
+//////////////////////////////////////////////////////////////////////////
+struct DynamicsRun {
+    std::vector<float> angle, speed;   // final state per engine
+    uint64_t steps = 0;
+    double ns = 0.0;
+};
+
+// Spins engines up from 1500 rpm on 800 J/cycle against the default fan
+// load for seconds of simulated time on a 1 kHz outer step.
+static DynamicsRun runDynamics(const ThermoModel& model, int engines, CrankIntegrator scheme, double fineDeg,
+                               double coarseDeg, double seconds) {
+    const ThermoSpec& s = model.spec();
+    KinematicsTable kin({ (float)(s.stroke * 0.5), (float)s.rodLength });
+    EngineBatch batch(engines, 4, kin);
+    for(int e=0;e<engines;e++) batch.setEngine(e, (float)((e * 37) % 720), 9000.0f);
+    batch.updateKinematics();
+    ThermoBatch thermo(model, batch, 800.0f);
+    DynamicsSpec spec;
+    spec.fineStepDeg = fineDeg;
+    spec.coarseStepDeg = coarseDeg;
+    CrankDynamics dyn(model, batch, spec);
+    const float dt = 1.0f / 1000.0f;
+    int outer = (int)lround(seconds / dt);
+    DynamicsRun run;
+    auto t0 = BenchClock::now();
+    for(int i=0;i<outer;i++){
+        run.steps += dyn.advance(batch, thermo, dt, scheme);
+        thermo.advance(batch);
+    }
+    run.ns = nsSince(t0);
+    run.angle.assign(batch.crankAngles(), batch.crankAngles() + engines);
+    run.speed.assign(batch.crankSpeeds(), batch.crankSpeeds() + engines);
+    return run;
+}
+
+static void benchDynamics() {
+    ThermoModel model;
+    const int probeEngines = 32, engines = 4096;
+    const double seconds = 1.0, tolDeg = 0.05;
+    auto t0 = BenchClock::now();
+    DynamicsRun ref = runDynamics(model, probeEngines, CrankIntegrator::RK4, 0.05, 0.05, seconds);
+    printf("crank dynamics (4 cyl, 800 J/cycle, fan load, 1500 rpm start, 1 kHz outer step)\n");
+    printf("  reference RK4 at 0.05 deg: %.0f rpm after %.1f s (%.0f ms)\n", ref.speed[0] / 6.0, seconds,
+           nsSince(t0) * 1e-6);
+
+    struct Candidate { const char* name; CrankIntegrator scheme; bool adaptive; };
+    const Candidate candidates[3] = {
+        { "semi-implicit Euler", CrankIntegrator::SemiImplicitEuler, false },
+        { "RK4, fixed         ", CrankIntegrator::RK4, false },
+        { "RK4, adaptive      ", CrankIntegrator::RK4, true },
+    };
+    const double ladder[8] = { 8.0, 4.0, 2.0, 1.0, 0.5, 0.25, 0.125, 0.0625 };
+    printf("  cheapest crank-angle step within %.2f deg of the reference after %.1f s:\n", tolDeg, seconds);
+    for(const Candidate& c: candidates){
+        for(double step: ladder){
+            // Adaptive runs take 4x longer steps outside the firing windows.
+            double fine = step;
+            double coarse = c.adaptive ? step * 4.0 : step;
+            DynamicsRun probe = runDynamics(model, probeEngines, c.scheme, fine, coarse, seconds);
+            double angleErr = 0.0, rpmErr = 0.0;
+            for(int e=0;e<probeEngines;e++){
+                double d = fabs(probe.angle[e] - ref.angle[e]);
+                angleErr = std::max(angleErr, std::min(d, 720.0 - d));
+                rpmErr = std::max(rpmErr, fabs(probe.speed[e] - ref.speed[e]) / 6.0);
+            }
+            if(angleErr > tolDeg && step != ladder[7]) continue;
+            DynamicsRun timed = runDynamics(model, engines, c.scheme, fine, coarse, seconds * 0.25);
+            double stepsPerSec = timed.steps / (timed.ns * 1e-9);
+            printf("    %s  %5.3f/%-5.3f deg: err %.3f deg %.3f rpm  %5.0f steps/engine-s  %5.1f M steps/s"
+                   "  %5.0f engine-s/s%s\n",
+                   c.name, fine, coarse, angleErr, rpmErr, (double)timed.steps / engines / (seconds * 0.25),
+                   stepsPerSec * 1e-6, engines * seconds * 0.25 / (timed.ns * 1e-9),
+                   angleErr > tolDeg ? "  (finest tried, not within tolerance)" : "");
+            break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Snapshots: spin-up vs restore, and forked fuel variants
+//////////////////////////////////////////////////////////////////////////
+struct SnapshotFleet {
+    EngineBatch batch;
+    ThermoBatch thermo;
+    CrankDynamics dyn;
+
+    SnapshotFleet(const ThermoModel& model, const KinematicsTable& kin, int engines)
+        : batch(engines, 4, kin), thermo(model, batch, 800.0f), dyn(model, batch) {}
+
+    std::vector<StateArray> state() {
+        std::vector<StateArray> arrays;
+        batch.stateArrays(arrays);
+        thermo.stateArrays(arrays);
+        dyn.stateArrays(arrays);
+        return arrays;
+    }
+
+    void run(double seconds) {
+        const float dt = 1.0f / 1000.0f;
+        for(int i=0;i<(int)lround(seconds / dt);i++){
+            dyn.advance(batch, thermo, dt, CrankIntegrator::RK4);
+            thermo.advance(batch);
+        }
+    }
+};
+
+static void benchSnapshot() {
+    ThermoModel model;
+    const ThermoSpec& s = model.spec();
+    KinematicsTable kin({ (float)(s.stroke * 0.5), (float)s.rodLength });
+    const int engines = 4096, variants = 16;
+    const double spinUp = 0.25, measure = 0.02;
+
+    // Spin-up from 1500 rpm: what every sweep point pays without snapshots.
+    SnapshotFleet warm(model, kin, engines);
+    for(int e=0;e<engines;e++) warm.batch.setEngine(e, (float)((e * 37) % 720), 9000.0f);
+    warm.batch.updateKinematics();
+    auto t0 = BenchClock::now();
+    warm.run(spinUp);
+    double spinNs = nsSince(t0);
+
+    SimSnapshot base;
+    t0 = BenchClock::now();
+    base.capture(0, warm.state());
+    double captureNs = nsSince(t0);
+    const char* path = "engine_bench_state.snap";
+    std::string error;
+    SimSnapshot loaded;
+    t0 = BenchClock::now();
+    bool ok = base.save(path, error);
+    double saveNs = nsSince(t0);
+    t0 = BenchClock::now();
+    ok = ok && loaded.load(path, error);
+    double loadNs = nsSince(t0);
+    if(!ok) {
+        printf("snapshot: %s\n", error.c_str());
+        return;
+    }
+
+    // Fuel variants of the warm fleet: each fork copies only thermo.fuel.
+    std::vector<SimSnapshot> forks;
+    t0 = BenchClock::now();
+    for(int v=0;v<variants;v++){
+        forks.push_back(loaded.fork());
+        size_t bytes;
+        float* fuel = (float*)forks.back().edit(0, "thermo.fuel", &bytes);
+        for(size_t e=0;e<bytes / sizeof(float);e++) fuel[e] = 500.0f + 40.0f * v;
+    }
+    double forkNs = nsSince(t0);
+
+    SnapshotFleet fleet(model, kin, engines);
+    double restoreNs = 0.0;
+    bool exact = true;
+    for(int v=0;v<variants && exact;v++){
+        t0 = BenchClock::now();
+        exact = forks[v].restore(0, fleet.state(), error);
+        restoreNs += nsSince(t0);
+        fleet.run(measure);
+    }
+    // Resuming must match running straight through.
+    SnapshotFleet resumed(model, kin, engines);
+    exact = exact && loaded.restore(0, resumed.state(), error);
+    resumed.run(measure);
+    warm.run(measure);
+    SimSnapshot check;
+    check.capture(0, resumed.state());
+    for(const StateArray& a: warm.state()){
+        size_t bytes;
+        const uint8_t* r = check.find(0, a.name, &bytes);
+        exact = exact && r && bytes == a.bytes && memcmp(r, a.data, bytes) == 0;
+    }
+    remove(path);
+
+    size_t shared = 0;
+    for(const SimSnapshot& f: forks) shared += f.sharedBytes(loaded);
+    printf("snapshots (%d engines x 4 cyl, RK4 dynamics, %.1f KB of state)\n", engines, base.bytes() / 1024.0);
+    printf("  spin-up %.1f s simulated: %8.2f ms\n", spinUp, spinNs * 1e-6);
+    printf("  capture %.3f ms  save %.3f ms  load (mapped) %.3f ms  restore %.3f ms per fleet\n", captureNs * 1e-6,
+           saveNs * 1e-6, loadNs * 1e-6, restoreNs / variants * 1e-6);
+    printf("  %d fuel forks in %.3f ms, %.1f%% of their state shared with the base; resume %s\n", variants,
+           forkNs * 1e-6, 100.0 * shared / (loaded.bytes() * (double)variants),
+           exact ? "bit-exact" : "DIFFERS");
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Engine descriptions: text parsing vs compiled, memory-mapped pack
+//////////////////////////////////////////////////////////////////////////
+static void benchEnginePack() {
+    // Variants of a few base engines over a stroke / rod grid; about one
+    // distinct geometry per 16 engines, as in a parameter sweep.
+    const char* bases[4] = { "inline-4", "v8", "boxer-6", "v12" };
+    const int variants = 4096;
+    std::string text;
+    char line[160];
+    for(int i=0;i<variants;i++){
+        snprintf(line, sizeof(line), "[variant-%05d]\nbase = %s\nstroke = %.1f\nrod_length = %.1f\ncompression_ratio = %.2f\n\n",
+                 i, bases[i & 3], 70.0 + (i / 16) % 16 * 2.0, 130.0 + (i / 256) * 3.0, 9.0 + (i % 16) * 0.25);
+        text += line;
+    }
+    const char* path = "engine_bench_variants.epk";
+    std::vector<EngineConfig> engines;
+    std::string error;
+
+    // Cold path as a tool would do it at startup: parse, then build each table.
+    auto t0 = BenchClock::now();
+    parseEngineConfigs(text.c_str(), "variants", engines, error);
+    double parseMs = nsSince(t0) * 1e-6;
+    t0 = BenchClock::now();
+    float acc = 0.0f;
+    for(const EngineConfig& cfg: engines) acc += KinematicsTable(engineSliderCrank(cfg)).displacement(33.0f);
+    double buildMs = nsSince(t0) * 1e-6;
+
+    t0 = BenchClock::now();
+    if(!writeEnginePack(path, engines, 1024, error)) {
+        printf("engine pack: %s\n", error.c_str());
+        return;
+    }
+    double writeMs = nsSince(t0) * 1e-6;
+
+    // Warm path: map, then per engine a config copy and a table view.
+    t0 = BenchClock::now();
+    EnginePack pack;
+    pack.open(path, error);
+    double openUs = nsSince(t0) * 1e-3;
+    t0 = BenchClock::now();
+    for(int i=0;i<pack.size();i++){
+        EngineConfig cfg = pack.config(i);
+        acc += pack.kinematics(i).displacement(33.0f) + cfg.cylinders;
+    }
+    double useMs = nsSince(t0) * 1e-6;
+    t0 = BenchClock::now();
+    int found = 0;
+    for(int i=0;i<variants;i+=7){
+        snprintf(line, sizeof(line), "variant-%05d", i);
+        found += pack.find(line) >= 0;
+    }
+    double findNs = nsSince(t0) / ((variants + 6) / 7);
+    benchSink = acc;
+
+    // Pack tables must match freshly built ones exactly.
+    int mismatches = 0;
+    for(int i=0;i<pack.size();i+=97){
+        KinematicsTable fresh(engineSliderCrank(pack.config(i)), pack.tableSize());
+        KinematicsTable view = pack.kinematics(i);
+        mismatches += memcmp(fresh.samples(), view.samples(), KinematicsTable::sampleCount(fresh.size()) * sizeof(float)) != 0;
+    }
+    int tables = pack.tableCount();
+    long packBytes = (long)(tables * (size_t)KinematicsTable::sampleCount(pack.tableSize()) * sizeof(float))
+                     + pack.size() * (long)sizeof(EnginePackEntry);
+    pack.close();
+    remove(path);
+
+    printf("engine descriptions (%d variants, %d distinct geometries, ~%ld KB pack)\n", variants, tables,
+           packBytes / 1024);
+    printf("  text: parse %.2f ms + build tables %.2f ms    compile to pack %.2f ms\n", parseMs, buildMs, writeMs);
+    printf("  pack: open %.1f us + configs and table views %.2f ms   lookup by name %.0f ns (%d found)"
+           "  x%.0f faster than text  (%d table mismatches)\n",
+           openUs, useMs, findNs, found, (parseMs + buildMs) / (openUs * 1e-3 + useMs), mismatches);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Telemetry: stream vs chunked log, full scan vs indexed time window
+//////////////////////////////////////////////////////////////////////////
+// Fills rows of angle / piston / phase for a fleet and returns the write time.
+static double writeTelemetry(TelemetrySink& sink, int engines, int cylinders, int samples) {
+    auto t0 = BenchClock::now();
+    for(int done=0;done<samples;){
+        int rows = std::min(sink.blockSamples() - sink.pendingRows(), samples - done);
+        for(int r=0;r<rows;r++){
+            float* angle = (float*)sink.column(0, r);
+            float* piston = (float*)sink.column(1, r);
+            uint8_t* phase = sink.column(2, r);
+            for(int e=0;e<engines;e++){
+                float a = fmodf((done + r) * 1.8f + e * 37.0f, 720.0f);
+                angle[e] = a;
+                for(int c=0;c<cylinders;c++){
+                    piston[e * cylinders + c] = a * 0.01f + c;
+                    phase[e * cylinders + c] = (uint8_t)((int)(a + c * 90.0f) / 180 % 4);
+                }
+            }
+        }
+        sink.endRows(rows);
+        done += rows;
+    }
+    sink.close();
+    return nsSince(t0) * 1e-6;
+}
+
+static void benchTelemetryLog() {
+    const int engines = 256, cylinders = 8, samples = 20000, chunkRows = 1000;
+    TelemetryHeader header = {};
+    header.engines = engines;
+    header.cylinders = cylinders;
+    header.sampleHz = 10000.0;
+    snprintf(header.engineName, sizeof(header.engineName), "bench");
+    const char* names[3] = { "crank_angle_deg", "piston_y", "phase" };
+    std::vector<TelemetryColumn> columns(3);
+    for(int i=0;i<3;i++){
+        memset(&columns[i], 0, sizeof(TelemetryColumn));
+        snprintf(columns[i].name, sizeof(columns[i].name), "%s", names[i]);
+        columns[i].type = (uint8_t)(i == 2 ? TelemetryType::U8 : TelemetryType::F32);
+        columns[i].scope = (uint8_t)(i == 0 ? TelemetryScope::Engine : TelemetryScope::Cylinder);
+    }
+    const char* streamPath = "engine_bench_telemetry.etl";
+    const char* logPath = "engine_bench_telemetry.elog";
+    std::string error;
+    TelemetryWriter stream;
+    TelemetryLogWriter log;
+    if(!stream.open(streamPath, header, columns, chunkRows, error) || !log.open(logPath, header, columns, chunkRows, error)) {
+        printf("telemetry: %s\n", error.c_str());
+        return;
+    }
+    double streamMs = writeTelemetry(stream, engines, cylinders, samples);
+    double logMs = writeTelemetry(log, engines, cylinders, samples);
+    double mb = (double)samples * engines * (4 + cylinders * 5) / 1048576.0;
+
+    // Mean piston position over everything, then over a 1% time window.
+    TelemetryReader reader;
+    reader.open(streamPath, error);
+    auto t0 = BenchClock::now();
+    double sum = 0.0;
+    while(reader.nextBlock(error)){
+        const float* piston = (const float*)reader.column(1);
+        for(size_t i=0;i<(size_t)reader.block().samples * engines * cylinders;i++) sum += piston[i];
+    }
+    double scanMs = nsSince(t0) * 1e-6;
+    reader.close();
+
+    TelemetryLog logReader;
+    logReader.open(logPath, error);
+    t0 = BenchClock::now();
+    uint64_t first = 0, last = 0;
+    double t = samples / header.sampleHz;
+    logReader.chunksInTime(0.5 * t, 0.51 * t, first, last);
+    double windowSum = 0.0;
+    for(uint64_t k=first;k<last;k++){
+        const float* piston = (const float*)logReader.column(k, 1);
+        for(size_t i=0;i<(size_t)logReader.chunk(k).rows * engines * cylinders;i++) windowSum += piston[i];
+    }
+    double windowUs = nsSince(t0) * 1e-3;
+    benchSink = (float)(sum + windowSum);
+    logReader.close();
+    remove(streamPath);
+    remove(logPath);
+
+    printf("telemetry (%d engines x %d cylinders, %d samples, %.0f MB)\n", engines, cylinders, samples, mb);
+    printf("  write: stream %.1f ms (%.0f MB/s)   mapped log %.1f ms (%.0f MB/s)\n", streamMs, mb / (streamMs * 1e-3),
+           logMs, mb / (logMs * 1e-3));
+    printf("  read piston: full stream scan %.1f ms   1%% window via chunk index %.0f us (%llu chunks)\n", scanMs,
+           windowUs, (unsigned long long)(last - first));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Telemetry column codec: ratio, encode and decode throughput
+//////////////////////////////////////////////////////////////////////////
+static void benchTelemetryCodec() {
+    // One chunk of a 64-engine inline-4 fleet sampled at 10 kHz, 2700-3300 rpm.
+    const int engines = 64, cylinders = 4, rows = 8192;
+    const double sampleHz = 10000.0;
+    SliderCrank g = { 0.043f, 0.145f };
+    std::vector<float> angle((size_t)rows * engines), piston((size_t)rows * cylinders * engines);
+    std::vector<uint8_t> phase(piston.size());
+    for(int r=0;r<rows;r++){
+        for(int e=0;e<engines;e++){
+            double rpm = 2700.0 + 600.0 * e / (engines - 1);
+            double a = fmod(e * 37.0 + r * rpm * 6.0 / sampleHz, 720.0);
+            angle[(size_t)r * engines + e] = (float)a;
+            for(int c=0;c<cylinders;c++){
+                double ca = fmod(a + c * 180.0, 720.0);
+                size_t i = ((size_t)r * cylinders + c) * engines + e;
+                piston[i] = (float)sliderCrankDisplacement(g, ca * M_PI / 180.0);
+                phase[i] = (uint8_t)(ca / 180.0);
+            }
+        }
+    }
+    struct Case { const char* name; const uint8_t* data; TelemetryType type; size_t width; float quantum; };
+    const Case cases[] = {
+        { "crank angle", (const uint8_t*)angle.data(), TelemetryType::F32, (size_t)engines, 0.0f },
+        { "crank angle +-0.001", (const uint8_t*)angle.data(), TelemetryType::F32, (size_t)engines, 0.002f },
+        { "piston", (const uint8_t*)piston.data(), TelemetryType::F32, (size_t)engines * cylinders, 0.0f },
+        { "piston +-1e-6", (const uint8_t*)piston.data(), TelemetryType::F32, (size_t)engines * cylinders, 2e-6f },
+        { "phase", phase.data(), TelemetryType::U8, (size_t)engines * cylinders, 0.0f },
+    };
+
+    printf("telemetry codec (%d rows of %d engines x %d cylinders, 10 kHz)\n", rows, engines, cylinders);
+    TelemetryEncoder encoder;
+    TelemetryDecoder decoder;
+    const CodecIsa best = codecIsa();
+    for(const Case& k: cases){
+        TelemetryColumn col = {};
+        col.type = (uint8_t)k.type;
+        col.codec = (uint8_t)TelemetryCodec::Delta;
+        col.quantum = k.quantum;
+        size_t values = (size_t)rows * k.width;
+        size_t rawBytes = values * (k.type == TelemetryType::U8 ? 1 : 4);
+        std::vector<uint8_t> enc(telemetryEncodedBound(values)), dec(rawBytes);
+
+        const int iters = 10;
+        auto t0 = BenchClock::now();
+        size_t bytes = 0;
+        for(int i=0;i<iters;i++) bytes = encoder.encode(col, k.data, rows, k.width, enc.data());
+        double encodeMBs = rawBytes * iters / (nsSince(t0) * 1e-9) / 1048576.0;
+
+        double decodeGBs[3] = {};
+        bool ok = true;
+        const CodecIsa isas[3] = { CodecIsa::Scalar, CodecIsa::AVX2, CodecIsa::NEON };
+        for(int v=0;v<3;v++){
+            if(!codecIsaSupported(isas[v])) continue;
+            forceCodecIsa(isas[v]);
+            t0 = BenchClock::now();
+            for(int i=0;i<iters * 4;i++) ok = decoder.decode(col, enc.data(), bytes, rows, k.width, dec.data()) && ok;
+            decodeGBs[v] = rawBytes * iters * 4 / (nsSince(t0) * 1e-9) * 1e-9;
+        }
+        forceCodecIsa(best);
+
+        // Lossless columns must come back bit for bit, quantized ones within quantum / 2.
+        double maxErr = 0.0;
+        if(k.type == TelemetryType::F32) {
+            const float* a = (const float*)k.data;
+            const float* b = (const float*)dec.data();
+            for(size_t i=0;i<values;i++) maxErr = std::max(maxErr, (double)fabsf(a[i] - b[i]));
+        } else {
+            for(size_t i=0;i<values;i++) maxErr = std::max(maxErr, (double)abs(k.data[i] - dec[i]));
+        }
+        printf("  %-20s %5.1fx (order %d)  encode %5.0f MB/s  decode scalar %5.2f GB/s", k.name,
+               (double)rawBytes / bytes, ((const TelemetryCodecHeader*)enc.data())->order, encodeMBs, decodeGBs[0]);
+        if(decodeGBs[1] > 0.0) printf("  avx2 %5.2f GB/s", decodeGBs[1]);
+        if(decodeGBs[2] > 0.0) printf("  neon %5.2f GB/s", decodeGBs[2]);
+        printf("  max error %.3g%s\n", maxErr, ok ? "" : "  DECODE FAILED");
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Thermodynamic cylinder model: cycle figures and fleet throughput
+//////////////////////////////////////////////////////////////////////////
+static void benchThermo() {
+    const float fuelJ = 800.0f;
+    auto t0 = BenchClock::now();
+    ThermoModel model;
+    double buildMs = nsSince(t0) * 1e-6;
+    const ThermoSpec& s = model.spec();
+    int n = model.samples();
+    int peakK = 0;
+    double meanTorque = 0.0;
+    for(int k=0;k<n;k++){
+        if(model.steadyPressure(k, fuelJ) > model.steadyPressure(peakK, fuelJ)) peakK = k;
+        meanTorque += model.torque(k, model.steadyPressure(k, fuelJ));
+    }
+    meanTorque /= n;
+    double work = model.steadyWork(fuelJ);
+    double otto = 1.0 - pow(s.compressionRatio, 1.0 - s.polyExpansion);
+    printf("thermo model (%.1f deg, %d samples, built in %.2f ms)\n", model.resolutionDeg(), n, buildMs);
+    printf("  %.0f J/cycle: IMEP %.2f bar  work %.1f J  efficiency %.1f%% (Otto at n=%.2f: %.1f%%)\n",
+           fuelJ, model.imep(fuelJ) * 1e-5, work, work / fuelJ * 100.0, s.polyExpansion, otto * 100.0);
+    printf("  peak %.1f bar at %.1f deg  mean torque %.2f N m (work / 4 pi = %.2f)\n",
+           model.steadyPressure(peakK, fuelJ) * 1e-5, peakK * model.resolutionDeg(), meanTorque, work / (4.0 * M_PI));
+
+    // Fleet at 3000 rpm (18000 deg/s) on a 10 kHz step: 1.8 degrees = 18 samples per step.
+    const int engines = 4096, cyl = 4;
+    const float dt = 1.0f / 10000.0f;
+    KinematicsTable kin({ (float)(s.stroke * 0.5), (float)s.rodLength });
+    EngineBatch batch(engines, cyl, kin);
+    for(int e=0;e<engines;e++) batch.setEngine(e, (e * 37) % 720, 18000.0f);
+    ThermoBatch thermo(model, batch, fuelJ);
+    const int iters = 400;
+    double batchNs = 0.0;
+    for(int it=0;it<iters;it++){
+        batch.step(dt);
+        t0 = BenchClock::now();
+        thermo.advance(batch);
+        batchNs += nsSince(t0);
+    }
+    benchSink = thermo.torques()[0];
+    batchNs /= iters;
+
+    // Reference: integrate every sample the step passes over.
+    const ThermoStep* steps = model.steps();
+    std::vector<float> p((size_t)engines * cyl, (float)s.exhaustPressure);
+    std::vector<int> k((size_t)engines * cyl, 0);
+    int per = (int)lroundf(18000.0f * dt / model.resolutionDeg());
+    t0 = BenchClock::now();
+    for(int it=0;it<iters / 8;it++)
+        for(size_t i=0;i<p.size();i++)
+            for(int j=0;j<per;j++){
+                const ThermoStep& st = steps[k[i]];
+                p[i] = p[i] * st.keep + st.target + fuelJ * st.heat;
+                k[i] = k[i] + 1 == n ? 0 : k[i] + 1;
+            }
+    double integrateNs = nsSince(t0) / (iters / 8);
+    benchSink = p[0];
+
+    double cylPerStep = (double)engines * cyl;
+    double stepsPerSec = 1e9 / batchNs;
+    printf("  %d engines x %d cyl, 3000 rpm, 10 kHz: ThermoBatch %.1f M cyl/s, per-sample integration %.1f M cyl/s"
+           "  x%.1f\n", engines, cyl, cylPerStep / batchNs * 1e3, cylPerStep / integrateNs * 1e3, integrateNs / batchNs);
+    printf("  real-time capacity: %.0f engines per core\n", stepsPerSec * engines / 10000.0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Software rasterizer: full animation frame per span ISA
+//////////////////////////////////////////////////////////////////////////
+static void renderSoftFrame(Framebuffer& fb, float scale, int frame) {
+    SoftBackend soft(fb);
+    soft.setViewScale(scale, scale);
+    gfx = &soft;
+    winW = (int)(fb.width / scale);
+    winH = (int)(fb.height / scale);
+    drawAnimationFrame(frame * 4.0f, frame * 4.0f / 90.0f);
+    gfx = nullptr;
+}
+
+static void benchSoftRaster(const char* label, int width, int height, float scale, int iters) {
+    printf("software rasterizer, %s (%dx%d)\n", label, width, height);
+    Framebuffer reference;
+    reference.resize(width, height);
+    forceSpanIsa(SpanIsa::Scalar);
+    renderSoftFrame(reference, scale, 7);
+
+    const SpanIsa isas[3] = { SpanIsa::Scalar, SpanIsa::SSE2, SpanIsa::AVX2 };
+    double scalarMs = 0.0;
+    for(SpanIsa isa: isas){
+        if(!spanIsaSupported(isa)) {
+            printf("  %-6s: not supported on this CPU\n", spanIsaName(isa));
+            continue;
+        }
+        forceSpanIsa(isa);
+        Framebuffer fb;
+        fb.resize(width, height);
+        renderSoftFrame(fb, scale, 7);
+        bool identical = fb.rgba == reference.rgba;
+
+        auto t0 = BenchClock::now();
+        for(int it=0;it<iters;it++) renderSoftFrame(fb, scale, it);
+        double ms = nsSince(t0) / iters / 1e6;
+        if(isa == SpanIsa::Scalar) scalarMs = ms;
+        printf("  %-6s: %8.3f ms/frame  %7.1f fps  x%.2f  %s\n", spanIsaName(isa), ms, 1000.0 / ms,
+               scalarMs / ms, identical ? "bit-identical to scalar" : "DIFFERS from scalar");
+    }
+    forceSpanIsa(SpanIsa::AVX2);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Tile-parallel rasterizer: record + bin + rasterize, 1..N threads
+//////////////////////////////////////////////////////////////////////////
+static void renderTiledFrame(CommandList& list, TileRenderer& tiles, Framebuffer& fb, float scale, int frame) {
+    list.begin();
+    list.setViewScale(scale, scale);
+    gfx = &list;
+    winW = (int)(fb.width / scale);
+    winH = (int)(fb.height / scale);
+    drawAnimationFrame(frame * 4.0f, frame * 4.0f / 90.0f);
+    gfx = nullptr;
+    tiles.render(list, fb);
+}
+
+static void benchTileScaling(const char* label, int width, int height, float scale, int iters) {
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    printf("tile-parallel rasterizer, %s (%dx%d, %s spans, %d hardware threads)\n", label, width, height,
+           spanIsaName(spanKernels().isa), maxThreads);
+    Framebuffer reference;
+    reference.resize(width, height);
+    renderSoftFrame(reference, scale, 7);
+
+    std::vector<int> counts;
+    for(int n=1;n<maxThreads;n*=2) counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    CommandList list;
+    Framebuffer fb;
+    fb.resize(width, height);
+    double oneThreadMs = 0.0;
+    for(int n: counts){
+        ThreadPool pool(n);
+        TileRenderer tiles(pool);
+        renderTiledFrame(list, tiles, fb, scale, 7);
+        bool identical = fb.rgba == reference.rgba;
+        size_t commands = list.commands().size();
+
+        auto t0 = BenchClock::now();
+        for(int it=0;it<iters;it++) renderTiledFrame(list, tiles, fb, scale, it);
+        double ms = nsSince(t0) / iters / 1e6;
+        if(n == 1) oneThreadMs = ms;
+        double speedup = oneThreadMs / ms;
+        printf("  %3d threads: %8.3f ms/frame  %7.1f fps  x%.2f  (%3.0f%% efficiency, %zu cmds)  %s\n", n, ms,
+               1000.0 / ms, speedup, 100.0 * speedup / n, commands,
+               identical ? "bit-identical to SoftBackend" : "DIFFERS from SoftBackend");
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Baseline suite: calibrated samples, robust statistics, JSON
+//////////////////////////////////////////////////////////////////////////
+struct SuiteOptions {
+    int samples = 21;
+    double sampleMs = 20.0;        // each sample runs at least this long
+    std::string filter;
+    std::string jsonPath;
+    FILE* table = stdout;          // stderr when the JSON goes to stdout
+};
+
+struct SuiteResult {
+    std::string name;
+    uint64_t opsPerSample = 0;
+    int samples = 0;
+    double minNs = 0, medianNs = 0, meanNs = 0, stddevNs = 0, madNs = 0, p90Ns = 0;   // per op
+};
+
+// Draws nothing; keeps a checksum of what the scene submits so the vertex
+// generation it measures cannot be optimized away.
+class SinkBackend : public RenderBackend {
+public:
+    double sum = 0.0;
+    void clear(float, float, float, float) override {}
+    void color(float, float, float, float) override {}
+    void blend(bool) override {}
+    void lineWidth(float) override {}
+    void pushTransform(float x, float y, float) override { sum += x + y; }
+    void popTransform() override {}
+    void fillRect(float x0, float y0, float x1, float y1) override { sum += x0 + y0 + x1 + y1; }
+    void fillFan(const float* xy, int count) override { sum += xy[2 * count - 1]; }
+    void lines(const float* xy, int count) override { sum += xy[2 * count - 1]; }
+    void lineLoop(const float* xy, int count) override { sum += xy[2 * count - 1]; }
+    void text(float x, float y, const char*, TextFont) override { sum += x + y; }
+};
+
+// run(n) performs n ops. The op count per sample doubles until a sample
+// takes sampleMs (this also warms caches and the branch predictors); one
+// more sample is discarded, then opts.samples are kept.
+template<class Run>
+static bool suiteMeasure(const SuiteOptions& opts, const char* name, std::vector<SuiteResult>& results, Run run) {
+    if(!opts.filter.empty() && strstr(name, opts.filter.c_str()) == nullptr) return false;
+    uint64_t n = 1;
+    for(;;) {
+        auto t0 = BenchClock::now();
+        run(n);
+        if(nsSince(t0) >= opts.sampleMs * 1e6 || n >= (1ull << 40)) break;
+        n *= 2;
+    }
+    run(n);
+
+    std::vector<double> ns(opts.samples);
+    for(double& v: ns){
+        auto t0 = BenchClock::now();
+        run(n);
+        v = nsSince(t0) / (double)n;
+    }
+    std::vector<double> sorted = ns;
+    std::sort(sorted.begin(), sorted.end());
+    auto quantile = [](const std::vector<double>& v, double q) {
+        double pos = q * (v.size() - 1);
+        size_t i = (size_t)pos;
+        return i + 1 < v.size() ? v[i] + (v[i + 1] - v[i]) * (pos - i) : v[i];
+    };
+    SuiteResult r;
+    r.name = name;
+    r.opsPerSample = n;
+    r.samples = opts.samples;
+    r.minNs = sorted.front();
+    r.medianNs = quantile(sorted, 0.5);
+    r.p90Ns = quantile(sorted, 0.9);
+    double sum = 0.0, sq = 0.0;
+    for(double v: ns) sum += v;
+    r.meanNs = sum / ns.size();
+    for(double v: ns) sq += (v - r.meanNs) * (v - r.meanNs);
+    r.stddevNs = ns.size() > 1 ? sqrt(sq / (ns.size() - 1)) : 0.0;
+    std::vector<double> dev;
+    for(double v: ns) dev.push_back(fabs(v - r.medianNs));
+    std::sort(dev.begin(), dev.end());
+    r.madNs = quantile(dev, 0.5);
+    results.push_back(r);
+    fprintf(opts.table, "  %-36s %10.1f ns/op  min %10.1f  mad %5.2f%%  p90 %10.1f  (%d x %llu ops)\n", name, r.medianNs, r.minNs,
+           r.medianNs > 0.0 ? 100.0 * r.madNs / r.medianNs : 0.0, r.p90Ns, r.samples, (unsigned long long)n);
+    return true;
+}
+
+static bool writeSuiteJson(const SuiteOptions& opts, const std::vector<SuiteResult>& results) {
+    FILE* f = opts.jsonPath == "-" ? stdout : fopen(opts.jsonPath.c_str(), "w");
+    if(!f) {
+        fprintf(stderr, "engine_bench: cannot create %s\n", opts.jsonPath.c_str());
+        return false;
+    }
+    fprintf(f, "{\n  \"suite\": \"engine_bench\",\n  \"version\": 1,\n  \"span_isa\": \"%s\",\n"
+               "  \"hardware_threads\": %u,\n  \"samples\": %d,\n  \"sample_ms\": %.1f,\n  \"benchmarks\": [",
+            spanIsaName(spanKernels().isa), std::thread::hardware_concurrency(), opts.samples, opts.sampleMs);
+    for(size_t i=0;i<results.size();i++){
+        const SuiteResult& r = results[i];
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"unit\": \"ns/op\", \"ops_per_sample\": %llu, \"samples\": %d, "
+                   "\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"mad\": %.3f, \"p90\": %.3f}",
+                i ? "," : "", r.name.c_str(), (unsigned long long)r.opsPerSample, r.samples, r.minNs, r.medianNs,
+                r.meanNs, r.stddevNs, r.madNs, r.p90Ns);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    bool ok = f == stdout ? fflush(f) == 0 : fclose(f) == 0;
+    if(!ok) fprintf(stderr, "engine_bench: cannot write %s\n", opts.jsonPath.c_str());
+    return ok;
+}
+
+static int runSuite(SuiteOptions opts) {
+    if(opts.jsonPath == "-") opts.table = stderr;
+    fprintf(opts.table, "baseline suite (%d samples of >= %.0f ms, %s spans)\n", opts.samples, opts.sampleMs,
+           spanIsaName(spanKernels().isa));
+    std::vector<SuiteResult> results;
+    const EngineLayout& layout = engineLayout();
+    int cylinders = layout.cylinders;
+
+    suiteMeasure(opts, "kinematics.pistonPositionForCrank", results, [&](uint64_t n) {
+        float sum = 0.0f;
+        for(uint64_t i=0;i<n;i++){
+            sum += pistonPositionForCrank(240.0f, (float)(i % 7200) * 0.1f, layout.phaseOffsetDeg[i % cylinders]);
+        }
+        benchSink = benchSink + sum;
+    });
+    suiteMeasure(opts, "kinematics.getPhaseKindForCylinder", results, [&](uint64_t n) {
+        int sum = 0;
+        for(uint64_t i=0;i<n;i++)
+            sum += getPhaseKindForCylinder((float)(i % 7200) * 0.1f, layout.phaseOffsetDeg[i % cylinders]);
+        benchSink = benchSink + (float)sum;
+    });
+
+    SinkBackend sink;
+    gfx = &sink;
+    suiteMeasure(opts, "scene.drawCircle", results, [&](uint64_t n) {
+        for(uint64_t i=0;i<n;i++) drawCircle(100.0f + (float)(i & 63), 200.0f, 18.0f, 22);
+    });
+    suiteMeasure(opts, "scene.drawRoundedRect", results, [&](uint64_t n) {
+        for(uint64_t i=0;i<n;i++) drawRoundedRect(450.0f, 180.0f + (float)(i & 63), 200.0f, 60.0f, 12.0f, 12);
+    });
+    benchSink = benchSink + (float)sink.sum;
+
+    // Frame builds as display() issues them, recorded the way headless and
+    // replay record them.
+    CommandList list;
+    winW = 900;
+    winH = 360;
+    gfx = &list;
+    suiteMeasure(opts, "frame.display", results, [&](uint64_t n) {
+        for(uint64_t i=0;i<n;i++){
+            list.begin();
+            drawAnimationFrame((float)(i % 180) * 4.0f, (float)(i % 180) * 4.0f / 90.0f);
+        }
+    });
+    suiteMeasure(opts, "frame.drawLandingPage", results, [&](uint64_t n) {
+        for(uint64_t i=0;i<n;i++){
+            list.begin();
+            hoverBtn = (i & 1) != 0;
+            drawLandingPage();
+        }
+    });
+    hoverBtn = false;
+    gfx = nullptr;
+
+    if(results.empty()) {
+        fprintf(stderr, "engine_bench: no benchmark matches '%s'\n", opts.filter.c_str());
+        return 1;
+    }
+    return opts.jsonPath.empty() || writeSuiteJson(opts, results) ? 0 : 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// State-sorted render queue: state changes, overhead, identity
+//////////////////////////////////////////////////////////////////////////
+static void benchRenderQueue(const char* preset, int iters) {
+    EngineConfig saved = engineConfig();
+    EngineConfig cfg;
+    engineConfigPreset(preset, cfg);
+    setEngineConfig(cfg);
+    printf("render queue (%s, %d frames)\n", preset, iters);
+
+    // Pixels: every frame of the sequence drawn directly and through the queue.
+    RenderQueue queue;
+    Framebuffer direct, queued;
+    direct.resize(900, 360);
+    queued.resize(900, 360);
+    int differing = 0;
+    double stateCalls = 0.0, stateChanges = 0.0, draws = 0.0;
+    winW = 900;
+    winH = 360;
+    for(int i=0;i<iters;i++){
+        float angle = (float)(i % 180) * 4.0f, t = angle / 90.0f;
+        { SoftBackend soft(direct); gfx = &soft; drawAnimationFrame(angle, t); }
+        {
+            SoftBackend soft(queued);
+            queue.begin(&soft);
+            gfx = &queue;
+            drawAnimationFrame(angle, t);
+            queue.flush();
+        }
+        if(direct.rgba != queued.rgba) differing++;
+        stateCalls += queue.stats().stateCalls;
+        stateChanges += queue.stats().stateChanges;
+        draws += queue.stats().draws;
+    }
+    printf("  %.0f draws, %.1f colour/blend/width calls -> %.1f issued per frame  %s\n", draws / iters,
+           stateCalls / iters, stateChanges / iters,
+           differing ? "DIFFERS from direct" : "bit-identical to direct");
+
+    // CPU cost of recording, sorting and replaying, against drawing straight
+    // to a backend that does nothing.
+    SinkBackend sink;
+    auto t0 = BenchClock::now();
+    gfx = &sink;
+    for(int i=0;i<iters;i++) drawAnimationFrame((float)(i % 180) * 4.0f, (float)(i % 180) * 4.0f / 90.0f);
+    double directUs = nsSince(t0) / iters / 1e3;
+    t0 = BenchClock::now();
+    for(int i=0;i<iters;i++){
+        queue.begin(&sink);
+        gfx = &queue;
+        drawAnimationFrame((float)(i % 180) * 4.0f, (float)(i % 180) * 4.0f / 90.0f);
+        queue.flush();
+    }
+    double queuedUs = nsSince(t0) / iters / 1e3;
+    benchSink = benchSink + (float)sink.sum;
+    printf("  direct %7.2f us/frame  queued %7.2f us/frame  (+%.2f us to sort)\n", directUs, queuedUs,
+           queuedUs - directUs);
+    gfx = nullptr;
+    setEngineConfig(saved);
+}
+
+int main(int argc, char** argv) {
+    bool suite = false;
+    SuiteOptions opts;
+    for(int i=1;i<argc;i++){
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(strcmp(a, "--suite") == 0) suite = true;
+        else if(strcmp(a, "--json") == 0 && hasValue) opts.jsonPath = argv[++i];
+        else if(strcmp(a, "--samples") == 0 && hasValue) opts.samples = atoi(argv[++i]);
+        else if(strcmp(a, "--sample-ms") == 0 && hasValue) opts.sampleMs = atof(argv[++i]);
+        else if(strcmp(a, "--filter") == 0 && hasValue) opts.filter = argv[++i];
+        else {
+            fprintf(stderr, "usage: engine_bench [--suite [--json FILE|-] [--samples N] [--sample-ms MS] [--filter TEXT]]\n");
+            return 2;
+        }
+    }
+    if(suite || !opts.jsonPath.empty() || !opts.filter.empty()) {
+        if(opts.samples < 1 || opts.sampleMs <= 0.0) {
+            fprintf(stderr, "engine_bench: --samples and --sample-ms must be positive\n");
+            return 2;
+        }
+        return runSuite(opts);
+    }
+
+    benchCircleTables();
+    benchKinematics();
+    benchPistonKernels();
+    benchEngineBatch("inline-4");
+    benchEngineBatch("v16");
+    benchThermo();
+    benchDynamics();
+    benchSnapshot();
+    benchEnginePack();
+    benchTelemetryLog();
+    benchTelemetryCodec();
+    benchSoftRaster("window", 900, 360, 1.0f, 400);
+    benchSoftRaster("4K", 3840, 2160, 3840.0f / 900.0f, 20);
+    benchTileScaling("4K", 3840, 2160, 3840.0f / 900.0f, 20);
+    benchTileScaling("8K", 7680, 4320, 7680.0f / 900.0f, 8);
+    benchRenderQueue("inline-4", 360);
+    benchRenderQueue("v8", 360);
+    benchRenderQueue("v16", 360);
+    return 0;
+}
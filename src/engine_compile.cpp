@@ -0,0 +1,88 @@
+// engine_compile.cpp
+// Compiles engine descriptions (presets or text files, see engine_config.h)
+// into a memory-mappable engine pack (see engine_pack.h), or lists a pack.
+// Compile (Linux / MinGW):
+//   g++ -O2 src/engine_compile.cpp src/engine_pack.cpp src/engine_config.cpp src/crank_kinematics.cpp src/mapped_file.cpp -o engine_compile
+// Windows MSVC:
+//   cl /EHsc /O2 /std:c++17 src\engine_compile.cpp src\engine_pack.cpp src\engine_config.cpp src\crank_kinematics.cpp src\mapped_file.cpp /Fe:engine_compile.exe
+// Usage:
+//   engine_compile [--table N] OUT.epk SPEC...   (SPEC: preset name or description file)
+//   engine_compile --list PACK
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "engine_config.h"
+#include "engine_pack.h"
+
+static const char* layoutName(BankLayout l) {
+    if(l == BankLayout::V) return "v";
+    if(l == BankLayout::Boxer) return "boxer";
+    return "inline";
+}
+
+static int listPack(const char* path) {
+    EnginePack pack;
+    std::string error;
+    if(!pack.open(path, error)) {
+        fprintf(stderr, "engine_compile: %s\n", error.c_str());
+        return 1;
+    }
+    printf("%s: %d engines, %d kinematics tables of %d samples\n", path, pack.size(), pack.tableCount(),
+           pack.tableSize());
+    for(int i=0;i<pack.size();i++){
+        EngineConfig cfg = pack.config(i);
+        printf("  %-31s %-6s %2d cyl  bank %5.1f  bore %5.1f  stroke %5.1f  rod %6.1f mm  cr %4.1f  table %u\n",
+               cfg.name, layoutName(cfg.layout), cfg.cylinders, cfg.bankAngleDeg, cfg.bore * 1e3f,
+               cfg.stroke * 1e3f, cfg.rodLength * 1e3f, cfg.compressionRatio, pack.entry(i).table);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int tableSize = 1024;
+    int first = 1;
+    if(argc == 3 && strcmp(argv[1], "--list") == 0) return listPack(argv[2]);
+    if(argc > 2 && strcmp(argv[1], "--table") == 0) {
+        tableSize = atoi(argv[2]);
+        first = 3;
+    }
+    if(argc - first < 2 || tableSize < 16) {
+        fprintf(stderr, "usage: engine_compile [--table N] OUT.epk SPEC...\n"
+                        "       engine_compile --list PACK\n"
+                        "SPEC is a description file or a preset: %s\n", engineConfigPresetList());
+        return 2;
+    }
+
+    const char* out = argv[first];
+    std::vector<EngineConfig> engines;
+    for(int i=first+1;i<argc;i++){
+        EngineConfig preset;
+        if(engineConfigPreset(argv[i], preset)) {
+            engines.push_back(preset);
+            continue;
+        }
+        std::vector<EngineConfig> file;
+        std::string error;
+        if(!loadEngineConfigs(argv[i], file, error)) {
+            fprintf(stderr, "engine_compile: %s\n", error.c_str());
+            return 1;
+        }
+        engines.insert(engines.end(), file.begin(), file.end());
+    }
+
+    std::string error;
+    if(!writeEnginePack(out, engines, tableSize, error)) {
+        fprintf(stderr, "engine_compile: %s\n", error.c_str());
+        return 1;
+    }
+    EnginePack pack;
+    if(!pack.open(out, error)) {
+        fprintf(stderr, "engine_compile: %s\n", error.c_str());
+        return 1;
+    }
+    printf("engine_compile: wrote %d engines, %d kinematics tables to %s\n", pack.size(), pack.tableCount(), out);
+    return 0;
+}
@@ -0,0 +1,416 @@
+// engine_config.cpp
+// Engine description parsing, presets and layout (see engine_config.h).
+
+#include "engine_config.h"
+#include "engine_geometry.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Presets (same text format as the files)
+//////////////////////////////////////////////////////////////////////////
+struct EnginePreset {
+    const char* name;
+    const char* text;
+};
+
+static const EnginePreset kPresets[] = {
+    { "single",   "cylinders = 1\nfiring_order = 1\n" },
+    { "inline-2", "cylinders = 2\nfiring_order = 1 2\n" },
+    { "inline-3", "cylinders = 3\nfiring_order = 1 2 3\n" },
+    { "inline-4", "cylinders = 4\nfiring_order = 1 4 3 2\n" },
+    { "inline-5", "cylinders = 5\nfiring_order = 1 2 4 5 3\n" },
+    { "inline-6", "cylinders = 6\nfiring_order = 1 5 3 6 2 4\n" },
+    { "inline-8", "cylinders = 8\nfiring_order = 1 6 2 5 8 3 7 4\n" },
+    // 90-degree twin, uneven 270 / 450 firing
+    { "v-twin",   "layout = v\ncylinders = 2\nbank_angle = 90\nfiring_order = 1 2\nphase = 0 450\n" },
+    { "v6",       "layout = v\ncylinders = 6\nbank_angle = 60\nfiring_order = 1 2 3 4 5 6\n" },
+    { "v8",       "layout = v\ncylinders = 8\nbank_angle = 90\nfiring_order = 1 8 4 3 6 5 7 2\n" },
+    { "v10",      "layout = v\ncylinders = 10\nbank_angle = 90\nfiring_order = 1 6 5 10 2 7 3 8 4 9\n" },
+    { "v12",      "layout = v\ncylinders = 12\nbank_angle = 60\nfiring_order = 1 12 5 8 3 10 6 7 2 11 4 9\n" },
+    { "v16",      "layout = v\ncylinders = 16\nbank_angle = 45\n"
+                  "firing_order = 1 8 9 14 3 6 15 4 16 5 12 11 2 7 10 13\n" },
+    { "boxer-2",  "layout = boxer\ncylinders = 2\nfiring_order = 1 2\n" },
+    { "boxer-4",  "layout = boxer\ncylinders = 4\nfiring_order = 1 3 2 4\n" },
+    { "boxer-6",  "layout = boxer\ncylinders = 6\nfiring_order = 1 6 2 4 3 5\n" },
+};
+
+const char* engineConfigPresetList() {
+    return "single, inline-2, inline-3, inline-4, inline-5, inline-6, inline-8, v-twin, v6, v8, v10, v12, v16, "
+           "boxer-2, boxer-4, boxer-6";
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Parsing
+//////////////////////////////////////////////////////////////////////////
+void evenFiringPhases(EngineConfig& cfg) {
+    float interval = 720.0f / cfg.cylinders;
+    for(int j=0;j<cfg.cylinders;j++){
+        float a = fmodf(720.0f - j * interval, 720.0f);
+        cfg.phaseOffsetDeg[cfg.firingOrder[j]] = a;
+    }
+}
+
+static char* trim(char* s) {
+    while(isspace((unsigned char)*s)) s++;
+    char* e = s + strlen(s);
+    while(e > s && isspace((unsigned char)e[-1])) *--e = '\0';
+    return s;
+}
+
+// Up to max numbers separated by spaces or commas; returns how many were read.
+static int parseList(const char* s, float* out, int max, bool& extra) {
+    int count = 0;
+    extra = false;
+    while(*s) {
+        while(*s == ' ' || *s == '\t' || *s == ',') s++;
+        if(!*s) break;
+        char* end = nullptr;
+        float v = strtof(s, &end);
+        if(end == s) { extra = true; return count; }
+        if(count == max) { extra = true; return count; }
+        out[count++] = v;
+        s = end;
+    }
+    return count;
+}
+
+// One engine being read: keys seen so far, resolved against the base when
+// the section ends.
+struct SectionState {
+    EngineConfig cfg;
+    bool hasBase = false;
+    int baseCylinders = 0;
+    bool layoutSet = false, bankSet = false;
+    int firingCount = -1, phaseCount = -1;
+    float firing[kMaxCylinders], phase[kMaxCylinders];
+};
+
+static void startSection(SectionState& st, const char* name) {
+    st = SectionState();
+    snprintf(st.cfg.name, sizeof(st.cfg.name), "%s", name);
+    st.cfg.cylinders = 0;
+}
+
+static bool finishSection(SectionState& st, const char* source, EngineConfig& out, std::string& error) {
+    EngineConfig& cfg = st.cfg;
+    char msg[160];
+    int n = cfg.cylinders;
+    if(n < 1 || n > kMaxCylinders) {
+        snprintf(msg, sizeof(msg), "%s [%s]: cylinders must be 1..%d", source, cfg.name, kMaxCylinders);
+        error = msg;
+        return false;
+    }
+    if(!st.layoutSet && !st.hasBase) cfg.layout = BankLayout::Inline;
+    if(cfg.layout == BankLayout::Inline) cfg.bankAngleDeg = 0.0f;
+    else if(cfg.layout == BankLayout::Boxer) cfg.bankAngleDeg = 180.0f;
+    else if(!st.bankSet && (cfg.bankAngleDeg <= 0.0f || cfg.bankAngleDeg >= 180.0f)) cfg.bankAngleDeg = 90.0f;
+    if(cfg.layout == BankLayout::V && (cfg.bankAngleDeg <= 0.0f || cfg.bankAngleDeg >= 180.0f)) {
+        snprintf(msg, sizeof(msg), "%s [%s]: bank_angle must be between 0 and 180", source, cfg.name);
+        error = msg;
+        return false;
+    }
+    if(!(cfg.stroke > 0.0f && cfg.bore > 0.0f && cfg.rodLength > cfg.stroke * 0.5f && cfg.compressionRatio > 1.0f)) {
+        snprintf(msg, sizeof(msg), "%s [%s]: need bore, stroke > 0, rod_length > stroke / 2, compression_ratio > 1",
+                 source, cfg.name);
+        error = msg;
+        return false;
+    }
+
+    // Firing order and phases carry over from the base while the cylinder count does.
+    bool inherit = st.hasBase && st.baseCylinders == n;
+    if(st.firingCount < 0 && !inherit) {
+        for(int i=0;i<n;i++) st.firing[i] = (float)(i + 1);
+        st.firingCount = n;
+    }
+    if(st.firingCount >= 0) {
+        if(st.firingCount != n) {
+            snprintf(msg, sizeof(msg), "%s [%s]: firing_order lists %d cylinders, expected %d",
+                     source, cfg.name, st.firingCount, n);
+            error = msg;
+            return false;
+        }
+        bool seen[kMaxCylinders] = {};
+        for(int j=0;j<n;j++){
+            int c = (int)st.firing[j];
+            if(c != st.firing[j] || c < 1 || c > n || seen[c - 1]) {
+                snprintf(msg, sizeof(msg), "%s [%s]: firing_order must name each cylinder 1..%d once",
+                         source, cfg.name, n);
+                error = msg;
+                return false;
+            }
+            seen[c - 1] = true;
+            cfg.firingOrder[j] = (uint8_t)(c - 1);
+        }
+        for(int j=n;j<kMaxCylinders;j++) cfg.firingOrder[j] = 0;
+    }
+
+    if(st.phaseCount >= 0) {
+        if(st.phaseCount != n) {
+            snprintf(msg, sizeof(msg), "%s [%s]: phase lists %d offsets, expected %d", source, cfg.name, st.phaseCount, n);
+            error = msg;
+            return false;
+        }
+        for(int i=0;i<kMaxCylinders;i++){
+            float a = i < n ? fmodf(st.phase[i], 720.0f) : 0.0f;
+            cfg.phaseOffsetDeg[i] = a < 0.0f ? a + 720.0f : a;
+        }
+    } else if(!inherit || st.firingCount >= 0) {
+        for(int i=0;i<kMaxCylinders;i++) cfg.phaseOffsetDeg[i] = 0.0f;
+        evenFiringPhases(cfg);
+    }
+    out = cfg;
+    return true;
+}
+
+bool parseEngineConfigs(const char* text, const char* source, std::vector<EngineConfig>& out, std::string& error) {
+    std::vector<EngineConfig> engines;
+    SectionState st;
+    startSection(st, "custom");
+    bool open = false;       // current section has a header or any key
+    char msg[160];
+
+    int lineNo = 0;
+    const char* p = text;
+    while(*p) {
+        const char* eol = strchr(p, '\n');
+        size_t len = eol ? (size_t)(eol - p) : strlen(p);
+        char line[512];
+        if(len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p = eol ? eol + 1 : p + strlen(p);
+        lineNo++;
+
+        if(char* hash = strchr(line, '#')) *hash = '\0';
+        char* key = trim(line);
+        if(!*key) continue;
+
+        if(*key == '[') {
+            char* close = strchr(key, ']');
+            if(!close) {
+                snprintf(msg, sizeof(msg), "%s:%d: expected [name]", source, lineNo);
+                error = msg;
+                return false;
+            }
+            *close = '\0';
+            if(open) {
+                EngineConfig cfg;
+                if(!finishSection(st, source, cfg, error)) return false;
+                engines.push_back(cfg);
+            }
+            startSection(st, trim(key + 1));
+            open = true;
+            continue;
+        }
+
+        char* eq = strchr(key, '=');
+        if(!eq) {
+            snprintf(msg, sizeof(msg), "%s:%d: expected key = value", source, lineNo);
+            error = msg;
+            return false;
+        }
+        *eq = '\0';
+        key = trim(key);
+        char* value = trim(eq + 1);
+        bool extra = false;
+        open = true;
+
+        if(strcmp(key, "name") == 0) {
+            snprintf(st.cfg.name, sizeof(st.cfg.name), "%s", value);
+        } else if(strcmp(key, "base") == 0) {
+            // A preset or an earlier engine of this file.
+            EngineConfig base;
+            bool found = false;
+            for(const EngineConfig& e: engines) if(strcmp(e.name, value) == 0) { base = e; found = true; }
+            if(!found) found = engineConfigPreset(value, base);
+            if(!found) {
+                snprintf(msg, sizeof(msg), "%s:%d: unknown base '%s'", source, lineNo, value);
+                error = msg;
+                return false;
+            }
+            char name[sizeof(st.cfg.name)];
+            memcpy(name, st.cfg.name, sizeof(name));
+            st.cfg = base;
+            memcpy(st.cfg.name, name, sizeof(name));
+            st.hasBase = true;
+            st.baseCylinders = base.cylinders;
+        } else if(strcmp(key, "layout") == 0) {
+            if(strcmp(value, "inline") == 0) st.cfg.layout = BankLayout::Inline;
+            else if(strcmp(value, "v") == 0) st.cfg.layout = BankLayout::V;
+            else if(strcmp(value, "boxer") == 0) st.cfg.layout = BankLayout::Boxer;
+            else {
+                snprintf(msg, sizeof(msg), "%s:%d: layout must be inline, v or boxer", source, lineNo);
+                error = msg;
+                return false;
+            }
+            st.layoutSet = true;
+        } else if(strcmp(key, "cylinders") == 0) {
+            st.cfg.cylinders = atoi(value);
+        } else if(strcmp(key, "bank_angle") == 0) {
+            st.cfg.bankAngleDeg = (float)atof(value);
+            st.bankSet = true;
+        } else if(strcmp(key, "firing_order") == 0) {
+            st.firingCount = parseList(value, st.firing, kMaxCylinders, extra);
+        } else if(strcmp(key, "phase") == 0) {
+            st.phaseCount = parseList(value, st.phase, kMaxCylinders, extra);
+        } else if(strcmp(key, "bore") == 0) {
+            st.cfg.bore = (float)atof(value) * 1e-3f;
+        } else if(strcmp(key, "stroke") == 0) {
+            st.cfg.stroke = (float)atof(value) * 1e-3f;
+        } else if(strcmp(key, "rod_length") == 0) {
+            st.cfg.rodLength = (float)atof(value) * 1e-3f;
+        } else if(strcmp(key, "compression_ratio") == 0) {
+            st.cfg.compressionRatio = (float)atof(value);
+        } else {
+            snprintf(msg, sizeof(msg), "%s:%d: unknown key '%s'", source, lineNo, key);
+            error = msg;
+            return false;
+        }
+        if(extra) {
+            snprintf(msg, sizeof(msg), "%s:%d: bad or too many values (at most %d)", source, lineNo, kMaxCylinders);
+            error = msg;
+            return false;
+        }
+    }
+    if(open) {
+        EngineConfig cfg;
+        if(!finishSection(st, source, cfg, error)) return false;
+        engines.push_back(cfg);
+    }
+    if(engines.empty()) {
+        error = std::string(source) + ": no engine described";
+        return false;
+    }
+    out.swap(engines);
+    return true;
+}
+
+bool engineConfigPreset(const std::string& name, EngineConfig& out) {
+    for(const EnginePreset& p: kPresets) {
+        if(name != p.name) continue;
+        std::string error;
+        std::vector<EngineConfig> cfg;
+        if(!parseEngineConfigs(p.text, p.name, cfg, error)) return false;
+        snprintf(cfg[0].name, sizeof(cfg[0].name), "%s", p.name);
+        out = cfg[0];
+        return true;
+    }
+    return false;
+}
+
+bool loadEngineConfigs(const std::string& path, std::vector<EngineConfig>& out, std::string& error) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t got;
+    while((got = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, got);
+    fclose(f);
+    return parseEngineConfigs(text.c_str(), path.c_str(), out, error);
+}
+
+bool loadEngineConfig(const std::string& path, EngineConfig& out, std::string& error) {
+    std::vector<EngineConfig> engines;
+    if(!loadEngineConfigs(path, engines, error)) return false;
+    out = engines[0];
+    return true;
+}
+
+bool resolveEngineConfig(const std::string& nameOrPath, EngineConfig& out, std::string& error) {
+    if(engineConfigPreset(nameOrPath, out)) return true;
+    return loadEngineConfig(nameOrPath, out, error);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Layout
+//////////////////////////////////////////////////////////////////////////
+EngineLayout buildEngineLayout(const EngineConfig& cfg) {
+    EngineLayout L;
+    int n = cfg.cylinders < 1 ? 1 : (cfg.cylinders > kMaxCylinders ? kMaxCylinders : cfg.cylinders);
+    L.cylinders = n;
+    L.layout = cfg.layout;
+    for(int i=0;i<kMaxCylinders;i++) L.phaseOffsetDeg[i] = i < n ? cfg.phaseOffsetDeg[i] : 0.0f;
+
+    // Same Y span as the inline block rectangle.
+    L.housingHalfW = spacing / 2.0f;
+    L.housingY0 = blockTopY - blockH + 20.0f;
+    L.housingY1 = blockTopY + 20.0f;
+
+    if(cfg.layout == BankLayout::Inline) {
+        // The original layout and framing, unchanged.
+        L.slots = n;
+        for(int i=0;i<n;i++){
+            L.slotX[i] = blockLeftX + i * spacing + cylinderWidth/2.0f + 20.0f;
+            CylinderPlacement& c = L.cyl[i];
+            c.crankX = L.slotX[i];
+            c.crankY = crankY;
+            c.sinTilt = 0.0f;
+            c.cosTilt = 1.0f;
+            c.upright = true;
+            c.slot = i;
+        }
+        float width = spacing*(n-1) + cylinderWidth + 80.0f;
+        L.blockX0 = blockLeftX;
+        L.blockX1 = blockLeftX + width;
+        L.minX = 0.0f;
+        L.maxX = width;
+        L.minY = 0.0f;
+        L.maxY = 260.0f;   // block plus crank area
+    } else {
+        float half = cfg.bankAngleDeg * 0.5f * (float)M_PI / 180.0f;
+        float tilt[2] = { -half, half };
+        // Horizontal and vertical reach of one throw around its crank centre:
+        // the housings, and pistons at TDC with their combustion cloud.
+        float topY = fmaxf(L.housingY1, pistonTdcY + pistonHeight/2.0f + 40.0f);
+        float reachX = 0.0f, lowY = -20.0f, highY = 0.0f;
+        for(float t: tilt){
+            CylinderPlacement probe = { 0.0f, crankY, sinf(t), cosf(t), false, 0 };
+            const float corners[4][2] = {
+                { -L.housingHalfW, L.housingY0 }, { L.housingHalfW, L.housingY0 },
+                { -L.housingHalfW, topY }, { L.housingHalfW, topY },
+            };
+            for(const auto& k: corners){
+                float x, y;
+                cylinderToEngine(probe, k[0], k[1], x, y);
+                reachX = fmaxf(reachX, fabsf(x));
+                lowY = fminf(lowY, y - crankY);
+                highY = fmaxf(highY, y - crankY);
+            }
+        }
+        float pitch = 2.0f * reachX;
+        L.slots = (n + 1) / 2;
+        for(int s=0;s<L.slots;s++) L.slotX[s] = blockLeftX + reachX + s * pitch;
+        for(int i=0;i<n;i++){
+            CylinderPlacement& c = L.cyl[i];
+            c.slot = i / 2;
+            c.crankX = L.slotX[c.slot];
+            c.crankY = crankY;
+            c.sinTilt = sinf(tilt[i & 1]);
+            c.cosTilt = cosf(tilt[i & 1]);
+            c.upright = false;
+        }
+        L.blockX0 = L.slotX[0] - reachX;
+        L.blockX1 = L.slotX[L.slots - 1] + reachX;
+        L.minX = 0.0f;
+        L.maxX = L.blockX1 + blockLeftX;
+        L.minY = crankY + lowY - 20.0f;
+        L.maxY = crankY + highY + 20.0f;
+    }
+    for(int i=n;i<kMaxCylinders;i++) L.cyl[i] = L.cyl[0];
+    for(int s=L.slots;s<kMaxCylinders;s++) L.slotX[s] = L.slotX[0];
+    L.crankshaftX0 = L.slotX[0] - 60.0f;
+    L.crankshaftX1 = L.slotX[L.slots - 1] + 60.0f;
+    return L;
+}
@@ -0,0 +1,125 @@
+// engine_config.h
+// Engine description (cylinder count, bank layout, firing order, per-cylinder
+// phase) and the placement of every cylinder in the drawing derived from it.
+//
+// A description comes from a built-in preset, a small text file, or a
+// compiled engine pack (engine_pack.h) built from such files:
+//
+//   # comments run to the end of the line
+//   name              = v8
+//   layout            = v              # inline | v | boxer
+//   cylinders         = 8              # 1 .. 16
+//   bank_angle        = 90             # included angle between the banks (v only)
+//   firing_order      = 1 8 4 3 6 5 7 2
+//   phase             = 0 450 ...      # optional, one cycle offset per cylinder
+//   bore              = 86             # mm
+//   stroke            = 86             # mm
+//   rod_length        = 143            # mm, centre to centre
+//   compression_ratio = 10.5
+//
+// One file may hold many engines, each starting with a [name] line; a
+// section can start from a preset or an earlier section with "base = name"
+// and override only what differs:
+//
+//   [v8-long-rod]
+//   base = v8
+//   rod_length = 155
+//
+// Cylinders are numbered from 1 in files and from 0 in code. In V and boxer
+// engines even cylinders (0, 2, ...) sit on the left bank and odd ones on the
+// right, one pair per crank throw. Without an explicit phase list the firing
+// order is spread evenly over the 720-degree cycle.
+//
+// Phase offsets follow getPhaseKindForCylinder: cycle angle = crank angle +
+// offset, and a cylinder fires when its cycle angle reaches 360.
+//
+// Bore, stroke and rod length are physical (metres in code) and feed the
+// kinematics and thermo models; the drawing keeps its own pixel geometry.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "crank_kinematics.h"
+
+const int kMaxCylinders = 16;
+
+enum class BankLayout : uint8_t { Inline, V, Boxer };
+
+struct EngineConfig {
+    // Defaults reproduce the original four-cylinder demo.
+    char name[32] = "inline-4";
+    BankLayout layout = BankLayout::Inline;
+    int cylinders = 4;
+    float bankAngleDeg = 0.0f;
+    uint8_t firingOrder[kMaxCylinders] = { 0, 3, 2, 1 };
+    float phaseOffsetDeg[kMaxCylinders] = { 0.0f, 180.0f, 360.0f, 540.0f };
+    float bore = 0.086f;               // m
+    float stroke = 0.086f;             // m
+    float rodLength = 0.143f;          // m
+    float compressionRatio = 10.5f;
+};
+
+inline SliderCrank engineSliderCrank(const EngineConfig& cfg) {
+    return SliderCrank{ cfg.stroke * 0.5f, cfg.rodLength };
+}
+
+// Built-in descriptions: single, inline-2 .. inline-6, inline-8, v-twin, v6,
+// v8, v10, v12, v16, boxer-2, boxer-4, boxer-6.
+bool engineConfigPreset(const std::string& name, EngineConfig& out);
+const char* engineConfigPresetList();
+// Text descriptions as above; source names the text in error messages. On
+// failure out is untouched and error says why.
+bool parseEngineConfigs(const char* text, const char* source, std::vector<EngineConfig>& out, std::string& error);
+bool loadEngineConfigs(const std::string& path, std::vector<EngineConfig>& out, std::string& error);
+// First engine of a file.
+bool loadEngineConfig(const std::string& path, EngineConfig& out, std::string& error);
+// Preset name first, then a file path.
+bool resolveEngineConfig(const std::string& nameOrPath, EngineConfig& out, std::string& error);
+// Sets phaseOffsetDeg from the firing order with even intervals.
+void evenFiringPhases(EngineConfig& cfg);
+
+//////////////////////////////////////////////////////////////////////////
+// Placement
+//////////////////////////////////////////////////////////////////////////
+// Each crank throw ("slot") is drawn as a small front view: its cylinders
+// radiate from the throw's crank centre along their bank axis. Inline engines
+// keep the original upright layout exactly.
+struct CylinderPlacement {
+    float crankX, crankY;   // centre of the throw, engine-local pixels
+    float sinTilt, cosTilt; // bank axis, tilted clockwise from vertical
+    bool upright;
+    int slot;
+};
+
+struct EngineLayout {
+    int cylinders = 0;
+    int slots = 0;
+    BankLayout layout = BankLayout::Inline;
+    CylinderPlacement cyl[kMaxCylinders];
+    float phaseOffsetDeg[kMaxCylinders];
+    float slotX[kMaxCylinders];           // throw centres along the crankshaft
+    float crankshaftX0, crankshaftX1;
+    // Block: one rectangle for inline engines, one housing per cylinder
+    // otherwise (across +-housingHalfW, along housingY0..housingY1 in the
+    // upright frame, i.e. the same Y values the inline block spans).
+    float blockX0, blockX1;
+    float housingHalfW, housingY0, housingY1;
+    // Engine-local bounds centred in the window by engineOrigin().
+    float minX, minY, maxX, maxY;
+};
+
+EngineLayout buildEngineLayout(const EngineConfig& cfg);
+
+// Maps a point given in the upright frame of cylinder p (dx across the bore
+// from its axis, y as in the inline drawing) to engine-local coordinates.
+inline void cylinderToEngine(const CylinderPlacement& p, float dx, float y, float& ox, float& oy) {
+    if(p.upright) {
+        ox = p.crankX + dx;
+        oy = y;
+        return;
+    }
+    float along = y - p.crankY;
+    ox = p.crankX + dx * p.cosTilt + along * p.sinTilt;
+    oy = p.crankY - dx * p.sinTilt + along * p.cosTilt;
+}
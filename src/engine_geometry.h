@@ -0,0 +1,31 @@
+// engine_geometry.h
+// Engine layout constants shared by the drawing code and the retained renderer.
+// All values are in engine-local pixels (before the centering translate in display()).
+// Cylinder count, placement and phases come from the engine description
+// (engine_config.h).
+#pragma once
+
+// Engine geometry
+const float cylinderWidth = 120.0f;
+const float cylinderHeight = 160.0f;
+const float pistonWidth = 70.0f;
+const float pistonHeight = 90.0f;
+const float blockTopY = 220.0f;
+const float blockLeftX = 40.0f;
+const float spacing = 170.0f;      // inline cylinder pitch
+
+// Visual stroke / mapping
+const float stroke = 80.0f;   // piston stroke (vertical travel)
+const float crankRadius = stroke / 2.0f;
+const float conRodLen = 120.0f;
+
+// Derived layout used by display() and the renderers
+const float blockH = 220.0f;
+const float boreInnerW = pistonWidth + 6.0f;
+const float boreInnerH = cylinderHeight - 10.0f;
+const float baseTopY = blockTopY - cylinderHeight/2.0f + 40.0f;
+const float pistonTdcY = baseTopY + 40.0f;                  // piston center Y at top dead centre
+const float wristPinOffset = pistonHeight/2.0f - 8.0f;      // piston center to rod attachment
+// Crank sits one rod length plus one throw below the TDC wrist pin, so the
+// rod keeps its length through the whole stroke.
+const float crankY = pistonTdcY - wristPinOffset - conRodLen - crankRadius;
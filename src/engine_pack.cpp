@@ -0,0 +1,183 @@
+// engine_pack.cpp
+// Compiled, memory-mapped engine descriptions (see engine_pack.h).
+
+#include "engine_pack.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+
+static const char kPackMagic[8] = { 'E', 'N', 'G', 'P', 'A', 'C', 'K', 0 };
+static const uint32_t kByteOrderTag = 0x01020304u;
+
+static uint64_t align64(uint64_t v) {
+    return (v + 63) & ~(uint64_t)63;
+}
+
+static uint32_t floatBits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Reading
+//////////////////////////////////////////////////////////////////////////
+bool EnginePack::open(const std::string& path, std::string& error) {
+    close();
+    if(!file.open(path)) {
+        error = "cannot map " + path;
+        return false;
+    }
+    const uint8_t* base = file.data();
+    uint64_t bytes = file.size();
+    const EnginePackHeader* h = (const EnginePackHeader*)base;
+    const char* why = nullptr;
+    if(bytes < sizeof(EnginePackHeader) || memcmp(h->magic, kPackMagic, sizeof(kPackMagic)) != 0) why = "not an engine pack";
+    else if(h->byteOrder != kByteOrderTag) why = "written on a machine of the other byte order";
+    else if(h->version != kEnginePackVersion) why = "unsupported pack version";
+    else if(h->fileSize != bytes) why = "truncated";
+    else if(h->tableSize < 16 || (h->tableSize & (h->tableSize - 1)) != 0) why = "bad table size";
+    else if(h->tableStride < KinematicsTable::sampleCount(h->tableSize) * sizeof(float) || h->tableStride % 64 != 0)
+        why = "bad table stride";
+    else if(h->entriesOffset % 64 != 0 || h->tablesOffset % 64 != 0) why = "misaligned sections";
+    else if(h->entriesOffset + (uint64_t)h->engineCount * sizeof(EnginePackEntry) > bytes
+            || h->tablesOffset + (uint64_t)h->tableCount * h->tableStride > bytes) why = "section out of bounds";
+    if(why) {
+        error = path + ": " + why;
+        file.close();
+        return false;
+    }
+    header = h;
+    entries = (const EnginePackEntry*)(base + h->entriesOffset);
+    return true;
+}
+
+void EnginePack::close() {
+    file.close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+int EnginePack::find(const char* name) const {
+    int lo = 0, hi = size();
+    while(lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = strncmp(entries[mid].name, name, sizeof(entries[mid].name));
+        if(c == 0) return strlen(name) < sizeof(entries[mid].name) ? mid : -1;
+        if(c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+EngineConfig EnginePack::config(int i) const {
+    const EnginePackEntry& e = entries[i];
+    EngineConfig cfg;
+    memcpy(cfg.name, e.name, sizeof(cfg.name));
+    cfg.name[sizeof(cfg.name) - 1] = '\0';
+    cfg.layout = e.layout <= (uint8_t)BankLayout::Boxer ? (BankLayout)e.layout : BankLayout::Inline;
+    cfg.cylinders = std::max(1, std::min((int)e.cylinders, kMaxCylinders));
+    cfg.bankAngleDeg = e.bankAngleDeg;
+    for(int c=0;c<kMaxCylinders;c++){
+        cfg.firingOrder[c] = e.firingOrder[c] < kMaxCylinders ? e.firingOrder[c] : 0;
+        cfg.phaseOffsetDeg[c] = e.phaseOffsetDeg[c];
+    }
+    cfg.bore = e.bore;
+    cfg.stroke = e.stroke;
+    cfg.rodLength = e.rodLength;
+    cfg.compressionRatio = e.compressionRatio;
+    return cfg;
+}
+
+KinematicsTable EnginePack::kinematics(int i) const {
+    const EnginePackEntry& e = entries[i];
+    SliderCrank geom = { e.stroke * 0.5f, e.rodLength };
+    if(e.table >= header->tableCount) return KinematicsTable(geom, (int)header->tableSize);
+    const uint8_t* t = file.data() + header->tablesOffset + (uint64_t)e.table * header->tableStride;
+    return KinematicsTable(geom, (int)header->tableSize, (const float*)t);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Writing
+//////////////////////////////////////////////////////////////////////////
+bool writeEnginePack(const std::string& path, const std::vector<EngineConfig>& engines, int tableSize,
+                     std::string& error) {
+    std::vector<const EngineConfig*> sorted;
+    sorted.reserve(engines.size());
+    for(const EngineConfig& e: engines) sorted.push_back(&e);
+    std::sort(sorted.begin(), sorted.end(), [](const EngineConfig* a, const EngineConfig* b) {
+        return strncmp(a->name, b->name, sizeof(a->name)) < 0;
+    });
+    for(size_t i=1;i<sorted.size();i++){
+        if(strncmp(sorted[i-1]->name, sorted[i]->name, sizeof(sorted[i]->name)) == 0) {
+            error = std::string("duplicate engine name '") + sorted[i]->name + "'";
+            return false;
+        }
+    }
+
+    // One table per distinct (crank radius, rod length), in first-use order.
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> tableOf;
+    std::vector<SliderCrank> geometries;
+    std::vector<EnginePackEntry> entries(sorted.size());
+    for(size_t i=0;i<sorted.size();i++){
+        const EngineConfig& cfg = *sorted[i];
+        SliderCrank g = engineSliderCrank(cfg);
+        auto key = std::make_pair(floatBits(g.crankRadius), floatBits(g.rodLength));
+        auto it = tableOf.find(key);
+        if(it == tableOf.end()) {
+            it = tableOf.insert(std::make_pair(key, (uint32_t)geometries.size())).first;
+            geometries.push_back(g);
+        }
+        EnginePackEntry& e = entries[i];
+        memset(&e, 0, sizeof(e));
+        strncpy(e.name, cfg.name, sizeof(e.name));
+        e.layout = (uint8_t)cfg.layout;
+        e.cylinders = (uint8_t)cfg.cylinders;
+        e.bankAngleDeg = cfg.bankAngleDeg;
+        memcpy(e.firingOrder, cfg.firingOrder, sizeof(e.firingOrder));
+        memcpy(e.phaseOffsetDeg, cfg.phaseOffsetDeg, sizeof(e.phaseOffsetDeg));
+        e.bore = cfg.bore;
+        e.stroke = cfg.stroke;
+        e.rodLength = cfg.rodLength;
+        e.compressionRatio = cfg.compressionRatio;
+        e.table = it->second;
+    }
+
+    KinematicsTable probe(SliderCrank{ 1.0f, 3.0f }, tableSize);
+    int n = probe.size();
+    size_t tableBytes = KinematicsTable::sampleCount(n) * sizeof(float);
+
+    EnginePackHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, kPackMagic, sizeof(kPackMagic));
+    h.version = kEnginePackVersion;
+    h.byteOrder = kByteOrderTag;
+    h.engineCount = (uint32_t)entries.size();
+    h.tableCount = (uint32_t)geometries.size();
+    h.tableSize = (uint32_t)n;
+    h.tableStride = (uint32_t)align64(tableBytes);
+    h.entriesOffset = align64(sizeof(h));
+    h.tablesOffset = align64(h.entriesOffset + entries.size() * sizeof(EnginePackEntry));
+    h.fileSize = h.tablesOffset + (uint64_t)h.tableCount * h.tableStride;
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) {
+        error = "cannot write " + path;
+        return false;
+    }
+    static const uint8_t zeros[64] = {};
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(!entries.empty()) ok = ok && fwrite(entries.data(), sizeof(EnginePackEntry), entries.size(), f) == entries.size();
+    uint64_t at = h.entriesOffset + entries.size() * sizeof(EnginePackEntry);
+    ok = ok && fwrite(zeros, 1, (size_t)(h.tablesOffset - at), f) == h.tablesOffset - at;
+    for(const SliderCrank& g: geometries){
+        KinematicsTable table(g, n);
+        ok = ok && fwrite(table.samples(), 1, tableBytes, f) == tableBytes;
+        ok = ok && fwrite(zeros, 1, h.tableStride - tableBytes, f) == h.tableStride - tableBytes;
+    }
+    ok = fclose(f) == 0 && ok;
+    if(!ok) error = "error writing " + path;
+    return ok;
+}
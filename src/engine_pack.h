@@ -0,0 +1,84 @@
+// engine_pack.h
+// Compiled engine descriptions: one file holding many EngineConfigs plus a
+// precomputed kinematics table per distinct slider-crank geometry, laid out
+// so that it is used straight from a read-only memory mapping. Opening a pack
+// checks the header and nothing else; engines are looked up by binary search
+// over name-sorted entries, and their tables are viewed in place
+// (KinematicsTable's external-samples constructor), never parsed or copied.
+//
+// Layout (little-endian, all offsets from the start of the file):
+//   EnginePackHeader                      at 0
+//   EnginePackEntry[engineCount]          at entriesOffset, sorted by name
+//   float[5 * (tableSize + 1)] per table  at tablesOffset + t * tableStride,
+//                                         each 64-byte aligned
+// Packs are written by engine_compile (or writeEnginePack) from the text
+// format in engine_config.h.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "crank_kinematics.h"
+#include "engine_config.h"
+#include "mapped_file.h"
+
+const uint32_t kEnginePackVersion = 1;
+
+struct EnginePackHeader {
+    char magic[8];              // "ENGPACK" + NUL
+    uint32_t version;
+    uint32_t byteOrder;         // 0x01020304 as stored by the writer
+    uint32_t engineCount;
+    uint32_t tableCount;
+    uint32_t tableSize;         // kinematics samples per revolution
+    uint32_t tableStride;       // bytes between consecutive tables
+    uint64_t entriesOffset;
+    uint64_t tablesOffset;
+    uint64_t fileSize;
+    uint64_t reserved;
+};
+
+struct EnginePackEntry {
+    char name[32];              // NUL-padded
+    uint8_t layout;             // BankLayout
+    uint8_t cylinders;
+    uint8_t reserved0[2];
+    float bankAngleDeg;
+    uint8_t firingOrder[kMaxCylinders];
+    float phaseOffsetDeg[kMaxCylinders];
+    float bore, stroke, rodLength, compressionRatio;
+    uint32_t table;             // kinematics table index
+    uint32_t reserved1[5];
+};
+
+static_assert(sizeof(EnginePackHeader) == 64, "EnginePackHeader is a file format");
+static_assert(sizeof(EnginePackEntry) == 160, "EnginePackEntry is a file format");
+
+class EnginePack {
+public:
+    // Maps path and validates the header and section bounds.
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    int size() const { return header ? (int)header->engineCount : 0; }
+    int tableSize() const { return header ? (int)header->tableSize : 0; }
+    int tableCount() const { return header ? (int)header->tableCount : 0; }
+    const EnginePackEntry& entry(int i) const { return entries[i]; }
+    // Index of the engine called name, or -1.
+    int find(const char* name) const;
+
+    EngineConfig config(int i) const;
+    // Precomputed table for engine i, viewing the mapping: valid while the
+    // pack stays open. An entry with a bad table index gets a freshly built one.
+    KinematicsTable kinematics(int i) const;
+
+private:
+    MappedFile file;
+    const EnginePackHeader* header = nullptr;
+    const EnginePackEntry* entries = nullptr;
+};
+
+// Sorts engines by name (names must be unique), shares one table between
+// engines of identical stroke and rod length, and writes the pack.
+bool writeEnginePack(const std::string& path, const std::vector<EngineConfig>& engines, int tableSize,
+                     std::string& error);
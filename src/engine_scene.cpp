@@ -0,0 +1,395 @@
+// engine_scene.cpp
+// Landing page and engine drawing (see engine_scene.h).
+
+#include "engine_scene.h"
+#include "circle_table.h"
+#include "crank_kinematics.h"
+#include "engine_config.h"
+#include "engine_geometry.h"
+#include "frame_profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Window
+int winW = 900, winH = 360;
+
+// UI States
+AppState appState = LANDING;
+
+// Landing page button bounds (pixels)
+float btnX = 0, btnY = 0, btnW = 260, btnH = 56;
+bool hoverBtn = false;
+
+RenderBackend* gfx = nullptr;
+
+// Engine description and the layout derived from it
+static EngineConfig currentConfig;
+static EngineLayout currentLayout = buildEngineLayout(currentConfig);
+
+// Largest fan drawCircle / drawRoundedRect will emit in one call.
+static const int kMaxFanSegments = 128;
+
+//////////////////////////////////////////////////////////////////////////
+// Utility drawing helpers
+//////////////////////////////////////////////////////////////////////////
+void drawFilledRect(float cx, float cy, float w, float h) {
+    float x0 = cx - w/2.0f;
+    float y0 = cy - h/2.0f;
+    gfx->fillRect(x0, y0, x0 + w, y0 + h);
+}
+
+void drawRoundedRect(float cx, float cy, float w, float h, float radius, int segments) {
+    // simple rounded rectangle by drawing central rect + corner circles
+    drawFilledRect(cx, cy, w - 2*radius, h);
+    drawFilledRect(cx - (w/2.0f - radius), cy, 2*radius, h - 2*radius);
+    drawFilledRect(cx + (w/2.0f - radius), cy, 2*radius, h - 2*radius);
+    // corners
+    float corners[4][2] = {
+        {cx - w/2.0f + radius, cy - h/2.0f + radius},
+        {cx + w/2.0f - radius, cy - h/2.0f + radius},
+        {cx + w/2.0f - radius, cy + h/2.0f - radius},
+        {cx - w/2.0f + radius, cy + h/2.0f - radius}
+    };
+    // corner c sweeps quarter c+2, 4-c, 0 and 2-c of a 4*segments circle
+    if(segments > kMaxFanSegments) segments = kMaxFanSegments;
+    UnitCircleTable t = unitCircle(4 * segments);
+    const int start[4] = {2*segments, 4*segments, 0, 2*segments};
+    const int dir[4] = {1, -1, 1, -1};
+    float xy[2 * (kMaxFanSegments + 2)];
+    for(int c=0;c<4;c++){
+        xy[0] = corners[c][0];
+        xy[1] = corners[c][1];
+        for(int i=0;i<=segments;i++){
+            int k = start[c] + dir[c]*i;
+            xy[2*i+2] = corners[c][0] + t.cosv[k] * radius;
+            xy[2*i+3] = corners[c][1] + t.sinv[k] * radius;
+        }
+        gfx->fillFan(xy, segments + 2);
+    }
+}
+
+void drawCircle(float cx, float cy, float r, int segments) {
+    if(segments > kMaxFanSegments) segments = kMaxFanSegments;
+    if(segments < kMinCircleSegments) segments = kMinCircleSegments;
+    UnitCircleTable t = unitCircle(segments);
+    float xy[2 * (kMaxFanSegments + 2)];
+    xy[0] = cx;
+    xy[1] = cy;
+    for(int i=0;i<=segments;i++){
+        xy[2*i+2] = cx + t.cosv[i]*r;
+        xy[2*i+3] = cy + t.sinv[i]*r;
+    }
+    gfx->fillFan(xy, segments + 2);
+}
+
+void drawText(const std::string &s, float x, float y, TextFont font) {
+    gfx->text(x, y, s.c_str(), font);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Engine description
+//////////////////////////////////////////////////////////////////////////
+void setEngineConfig(const EngineConfig& cfg) {
+    currentConfig = cfg;
+    currentLayout = buildEngineLayout(cfg);
+}
+
+const EngineConfig& engineConfig() {
+    return currentConfig;
+}
+
+const EngineLayout& engineLayout() {
+    return currentLayout;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Engine drawing and animation
+//////////////////////////////////////////////////////////////////////////
+// Rectangle centred on (dx, y) in the upright frame of cylinder p.
+static void drawCylinderRect(const CylinderPlacement& p, float dx, float y, float w, float h) {
+    if(p.upright) {
+        drawFilledRect(p.crankX + dx, y, w, h);
+        return;
+    }
+    const float cx[4] = { -w/2.0f, w/2.0f, w/2.0f, -w/2.0f };
+    const float cy[4] = { -h/2.0f, -h/2.0f, h/2.0f, h/2.0f };
+    float xy[8];
+    for(int k=0;k<4;k++) cylinderToEngine(p, dx + cx[k], y + cy[k], xy[2*k], xy[2*k+1]);
+    gfx->fillFan(xy, 4);
+}
+
+// First pass of cylinder idx: its position on its crank throw picks the run.
+static int cylinderPassBase(int idx) {
+    int onThrow = 0;
+    for(int j=0;j<idx;j++) onThrow += currentLayout.cyl[j].slot == currentLayout.cyl[idx].slot;
+    return PASS_CYLINDER + std::min(onThrow, kCylindersPerThrow - 1) * kCylinderPasses;
+}
+
+// Pass base of the cylinder being drawn, for drawCombustionEffect.
+static int cylinderPass = PASS_CYLINDER;
+
+void drawCombustionEffect(const CylinderPlacement& p, float cy, float size, int kind, float timef) {
+    ProfileScope scope(ProfPass::Combustion);
+    gfx->blend(true);
+    int layers = kCombustionLayers;
+    for(int i=0;i<layers;i++){
+        gfx->pass(cylinderPass + CYL_COMBUSTION + i);
+        float t = (float)i/layers;
+        float r = size * (0.6f + t*0.8f);
+        float alpha = 0.18f * (1.0f - t) + 0.02f;
+        if(kind==0) gfx->color(0.95f, 0.95f, 0.55f, alpha); // faint yellow
+        else if(kind==1) gfx->color(0.6f, 0.6f, 0.6f, alpha); // compression (darkish cloud)
+        else if(kind==2) gfx->color(1.0f, 0.45f, 0.05f, alpha); // orange flame
+        else gfx->color(0.6f, 0.6f, 0.6f, alpha); // exhaust grey
+        float ox = (sinf(timef*1.5f + i*1.7f) * 6.0f * t) + (i*2.0f);
+        float oy = (cosf(timef*1.1f + i*2.9f) * 8.0f * t) + (i*4.0f);
+        float x, y;
+        cylinderToEngine(p, ox, cy + oy, x, y);
+        drawCircle(x, y, r, 22);
+    }
+    gfx->blend(false);
+}
+
+void drawBlock() {
+    ProfileScope scope(ProfPass::Block);
+    const EngineLayout& L = currentLayout;
+    gfx->pass(PASS_BLOCK);
+    gfx->color(0.58f, 0.58f, 0.58f);
+    if(L.layout == BankLayout::Inline) {
+        float w = L.blockX1 - L.blockX0;
+        drawFilledRect(L.blockX0 + w/2.0f, blockTopY - blockH/2.0f + 20.0f, w, blockH);
+        return;
+    }
+    // One housing per cylinder, all drawn before any bore so banks sharing a
+    // throw do not cover each other's cylinders.
+    float cy = (L.housingY0 + L.housingY1) / 2.0f;
+    for(int i=0;i<L.cylinders;i++)
+        drawCylinderRect(L.cyl[i], 0.0f, cy, 2.0f * L.housingHalfW, L.housingY1 - L.housingY0);
+}
+
+void drawCylinderAndPiston(int idx, float pistonCenterY, int phaseKind, float angleDeg, float timeSec) {
+    const CylinderPlacement& p = currentLayout.cyl[idx];
+    float cyTop = blockTopY - cylinderHeight/2.0f;
+
+    float innerW = boreInnerW;
+    float innerH = boreInnerH;
+    cylinderPass = cylinderPassBase(idx);
+    gfx->pass(cylinderPass + CYL_BORE);
+    gfx->color(0.33f,0.33f,0.33f);
+    drawCylinderRect(p, 0.0f, cyTop, innerW, innerH);
+
+    gfx->pass(cylinderPass + CYL_BORE_OUTLINE);
+    gfx->color(0.18f,0.18f,0.18f);
+    const float corner[8] = {
+        -innerW/2.0f, cyTop - innerH/2.0f,
+         innerW/2.0f, cyTop - innerH/2.0f,
+         innerW/2.0f, cyTop + innerH/2.0f,
+        -innerW/2.0f, cyTop + innerH/2.0f
+    };
+    float outline[8];
+    for(int k=0;k<4;k++) cylinderToEngine(p, corner[2*k], corner[2*k+1], outline[2*k], outline[2*k+1]);
+    gfx->lineLoop(outline, 4);
+
+    float pistonCY = pistonCenterY;
+    gfx->pass(cylinderPass + CYL_PISTON);
+    gfx->color(0.15f,0.15f,0.15f);
+    drawCylinderRect(p, 0.0f, pistonCY, pistonWidth, pistonHeight);
+
+    // piston top grooves
+    gfx->pass(cylinderPass + CYL_GROOVES);
+    gfx->color(0.05f, 0.05f, 0.05f);
+    const float groove[8] = {
+        -pistonWidth/2.0f + 6.0f, pistonCY + pistonHeight/4.0f,
+         pistonWidth/2.0f - 6.0f, pistonCY + pistonHeight/4.0f,
+        -pistonWidth/2.0f + 8.0f, pistonCY,
+         pistonWidth/2.0f - 8.0f, pistonCY
+    };
+    float grooves[8];
+    for(int k=0;k<4;k++) cylinderToEngine(p, groove[2*k], groove[2*k+1], grooves[2*k], grooves[2*k+1]);
+    gfx->lines(grooves, 4);
+
+    float effectY = pistonCY + pistonHeight/2.0f + 12.0f;
+    drawCombustionEffect(p, effectY, combustionEffectSize(idx, angleDeg), phaseKind, timeSec);
+}
+
+const KinematicsTable& engineKinematics() {
+    static const KinematicsTable table(SliderCrank{ crankRadius, conRodLen });
+    return table;
+}
+
+float pistonPositionForCrank(float baseTopY, float angleDeg, float phaseOffsetDeg) {
+    return baseTopY - engineKinematics().displacement(angleDeg + phaseOffsetDeg);
+}
+
+void crankPinPosition(int idx, float angleDeg, float phaseOffsetDeg, float& x, float& y) {
+    float dx, dy;
+    engineKinematics().crankPin(angleDeg + phaseOffsetDeg, dx, dy);
+    cylinderToEngine(currentLayout.cyl[idx], dx, crankY + dy, x, y);
+}
+
+int getPhaseKindForCylinder(float angleDeg, float phaseOffsetDeg) {
+    float a = fmodf(angleDeg + phaseOffsetDeg, 720.0f);
+    if (a < 0) a += 720.0f;
+    if (a < 180.0f) return 0;
+    else if (a < 360.0f) return 1;
+    else if (a < 540.0f) return 2;
+    else return 3;
+}
+
+float combustionEffectSize(int idx, float angleDeg) {
+    return 18.0f + fabsf(sinf(angleDeg * M_PI/180.0f + idx * 0.9f) * 10.0f);
+}
+
+void drawCrankshaft(float x0, float x1, float y) {
+    gfx->pass(PASS_CRANKSHAFT);
+    gfx->color(0.35f, 0.35f, 0.35f);
+    gfx->fillRect(x0, y - 8.0f, x1, y + 8.0f);
+}
+
+void engineOrigin(float& x, float& y, float& scale) {
+    const EngineLayout& L = currentLayout;
+    const float margin = 20.0f;
+    float engineWidth = L.maxX - L.minX;
+    float engineHeight = L.maxY - L.minY;
+    scale = 1.0f;
+    if(engineWidth > winW - 2.0f*margin) scale = (winW - 2.0f*margin) / engineWidth;
+    if(engineHeight * scale > winH - 2.0f*margin) scale = (winH - 2.0f*margin) / engineHeight;
+    if(scale < 0.05f) scale = 0.05f;
+    x = (winW - engineWidth * scale) * 0.5f - L.minX * scale;
+    y = (winH - engineHeight * scale) * 0.5f - L.minY * scale;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Landing page drawing
+//////////////////////////////////////////////////////////////////////////
+void drawLandingPage() {
+    ProfileScope scope(ProfPass::Landing);
+    // Background slightly different
+    gfx->clear(0.96f, 0.96f, 0.98f, 1.0f);
+
+    // Title
+    gfx->color(0.12f, 0.12f, 0.12f);
+    char title[64];
+    if(currentConfig.layout == BankLayout::V) snprintf(title, sizeof(title), "V%d Engine Simulation", currentConfig.cylinders);
+    else if(currentConfig.layout == BankLayout::Boxer) snprintf(title, sizeof(title), "Flat-%d Engine Simulation", currentConfig.cylinders);
+    else snprintf(title, sizeof(title), "%d-Cylinder Engine Simulation", currentConfig.cylinders);
+    float tx = 40.0f;
+    float ty = winH - 70.0f;
+    drawText(title, tx, ty, FONT_TIMES_ROMAN_24);
+
+    // Subtitle / description
+    gfx->color(0.18f, 0.18f, 0.18f);
+    std::string desc = "Visualizes pistons, connecting rods, crankshaft and the 4-stroke cycle.";
+    drawText(desc, tx, ty - 30.0f, FONT_HELVETICA_18);
+    std::string inst = "Click START or press Enter → Space toggles run/pause • 'f'/'s' adjust speed • 'm' return to menu";
+    drawText(inst, tx, ty - 52.0f, FONT_HELVETICA_12);
+
+    // center preview box with faint schematic (draw block + cylinders small)
+    float previewCX = winW - 360.0f;
+    float previewCY = winH/2.0f;
+    gfx->color(0.88f, 0.88f, 0.9f);
+    drawRoundedRect(previewCX, previewCY, 520.0f, 240.0f, 12.0f);
+    // small engine preview inside, one column per crank throw
+    int slots = currentLayout.slots;
+    float previewScale = 0.6f;
+    if(spacing*previewScale*(slots-1) + cylinderWidth*previewScale + 80.0f > 480.0f)
+        previewScale = 400.0f / (spacing*(slots-1) + cylinderWidth);
+    float previewBlockLeft = previewCX - 220.0f;
+    float scaledSpacing = spacing * previewScale;
+    float scaledCylW = cylinderWidth * previewScale;
+    float previewTopY = previewCY + 20.0f;
+    // block
+    gfx->color(0.6f, 0.6f, 0.6f);
+    float pbW = scaledSpacing*(slots-1) + scaledCylW + 80.0f;
+    drawFilledRect(previewBlockLeft + pbW/2.0f, previewTopY - 60.0f, pbW, 160.0f);
+
+    // small pistons
+    for(int i=0;i<slots;i++){
+        float cx = previewBlockLeft + i * scaledSpacing + scaledCylW/2.0f + 20.0f;
+        float cy = previewTopY - 20.0f;
+        gfx->color(0.33f,0.33f,0.33f);
+        drawFilledRect(cx, cy, scaledCylW, cylinderHeight * previewScale);
+    }
+
+    // Draw Start button
+    btnX = 160.0f;
+    btnY = winH/2.0f - 20.0f;
+    float labelY = btnY - 6.0f;
+
+    if(hoverBtn) gfx->color(0.10f, 0.55f, 0.92f);
+    else gfx->color(0.12f, 0.47f, 0.82f);
+    drawRoundedRect(btnX, btnY, btnW, btnH, 10.0f);
+
+    // button text
+    gfx->color(1.0f,1.0f,1.0f);
+    std::string btext = "Start Simulation";
+    float textX = btnX - (btext.size() * 8.0f)/2.0f + 8.0f;
+    drawText(btext, textX, labelY, FONT_HELVETICA_18);
+
+    // footer small
+    gfx->color(0.3f,0.3f,0.3f);
+    drawText("Harshavardhan3015 - Engine Simulation (click Start)", 10.0f, 10.0f, FONT_HELVETICA_12);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Animation view
+//////////////////////////////////////////////////////////////////////////
+void drawEngine(float crankAngleDeg, float timeSec) {
+    // Draw engine (placement from the engine layout)
+    const EngineLayout& L = currentLayout;
+    drawBlock();
+
+    drawCrankshaft(L.crankshaftX0, L.crankshaftX1, crankY);
+
+    for(int i=0;i<L.cylinders;i++){
+        float phaseOffset = L.phaseOffsetDeg[i];
+        float pistonCY = pistonPositionForCrank(pistonTdcY, crankAngleDeg, phaseOffset);
+        int phaseKind = getPhaseKindForCylinder(crankAngleDeg, phaseOffset);
+        drawCylinderAndPiston(i, pistonCY, phaseKind, crankAngleDeg, timeSec);
+
+        float crankPinX, crankPinY;
+        crankPinPosition(i, crankAngleDeg, phaseOffset, crankPinX, crankPinY);
+        float wristX, wristY;
+        cylinderToEngine(L.cyl[i], 0.0f, pistonCY - wristPinOffset, wristX, wristY);
+
+        gfx->pass(cylinderPassBase(i) + CYL_CRANK_PIN);
+        gfx->color(0.20f, 0.20f, 0.20f);
+        drawCircle(crankPinX, crankPinY, 8.0f, 20);
+
+        gfx->pass(cylinderPassBase(i) + CYL_ROD);
+        gfx->lineWidth(6.0f);
+        gfx->color(0.22f, 0.22f, 0.22f);
+        const float rod[4] = {
+            crankPinX, crankPinY,
+            wristX, wristY
+        };
+        gfx->lines(rod, 2);
+        gfx->lineWidth(1.0f);
+    }
+
+    gfx->pass(PASS_WEB);
+    for(int s=0;s<L.slots;s++){
+        float webX = L.slotX[s];
+        gfx->color(0.28f, 0.28f, 0.28f);
+        drawFilledRect(webX - 6.0f, crankY, 28.0f, 10.0f);
+        drawCircle(webX, crankY, 12.0f, 24);
+    }
+}
+
+void drawAnimationFrame(float crankAngleDeg, float timeSec) {
+    // Animation state: clear
+    gfx->clear(0.92f, 0.92f, 0.94f, 1.0f);
+
+    // === CENTER ENGINE ===
+    float ox, oy, scale;
+    engineOrigin(ox, oy, scale);
+    gfx->pushTransform(ox, oy, scale);
+    drawEngine(crankAngleDeg, timeSec);
+    gfx->popTransform(); // restore
+}
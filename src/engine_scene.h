@@ -0,0 +1,77 @@
+// engine_scene.h
+// Landing page and engine drawing, written against RenderBackend so the same
+// code renders through GL in the window and through the software rasterizer
+// in headless mode.
+#pragma once
+
+#include <string>
+#include "render_backend.h"
+
+class KinematicsTable;
+struct EngineConfig;
+struct EngineLayout;
+
+// Window
+extern int winW, winH;
+
+// UI States
+enum AppState { LANDING, ANIMATION };
+extern AppState appState;
+
+// Landing page button bounds (pixels)
+extern float btnX, btnY, btnW, btnH;
+extern bool hoverBtn;
+
+// Backend the helpers draw through; set by main() / the headless loop.
+extern RenderBackend* gfx;
+
+// Painter's-order layers of the animation (RenderBackend::pass), so a
+// RenderQueue can group draws by state without changing a pixel. Within a
+// layer, draws of different cylinders do not overlap: cylinders on one
+// crank throw (V and boxer banks) overlap each other, so each position on
+// the throw gets its own run of cylinder passes, in cylinder order. Each
+// combustion cloud layer is a pass because one cloud's layers blend in order.
+const int kCombustionLayers = 6;
+enum CylinderPass {
+    CYL_BORE, CYL_BORE_OUTLINE, CYL_PISTON, CYL_GROOVES,
+    CYL_COMBUSTION,                                   // + cloud layer
+    CYL_CRANK_PIN = CYL_COMBUSTION + kCombustionLayers, CYL_ROD,
+    kCylinderPasses
+};
+const int kCylindersPerThrow = 2;
+enum ScenePass {
+    PASS_BLOCK, PASS_CRANKSHAFT,
+    PASS_CYLINDER,                                    // + throw position * kCylinderPasses + CylinderPass
+    PASS_WEB = PASS_CYLINDER + kCylindersPerThrow * kCylinderPasses,
+};
+
+// Utility drawing helpers
+void drawFilledRect(float cx, float cy, float w, float h);
+void drawRoundedRect(float cx, float cy, float w, float h, float radius = 8.0f, int segments = 12);
+void drawCircle(float cx, float cy, float r, int segments = 32);
+void drawText(const std::string &s, float x, float y, TextFont font = FONT_HELVETICA_18);
+
+// Engine description the scene draws (default: the original inline-4). Set it
+// once at startup; the layout is rebuilt here, never per frame.
+void setEngineConfig(const EngineConfig& cfg);
+const EngineConfig& engineConfig();
+const EngineLayout& engineLayout();
+
+// Engine kinematics used by the drawing code (exact slider-crank, via a
+// table built once for the layout's crank radius and rod length).
+const KinematicsTable& engineKinematics();
+// Piston center Y for a piston whose TDC center is at baseTopY.
+float pistonPositionForCrank(float baseTopY, float angleDeg, float phaseOffsetDeg);
+void crankPinPosition(int idx, float angleDeg, float phaseOffsetDeg, float& x, float& y);
+int getPhaseKindForCylinder(float angleDeg, float phaseOffsetDeg);
+float combustionEffectSize(int idx, float angleDeg);
+
+// Translation and scale (at most 1) that fit and center the engine in the
+// current window; apply with gfx->pushTransform(x, y, scale).
+void engineOrigin(float& x, float& y, float& scale);
+
+void drawLandingPage();
+// Engine only, in engine-local coordinates (caller applies engineOrigin).
+void drawEngine(float crankAngleDeg, float timeSec);
+// Clear + centered engine: the full animation view.
+void drawAnimationFrame(float crankAngleDeg, float timeSec);
@@ -1,372 +1,421 @@
 // engine_sim.cpp
-// 4-Cylinder Engine Simulation with Landing Page (OpenGL + GLUT / freeglut)
+// Engine Simulation with Landing Page (OpenGL + GLUT / freeglut)
 // Includes centering so the engine is always centered in the window.
 // Compile (Linux):
-//   g++ src/engine_sim.cpp -o engine_sim -lGL -lGLU -lglut
+//   g++ -O2 src/engine_sim.cpp src/engine_scene.cpp src/engine_config.cpp src/engine_pack.cpp src/mapped_file.cpp src/gl_backend.cpp src/gl_ext.cpp src/retained_renderer.cpp src/crank_kinematics.cpp src/soft_raster.cpp src/span_kernels.cpp src/cpu_features.cpp src/command_list.cpp src/tile_renderer.cpp src/thread_pool.cpp src/sim_core.cpp src/telemetry_stream.cpp src/telemetry_log.cpp src/telemetry_codec.cpp src/image_io.cpp src/session_log.cpp src/frame_profiler.cpp src/gl_pass_clock.cpp src/trace_export.cpp src/gl_call_stats.cpp src/render_queue.cpp -o engine_sim -lGL -lGLU -lglut -pthread
 // Windows MinGW (MSYS2):
-//   g++ src/engine_sim.cpp -o engine_sim.exe -lfreeglut -lopengl32 -lglu32
+//   g++ -O2 src/engine_sim.cpp src/engine_scene.cpp src/engine_config.cpp src/engine_pack.cpp src/mapped_file.cpp src/gl_backend.cpp src/gl_ext.cpp src/retained_renderer.cpp src/crank_kinematics.cpp src/soft_raster.cpp src/span_kernels.cpp src/cpu_features.cpp src/command_list.cpp src/tile_renderer.cpp src/thread_pool.cpp src/sim_core.cpp src/telemetry_stream.cpp src/telemetry_log.cpp src/telemetry_codec.cpp src/image_io.cpp src/session_log.cpp src/frame_profiler.cpp src/gl_pass_clock.cpp src/trace_export.cpp src/gl_call_stats.cpp src/render_queue.cpp -o engine_sim.exe -lfreeglut -lopengl32 -lglu32
 // Windows MSVC (Developer Command Prompt):
-//   cl /EHsc src\engine_sim.cpp /Fe:engine_sim.exe freeglut.lib opengl32.lib glu32.lib
+//   cl /EHsc /O2 /std:c++17 src\engine_sim.cpp src\engine_scene.cpp src\engine_config.cpp src\engine_pack.cpp src\mapped_file.cpp src\gl_backend.cpp src\gl_ext.cpp src\retained_renderer.cpp src\crank_kinematics.cpp src\soft_raster.cpp src\span_kernels.cpp src\cpu_features.cpp src\command_list.cpp src\tile_renderer.cpp src\thread_pool.cpp src\sim_core.cpp src\telemetry_stream.cpp src\telemetry_log.cpp src\telemetry_codec.cpp src\image_io.cpp src\session_log.cpp src\frame_profiler.cpp src\gl_pass_clock.cpp src\trace_export.cpp src\gl_call_stats.cpp src\render_queue.cpp /Fe:engine_sim.exe freeglut.lib opengl32.lib glu32.lib
+//
+// Headless (no window / GPU): renders into the software rasterizer and dumps frames
+//   engine_sim --headless [--frames N] [--step DEG] [--size WxH] [--scale S] [--out PREFIX] [--format png|ppm]
+//              [--threads N]   (tile-parallel rasterization; default: all cores)
+// Engine description (preset name or spec file, default inline-4):  engine_sim --engine v8
+//   from a compiled pack (engine_compile):  engine_sim --engine-pack fleet.epk [--engine NAME]
+// Simulation rate (fixed steps per second, independent of the display):  engine_sim --sim-hz 10000
+// Per-step telemetry (crank angle, speed, piston Y and phase per cylinder) to a
+// chunked log readable with engine_sim_batch --inspect:  engine_sim --log run.elog
+// Input session record / replay: --record logs every input event and clock
+// read; --replay reruns the session headless at full speed through the same
+// handlers, checks each frame's state against the recording and reports
+// frames/s and a hash of the frames (optionally written with --out):
+//   engine_sim --record session.ses      engine_sim --replay session.ses [--out PREFIX]
+// Frame profiler: 'p' toggles an overlay with the frame-time graph, p50/p95/p99,
+// draw calls, vertices and CPU (and, with GL 3.3 timer queries, GPU) time per
+// pass: display, landing, block, combustion, retained, sim step, swap.
+// Span trace (timer ticks and their interval, sim steps, each draw helper,
+// swap, tile rasterization) for chrome://tracing or ui.perfetto.dev, in any
+// mode; Chrome JSON for .json paths, Perfetto protobuf otherwise:
+//   engine_sim --trace run.perfetto-trace      engine_sim --replay s.ses --trace replay.json
+// GL call counts per frame and per entry point (calls, vertices, state
+// changes and redundant ones) for the fixed animation sequence and the
+// landing page, without a window; --gl-budget fails the run when a count
+// exceeds the budget file, --gl-budget-write records the current counts:
+//   engine_sim --gl-count [--frames N] [--gl-budget FILE] [--gl-budget-write FILE]
+// (the 'p' overlay shows the same counts live.) Without vertex buffers the
+// animation is drawn through a state-sorted RenderQueue (render_queue.h).
+// Software rasterizer in the window instead of GL:   engine_sim --backend soft [--isa scalar|sse2|avx2]
+// Pixel comparison of the two paths over the same frame sequence:
+//   engine_sim --capture gl_            (GL window, reads back each frame, then exits)
+//   engine_sim --headless --reference gl_ [--tolerance 8] [--max-diff-pct 1]
 
 #include <GL/glut.h>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <string>
 #include <algorithm>
-
-// MSVC does not always define M_PI, M_PI_2 — define manually if missing
+#include <chrono>
+#include "engine_config.h"
+#include "engine_geometry.h"
+#include "engine_pack.h"
+#include "engine_scene.h"
+#include "frame_profiler.h"
+#include "gl_backend.h"
+#include "gl_call_stats.h"
+#include "gl_pass_clock.h"
+#include "image_io.h"
+#include "render_queue.h"
+#include "retained_renderer.h"
+#include "session_log.h"
+#include "sim_core.h"
+#include "soft_raster.h"
+#include "span_kernels.h"
+#include "telemetry_log.h"
+#include "command_list.h"
+#include "thread_pool.h"
+#include "tile_renderer.h"
+#include "trace_export.h"
+
+// MSVC does not always define M_PI — define manually if missing
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
-#ifndef M_PI_2
-#define M_PI_2 1.57079632679489661923
-#endif
+// Animation: the sim runs in fixed steps; timer() only feeds it wall-clock time.
+static SimCore sim;
+int lastTime = 0;
 
-// Window
-int winW = 900, winH = 360;
+static GLBackend glBackend;
 
-// Animation
-float crankAngle = 0.0f;            // degrees
-float crankSpeedDegPerSec = 90.0f;  // degrees per second (adjust speed)
-int lastTime = 0;
+//////////////////////////////////////////////////////////////////////////
+// Run options
+//////////////////////////////////////////////////////////////////////////
+struct RunOptions {
+    bool headless = false;
+    bool softBackend = false;      // rasterize on the CPU even in the window
+    bool forceIsa = false;
+    SpanIsa isa = SpanIsa::AVX2;
+    int frames = 180;
+    float stepDeg = 4.0f;          // simulated crank-angle advance per frame
+    int width = 900, height = 360;
+    float scale = 1.0f;            // output pixels per scene unit (headless)
+    double simHz = 10000.0;        // fixed simulation step rate
+    int threads = 0;               // headless raster threads, 0 = hardware_concurrency
+    std::string outPrefix = "frame_";
+    bool png = true;
+    std::string capturePrefix;     // GL readback of the deterministic sequence
+    std::string referencePrefix;   // compare headless frames against these
+    int tolerance = 8;
+    float maxDiffPct = 1.0f;
+    std::string engine;            // preset name or description file
+    std::string enginePack;        // compiled pack searched first for engine
+    std::string logPath;           // per-step telemetry log
+    std::string recordPath;        // input session to record
+    std::string replayPath;        // input session to replay headless
+    std::string tracePath;         // span trace
+    bool glCount = false;          // count the GL calls of the sequence, no window
+    std::string glBudgetPath;      // fail if counts exceed this
+    std::string glBudgetWritePath; // write the counts as a budget
+    bool outSet = false;           // --out given (replay writes frames only then)
+};
+
+static RunOptions options;
+
+// Deterministic frame sequence shared by headless, capture and reference
+// runs: frame i shows crank angle i*step, and the combustion jitter clock is
+// the time the engine would take to get there at the default speed.
+static const float kSequenceSpeedDegPerSec = 90.0f;
+
+static float sequenceAngle(int i) {
+    return fmodf(i * options.stepDeg, 720.0f);
+}
 
-// Engine geometry
-const float cylinderWidth = 120.0f;
-const float cylinderHeight = 160.0f;
-const float pistonWidth = 70.0f;
-const float pistonHeight = 90.0f;
-const int numCyl = 4;
-const float blockTopY = 220.0f;
-const float blockLeftX = 40.0f;
-const float spacing = 170.0f;
-
-// Visual stroke / mapping
-const float stroke = 80.0f;   // piston stroke (vertical travel)
-const float crankRadius = stroke / 2.0f;
-const float conRodLen = 120.0f;
-
-// UI States
-enum AppState { LANDING, ANIMATION };
-AppState appState = LANDING;
-
-// Landing page button bounds (pixels)
-float btnX = 0, btnY = 0, btnW = 260, btnH = 56;
-bool hoverBtn = false;
+static float sequenceTime(int i) {
+    return (i * options.stepDeg) / kSequenceSpeedDegPerSec;
+}
+
+static std::string sequencePath(const std::string& prefix, int i, const char* ext) {
+    char name[32];
+    snprintf(name, sizeof(name), "%04d.%s", i, ext);
+    return prefix + name;
+}
+
+// Windowed software rendering target, blitted with glDrawPixels.
+static Framebuffer windowFb;
+static int captureFrame = 0;
 
 //////////////////////////////////////////////////////////////////////////
-// Utility drawing helpers
+// Telemetry log
 //////////////////////////////////////////////////////////////////////////
-void drawFilledRect(float cx, float cy, float w, float h) {
-    float x0 = cx - w/2.0f;
-    float y0 = cy - h/2.0f;
-    glBegin(GL_QUADS);
-      glVertex2f(x0, y0);
-      glVertex2f(x0 + w, y0);
-      glVertex2f(x0 + w, y0 + h);
-      glVertex2f(x0, y0 + h);
-    glEnd();
-}
-
-void drawRoundedRect(float cx, float cy, float w, float h, float radius = 8.0f, int segments = 12) {
-    // simple rounded rectangle by drawing central rect + corner circles
-    drawFilledRect(cx, cy, w - 2*radius, h);
-    drawFilledRect(cx - (w/2.0f - radius), cy, 2*radius, h - 2*radius);
-    drawFilledRect(cx + (w/2.0f - radius), cy, 2*radius, h - 2*radius);
-    // corners
-    float corners[4][2] = {
-        {cx - w/2.0f + radius, cy - h/2.0f + radius},
-        {cx + w/2.0f - radius, cy - h/2.0f + radius},
-        {cx + w/2.0f - radius, cy + h/2.0f - radius},
-        {cx - w/2.0f + radius, cy + h/2.0f - radius}
-    };
-    for(int c=0;c<4;c++){
-        glBegin(GL_TRIANGLE_FAN);
-        glVertex2f(corners[c][0], corners[c][1]);
-        for(int i=0;i<=segments;i++){
-            float a = (float)i/segments * M_PI_2;
-            float ax = cosf(a) * radius;
-            float ay = sinf(a) * radius;
-            if(c==0) glVertex2f(corners[c][0] - ax, corners[c][1] - ay);
-            if(c==1) glVertex2f(corners[c][0] + ax, corners[c][1] - ay);
-            if(c==2) glVertex2f(corners[c][0] + ax, corners[c][1] + ay);
-            if(c==3) glVertex2f(corners[c][0] - ax, corners[c][1] + ay);
-        }
-        glEnd();
+// One row per sim step, fed by the step callback; closed at exit.
+static TelemetryLogWriter simLog;
+static const int kSimLogChunkRows = 8192;
+
+static void logStep(const SimState& s) {
+    const EngineLayout& layout = engineLayout();
+    float angle = (float)s.crankAngleDeg;
+    *(float*)simLog.column(0) = angle;
+    *(float*)simLog.column(1) = (float)s.crankSpeedDegPerSec;
+    float* pistonY = (float*)simLog.column(2);
+    uint8_t* phase = simLog.column(3);
+    for(int i=0;i<layout.cylinders;i++){
+        pistonY[i] = pistonPositionForCrank(pistonTdcY, angle, layout.phaseOffsetDeg[i]);
+        phase[i] = (uint8_t)getPhaseKindForCylinder(angle, layout.phaseOffsetDeg[i]);
+    }
+    if(!simLog.endRows(1)) {
+        fprintf(stderr, "engine_sim: telemetry log write failed\n");
+        sim.setStepCallback(nullptr);
     }
 }
 
-void drawCircle(float cx, float cy, float r, int segments = 32) {
-    glBegin(GL_TRIANGLE_FAN);
-      glVertex2f(cx, cy);
-      for(int i=0;i<=segments;i++){
-          float a = (float)i/segments * 2.0f * M_PI;
-          glVertex2f(cx + cosf(a)*r, cy + sinf(a)*r);
-      }
-    glEnd();
+static void closeSimLog() {
+    sim.setStepCallback(nullptr);
+    simLog.close();
 }
 
-void drawText(const std::string &s, float x, float y, void* font = GLUT_BITMAP_HELVETICA_18) {
-    glRasterPos2f(x, y);
-    for(char c: s) glutBitmapCharacter(font, c);
+static bool openSimLog(const std::string& path) {
+    TelemetryHeader header = {};
+    header.engines = 1;
+    header.cylinders = (uint32_t)engineLayout().cylinders;
+    header.sampleHz = sim.stepHz();
+    snprintf(header.engineName, sizeof(header.engineName), "%s", engineConfig().name);
+    const struct { const char* name; TelemetryType type; TelemetryScope scope; } defs[] = {
+        { "crank_angle_deg", TelemetryType::F32, TelemetryScope::Engine },
+        { "crank_speed_dps", TelemetryType::F32, TelemetryScope::Engine },
+        { "piston_y", TelemetryType::F32, TelemetryScope::Cylinder },
+        { "phase", TelemetryType::U8, TelemetryScope::Cylinder },
+    };
+    std::vector<TelemetryColumn> columns;
+    for(const auto& d: defs){
+        TelemetryColumn c = {};
+        snprintf(c.name, sizeof(c.name), "%s", d.name);
+        c.type = (uint8_t)d.type;
+        c.scope = (uint8_t)d.scope;
+        c.codec = (uint8_t)TelemetryCodec::Delta;   // lossless; smooth at the sim rate
+        columns.push_back(c);
+    }
+    std::string error;
+    if(!simLog.open(path, header, columns, kSimLogChunkRows, error)) {
+        fprintf(stderr, "engine_sim: %s\n", error.c_str());
+        return false;
+    }
+    sim.setStepCallback(logStep);
+    atexit(closeSimLog);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
-// Engine drawing and animation
+// Input session
 //////////////////////////////////////////////////////////////////////////
-void drawCombustionEffect(float cx, float cy, float size, int kind) {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    int layers = 6;
-    float timef = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
-    for(int i=0;i<layers;i++){
-        float t = (float)i/layers;
-        float r = size * (0.6f + t*0.8f);
-        float alpha = 0.18f * (1.0f - t) + 0.02f;
-        if(kind==0) glColor4f(0.95f, 0.95f, 0.55f, alpha); // faint yellow
-        else if(kind==1) glColor4f(0.6f, 0.6f, 0.6f, alpha); // compression (darkish cloud)
-        else if(kind==2) glColor4f(1.0f, 0.45f, 0.05f, alpha); // orange flame
-        else glColor4f(0.6f, 0.6f, 0.6f, alpha); // exhaust grey
-        float ox = (sinf(timef*1.5f + i*1.7f) * 6.0f * t) + (i*2.0f);
-        float oy = (cosf(timef*1.1f + i*2.9f) * 8.0f * t) + (i*4.0f);
-        drawCircle(cx + ox, cy + oy, r, 22);
-    }
-    glDisable(GL_BLEND);
-}
-
-void drawBlock() {
-    glColor3f(0.58f, 0.58f, 0.58f);
-    float blockW = spacing*(numCyl-1) + cylinderWidth + 80.0f;
-    float blockH = 220.0f;
-    drawFilledRect(blockLeftX + blockW/2.0f, blockTopY - blockH/2.0f + 20.0f, blockW, blockH);
-}
-
-void drawCylinderAndPiston(int idx, float pistonCenterY, int phaseKind) {
-    float cx = blockLeftX + idx * spacing + cylinderWidth/2.0f + 20.0f;
-    float cyTop = blockTopY - cylinderHeight/2.0f;
-
-    float innerW = pistonWidth + 6.0f;
-    float innerH = cylinderHeight - 10.0f;
-    glColor3f(0.33f,0.33f,0.33f);
-    drawFilledRect(cx, cyTop, innerW, innerH);
-
-    glColor3f(0.18f,0.18f,0.18f);
-    glBegin(GL_LINE_LOOP);
-      float x0 = cx - innerW/2.0f;
-      float y0 = cyTop - innerH/2.0f;
-      glVertex2f(x0, y0);
-      glVertex2f(x0 + innerW, y0);
-      glVertex2f(x0 + innerW, y0 + innerH);
-      glVertex2f(x0, y0 + innerH);
-    glEnd();
-
-    float pistonCX = cx;
-    float pistonCY = pistonCenterY;
-    glColor3f(0.15f,0.15f,0.15f);
-    drawFilledRect(pistonCX, pistonCY, pistonWidth, pistonHeight);
-
-    // piston top grooves
-    glColor3f(0.05f, 0.05f, 0.05f);
-    glBegin(GL_LINES);
-      glVertex2f(pistonCX - pistonWidth/2.0f + 6.0f, pistonCY + pistonHeight/4.0f);
-      glVertex2f(pistonCX + pistonWidth/2.0f - 6.0f, pistonCY + pistonHeight/4.0f);
-      glVertex2f(pistonCX - pistonWidth/2.0f + 8.0f, pistonCY);
-      glVertex2f(pistonCX + pistonWidth/2.0f - 8.0f, pistonCY);
-    glEnd();
-
-    float effectY = pistonCY + pistonHeight/2.0f + 12.0f;
-    float effectSize = 18.0f + fabsf(sinf(crankAngle * M_PI/180.0f + idx * 0.9f) * 10.0f);
-    drawCombustionEffect(pistonCX, effectY, effectSize, phaseKind);
-}
-
-float pistonPositionForCrank(float baseTopY, float angleDeg, float phaseOffsetDeg) {
-    float a = (angleDeg + phaseOffsetDeg) * M_PI / 180.0f;
-    float R = crankRadius;
-    float disp = R - R * cosf(a);
-    float smallCOR = (1.0f - cosf(a)) * (R*0.15f);
-    float total = baseTopY - disp - smallCOR;
-    return total;
-}
-
-int getPhaseKindForCylinder(float angleDeg, float phaseOffsetDeg) {
-    float a = fmodf(angleDeg + phaseOffsetDeg, 720.0f);
-    if (a < 0) a += 720.0f;
-    if (a < 180.0f) return 0;
-    else if (a < 360.0f) return 1;
-    else if (a < 540.0f) return 2;
-    else return 3;
-}
-
-void drawCrankshaft(float x, float y, float length) {
-    glPushMatrix();
-      glColor3f(0.35f, 0.35f, 0.35f);
-      glBegin(GL_QUADS);
-        glVertex2f(x - length/2.0f, y - 8.0f);
-        glVertex2f(x + length/2.0f, y - 8.0f);
-        glVertex2f(x + length/2.0f, y + 8.0f);
-        glVertex2f(x - length/2.0f, y + 8.0f);
-      glEnd();
-    glPopMatrix();
+// The handlers reach the outside world only through elapsedMs(),
+// postRedisplay() and requestQuit(). Recording wraps the GLUT callbacks and
+// logs the clock; replay answers the clock from the log and drops the rest.
+static SessionRecorder sessionRec;
+
+struct ReplayRun {
+    SessionReplay log;
+    bool quit = false;          // ESC replayed
+    std::string divergence;     // first mismatch with the recording
+};
+
+static ReplayRun* replaying = nullptr;
+
+static int elapsedMs() {
+    if(replaying) {
+        SessionEvent ev;
+        if(replaying->log.next(ev) && ev.type == SessionEventType::Time) return (int)ev.clockMs;
+        if(replaying->divergence.empty()) replaying->divergence = "clock read not in the recording";
+        return 0;
+    }
+    int t = glutGet(GLUT_ELAPSED_TIME);
+    sessionRec.time(t);
+    return t;
+}
+
+static void postRedisplay() {
+    if(!replaying) glutPostRedisplay();
+}
+
+static void requestQuit() {
+    if(replaying) replaying->quit = true;
+    else exit(0);
+}
+
+// Everything a frame depends on besides the engine: replay compares it
+// with the recording before drawing.
+static uint32_t sceneFingerprint(float angle, float timeSec) {
+    uint32_t s[8];
+    memcpy(&s[0], &angle, 4);
+    memcpy(&s[1], &timeSec, 4);
+    s[2] = (uint32_t)appState;
+    s[3] = hoverBtn ? 1u : 0u;
+    s[4] = (uint32_t)winW;
+    s[5] = (uint32_t)winH;
+    uint64_t step = sim.current().step;
+    memcpy(&s[6], &step, 8);
+    return sessionHash(s, sizeof(s));
+}
+
+static void closeSession() {
+    sessionRec.close();
+}
+
+static bool openSession(const std::string& path) {
+    SessionHeader header = {};
+    header.flags = options.softBackend ? (uint32_t)SessionSoftBackend : 0u;
+    header.simHz = sim.stepHz();
+    header.winW = winW;
+    header.winH = winH;
+    header.engine = engineConfig();
+    std::string error;
+    if(!sessionRec.open(path, header, error)) {
+        fprintf(stderr, "engine_sim: %s\n", error.c_str());
+        return false;
+    }
+    atexit(closeSession);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
-// Landing page drawing
+// Span trace
 //////////////////////////////////////////////////////////////////////////
-void drawLandingPage() {
-    // Background slightly different
-    glClearColor(0.96f, 0.96f, 0.98f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Title
-    glColor3f(0.12f, 0.12f, 0.12f);
-    std::string title = "4-Cylinder Engine Simulation";
-    float tx = 40.0f;
-    float ty = winH - 70.0f;
-    drawText(title, tx, ty, GLUT_BITMAP_TIMES_ROMAN_24);
-
-    // Subtitle / description
-    glColor3f(0.18f, 0.18f, 0.18f);
-    std::string desc = "Visualizes pistons, connecting rods, crankshaft and the 4-stroke cycle.";
-    drawText(desc, tx, ty - 30.0f, GLUT_BITMAP_HELVETICA_18);
-    std::string inst = "Click START or press Enter → Space toggles run/pause • 'f'/'s' adjust speed • 'm' return to menu";
-    drawText(inst, tx, ty - 52.0f, GLUT_BITMAP_HELVETICA_12);
-
-    // center preview box with faint schematic (draw block + cylinders small)
-    float previewCX = winW - 360.0f;
-    float previewCY = winH/2.0f;
-    glColor3f(0.88f, 0.88f, 0.9f);
-    drawRoundedRect(previewCX, previewCY, 520.0f, 240.0f, 12.0f);
-    // small engine preview inside
-    float previewBlockLeft = previewCX - 220.0f;
-    float scaledSpacing = spacing * 0.6f;
-    float scaledCylW = cylinderWidth * 0.6f;
-    float previewTopY = previewCY + 20.0f;
-    // block
-    glColor3f(0.6f, 0.6f, 0.6f);
-    float pbW = scaledSpacing*(numCyl-1) + scaledCylW + 80.0f;
-    drawFilledRect(previewBlockLeft + pbW/2.0f, previewTopY - 60.0f, pbW, 160.0f);
-
-    // small pistons
-    for(int i=0;i<numCyl;i++){
-        float cx = previewBlockLeft + i * scaledSpacing + scaledCylW/2.0f + 20.0f;
-        float cy = previewTopY - 20.0f;
-        glColor3f(0.33f,0.33f,0.33f);
-        drawFilledRect(cx, cy, scaledCylW, cylinderHeight * 0.6f);
-    }
-
-    // Draw Start button
-    btnX = 160.0f;
-    btnY = winH/2.0f - 20.0f;
-    float labelY = btnY - 6.0f;
-
-    if(hoverBtn) glColor3f(0.10f, 0.55f, 0.92f);
-    else glColor3f(0.12f, 0.47f, 0.82f);
-    drawRoundedRect(btnX, btnY, btnW, btnH, 10.0f);
-
-    // button text
-    glColor3f(1.0f,1.0f,1.0f);
-    std::string btext = "Start Simulation";
-    float textX = btnX - (btext.size() * 8.0f)/2.0f + 8.0f;
-    drawText(btext, textX, labelY, GLUT_BITMAP_HELVETICA_18);
-
-    // footer small
-    glColor3f(0.3f,0.3f,0.3f);
-    drawText("Harshavardhan3015 - Engine Simulation (click Start)", 10.0f, 10.0f, GLUT_BITMAP_HELVETICA_12);
-
-    glutSwapBuffers();
+static bool openTrace(const std::string& path) {
+    std::string error;
+    if(!traceOpen(path, traceFormatForPath(path), error)) {
+        fprintf(stderr, "engine_sim: %s\n", error.c_str());
+        return false;
+    }
+    atexit(traceClose);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Main display
 //////////////////////////////////////////////////////////////////////////
-void display() {
-    if(appState == LANDING) {
-        drawLandingPage();
-        return;
-    }
-
+static void drawAnimationRetained(float angle, float timeSec) {
     // Animation state: clear
-    glClearColor(0.92f, 0.92f, 0.94f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gfx->clear(0.92f, 0.92f, 0.94f, 1.0f);
 
     // === CENTER ENGINE ===
-    glPushMatrix();
-    float engineWidth  = spacing * (numCyl - 1) + cylinderWidth + 80.0f;
-    float engineHeight = 260.0f; // approximate height that includes block + crank area
-    float centerX = (winW - engineWidth) * 0.5f;
-    float centerY = (winH - engineHeight) * 0.5f;
-    glTranslatef(centerX, centerY, 0.0f);
-
-    // Draw engine (uses blockLeftX, blockTopY, spacing, etc.)
-    drawBlock();
-
-    float baseTopY = blockTopY - cylinderHeight/2.0f + 40.0f;
-    float crankY = blockTopY + 40.0f;
-    float crankX = blockLeftX + (spacing*(numCyl-1))/2.0f + cylinderWidth/2.0f + 20.0f;
-    drawCrankshaft(crankX, crankY, spacing*(numCyl-1) + 120.0f);
-
-    for(int i=0;i<numCyl;i++){
-        float cylinderX = blockLeftX + i * spacing + cylinderWidth/2.0f + 20.0f;
-        float phaseOffset = i * 180.0f;
-        float pistonCY = pistonPositionForCrank(baseTopY + 40.0f, crankAngle, phaseOffset);
-        int phaseKind = getPhaseKindForCylinder(crankAngle, phaseOffset);
-        drawCylinderAndPiston(i, pistonCY, phaseKind);
-
-        float lateral = (i - (numCyl-1)/2.0f) * spacing;
-        float a = (crankAngle + phaseOffset) * M_PI/180.0f;
-        float crankPinX = crankX + lateral;
-        float crankPinY = crankY - crankRadius * sinf(a);
-
-        glColor3f(0.20f, 0.20f, 0.20f);
-        drawCircle(crankPinX, crankPinY, 8.0f, 20);
-
-        glLineWidth(6.0f);
-        glColor3f(0.22f, 0.22f, 0.22f);
-        glBegin(GL_LINES);
-          glVertex2f(crankPinX, crankPinY);
-          glVertex2f(cylinderX, pistonCY - pistonHeight/2.0f + 8.0f);
-        glEnd();
-        glLineWidth(1.0f);
-    }
-
-    for(int i=0;i<numCyl;i++){
-        float lateral = (i - (numCyl-1)/2.0f) * spacing;
-        float a = (crankAngle + i*180.0f) * M_PI/180.0f;
-        float crankPinX = crankX + lateral;
-        float crankPinY = crankY - crankRadius * sinf(a);
-        glColor3f(0.28f, 0.28f, 0.28f);
-        drawFilledRect(crankPinX - 6.0f, crankY, 28.0f, 10.0f);
-        drawCircle(crankPinX, crankY, 12.0f, 24);
-    }
-
-    glPopMatrix(); // restore
-    glutSwapBuffers();
+    float ox, oy, scale;
+    engineOrigin(ox, oy, scale);
+    gfx->pushTransform(ox, oy, scale);
+
+    const EngineLayout& layout = engineLayout();
+    EngineFrame frame;
+    frame.cylinders = layout.cylinders;
+    frame.timeSec = timeSec;
+    for(int i=0;i<layout.cylinders;i++){
+        float phaseOffset = layout.phaseOffsetDeg[i];
+        frame.pistonY[i] = pistonPositionForCrank(pistonTdcY, angle, phaseOffset);
+        frame.phaseKind[i] = getPhaseKindForCylinder(angle, phaseOffset);
+        crankPinPosition(i, angle, phaseOffset, frame.crankPinX[i], frame.crankPinY[i]);
+        frame.effectSize[i] = combustionEffectSize(i, angle);
+    }
+    retainedDrawEngine(frame);
+
+    gfx->popTransform(); // restore
+}
+
+// The immediate-mode animation is recorded into a state-sorted queue and
+// flushed once, so blend and line width are set per pass rather than per
+// cylinder; the queue keeps its storage, so frames allocate nothing.
+static RenderQueue frameQueue;
+
+static void drawAnimationQueued(float angle, float timeSec) {
+    RenderBackend* target = gfx;
+    frameQueue.begin(target);
+    gfx = &frameQueue;
+    drawAnimationFrame(angle, timeSec);
+    frameQueue.flush();
+    gfx = target;
+}
+
+static void drawScene(float angle, float timeSec) {
+    if(appState == LANDING) drawLandingPage();
+    else if(!options.softBackend && retainedReady()) drawAnimationRetained(angle, timeSec);
+    else drawAnimationQueued(angle, timeSec);
+}
+
+void display() {
+    SimRenderState rs = sim.renderState();
+    float angle = rs.crankAngleDeg;
+    float timeSec = rs.timeSec;
+    bool capturing = !options.capturePrefix.empty();
+    if(capturing) {
+        angle = sequenceAngle(captureFrame);
+        timeSec = sequenceTime(captureFrame);
+    }
+    if(sessionRec.isOpen()) sessionRec.display(glutGet(GLUT_ELAPSED_TIME), sceneFingerprint(angle, timeSec));
+
+    frameProfiler.beginFrame();
+    glCallStats.beginFrame();
+    {
+    ProfileScope scope(ProfPass::Display);
+    if(options.softBackend) {
+        if(windowFb.width != winW || windowFb.height != winH) windowFb.resize(winW, winH);
+        SoftBackend soft(windowFb);
+        gfx = &soft;
+        drawScene(angle, timeSec);
+        gfx = &glBackend;
+        glDisable(GL_BLEND);
+        glRasterPos2i(0, 0);
+        glDrawPixels(winW, winH, GL_RGBA, GL_UNSIGNED_BYTE, windowFb.rgba.data());
+    } else {
+        drawScene(angle, timeSec);
+    }
+    }
+
+    if(capturing) {
+        Framebuffer shot;
+        shot.resize(winW, winH);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, winW, winH, GL_RGBA, GL_UNSIGNED_BYTE, shot.rgba.data());
+        writePNG(sequencePath(options.capturePrefix, captureFrame, "png"), shot);
+        if(++captureFrame >= options.frames) exit(0);
+    } else if(frameProfiler.enabled()) {
+        glCallStats.endFrame();   // the overlay's own calls are not counted
+        const GLCallFrame& gl = glCallStats.lastFrame();
+        char note[96];
+        snprintf(note, sizeof(note), "gl calls %u   state changes %u (%u redundant)", gl.totalCalls(),
+                 gl.totalChanges(), gl.totalRedundant());
+        frameProfiler.drawOverlay(winW, winH, note);
+    }
+    {
+        ProfileScope scope(ProfPass::Swap);
+        glutSwapBuffers();
+    }
+    frameProfiler.endFrame();
+    traceFlush();
 }
 
 //////////////////////////////////////////////////////////////////////////
 // Input handling (keyboard + mouse)
 //////////////////////////////////////////////////////////////////////////
+static GLPassClock glPassClock;
+
 void keyboard(unsigned char key, int x, int y) {
+    if(key == 'p' || key == 'P') {
+        frameProfiler.setEnabled(!frameProfiler.enabled());
+        glCallStats.setEnabled(frameProfiler.enabled() && !replaying);
+        if(frameProfiler.enabled() && !replaying && glPassClock.init()) frameProfiler.setGpuClock(&glPassClock);
+        postRedisplay();
+        return;
+    }
     if(appState == LANDING) {
         if(key == 13 || key == 10) { // Enter
             appState = ANIMATION;
-            lastTime = glutGet(GLUT_ELAPSED_TIME);
-            glutPostRedisplay();
+            lastTime = elapsedMs();
+            postRedisplay();
             return;
         }
-        if(key == 27) exit(0);
+        if(key == 27) requestQuit();
     } else {
-        if(key == 27) exit(0);
+        if(key == 27) requestQuit();
         else if(key == ' ') {
-            if (crankSpeedDegPerSec > 1.0f) crankSpeedDegPerSec = 0.0f;
-            else crankSpeedDegPerSec = 120.0f;
+            if (sim.crankSpeed() > 1.0) sim.setCrankSpeed(0.0);
+            else sim.setCrankSpeed(120.0);
         } else if (key == 'f') {
-            crankSpeedDegPerSec += 30.0f;
+            sim.setCrankSpeed(sim.crankSpeed() + 30.0);
         } else if (key == 's') {
-            crankSpeedDegPerSec = std::max(0.0f, crankSpeedDegPerSec - 30.0f);
+            sim.setCrankSpeed(std::max(0.0, sim.crankSpeed() - 30.0));
         } else if (key == 'm' || key == 'M') {
             appState = LANDING;
-            glutPostRedisplay();
+            postRedisplay();
         }
     }
 }
@@ -381,7 +430,7 @@ void passiveMouse(int x, int y) {
     bool hovered = (wx >= bx && wx <= bx + btnW && wy >= by && wy <= by + btnH);
     if(hovered != hoverBtn) {
         hoverBtn = hovered;
-        glutPostRedisplay();
+        postRedisplay();
     }
 }
 
@@ -394,8 +443,8 @@ void mouseClick(int button, int state, int x, int y) {
         bool clicked = (wx >= bx && wx <= bx + btnW && wy >= by && wy <= by + btnH);
         if(clicked) {
             appState = ANIMATION;
-            lastTime = glutGet(GLUT_ELAPSED_TIME);
-            glutPostRedisplay();
+            lastTime = elapsedMs();
+            postRedisplay();
         }
     }
 }
@@ -405,6 +454,7 @@ void mouseClick(int button, int state, int x, int y) {
 //////////////////////////////////////////////////////////////////////////
 void reshape(int w, int h) {
     winW = w; winH = h;
+    if(replaying) return;
     glViewport(0,0,w,h);
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
@@ -413,20 +463,361 @@ void reshape(int w, int h) {
     glLoadIdentity();
 }
 
+static void recordTimer(int value);
+
 void timer(int value) {
+    TraceScope tick("timer");
+    if(traceEnabled()) {
+        // Wall-clock spacing of the ticks, against the 16 ms asked for.
+        static int64_t lastTickNs = 0;
+        int64_t now = traceNowNs();
+        if(lastTickNs) traceCounter("timer interval ms", (now - lastTickNs) * 1e-6);
+        lastTickNs = now;
+    }
     if(appState == ANIMATION) {
-        int t = glutGet(GLUT_ELAPSED_TIME);
+        int t = elapsedMs();
         if(lastTime==0) lastTime = t;
         int dt = t - lastTime;
         lastTime = t;
-        crankAngle += crankSpeedDegPerSec * (dt / 1000.0f);
-        if(crankAngle > 720.0f) crankAngle = fmodf(crankAngle, 720.0f);
-        glutPostRedisplay();
+        {
+            ProfileScope scope(ProfPass::Sim);
+            traceCounter("sim steps", sim.advance(dt / 1000.0));
+        }
+        postRedisplay();
     }
-    glutTimerFunc(16, timer, 0);
+    if(!replaying) glutTimerFunc(16, sessionRec.isOpen() ? recordTimer : timer, 0);
+}
+
+// GLUT callbacks while recording: log the event, then handle it as usual.
+static void recordKeyboard(unsigned char key, int x, int y) {
+    sessionRec.key(glutGet(GLUT_ELAPSED_TIME), key, x, y);
+    keyboard(key, x, y);
+}
+
+static void recordPassiveMouse(int x, int y) {
+    sessionRec.passive(glutGet(GLUT_ELAPSED_TIME), x, y);
+    passiveMouse(x, y);
+}
+
+static void recordMouseClick(int button, int state, int x, int y) {
+    sessionRec.mouse(glutGet(GLUT_ELAPSED_TIME), button, state, x, y);
+    mouseClick(button, state, x, y);
+}
+
+static void recordReshape(int w, int h) {
+    sessionRec.reshape(glutGet(GLUT_ELAPSED_TIME), w, h);
+    reshape(w, h);
+}
+
+static void recordTimer(int value) {
+    sessionRec.timer(glutGet(GLUT_ELAPSED_TIME), value);
+    timer(value);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Headless rendering
+//////////////////////////////////////////////////////////////////////////
+static bool parseArgs(int argc, char** argv, RunOptions& opt) {
+    for(int i=1;i<argc;i++){
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(strcmp(a, "--headless") == 0) opt.headless = true;
+        else if(strcmp(a, "--frames") == 0 && hasValue) opt.frames = atoi(argv[++i]);
+        else if(strcmp(a, "--step") == 0 && hasValue) opt.stepDeg = (float)atof(argv[++i]);
+        else if(strcmp(a, "--scale") == 0 && hasValue) opt.scale = (float)atof(argv[++i]);
+        else if(strcmp(a, "--threads") == 0 && hasValue) opt.threads = atoi(argv[++i]);
+        else if(strcmp(a, "--sim-hz") == 0 && hasValue) opt.simHz = atof(argv[++i]);
+        else if(strcmp(a, "--out") == 0 && hasValue) {
+            opt.outPrefix = argv[++i];
+            opt.outSet = true;
+        }
+        else if(strcmp(a, "--format") == 0 && hasValue) opt.png = strcmp(argv[++i], "ppm") != 0;
+        else if(strcmp(a, "--capture") == 0 && hasValue) opt.capturePrefix = argv[++i];
+        else if(strcmp(a, "--reference") == 0 && hasValue) opt.referencePrefix = argv[++i];
+        else if(strcmp(a, "--tolerance") == 0 && hasValue) opt.tolerance = atoi(argv[++i]);
+        else if(strcmp(a, "--max-diff-pct") == 0 && hasValue) opt.maxDiffPct = (float)atof(argv[++i]);
+        else if(strcmp(a, "--engine") == 0 && hasValue) opt.engine = argv[++i];
+        else if(strcmp(a, "--engine-pack") == 0 && hasValue) opt.enginePack = argv[++i];
+        else if(strcmp(a, "--log") == 0 && hasValue) opt.logPath = argv[++i];
+        else if(strcmp(a, "--record") == 0 && hasValue) opt.recordPath = argv[++i];
+        else if(strcmp(a, "--replay") == 0 && hasValue) opt.replayPath = argv[++i];
+        else if(strcmp(a, "--trace") == 0 && hasValue) opt.tracePath = argv[++i];
+        else if(strcmp(a, "--gl-count") == 0) opt.glCount = true;
+        else if(strcmp(a, "--gl-budget") == 0 && hasValue) opt.glBudgetPath = argv[++i];
+        else if(strcmp(a, "--gl-budget-write") == 0 && hasValue) opt.glBudgetWritePath = argv[++i];
+        else if(strcmp(a, "--backend") == 0 && hasValue) opt.softBackend = strcmp(argv[++i], "soft") == 0;
+        else if(strcmp(a, "--isa") == 0 && hasValue) {
+            const char* isa = argv[++i];
+            opt.forceIsa = true;
+            if(strcmp(isa, "scalar") == 0) opt.isa = SpanIsa::Scalar;
+            else if(strcmp(isa, "sse2") == 0) opt.isa = SpanIsa::SSE2;
+            else opt.isa = SpanIsa::AVX2;
+        }
+        else if(strcmp(a, "--size") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2) return false;
+        }
+        else if(strncmp(a, "--", 2) == 0) return false;   // single-dash args belong to glutInit
+    }
+    return opt.frames > 0 && opt.width > 0 && opt.height > 0 && opt.scale > 0.0f && opt.threads >= 0
+        && opt.simHz > 0.0 && (opt.recordPath.empty() || (opt.capturePrefix.empty() && !opt.headless))
+        && (opt.replayPath.empty() || opt.recordPath.empty())
+        && (opt.glCount || (opt.glBudgetPath.empty() && opt.glBudgetWritePath.empty()));
+}
+
+static int runHeadless(const RunOptions& opt) {
+    // Scene units stay window pixels; --scale renders them larger.
+    winW = (int)(opt.width / opt.scale);
+    winH = (int)(opt.height / opt.scale);
+    appState = ANIMATION;
+
+    // Each frame is recorded once, then rasterized tile by tile on the pool.
+    Framebuffer fb, reference;
+    fb.resize(opt.width, opt.height);
+    CommandList recorder;
+    recorder.setViewScale(opt.scale, opt.scale);
+    ThreadPool pool(opt.threads);
+    TileRenderer tiles(pool);
+    gfx = &recorder;
+
+    bool compare = !opt.referencePrefix.empty();
+    bool logging = !opt.logPath.empty();
+    if(logging) sim.reset(SimState{ 0.0, kSequenceSpeedDegPerSec, 0.0, 0 });
+    int failures = 0;
+    for(int i=0;i<opt.frames;i++){
+        // With a log, the sim steps through the sequence at its own speed up
+        // to each frame; the frames themselves stay the fixed sequence.
+        if(logging) {
+            double target = std::floor(sequenceTime(i) * sim.stepHz() + 0.5);
+            if(target > (double)sim.current().step) sim.runSteps((uint64_t)target - sim.current().step);
+        }
+        {
+            ProfileScope scope(ProfPass::Display);
+            recorder.begin();
+            drawAnimationFrame(sequenceAngle(i), sequenceTime(i));
+            tiles.render(recorder, fb);
+        }
+        traceFlush();
+
+        if(compare) {
+            std::string refPath = sequencePath(opt.referencePrefix, i, "png");
+            if(!readImage(refPath, reference)) {
+                fprintf(stderr, "engine_sim: cannot read %s\n", refPath.c_str());
+                return 1;
+            }
+            ImageDiff d = compareImages(fb, reference, opt.tolerance);
+            bool ok = d.sizeMatches && d.pctPixelsOver <= opt.maxDiffPct;
+            if(!ok) failures++;
+            printf("frame %04d: max %3d  mean %.3f  over-tolerance %.3f%%%s\n", i, d.maxChannelDiff,
+                   d.meanChannelDiff, d.pctPixelsOver, d.sizeMatches ? (ok ? "" : "  FAIL") : "  SIZE MISMATCH");
+            continue;
+        }
+
+        std::string path = sequencePath(opt.outPrefix, i, opt.png ? "png" : "ppm");
+        bool ok = opt.png ? writePNG(path, fb) : writePPM(path, fb);
+        if(!ok) {
+            fprintf(stderr, "engine_sim: cannot write %s\n", path.c_str());
+            return 1;
+        }
+    }
+    if(compare) {
+        printf("engine_sim: %d/%d frames within %.2f%% (tolerance %d, %s spans)\n", opt.frames - failures, opt.frames,
+               opt.maxDiffPct, opt.tolerance, spanIsaName(spanKernels().isa));
+        return failures ? 1 : 0;
+    }
+    printf("engine_sim: wrote %d frames (%dx%d) to %s*\n", opt.frames, opt.width, opt.height, opt.outPrefix.c_str());
+    return 0;
+}
+
+// Counts the GL calls GLBackend makes for the fixed animation sequence (as
+// display() draws it without vertex buffers) and for the landing page,
+// without forwarding them (no context needed).
+static void printGLCounts(const char* label, const std::vector<GLCallMetric>& metrics) {
+    printf("%s, per frame:\n", label);
+    for(const GLCallMetric& m: metrics)
+        if(m.perFrame > 0.0 || m.name.compare(0, 10, "redundant.") == 0)
+            printf("  %-34s %10.2f\n", m.name.c_str(), m.perFrame);
+}
+
+static int runGLCount(const RunOptions& opt) {
+    gfx = &glBackend;
+    glCallStats.setForward(false);
+    glCallStats.setEnabled(true);
+    appState = ANIMATION;
+    for(int i=0;i<opt.frames;i++){
+        glCallStats.beginFrame();
+        drawAnimationQueued(sequenceAngle(i), sequenceTime(i));
+        glCallStats.endFrame();
+    }
+    std::vector<GLCallMetric> metrics = glCallStats.averages();
+    char label[64];
+    snprintf(label, sizeof(label), "animation (%d frames)", opt.frames);
+    printGLCounts(label, metrics);
+
+    glCallStats.setEnabled(true);
+    appState = LANDING;
+    glCallStats.beginFrame();
+    drawLandingPage();
+    glCallStats.endFrame();
+    std::vector<GLCallMetric> landing = glCallStats.averages();
+    printGLCounts("landing page", landing);
+    for(GLCallMetric& m: landing) metrics.push_back({ "landing." + m.name, m.perFrame });
+    glCallStats.setEnabled(false);
+    gfx = nullptr;
+
+    std::string error;
+    if(!opt.glBudgetWritePath.empty()) {
+        if(!writeGLCallBudget(opt.glBudgetWritePath, metrics, error)) {
+            fprintf(stderr, "engine_sim: %s\n", error.c_str());
+            return 1;
+        }
+        printf("engine_sim: wrote GL call budget %s\n", opt.glBudgetWritePath.c_str());
+    }
+    if(!opt.glBudgetPath.empty()) {
+        if(!checkGLCallBudget(opt.glBudgetPath, metrics, error)) {
+            fprintf(stderr, "engine_sim: %s\n", error.c_str());
+            return 1;
+        }
+        printf("engine_sim: GL calls within budget %s\n", opt.glBudgetPath.c_str());
+    }
+    return 0;
+}
+
+// Reruns a recorded session through the input handlers with the clock taken
+// from the log, drawing each recorded frame headless as fast as it renders.
+static int runReplay(const RunOptions& opt) {
+    ReplayRun run;
+    std::string error;
+    if(!run.log.open(opt.replayPath, error)) {
+        fprintf(stderr, "engine_sim: %s\n", error.c_str());
+        return 2;
+    }
+    const SessionHeader& header = run.log.header();
+    setEngineConfig(header.engine);
+    sim.setStepHz(header.simHz);
+    if(!opt.logPath.empty() && !openSimLog(opt.logPath)) return 1;
+    winW = header.winW;
+    winH = header.winH;
+
+    Framebuffer fb;
+    CommandList recorder;
+    recorder.setViewScale(opt.scale, opt.scale);
+    ThreadPool pool(opt.threads);
+    TileRenderer tiles(pool);
+    gfx = &recorder;
+
+    replaying = &run;
+    auto start = std::chrono::steady_clock::now();
+    lastTime = elapsedMs();   // main() reads the clock once before the loop
+    int frames = 0;
+    uint32_t framesHash = sessionHash(nullptr, 0);
+    SessionEvent ev;
+    while(run.divergence.empty() && !run.quit && run.log.next(ev)) {
+        switch(ev.type) {
+        case SessionEventType::Key: keyboard((unsigned char)ev.a, ev.b, ev.c); break;
+        case SessionEventType::Mouse: mouseClick(ev.a, ev.b, ev.c, ev.d); break;
+        case SessionEventType::Passive: passiveMouse(ev.a, ev.b); break;
+        case SessionEventType::Reshape: reshape(ev.a, ev.b); break;
+        case SessionEventType::Timer: timer(ev.a); break;
+        case SessionEventType::Display: {
+            SimRenderState rs = sim.renderState();
+            if(sceneFingerprint(rs.crankAngleDeg, rs.timeSec) != ev.fingerprint) {
+                run.divergence = "scene state differs from the recording";
+                break;
+            }
+            int w = std::max(1, (int)(winW * opt.scale)), h = std::max(1, (int)(winH * opt.scale));
+            if(fb.width != w || fb.height != h) fb.resize(w, h);
+            {
+                ProfileScope scope(ProfPass::Display);
+                recorder.begin();
+                drawScene(rs.crankAngleDeg, rs.timeSec);
+                tiles.render(recorder, fb);
+            }
+            traceFlush();
+            framesHash = sessionHash(fb.rgba.data(), fb.rgba.size() * sizeof(fb.rgba[0]), framesHash);
+            if(opt.outSet) {
+                std::string path = sequencePath(opt.outPrefix, frames, opt.png ? "png" : "ppm");
+                if(!(opt.png ? writePNG(path, fb) : writePPM(path, fb))) {
+                    fprintf(stderr, "engine_sim: cannot write %s\n", path.c_str());
+                    return 1;
+                }
+            }
+            frames++;
+            break;
+        }
+        default: run.divergence = "clock read not in the recording"; break;
+        }
+    }
+    replaying = nullptr;
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if(!run.divergence.empty()) {
+        fprintf(stderr, "engine_sim: replay diverged at event %llu (frame %d): %s\n",
+                (unsigned long long)run.log.events(), frames, run.divergence.c_str());
+        return 1;
+    }
+    if(run.log.malformed()) {
+        fprintf(stderr, "engine_sim: %s is corrupt after event %llu\n", opt.replayPath.c_str(),
+                (unsigned long long)run.log.events());
+        return 1;
+    }
+    if(run.log.truncated())
+        fprintf(stderr, "engine_sim: %s ends mid-event; replayed up to there\n", opt.replayPath.c_str());
+    printf("engine_sim: replayed %llu events, %d frames, %llu sim steps in %.3f s (%.1f frames/s)\n",
+           (unsigned long long)run.log.events(), frames, (unsigned long long)sim.current().step, sec,
+           sec > 0.0 ? frames / sec : 0.0);
+    printf("engine_sim: frames hash %08x (%s spans)\n", framesHash, spanIsaName(spanKernels().isa));
+    return 0;
 }
 
 int main(int argc, char** argv) {
+    if(!parseArgs(argc, argv, options)) {
+        fprintf(stderr, "usage: engine_sim [--engine PRESET|FILE|NAME] [--engine-pack PACK] [--backend gl|soft]\n"
+                        "                  [--isa scalar|sse2|avx2] [--sim-hz HZ] [--log FILE] [--capture PREFIX]\n"
+                        "                  [--record FILE] [--replay FILE [--out PREFIX] [--threads N]] [--trace FILE]\n"
+                        "                  [--gl-count [--frames N] [--gl-budget FILE] [--gl-budget-write FILE]]\n"
+                        "                  [--headless [--frames N] [--step DEG] [--size WxH] [--scale S]\n"
+                        "                   [--out PREFIX] [--format png|ppm] [--reference PREFIX]\n"
+                        "                   [--tolerance T] [--max-diff-pct P] [--threads N]]\n");
+        fprintf(stderr, "engine presets: %s\n", engineConfigPresetList());
+        return 2;
+    }
+    if(!options.enginePack.empty()) {
+        EnginePack pack;
+        std::string error;
+        if(!pack.open(options.enginePack, error)) {
+            fprintf(stderr, "engine_sim: %s\n", error.c_str());
+            return 2;
+        }
+        int idx = options.engine.empty() ? 0 : pack.find(options.engine.c_str());
+        if(idx < 0) {
+            fprintf(stderr, "engine_sim: no engine '%s' in %s\n", options.engine.c_str(), options.enginePack.c_str());
+            return 2;
+        }
+        if(pack.size() > 0) {
+            setEngineConfig(pack.config(idx));
+            options.engine.clear();
+        }
+    }
+    if(!options.engine.empty()) {
+        EngineConfig cfg;
+        std::string error;
+        if(!resolveEngineConfig(options.engine, cfg, error)) {
+            fprintf(stderr, "engine_sim: %s\n", error.c_str());
+            fprintf(stderr, "engine presets: %s\n", engineConfigPresetList());
+            return 2;
+        }
+        setEngineConfig(cfg);
+    }
+    if(options.forceIsa) forceSpanIsa(options.isa);
+    if(!options.tracePath.empty() && !openTrace(options.tracePath)) return 1;
+    if(!options.replayPath.empty()) return runReplay(options);
+    sim.setStepHz(options.simHz);
+    if(!options.logPath.empty() && !openSimLog(options.logPath)) return 1;
+    if(options.headless) return runHeadless(options);
+    if(options.glCount) return runGLCount(options);
+
+    if(!options.capturePrefix.empty()) appState = ANIMATION;
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
     glutInitWindowSize(winW, winH);
@@ -436,14 +827,20 @@ int main(int argc, char** argv) {
     glEnable(GL_POINT_SMOOTH);
     glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
 
+    gfx = &glBackend;
+    // Vertex-buffer path for the animation; immediate mode stays as fallback.
+    if(!options.softBackend) retainedInit(engineLayout());
+
+    bool recording = !options.recordPath.empty();
+    if(recording && !openSession(options.recordPath)) return 1;
     glutDisplayFunc(display);
-    glutReshapeFunc(reshape);
-    glutKeyboardFunc(keyboard);
-    glutPassiveMotionFunc(passiveMouse);
-    glutMouseFunc(mouseClick);
+    glutReshapeFunc(recording ? recordReshape : reshape);
+    glutKeyboardFunc(recording ? recordKeyboard : keyboard);
+    glutPassiveMotionFunc(recording ? recordPassiveMouse : passiveMouse);
+    glutMouseFunc(recording ? recordMouseClick : mouseClick);
 
-    lastTime = glutGet(GLUT_ELAPSED_TIME);
-    glutTimerFunc(16, timer, 0);
+    lastTime = elapsedMs();
+    glutTimerFunc(16, recording ? recordTimer : timer, 0);
 
     glutMainLoop();
     return 0;
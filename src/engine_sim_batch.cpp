@@ -0,0 +1,560 @@
+// engine_sim_batch.cpp
+// Headless fleet simulation: runs N engines of one description for a given
+// simulated duration and streams their telemetry (telemetry_stream.h).
+// No GL or GLUT; engines are split into shards that run on the thread pool.
+// Compile (Linux / MinGW):
+//   g++ -O2 src/engine_sim_batch.cpp src/telemetry_stream.cpp src/telemetry_log.cpp src/telemetry_codec.cpp src/engine_config.cpp src/engine_pack.cpp src/mapped_file.cpp src/crank_kinematics.cpp src/engine_batch.cpp src/piston_kernels.cpp src/cpu_features.cpp src/thermo_model.cpp src/crank_dynamics.cpp src/sim_snapshot.cpp src/thread_pool.cpp -o engine_sim_batch -pthread
+// Windows MSVC:
+//   cl /EHsc /O2 /std:c++17 src\engine_sim_batch.cpp src\telemetry_stream.cpp src\telemetry_log.cpp src\telemetry_codec.cpp src\engine_config.cpp src\engine_pack.cpp src\mapped_file.cpp src\crank_kinematics.cpp src\engine_batch.cpp src\piston_kernels.cpp src\cpu_features.cpp src\thermo_model.cpp src\crank_dynamics.cpp src\sim_snapshot.cpp src\thread_pool.cpp /Fe:engine_sim_batch.exe
+// Usage:
+//   engine_sim_batch [--engines N] [--engine PRESET|FILE|NAME] [--engine-pack PACK]
+//                    [--duration SEC] [--sample-hz HZ] [--rpm RPM] [--rpm-spread F] [--fuel J]
+//                    [--dynamics rk4|euler|off] [--step-deg DEG] [--columns LIST] [--block N] [--threads N]
+//                    [--format stream|log] [--compress] [--max-error COLUMN=E ...] [--out FILE|-]
+//                    [--load-state FILE] [--save-state FILE]
+//   engine_sim_batch --inspect FILE [--window T0:T1]
+// --format log writes a chunked, memory-mapped log (telemetry_log.h) with
+// --block rows per chunk instead of a stream; --inspect on a log reads the
+// per-chunk index and, with --window, only the chunks covering that time.
+// --compress delta-codes every column (telemetry_codec.h), lossless; each
+// --max-error COLUMN=E (e.g. piston=1e-6) also quantizes that float column so
+// values come back within E.
+// --save-state writes the fleet's state at the end of the run
+// (sim_snapshot.h); --load-state starts from such a snapshot instead of the
+// --rpm spin-up, with telemetry time restarting at 0. A snapshot of fewer
+// engines is forked over the fleet shard by shard (the engine count must
+// then be a multiple of 256); --fuel, if given, replaces the stored fuel.
+// Each sample interval is one simulation step: constant speed with
+// --dynamics off, otherwise CrankDynamics substeps by crank angle inside it:
+// finer inside firing windows (RK4) or uniformly (euler), or every
+// --step-deg degrees for either scheme.
+// Columns (LIST is comma separated, default all): angle, speed, piston,
+// phase, pressure, torque, work.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "crank_dynamics.h"
+#include "crank_kinematics.h"
+#include "engine_batch.h"
+#include "engine_config.h"
+#include "engine_pack.h"
+#include "sim_snapshot.h"
+#include "telemetry_log.h"
+#include "telemetry_stream.h"
+#include "thermo_model.h"
+#include "thread_pool.h"
+
+struct BatchOptions {
+    int engines = 1024;
+    std::string engine;
+    std::string enginePack;
+    double durationSec = 1.0;
+    double sampleHz = 1000.0;
+    double rpm = 3000.0;
+    double rpmSpread = 0.2;        // start speeds spread evenly over rpm * (1 +- spread / 2)
+    float fuelJ = 800.0f;          // fuel energy per cylinder per cycle
+    bool fuelSet = false;          // --fuel given (overrides a loaded state)
+    bool dynamics = true;
+    CrankIntegrator scheme = CrankIntegrator::RK4;
+    double stepDeg = 0.0;          // fixed crank-angle step; 0: DynamicsSpec limits
+    std::string columns = "angle,speed,piston,phase,pressure,torque,work";
+    int blockSamples = 256;
+    int threads = 0;
+    std::string out = "telemetry.etl";
+    bool log = false;              // chunked, mapped log instead of a stream
+    bool compress = false;         // delta-code every column
+    std::vector<std::string> maxErrors;   // KEY=E: quantize a column to |error| <= E
+    std::string loadState, saveState;   // snapshot to start from / to write at the end
+    std::string inspect;
+    double windowFirst = 0.0, windowLast = -1.0;
+};
+
+enum ColumnKind { ColAngle, ColSpeed, ColPiston, ColPhase, ColPressure, ColTorque, ColWork, ColKindCount };
+
+struct ColumnDef {
+    const char* key;
+    const char* name;
+    TelemetryType type;
+    TelemetryScope scope;
+};
+
+static const ColumnDef kColumnDefs[ColKindCount] = {
+    { "angle", "crank_angle_deg", TelemetryType::F32, TelemetryScope::Engine },
+    { "speed", "crank_speed_rpm", TelemetryType::F32, TelemetryScope::Engine },
+    { "piston", "piston_pos_m", TelemetryType::F32, TelemetryScope::Cylinder },
+    { "phase", "phase", TelemetryType::U8, TelemetryScope::Cylinder },
+    { "pressure", "pressure_pa", TelemetryType::F32, TelemetryScope::Cylinder },
+    { "torque", "torque_nm", TelemetryType::F32, TelemetryScope::Engine },
+    { "work", "cycle_work_j", TelemetryType::F32, TelemetryScope::Engine },
+};
+
+// A contiguous range of engines with its own batch and model state.
+struct Shard {
+    int first = 0, count = 0;
+    std::unique_ptr<EngineBatch> batch;
+    std::unique_ptr<ThermoBatch> thermo;
+    std::unique_ptr<CrankDynamics> dynamics;
+    double crankDeg = 0.0;         // total crank angle travelled by all engines
+};
+
+static const int kShardEngines = 256;
+
+static bool parseArgs(int argc, char** argv, BatchOptions& opt) {
+    for(int i=1;i<argc;i++){
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(strcmp(a, "--engines") == 0 && hasValue) opt.engines = atoi(argv[++i]);
+        else if(strcmp(a, "--engine") == 0 && hasValue) opt.engine = argv[++i];
+        else if(strcmp(a, "--engine-pack") == 0 && hasValue) opt.enginePack = argv[++i];
+        else if(strcmp(a, "--duration") == 0 && hasValue) opt.durationSec = atof(argv[++i]);
+        else if(strcmp(a, "--sample-hz") == 0 && hasValue) opt.sampleHz = atof(argv[++i]);
+        else if(strcmp(a, "--rpm") == 0 && hasValue) opt.rpm = atof(argv[++i]);
+        else if(strcmp(a, "--rpm-spread") == 0 && hasValue) opt.rpmSpread = atof(argv[++i]);
+        else if(strcmp(a, "--fuel") == 0 && hasValue) {
+            opt.fuelJ = (float)atof(argv[++i]);
+            opt.fuelSet = true;
+        }
+        else if(strcmp(a, "--columns") == 0 && hasValue) opt.columns = argv[++i];
+        else if(strcmp(a, "--block") == 0 && hasValue) opt.blockSamples = atoi(argv[++i]);
+        else if(strcmp(a, "--threads") == 0 && hasValue) opt.threads = atoi(argv[++i]);
+        else if(strcmp(a, "--out") == 0 && hasValue) opt.out = argv[++i];
+        else if(strcmp(a, "--inspect") == 0 && hasValue) opt.inspect = argv[++i];
+        else if(strcmp(a, "--load-state") == 0 && hasValue) opt.loadState = argv[++i];
+        else if(strcmp(a, "--save-state") == 0 && hasValue) opt.saveState = argv[++i];
+        else if(strcmp(a, "--format") == 0 && hasValue) opt.log = strcmp(argv[++i], "log") == 0;
+        else if(strcmp(a, "--compress") == 0) opt.compress = true;
+        else if(strcmp(a, "--max-error") == 0 && hasValue) opt.maxErrors.push_back(argv[++i]);
+        else if(strcmp(a, "--window") == 0 && hasValue) {
+            if(sscanf(argv[++i], "%lf:%lf", &opt.windowFirst, &opt.windowLast) != 2) return false;
+        }
+        else if(strcmp(a, "--dynamics") == 0 && hasValue) {
+            const char* d = argv[++i];
+            opt.dynamics = strcmp(d, "off") != 0;
+            opt.scheme = strcmp(d, "euler") == 0 ? CrankIntegrator::SemiImplicitEuler : CrankIntegrator::RK4;
+        }
+        else if(strcmp(a, "--step-deg") == 0 && hasValue) opt.stepDeg = atof(argv[++i]);
+        else return false;
+    }
+    return opt.engines > 0 && opt.durationSec > 0.0 && opt.sampleHz > 0.0 && opt.rpm >= 0.0 && opt.rpmSpread >= 0.0
+        && opt.blockSamples > 0 && opt.threads >= 0 && opt.stepDeg >= 0.0;
+}
+
+static bool parseColumns(const std::string& list, std::vector<int>& kinds) {
+    size_t pos = 0;
+    while(pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        if(end == std::string::npos) end = list.size();
+        std::string key = list.substr(pos, end - pos);
+        int found = -1;
+        for(int k=0;k<ColKindCount;k++) if(key == kColumnDefs[k].key) found = k;
+        if(found < 0) return false;
+        if(std::find(kinds.begin(), kinds.end(), found) == kinds.end()) kinds.push_back(found);
+        pos = end + 1;
+    }
+    return !kinds.empty();
+}
+
+// Codec of each selected column: Delta for all with --compress, quantized
+// where --max-error names the column.
+static bool parseCodecs(const BatchOptions& opt, const std::vector<int>& kinds, std::vector<TelemetryColumn>& columns) {
+    for(TelemetryColumn& c: columns) c.codec = (uint8_t)(opt.compress ? TelemetryCodec::Delta : TelemetryCodec::None);
+    for(const std::string& spec: opt.maxErrors){
+        size_t eq = spec.find('=');
+        double e = eq == std::string::npos ? 0.0 : atof(spec.c_str() + eq + 1);
+        int found = -1;
+        for(size_t i=0;i<kinds.size();i++)
+            if(spec.compare(0, eq, kColumnDefs[kinds[i]].key) == 0 && kColumnDefs[kinds[i]].type == TelemetryType::F32)
+                found = (int)i;
+        if(found < 0 || !(e > 0.0)) return false;
+        columns[found].codec = (uint8_t)TelemetryCodec::Delta;
+        columns[found].quantum = (float)(2.0 * e);
+    }
+    return true;
+}
+
+static bool resolveEngine(const BatchOptions& opt, EngineConfig& cfg) {
+    std::string error;
+    if(!opt.enginePack.empty()) {
+        EnginePack pack;
+        if(!pack.open(opt.enginePack, error)) {
+            fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+            return false;
+        }
+        int idx = opt.engine.empty() ? 0 : pack.find(opt.engine.c_str());
+        if(idx < 0) {
+            fprintf(stderr, "engine_sim_batch: no engine '%s' in %s\n", opt.engine.c_str(), opt.enginePack.c_str());
+            return false;
+        }
+        if(pack.size() > 0) {
+            cfg = pack.config(idx);
+            return true;
+        }
+    }
+    if(opt.engine.empty()) return true;
+    if(!resolveEngineConfig(opt.engine, cfg, error)) {
+        fprintf(stderr, "engine_sim_batch: %s\nengine presets: %s\n", error.c_str(), engineConfigPresetList());
+        return false;
+    }
+    return true;
+}
+
+static std::vector<StateArray> shardState(Shard& sh) {
+    std::vector<StateArray> arrays;
+    sh.batch->stateArrays(arrays);
+    sh.thermo->stateArrays(arrays);
+    if(sh.dynamics) sh.dynamics->stateArrays(arrays);
+    return arrays;
+}
+
+// Restores every shard from the snapshot at path; snapshot shard s % n for
+// shard s when the snapshot holds n < shards.
+static bool loadState(const BatchOptions& opt, const EngineConfig& cfg, std::vector<Shard>& shards, double& timeSec,
+                      uint64_t& samples) {
+    SimSnapshot snap;
+    std::string error;
+    if(!snap.load(opt.loadState, error)) {
+        fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+        return false;
+    }
+    const SnapshotHeader& h = snap.info();
+    if(h.cylinders != (uint32_t)cfg.cylinders || strncmp(h.engineName, cfg.name, sizeof(cfg.name)) != 0
+       || snap.shards() < 1) {
+        fprintf(stderr, "engine_sim_batch: %s holds %u x %.31s, not %.31s\n", opt.loadState.c_str(), h.engines,
+                h.engineName, cfg.name);
+        return false;
+    }
+    for(size_t s=0;s<shards.size();s++){
+        if(!snap.restore((int)(s % snap.shards()), shardState(shards[s]), error)) {
+            fprintf(stderr, "engine_sim_batch: %s: %s\n", opt.loadState.c_str(), error.c_str());
+            return false;
+        }
+        if(opt.fuelSet) for(int e=0;e<shards[s].count;e++) shards[s].thermo->setFuel(e, opt.fuelJ);
+    }
+    timeSec = h.timeSec;
+    samples = h.samples;
+    fprintf(stderr, "engine_sim_batch: started from %s (%u engines at %.3f s)\n", opt.loadState.c_str(), h.engines,
+            h.timeSec);
+    return true;
+}
+
+static bool saveState(const BatchOptions& opt, const EngineConfig& cfg, std::vector<Shard>& shards, double timeSec,
+                      uint64_t samples) {
+    SimSnapshot snap;
+    SnapshotHeader& h = snap.info();
+    h.engines = (uint32_t)opt.engines;
+    h.cylinders = (uint32_t)cfg.cylinders;
+    h.timeSec = timeSec;
+    h.samples = samples;
+    memcpy(h.engineName, cfg.name, sizeof(h.engineName));
+    for(size_t s=0;s<shards.size();s++) snap.capture((int)s, shardState(shards[s]));
+    std::string error;
+    if(!snap.save(opt.saveState, error)) {
+        fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Copies shard s's values for one sample into row r of every column.
+static void emitRow(TelemetrySink& writer, const std::vector<int>& kinds, const Shard& s, int engines, int r) {
+    const EngineBatch& b = *s.batch;
+    int cyl = b.cylinders();
+    for(size_t i=0;i<kinds.size();i++){
+        uint8_t* row = writer.column((int)i, r);
+        float* out = (float*)row + s.first;
+        switch(kinds[i]){
+        case ColAngle:
+            memcpy(out, b.crankAngles(), s.count * sizeof(float));
+            break;
+        case ColSpeed:
+            for(int e=0;e<s.count;e++) out[e] = b.crankSpeeds()[e] * (1.0f / 6.0f);
+            break;
+        case ColPiston:
+            for(int c=0;c<cyl;c++) memcpy(out + (size_t)c * engines, b.pistonPositions(c), s.count * sizeof(float));
+            break;
+        case ColPhase:
+            for(int c=0;c<cyl;c++) memcpy(row + (size_t)c * engines + s.first, b.phaseKinds(c), s.count);
+            break;
+        case ColPressure:
+            for(int c=0;c<cyl;c++) memcpy(out + (size_t)c * engines, s.thermo->pressures(c), s.count * sizeof(float));
+            break;
+        case ColTorque:
+            memcpy(out, s.dynamics ? s.dynamics->netTorques() : s.thermo->torques(), s.count * sizeof(float));
+            break;
+        case ColWork:
+            for(int e=0;e<s.count;e++){
+                float w = 0.0f;
+                for(int c=0;c<cyl;c++) w += s.thermo->cycleWork(c)[e];
+                out[e] = w;
+            }
+            break;
+        }
+    }
+}
+
+// Running min / max / mean of every column.
+struct ColumnStats {
+    std::vector<double> lo, hi, sum;
+    std::vector<uint64_t> count;
+
+    explicit ColumnStats(size_t n) : lo(n, INFINITY), hi(n, -INFINITY), sum(n, 0.0), count(n, 0) {}
+
+    void add(size_t i, const TelemetryColumn& c, const uint8_t* data, size_t values) {
+        for(size_t v=0;v<values;v++){
+            double x = c.type == (uint8_t)TelemetryType::F32 ? ((const float*)data)[v] : data[v];
+            lo[i] = std::min(lo[i], x);
+            hi[i] = std::max(hi[i], x);
+            sum[i] += x;
+        }
+        count[i] += values;
+    }
+
+    void print(const std::vector<TelemetryColumn>& cols) const {
+        for(size_t i=0;i<cols.size();i++){
+            const TelemetryColumn& c = cols[i];
+            char codec[32] = "raw";
+            if(c.codec == (uint8_t)TelemetryCodec::Delta) {
+                if(c.quantum > 0.0f) snprintf(codec, sizeof(codec), "delta +-%.3g", c.quantum * 0.5);
+                else snprintf(codec, sizeof(codec), "delta");
+            }
+            printf("  %-16.24s %-3s %-8s %-12s min %12.5g  max %12.5g  mean %12.5g\n", c.name,
+                   c.type == (uint8_t)TelemetryType::F32 ? "f32" : "u8",
+                   c.scope == (uint8_t)TelemetryScope::Cylinder ? "cylinder" : "engine", codec, lo[i], hi[i],
+                   count[i] ? sum[i] / count[i] : 0.0);
+        }
+    }
+};
+
+static size_t valuesPerRow(const TelemetryColumn& c, uint32_t engines, uint32_t cylinders) {
+    size_t bytes = telemetryRowBytes(c, (int)engines, (int)cylinders);
+    return c.type == (uint8_t)TelemetryType::F32 ? bytes / 4 : bytes;
+}
+
+static int inspectStream(const std::string& path) {
+    TelemetryReader reader;
+    std::string error;
+    if(!reader.open(path, error)) {
+        fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+        return 1;
+    }
+    const TelemetryHeader& h = reader.header();
+    ColumnStats stats(reader.columns().size());
+    uint64_t samples = 0, blocks = 0;
+    while(reader.nextBlock(error)) {
+        blocks++;
+        samples += reader.block().samples;
+        for(size_t i=0;i<reader.columns().size();i++){
+            const TelemetryColumn& c = reader.columns()[i];
+            stats.add(i, c, reader.column((int)i), valuesPerRow(c, h.engines, h.cylinders) * reader.block().samples);
+        }
+    }
+    if(!error.empty()) {
+        fprintf(stderr, "engine_sim_batch: %s: %s\n", path.c_str(), error.c_str());
+        return 1;
+    }
+    printf("%s: %.31s, %u engines x %u cylinders, %llu samples at %.0f Hz (%.3f s) in %llu blocks\n", path.c_str(),
+           h.engineName, h.engines, h.cylinders, (unsigned long long)samples, h.sampleHz, samples / h.sampleHz,
+           (unsigned long long)blocks);
+    stats.print(reader.columns());
+    return 0;
+}
+
+// Whole-log ranges come from the chunk index alone; a time window maps only
+// the chunks that cover it.
+static int inspectLog(const std::string& path, double t0, double t1) {
+    TelemetryLog log;
+    std::string error;
+    if(!log.open(path, error)) {
+        fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+        return 1;
+    }
+    const TelemetryLogHeader& h = log.header();
+    const std::vector<TelemetryColumn>& cols = log.columns();
+    printf("%s: %.31s, %u engines x %u cylinders, %llu samples at %.0f Hz (%.3f s) in %llu chunks of %u rows\n",
+           path.c_str(), h.engineName, h.engines, h.cylinders, (unsigned long long)h.rows, h.sampleHz,
+           h.rows / h.sampleHz, (unsigned long long)log.chunkCount(), h.chunkRows);
+    printf(" index ranges:\n");
+    for(size_t i=0;i<cols.size();i++){
+        float lo = INFINITY, hi = -INFINITY;
+        uint64_t stored = 0;
+        for(uint64_t k=0;k<log.chunkCount();k++){
+            lo = std::min(lo, log.range(k, (int)i).min);
+            hi = std::max(hi, log.range(k, (int)i).max);
+            stored += log.columnEntry(k, (int)i).bytes;
+        }
+        double raw = (double)telemetryRowBytes(cols[i], (int)h.engines, (int)h.cylinders) * h.rows;
+        printf("  %-16.24s min %12.5g  max %12.5g  stored %8.2f MB (%.1fx)\n", cols[i].name, lo, hi,
+               stored / 1048576.0, stored ? raw / stored : 0.0);
+    }
+    if(t1 < t0) return 0;
+
+    uint64_t first, last;
+    log.chunksInTime(t0, t1, first, last);
+    ColumnStats stats(cols.size());
+    uint64_t rows = 0;
+    std::vector<uint8_t> values;
+    for(uint64_t k=first;k<last;k++){
+        const TelemetryChunkHeader& ch = log.chunk(k);
+        // Rows of this chunk inside the window.
+        double r0 = std::max(0.0, ceil(t0 * h.sampleHz - 1e-9) - (double)ch.firstRow);
+        double r1 = std::min((double)ch.rows, floor(t1 * h.sampleHz + 1e-9) - (double)ch.firstRow + 1.0);
+        if(r1 <= r0) continue;
+        rows += (uint64_t)(r1 - r0);
+        for(size_t i=0;i<cols.size();i++){
+            size_t per = valuesPerRow(cols[i], h.engines, h.cylinders);
+            size_t width = cols[i].type == (uint8_t)TelemetryType::F32 ? 4 : 1;
+            values.resize((size_t)ch.rows * per * width);
+            if(!log.readColumn(k, (int)i, values.data())) {
+                fprintf(stderr, "engine_sim_batch: %s: bad column %.24s in chunk %llu\n", path.c_str(), cols[i].name,
+                        (unsigned long long)k);
+                return 1;
+            }
+            stats.add(i, cols[i], values.data() + (size_t)r0 * per * width, (size_t)(r1 - r0) * per);
+        }
+    }
+    printf(" window %.4f .. %.4f s: %llu samples from chunks %llu .. %llu\n", t0, t1, (unsigned long long)rows,
+           (unsigned long long)first, (unsigned long long)(last ? last - 1 : 0));
+    stats.print(cols);
+    return 0;
+}
+
+static int inspect(const std::string& path, double t0, double t1) {
+    char magic[8] = {};
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f) {
+        if(fread(magic, 1, sizeof(magic), f) != sizeof(magic)) magic[0] = 0;
+        fclose(f);
+    }
+    if(memcmp(magic, "ENGTLOG", 8) == 0) return inspectLog(path, t0, t1);
+    return inspectStream(path);
+}
+
+int main(int argc, char** argv) {
+    BatchOptions opt;
+    std::vector<int> kinds;
+    if(!parseArgs(argc, argv, opt) || !parseColumns(opt.columns, kinds)) {
+        fprintf(stderr, "usage: engine_sim_batch [--engines N] [--engine PRESET|FILE|NAME] [--engine-pack PACK]\n"
+                        "                        [--duration SEC] [--sample-hz HZ] [--rpm RPM] [--rpm-spread F]\n"
+                        "                        [--fuel J] [--dynamics rk4|euler|off] [--step-deg DEG] [--columns LIST]\n"
+                        "                        [--block N] [--threads N] [--format stream|log] [--compress]\n"
+                        "                        [--max-error COLUMN=E ...] [--out FILE|-]\n"
+                        "                        [--load-state FILE] [--save-state FILE]\n"
+                        "       engine_sim_batch --inspect FILE [--window T0:T1]\n"
+                        "columns: angle,speed,piston,phase,pressure,torque,work\n");
+        fprintf(stderr, "engine presets: %s\n", engineConfigPresetList());
+        return 2;
+    }
+    if(!opt.inspect.empty()) return inspect(opt.inspect, opt.windowFirst, opt.windowLast);
+    if(opt.log && opt.out == "-") {
+        fprintf(stderr, "engine_sim_batch: --format log needs a file, not stdout\n");
+        return 1;
+    }
+
+    EngineConfig cfg;
+    if(!resolveEngine(opt, cfg)) return 2;
+    double maxRpm = opt.rpm * (1.0 + opt.rpmSpread * 0.5);
+    // ThermoBatch follows each cylinder forward less than one cycle per step.
+    if(maxRpm * 6.0 / opt.sampleHz >= 360.0) {
+        fprintf(stderr, "engine_sim_batch: --sample-hz %.0f is too low for %.0f rpm\n", opt.sampleHz, maxRpm);
+        return 2;
+    }
+
+    KinematicsTable kin(engineSliderCrank(cfg));
+    ThermoModel model(engineThermoSpec(cfg));
+    const float dt = (float)(1.0 / opt.sampleHz);
+    DynamicsSpec spec;
+    if(opt.stepDeg > 0.0) spec.fineStepDeg = spec.coarseStepDeg = opt.stepDeg;
+    int shardCount = (opt.engines + kShardEngines - 1) / kShardEngines;
+    std::vector<Shard> shards(shardCount);
+    for(int s=0;s<shardCount;s++){
+        Shard& sh = shards[s];
+        sh.first = s * kShardEngines;
+        sh.count = std::min(kShardEngines, opt.engines - sh.first);
+        sh.batch.reset(new EngineBatch(sh.count, cfg, kin));
+        for(int e=0;e<sh.count;e++){
+            int g = sh.first + e;
+            double f = opt.engines > 1 ? (double)g / (opt.engines - 1) - 0.5 : 0.0;
+            sh.batch->setEngine(e, (float)((g * 37) % 720), (float)(opt.rpm * (1.0 + opt.rpmSpread * f) * 6.0));
+        }
+        sh.batch->updateKinematics();
+        sh.thermo.reset(new ThermoBatch(model, *sh.batch, opt.fuelJ));
+        if(opt.dynamics) sh.dynamics.reset(new CrankDynamics(model, *sh.batch, spec));
+    }
+    double startSec = 0.0;
+    uint64_t startSamples = 0;
+    if(!opt.loadState.empty() && !loadState(opt, cfg, shards, startSec, startSamples)) return 1;
+
+    TelemetryHeader header = {};
+    header.engines = (uint32_t)opt.engines;
+    header.cylinders = (uint32_t)cfg.cylinders;
+    header.sampleHz = opt.sampleHz;
+    memcpy(header.engineName, cfg.name, sizeof(header.engineName));
+    std::vector<TelemetryColumn> columns;
+    for(int k: kinds){
+        TelemetryColumn c = {};
+        snprintf(c.name, sizeof(c.name), "%s", kColumnDefs[k].name);
+        c.type = (uint8_t)kColumnDefs[k].type;
+        c.scope = (uint8_t)kColumnDefs[k].scope;
+        columns.push_back(c);
+    }
+    if(!parseCodecs(opt, kinds, columns)) {
+        fprintf(stderr, "engine_sim_batch: --max-error needs COLUMN=E with a selected float column and E > 0\n");
+        return 2;
+    }
+    TelemetryWriter stream;
+    TelemetryLogWriter log;
+    TelemetrySink& writer = opt.log ? (TelemetrySink&)log : (TelemetrySink&)stream;
+    std::string error;
+    bool opened = opt.log ? log.open(opt.out, header, columns, opt.blockSamples, error)
+                          : stream.open(opt.out, header, columns, opt.blockSamples, error);
+    if(!opened) {
+        fprintf(stderr, "engine_sim_batch: %s\n", error.c_str());
+        return 1;
+    }
+
+    ThreadPool pool(opt.threads);
+    uint64_t total = (uint64_t)llround(opt.durationSec * opt.sampleHz);
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = true;
+    for(uint64_t done=0;done<total && ok;){
+        int rows = (int)std::min<uint64_t>(writer.blockSamples() - writer.pendingRows(), total - done);
+        pool.parallelFor(shardCount, [&](int s) {
+            Shard& sh = shards[s];
+            for(int r=0;r<rows;r++){
+                if(sh.dynamics) sh.dynamics->advance(*sh.batch, *sh.thermo, dt, opt.scheme);
+                else sh.batch->step(dt);
+                sh.thermo->advance(*sh.batch);
+                const float* speed = sh.batch->crankSpeeds();
+                double deg = 0.0;
+                for(int e=0;e<sh.count;e++) deg += speed[e];
+                sh.crankDeg += deg * dt;
+                emitRow(writer, kinds, sh, opt.engines, r);
+            }
+        });
+        ok = writer.endRows(rows);
+        done += rows;
+    }
+    ok = writer.close() && ok;
+    double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if(!ok) {
+        fprintf(stderr, "engine_sim_batch: error writing %s\n", opt.out.c_str());
+        return 1;
+    }
+
+    if(!opt.saveState.empty() && !saveState(opt, cfg, shards, startSec + total / opt.sampleHz, startSamples + total)) return 1;
+
+    double cycles = 0.0;
+    for(const Shard& sh: shards) cycles += sh.crankDeg / 720.0;
+    fprintf(stderr, "engine_sim_batch: %d x %.31s, %.2f s at %.0f Hz (%s), %d threads: %.0f engine-cycles in %.2f s"
+            " = %.2f M engine-cycles/min, %.1f MB to %s\n", opt.engines, cfg.name, opt.durationSec, opt.sampleHz,
+            !opt.dynamics ? "constant speed" : (opt.scheme == CrankIntegrator::RK4 ? "rk4" : "euler"), pool.size(),
+            cycles, wallSec, cycles / wallSec * 60.0 * 1e-6, writer.bytesWritten() / 1048576.0, opt.out.c_str());
+    return 0;
+}
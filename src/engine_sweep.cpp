@@ -0,0 +1,255 @@
+// engine_sweep.cpp
+// Parallel parameter sweep over stroke, rod length, cylinder count and
+// speed. Every grid point gets the steady-state figures of an evenly firing
+// inline engine at constant speed:
+//   peak piston acceleration   max |s''(theta)| w^2
+//   cycle work                 indicated work per 720 degrees (ThermoModel)
+//   torque ripple              (max - min) / mean of gas plus reciprocating
+//                              inertia torque over the cycle
+// Work is grouped by geometry: one task builds the ThermoModel and the
+// per-cylinder torque curves for a (stroke, rod) pair once, then sums them
+// for every cylinder count and speed. Tasks go to the work-stealing
+// ThreadPool; results land in a preallocated table, so the output does not
+// depend on the thread count.
+// Compile (Linux / MinGW):
+//   g++ -O2 src/engine_sweep.cpp src/thermo_model.cpp src/crank_kinematics.cpp src/engine_config.cpp src/engine_batch.cpp src/piston_kernels.cpp src/cpu_features.cpp src/thread_pool.cpp -o engine_sweep -pthread
+// Windows MSVC:
+//   cl /EHsc /O2 /std:c++17 src\engine_sweep.cpp src\thermo_model.cpp src\crank_kinematics.cpp src\engine_config.cpp src\engine_batch.cpp src\piston_kernels.cpp src\cpu_features.cpp src\thread_pool.cpp /Fe:engine_sweep.exe
+// Usage:
+//   engine_sweep [--stroke A:B:STEP] [--rod A:B:STEP] [--cylinders A:B:STEP] [--rpm A:B:STEP]
+//                [--bore MM] [--fuel J] [--recip-mass KG] [--resolution DEG] [--threads N]
+//                [--scaling] [--out FILE|-]
+// Lengths are in mm. --scaling reruns the sweep on 1, 2, 4 ... threads and
+// reports speedup and parallel efficiency.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crank_kinematics.h"
+#include "thermo_model.h"
+#include "thread_pool.h"
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct Range {
+    double first, last, step;
+    int count() const { return step > 0.0 && last >= first ? (int)floor((last - first) / step + 1e-9) + 1 : 0; }
+    double at(int i) const { return first + i * step; }
+};
+
+struct SweepOptions {
+    Range stroke = { 60.0, 100.0, 2.0 };
+    Range rod = { 120.0, 180.0, 5.0 };
+    Range cylinders = { 1.0, 16.0, 1.0 };
+    Range rpm = { 1000.0, 8000.0, 500.0 };
+    double bore = 86.0;
+    float fuelJ = 800.0f;
+    double recipMass = 0.45;
+    double resolutionDeg = 0.25;
+    int threads = 0;
+    bool scaling = false;
+    std::string out = "sweep.csv";
+};
+
+struct SweepPoint {
+    float strokeMm, rodMm;
+    int cylinders;
+    float rpm;
+    float peakAccel;       // m/s^2
+    float cycleWork;       // J, all cylinders
+    float meanTorque;      // N m
+    float torqueRipple;    // (max - min) / mean
+    float powerKw;
+};
+
+static bool parseRange(const char* s, Range& r) {
+    double a, b, step;
+    int n = sscanf(s, "%lf:%lf:%lf", &a, &b, &step);
+    if(n == 1) { b = a; step = 1.0; }
+    else if(n == 2) step = 1.0;
+    else if(n != 3) return false;
+    r = { a, b, step };
+    return r.count() > 0;
+}
+
+static bool parseArgs(int argc, char** argv, SweepOptions& opt) {
+    for(int i=1;i<argc;i++){
+        const char* a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(strcmp(a, "--stroke") == 0 && hasValue) { if(!parseRange(argv[++i], opt.stroke)) return false; }
+        else if(strcmp(a, "--rod") == 0 && hasValue) { if(!parseRange(argv[++i], opt.rod)) return false; }
+        else if(strcmp(a, "--cylinders") == 0 && hasValue) { if(!parseRange(argv[++i], opt.cylinders)) return false; }
+        else if(strcmp(a, "--rpm") == 0 && hasValue) { if(!parseRange(argv[++i], opt.rpm)) return false; }
+        else if(strcmp(a, "--bore") == 0 && hasValue) opt.bore = atof(argv[++i]);
+        else if(strcmp(a, "--fuel") == 0 && hasValue) opt.fuelJ = (float)atof(argv[++i]);
+        else if(strcmp(a, "--recip-mass") == 0 && hasValue) opt.recipMass = atof(argv[++i]);
+        else if(strcmp(a, "--resolution") == 0 && hasValue) opt.resolutionDeg = atof(argv[++i]);
+        else if(strcmp(a, "--threads") == 0 && hasValue) opt.threads = atoi(argv[++i]);
+        else if(strcmp(a, "--out") == 0 && hasValue) opt.out = argv[++i];
+        else if(strcmp(a, "--scaling") == 0) opt.scaling = true;
+        else return false;
+    }
+    return opt.bore > 0.0 && opt.resolutionDeg > 0.0 && opt.threads >= 0 && opt.cylinders.first >= 1.0
+        && opt.stroke.first > 0.0 && opt.rpm.first >= 0.0;
+}
+
+// Points of one geometry are contiguous: cylinders outer, speed inner.
+static int pointsPerGeometry(const SweepOptions& opt) {
+    return opt.cylinders.count() * opt.rpm.count();
+}
+
+static void sweepGeometry(const SweepOptions& opt, double strokeMm, double rodMm, SweepPoint* out) {
+    int cylCount = opt.cylinders.count(), rpmCount = opt.rpm.count();
+    SweepPoint blank = {};
+    blank.strokeMm = (float)strokeMm;
+    blank.rodMm = (float)rodMm;
+    if(rodMm <= strokeMm * 0.5) {
+        // Not a mechanism: the rod cannot reach round the crank.
+        for(int i=0;i<cylCount * rpmCount;i++){
+            out[i] = blank;
+            out[i].cylinders = (int)lround(opt.cylinders.at(i / rpmCount));
+            out[i].rpm = (float)opt.rpm.at(i % rpmCount);
+            out[i].peakAccel = out[i].cycleWork = out[i].meanTorque = out[i].torqueRipple = out[i].powerKw = NAN;
+        }
+        return;
+    }
+
+    ThermoSpec spec;
+    spec.bore = opt.bore * 1e-3;
+    spec.stroke = strokeMm * 1e-3;
+    spec.rodLength = rodMm * 1e-3;
+    spec.resolutionDeg = opt.resolutionDeg;
+    ThermoModel model(spec);
+    SliderCrank crank = { (float)(spec.stroke * 0.5), (float)spec.rodLength };
+    int n = model.samples();
+    const double toRad = M_PI / 180.0;
+
+    // One cylinder over the cycle: gas torque, and the reciprocating torque
+    // per unit w^2 (-m s' s''), plus the acceleration peak per unit w^2.
+    std::vector<double> gas(n), coupling(n);
+    double peakAcc = 0.0;
+    for(int k=0;k<n;k++){
+        double theta = k * (720.0 / n) * toRad;
+        double v = sliderCrankVelocity(crank, theta);
+        double a = sliderCrankAcceleration(crank, theta);
+        gas[k] = model.torque(k, model.steadyPressure(k, opt.fuelJ));
+        coupling[k] = -opt.recipMass * v * a;
+        peakAcc = std::max(peakAcc, fabs(a));
+    }
+    double cylWork = model.steadyWork(opt.fuelJ);
+
+    std::vector<double> gasSum(n), couplingSum(n);
+    for(int ci=0;ci<cylCount;ci++){
+        int cyl = (int)lround(opt.cylinders.at(ci));
+        // Even firing: cylinder j runs j * 720 / cyl degrees ahead.
+        std::fill(gasSum.begin(), gasSum.end(), 0.0);
+        std::fill(couplingSum.begin(), couplingSum.end(), 0.0);
+        for(int j=0;j<cyl;j++){
+            int shift = (int)lround((double)j * n / cyl) % n;
+            for(int k=0;k<n;k++){
+                int kk = k + shift < n ? k + shift : k + shift - n;
+                gasSum[k] += gas[kk];
+                couplingSum[k] += coupling[kk];
+            }
+        }
+        double work = cylWork * cyl;
+        double mean = work / (4.0 * M_PI);
+        for(int ri=0;ri<rpmCount;ri++){
+            double rpm = opt.rpm.at(ri);
+            double w = rpm * 2.0 * M_PI / 60.0;
+            double lo = INFINITY, hi = -INFINITY;
+            for(int k=0;k<n;k++){
+                double t = gasSum[k] + couplingSum[k] * w * w;
+                lo = std::min(lo, t);
+                hi = std::max(hi, t);
+            }
+            SweepPoint& p = out[ci * rpmCount + ri];
+            p = blank;
+            p.cylinders = cyl;
+            p.rpm = (float)rpm;
+            p.peakAccel = (float)(peakAcc * w * w);
+            p.cycleWork = (float)work;
+            p.meanTorque = (float)mean;
+            p.torqueRipple = (float)((hi - lo) / mean);
+            p.powerKw = (float)(mean * w * 1e-3);
+        }
+    }
+}
+
+// Runs the whole grid on threads threads; returns wall seconds.
+static double runSweep(const SweepOptions& opt, int threads, std::vector<SweepPoint>& points) {
+    int rods = opt.rod.count();
+    int geometries = opt.stroke.count() * rods;
+    int per = pointsPerGeometry(opt);
+    points.resize((size_t)geometries * per);
+    ThreadPool pool(threads);
+    auto t0 = std::chrono::steady_clock::now();
+    pool.parallelFor(geometries, [&](int g) {
+        sweepGeometry(opt, opt.stroke.at(g / rods), opt.rod.at(g % rods), points.data() + (size_t)g * per);
+    });
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static bool writeTable(const std::string& path, const std::vector<SweepPoint>& points) {
+    FILE* f = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if(!f) return false;
+    fprintf(f, "stroke_mm,rod_mm,cylinders,rpm,peak_piston_accel_ms2,cycle_work_j,mean_torque_nm,torque_ripple,"
+               "power_kw\n");
+    for(const SweepPoint& p: points){
+        if(std::isnan(p.cycleWork)) continue;
+        fprintf(f, "%.2f,%.2f,%d,%.0f,%.1f,%.2f,%.3f,%.4f,%.3f\n", p.strokeMm, p.rodMm, p.cylinders, p.rpm,
+                p.peakAccel, p.cycleWork, p.meanTorque, p.torqueRipple, p.powerKw);
+    }
+    bool ok = !ferror(f);
+    if(f != stdout) ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    SweepOptions opt;
+    if(!parseArgs(argc, argv, opt)) {
+        fprintf(stderr, "usage: engine_sweep [--stroke A:B:STEP] [--rod A:B:STEP] [--cylinders A:B:STEP]\n"
+                        "                    [--rpm A:B:STEP] [--bore MM] [--fuel J] [--recip-mass KG]\n"
+                        "                    [--resolution DEG] [--threads N] [--scaling] [--out FILE|-]\n");
+        return 2;
+    }
+    int geometries = opt.stroke.count() * opt.rod.count();
+    size_t total = (size_t)geometries * pointsPerGeometry(opt);
+
+    std::vector<SweepPoint> points;
+    double sec = runSweep(opt, opt.threads, points);
+    int threads = opt.threads > 0 ? opt.threads : std::max(1, (int)std::thread::hardware_concurrency());
+    fprintf(stderr, "engine_sweep: %zu points (%d geometries) on %d threads in %.3f s = %.0f points/s\n", total,
+            geometries, threads, sec, total / sec);
+    if(!writeTable(opt.out, points)) {
+        fprintf(stderr, "engine_sweep: cannot write %s\n", opt.out.c_str());
+        return 1;
+    }
+
+    if(opt.scaling) {
+        // Same grid on 1, 2, 4 ... threads, up to the hardware count.
+        int hw = std::max(1, (int)std::thread::hardware_concurrency());
+        std::vector<SweepPoint> check;
+        double base = 0.0;
+        fprintf(stderr, "scaling (%d hardware threads):\n", hw);
+        for(int t=1;;t*=2){
+            if(t > hw) t = hw;
+            double s = runSweep(opt, t, check);
+            if(t == 1) base = s;
+            bool same = memcmp(check.data(), points.data(), points.size() * sizeof(SweepPoint)) == 0;
+            fprintf(stderr, "  %3d threads: %8.3f s  %10.0f points/s  x%5.2f  (%3.0f%% efficiency)%s\n", t, s,
+                    total / s, base / s, base / s / t * 100.0, same ? "" : "  RESULTS DIFFER");
+            if(t == hw) break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+// frame_profiler.cpp
+// Pass timers, frame history and overlay (see frame_profiler.h).
+
+#include "frame_profiler.h"
+#include "engine_scene.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+FrameProfiler frameProfiler;
+
+static const char* const kPassNames[kProfPasses] = {
+    "display", "landing", "block", "combustion", "retained", "sim", "swap",
+};
+
+const char* profPassName(ProfPass p) {
+    return (int)p < kProfPasses ? kPassNames[(int)p] : "?";
+}
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameProfiler::setEnabled(bool enable) {
+    on = enable;
+    if(on) profileSinks.fetch_or(kSinkOverlay);
+    else profileSinks.fetch_and((uint8_t)~kSinkOverlay);
+    head = count = 0;
+    cur = ProfileFrame();
+    inFrame = false;
+    open = nullptr;
+    lastFrameStartNs = 0;
+    for(int p=0;p<kProfPasses;p++) passDepth[p] = 0;
+}
+
+void FrameProfiler::beginFrame() {
+    if(!on) return;
+    if(gpu) collectGpu();
+    frameStartNs = nowNs();
+    cur.intervalMs = lastFrameStartNs ? (float)((frameStartNs - lastFrameStartNs) * 1e-6) : 0.0f;
+    lastFrameStartNs = frameStartNs;
+    cur.id = nextId++;
+    inFrame = true;
+    if(gpu) {
+        open = &pending[cur.id % 4];
+        open->id = cur.id;
+        open->intervals = 0;
+        gpu->beginFrame(cur.id);
+    }
+}
+
+void FrameProfiler::endFrame() {
+    if(!on || !inFrame) return;
+    if(gpu) gpu->endFrame();
+    for(int p=0;p<kProfPasses;p++) cur.gpuMs[p] = -1.0f;
+    history[head] = cur;
+    head = (head + 1) % kProfileFrames;
+    count = std::min(count + 1, kProfileFrames);
+    cur = ProfileFrame();
+    inFrame = false;
+    open = nullptr;
+}
+
+void FrameProfiler::beginPass(ProfPass p) {
+    int i = (int)p;
+    if(passDepth[i]++ > 0) return;   // recursion: the outermost entry counts
+    passMark[i] = open ? (int16_t)gpu->mark() : -1;
+    passStartNs[i] = nowNs();
+}
+
+void FrameProfiler::endPass(ProfPass p) {
+    int i = (int)p;
+    if(passDepth[i] <= 0 || --passDepth[i] > 0) return;
+    cur.cpuMs[i] += (float)((nowNs() - passStartNs[i]) * 1e-6);
+    cur.entries[i]++;
+    if(open && passMark[i] >= 0 && open->intervals < kProfileGpuIntervals) {
+        int end = gpu->mark();
+        if(end >= 0) open->interval[open->intervals++] = { (uint8_t)i, passMark[i], (int16_t)end };
+    }
+}
+
+void ProfileScope::begin() {
+    if(sinks & kSinkTrace) startNs = traceNowNs();
+    if(sinks & kSinkOverlay) frameProfiler.beginPass(p);
+}
+
+void ProfileScope::end() {
+    if(sinks & kSinkOverlay) frameProfiler.endPass(p);
+    if(sinks & kSinkTrace) traceSpan(profPassName(p), startNs, traceNowNs());
+}
+
+ProfileFrame* FrameProfiler::findFrame(uint64_t id) {
+    if(count == 0) return nullptr;
+    ProfileFrame& newest = history[(head + kProfileFrames - 1) % kProfileFrames];
+    if(id > newest.id || newest.id - id >= (uint64_t)count) return nullptr;
+    return &history[(head + kProfileFrames - 1 - (int)(newest.id - id)) % kProfileFrames];
+}
+
+void FrameProfiler::collectGpu() {
+    uint64_t id;
+    while(gpu->poll(id, markNs)) {
+        const GpuPending& pend = pending[id % 4];
+        ProfileFrame* f = findFrame(id);
+        if(pend.id != id || !f) continue;
+        for(int p=0;p<kProfPasses;p++) f->gpuMs[p] = 0.0f;
+        for(int k=0;k<pend.intervals;k++){
+            const GpuInterval& iv = pend.interval[k];
+            if(iv.end < (int)markNs.size() && markNs[iv.end] >= markNs[iv.begin])
+                f->gpuMs[iv.pass] += (float)((markNs[iv.end] - markNs[iv.begin]) * 1e-6);
+        }
+    }
+}
+
+const ProfileFrame& FrameProfiler::frame(int i) const {
+    return history[(head - count + i + 2 * kProfileFrames) % kProfileFrames];
+}
+
+float FrameProfiler::intervalPercentile(float pct) const {
+    sorted.clear();
+    for(int i=0;i<count;i++) if(frame(i).intervalMs > 0.0f) sorted.push_back(frame(i).intervalMs);
+    if(sorted.empty()) return 0.0f;
+    size_t k = (size_t)(pct / 100.0f * (sorted.size() - 1) + 0.5f);
+    std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+    return sorted[k];
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Overlay
+//////////////////////////////////////////////////////////////////////////
+void FrameProfiler::drawOverlay(int windowW, int windowH, const char* note) {
+    if(!on) return;
+    on = false;   // the overlay's own draws are not part of the frame
+
+    const float rowH = 15.0f, graphH = 64.0f, graphMaxMs = 50.0f;
+    const float panelW = std::min(380.0f, windowW - 20.0f);
+    const float x0 = 10.0f, top = windowH - 10.0f;
+    const int rows = 3 + kProfPasses + (note ? 1 : 0);
+    float bottom = top - rows * rowH - graphH - 16.0f;
+
+    gfx->blend(true);
+    gfx->color(0.05f, 0.05f, 0.08f, 0.72f);
+    gfx->fillRect(x0, bottom, x0 + panelW, top);
+    gfx->blend(false);
+
+    // Averages over the kept frames; GPU only over frames read back.
+    float cpu[kProfPasses] = {}, gpuSum[kProfPasses] = {}, entries[kProfPasses] = {};
+    int gpuFrames = 0;
+    double intervalSum = 0.0;
+    int intervals = 0;
+    for(int i=0;i<count;i++){
+        const ProfileFrame& f = frame(i);
+        bool hasGpu = f.gpuMs[0] >= 0.0f;
+        gpuFrames += hasGpu;
+        for(int p=0;p<kProfPasses;p++){
+            cpu[p] += f.cpuMs[p];
+            entries[p] += f.entries[p];
+            if(hasGpu) gpuSum[p] += f.gpuMs[p];
+        }
+        if(f.intervalMs > 0.0f) {
+            intervalSum += f.intervalMs;
+            intervals++;
+        }
+    }
+    const ProfileFrame* last = count ? &frame(count - 1) : nullptr;
+
+    char line[128];
+    float y = top - rowH + 2.0f;
+    gfx->color(1.0f, 1.0f, 1.0f);
+    snprintf(line, sizeof(line), "frame %5.1f ms %4.0f fps  p50 %.1f  p95 %.1f  p99 %.1f  max %.1f",
+             last ? last->intervalMs : 0.0f, intervals ? 1000.0 * intervals / intervalSum : 0.0,
+             intervalPercentile(50.0f), intervalPercentile(95.0f), intervalPercentile(99.0f),
+             intervalPercentile(100.0f));
+    drawText(line, x0 + 6.0f, y, FONT_HELVETICA_12);
+    y -= rowH;
+    snprintf(line, sizeof(line), "draw calls %u   vertices %u", last ? last->drawCalls : 0u, last ? last->vertices : 0u);
+    drawText(line, x0 + 6.0f, y, FONT_HELVETICA_12);
+    y -= rowH;
+    if(note) {
+        drawText(note, x0 + 6.0f, y, FONT_HELVETICA_12);
+        y -= rowH;
+    }
+    gfx->color(0.7f, 0.7f, 0.75f);
+    drawText("pass            cpu ms    gpu ms    calls/frame", x0 + 6.0f, y, FONT_HELVETICA_12);
+    for(int p=0;p<kProfPasses;p++){
+        y -= rowH;
+        char gpuText[16] = "     -";
+        if(gpuFrames && entries[p] > 0.0f) snprintf(gpuText, sizeof(gpuText), "%6.3f", gpuSum[p] / gpuFrames);
+        snprintf(line, sizeof(line), "%-12s %8.3f  %s  %8.1f", kPassNames[p], count ? cpu[p] / count : 0.0f, gpuText,
+                 count ? entries[p] / count : 0.0f);
+        gfx->color(entries[p] > 0.0f ? 1.0f : 0.5f, entries[p] > 0.0f ? 1.0f : 0.5f, entries[p] > 0.0f ? 1.0f : 0.5f);
+        drawText(line, x0 + 6.0f, y, FONT_HELVETICA_12);
+    }
+
+    // Frame interval graph, newest on the right, with 60 and 30 fps lines.
+    float gx0 = x0 + 6.0f, gy0 = bottom + 6.0f;
+    float barW = (panelW - 12.0f) / kProfileFrames;
+    float scale = graphH / graphMaxMs;
+    for(int i=0;i<count;i++){
+        float ms = frame(i).intervalMs;
+        if(ms <= 0.0f) continue;
+        if(ms <= 17.5f) gfx->color(0.3f, 0.85f, 0.35f);
+        else if(ms <= 34.0f) gfx->color(0.95f, 0.8f, 0.2f);
+        else gfx->color(0.95f, 0.3f, 0.25f);
+        float bx = gx0 + (kProfileFrames - count + i) * barW;
+        gfx->fillRect(bx, gy0, bx + std::max(barW - 0.25f, 1.0f), gy0 + std::min(ms, graphMaxMs) * scale);
+    }
+    gfx->color(0.8f, 0.8f, 0.85f);
+    const float marks[4] = {
+        gx0, gy0 + 1000.0f / 60.0f * scale, gx0 + panelW - 12.0f, gy0 + 1000.0f / 60.0f * scale,
+    };
+    gfx->lines(marks, 2);
+    const float marks30[4] = {
+        gx0, gy0 + 1000.0f / 30.0f * scale, gx0 + panelW - 12.0f, gy0 + 1000.0f / 30.0f * scale,
+    };
+    gfx->lines(marks30, 2);
+
+    on = true;
+}
@@ -0,0 +1,135 @@
+// frame_profiler.h
+// Frame-time profiler with a live overlay. Render passes are timed with
+// scoped CPU timers (ProfileScope) and, when a GpuPassClock is attached,
+// with GPU timestamps around the same scopes; a pass entered several times
+// in a frame (one combustion cloud per cylinder) sums its intervals. The
+// backends count draw calls and vertices submitted. The last kProfileFrames
+// frames are kept for the overlay: frame interval graph, p50 / p95 / p99,
+// and per-pass CPU and GPU milliseconds.
+//
+// Everything is off until setEnabled(true); disabled scopes and counters
+// cost one branch on a global flag. ProfileScope also feeds the span trace
+// (trace_export.h) when one is open.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "trace_export.h"
+
+enum class ProfPass : uint8_t { Display, Landing, Block, Combustion, Retained, Sim, Swap, Count };
+
+const int kProfPasses = (int)ProfPass::Count;
+const int kProfileFrames = 240;
+const int kProfileGpuIntervals = 96;   // GPU-timed scope entries per frame
+
+const char* profPassName(ProfPass p);
+
+// GPU half of the pass timers: timestamps queued in the command stream and
+// read back frames later, without stalling.
+class GpuPassClock {
+public:
+    virtual ~GpuPassClock() {}
+    virtual void beginFrame(uint64_t frame) = 0;
+    // Queues a timestamp; its index within the frame, or -1 when out of queries.
+    virtual int mark() = 0;
+    virtual void endFrame() = 0;
+    // Oldest ended frame whose timestamps have all landed: its id and the
+    // time of each mark in ns. False while none is ready.
+    virtual bool poll(uint64_t& frame, std::vector<uint64_t>& markNs) = 0;
+};
+
+struct ProfileFrame {
+    uint64_t id = 0;
+    float intervalMs = 0.0f;            // since the previous frame began
+    float cpuMs[kProfPasses] = {};
+    float gpuMs[kProfPasses] = {};      // negative until read back (or without a clock)
+    uint16_t entries[kProfPasses] = {};
+    uint32_t drawCalls = 0;
+    uint32_t vertices = 0;
+};
+
+class FrameProfiler {
+public:
+    void setEnabled(bool on);
+    bool enabled() const { return on; }
+    // Not owned; nullptr for CPU timing only.
+    void setGpuClock(GpuPassClock* clock) { gpu = clock; }
+
+    // Brackets one displayed frame. Passes timed outside a frame (the sim
+    // step in the timer callback) count towards the next one.
+    void beginFrame();
+    void endFrame();
+
+    void beginPass(ProfPass p);
+    void endPass(ProfPass p);
+    void countDraw(int vertices) {
+        if(on) {
+            cur.drawCalls++;
+            cur.vertices += (uint32_t)vertices;
+        }
+    }
+
+    // Frames kept, oldest first; i < frames().
+    int frames() const { return count; }
+    const ProfileFrame& frame(int i) const;
+    // Percentile (0..100) of the frame interval over the kept frames.
+    float intervalPercentile(float pct) const;
+
+    // Draws the overlay at the top-left of the window through gfx / drawText,
+    // with note (if any) as an extra line under the draw counts.
+    void drawOverlay(int windowW, int windowH, const char* note = nullptr);
+
+private:
+    struct GpuInterval {
+        uint8_t pass;
+        int16_t begin, end;             // mark indices
+    };
+    struct GpuPending {
+        uint64_t id = 0;
+        int intervals = 0;
+        GpuInterval interval[kProfileGpuIntervals];
+    };
+
+    ProfileFrame* findFrame(uint64_t id);
+    void collectGpu();
+
+    bool on = false;
+    GpuPassClock* gpu = nullptr;
+    ProfileFrame history[kProfileFrames];
+    int head = 0, count = 0;            // next slot, frames kept
+    ProfileFrame cur;
+    bool inFrame = false;
+    uint64_t nextId = 1;
+    int64_t frameStartNs = 0, lastFrameStartNs = 0;
+    int64_t passStartNs[kProfPasses] = {};
+    int passDepth[kProfPasses] = {};
+    int16_t passMark[kProfPasses] = {};
+    GpuPending pending[4];              // frames whose timestamps are in flight
+    GpuPending* open = nullptr;
+    std::vector<uint64_t> markNs;
+    mutable std::vector<float> sorted;
+};
+
+extern FrameProfiler frameProfiler;
+
+// Times the enclosing scope as pass p while the profiler is enabled or a
+// trace is open.
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfPass pass) : p(pass), sinks(profileSinks.load(std::memory_order_relaxed)) {
+        if(sinks) begin();
+    }
+    ~ProfileScope() {
+        if(sinks) end();
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    void begin();
+    void end();
+
+    ProfPass p;
+    uint8_t sinks;
+    int64_t startNs = 0;
+};
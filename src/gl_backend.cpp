@@ -0,0 +1,79 @@
+// gl_backend.cpp
+// Immediate-mode GL implementation of RenderBackend.
+
+#include "gl_backend.h"
+#include "frame_profiler.h"
+#include "gl_call_stats.h"
+#include <GL/glut.h>
+
+void GLBackend::clear(float r, float g, float b, float a) {
+    cglClearColor(r, g, b, a);
+    cglClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GLBackend::color(float r, float g, float b, float a) {
+    cglColor4f(r, g, b, a);
+}
+
+void GLBackend::blend(bool enabled) {
+    if(enabled) {
+        cglEnable(GL_BLEND);
+        cglBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        cglDisable(GL_BLEND);
+    }
+}
+
+void GLBackend::lineWidth(float w) {
+    cglLineWidth(w);
+}
+
+void GLBackend::pushTransform(float x, float y, float scale) {
+    cglPushMatrix();
+    cglTranslatef(x, y, 0.0f);
+    if(scale != 1.0f) cglScalef(scale, scale, 1.0f);
+}
+
+void GLBackend::popTransform() {
+    cglPopMatrix();
+}
+
+void GLBackend::fillRect(float x0, float y0, float x1, float y1) {
+    frameProfiler.countDraw(4);
+    cglBegin(GL_QUADS);
+      cglVertex2f(x0, y0);
+      cglVertex2f(x1, y0);
+      cglVertex2f(x1, y1);
+      cglVertex2f(x0, y1);
+    cglEnd();
+}
+
+void GLBackend::fillFan(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    cglBegin(GL_TRIANGLE_FAN);
+    for(int i=0;i<count;i++) cglVertex2f(xy[2*i], xy[2*i+1]);
+    cglEnd();
+}
+
+void GLBackend::lines(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    cglBegin(GL_LINES);
+    for(int i=0;i<count;i++) cglVertex2f(xy[2*i], xy[2*i+1]);
+    cglEnd();
+}
+
+void GLBackend::lineLoop(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    cglBegin(GL_LINE_LOOP);
+    for(int i=0;i<count;i++) cglVertex2f(xy[2*i], xy[2*i+1]);
+    cglEnd();
+}
+
+void GLBackend::text(float x, float y, const char* s, TextFont font) {
+    frameProfiler.countDraw(0);
+    void* glutFont = GLUT_BITMAP_HELVETICA_18;
+    if(font == FONT_HELVETICA_12) glutFont = GLUT_BITMAP_HELVETICA_12;
+    else if(font == FONT_TIMES_ROMAN_24) glutFont = GLUT_BITMAP_TIMES_ROMAN_24;
+    cglRasterPos2f(x, y);
+    for(; *s; ++s) cglutBitmapCharacter(glutFont, *s);
+}
@@ -0,0 +1,22 @@
+// gl_backend.h
+// RenderBackend implemented with GL immediate mode (the original drawing path).
+#pragma once
+
+#include "render_backend.h"
+
+class GLBackend : public RenderBackend {
+public:
+    void clear(float r, float g, float b, float a) override;
+    void color(float r, float g, float b, float a = 1.0f) override;
+    void blend(bool enabled) override;
+    void lineWidth(float w) override;
+
+    void pushTransform(float x, float y, float scale = 1.0f) override;
+    void popTransform() override;
+
+    void fillRect(float x0, float y0, float x1, float y1) override;
+    void fillFan(const float* xy, int count) override;
+    void lines(const float* xy, int count) override;
+    void lineLoop(const float* xy, int count) override;
+    void text(float x, float y, const char* s, TextFont font) override;
+};
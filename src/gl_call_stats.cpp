@@ -0,0 +1,176 @@
+// gl_call_stats.cpp
+// GL call counters and budget files (see gl_call_stats.h).
+
+#include "gl_call_stats.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+GLCallStats glCallStats;
+
+#define ENGINE_GL_COUNTED_NAME(id, name) name,
+static const char* const kCallNames[kGLCalls] = { ENGINE_GL_COUNTED(ENGINE_GL_COUNTED_NAME) };
+#undef ENGINE_GL_COUNTED_NAME
+
+static const char* const kStateNames[kGLStates] = { "color", "blend", "blend_func", "line_width" };
+
+const char* glCallName(GLCall c) {
+    return (int)c < kGLCalls ? kCallNames[(int)c] : "?";
+}
+
+const char* glStateName(GLState s) {
+    return (int)s < kGLStates ? kStateNames[(int)s] : "?";
+}
+
+uint32_t GLCallFrame::totalCalls() const {
+    uint32_t n = 0;
+    for(int i=0;i<kGLCalls;i++) n += calls[i];
+    return n;
+}
+
+uint32_t GLCallFrame::totalChanges() const {
+    uint32_t n = 0;
+    for(int i=0;i<kGLStates;i++) n += changes[i];
+    return n;
+}
+
+uint32_t GLCallFrame::totalRedundant() const {
+    uint32_t n = 0;
+    for(int i=0;i<kGLStates;i++) n += redundant[i];
+    return n;
+}
+
+void GLCallStats::setEnabled(bool enable) {
+    on = enable;
+    cur = last = sum = GLCallFrame();
+    frameCount = 0;
+    for(bool& k: known) k = false;
+}
+
+void GLCallStats::beginFrame() {
+    cur = GLCallFrame();
+}
+
+void GLCallStats::endFrame() {
+    if(!on) return;
+    last = cur;
+    for(int i=0;i<kGLCalls;i++) sum.calls[i] += cur.calls[i];
+    for(int i=0;i<kGLStates;i++){
+        sum.changes[i] += cur.changes[i];
+        sum.redundant[i] += cur.redundant[i];
+    }
+    sum.vertices += cur.vertices;
+    frameCount++;
+    cur = GLCallFrame();
+}
+
+std::vector<GLCallMetric> GLCallStats::averages() const {
+    std::vector<GLCallMetric> m;
+    double n = frameCount ? (double)frameCount : 1.0;
+    m.push_back({ "calls", sum.totalCalls() / n });
+    m.push_back({ "vertices", sum.vertices / n });
+    m.push_back({ "state_changes", sum.totalChanges() / n });
+    m.push_back({ "redundant_state_changes", sum.totalRedundant() / n });
+    for(int i=0;i<kGLCalls;i++) m.push_back({ std::string("calls.") + kCallNames[i], sum.calls[i] / n });
+    for(int i=0;i<kGLStates;i++){
+        m.push_back({ std::string("changes.") + kStateNames[i], sum.changes[i] / n });
+        m.push_back({ std::string("redundant.") + kStateNames[i], sum.redundant[i] / n });
+    }
+    return m;
+}
+
+void GLCallStats::setState(GLState s, bool same) {
+    int i = (int)s;
+    cur.changes[i]++;
+    if(known[i] && same) cur.redundant[i]++;
+    known[i] = true;
+}
+
+bool GLCallStats::color(float r, float g, float b, float a) {
+    cur.calls[(int)GLCall::Color]++;
+    setState(GLState::Color, colorRGBA[0] == r && colorRGBA[1] == g && colorRGBA[2] == b && colorRGBA[3] == a);
+    colorRGBA[0] = r; colorRGBA[1] = g; colorRGBA[2] = b; colorRGBA[3] = a;
+    return fwd;
+}
+
+bool GLCallStats::blend(GLCall c, bool enable) {
+    cur.calls[(int)c]++;
+    setState(GLState::Blend, blendOn == enable);
+    blendOn = enable;
+    return fwd;
+}
+
+bool GLCallStats::blendFunc(GLenum src, GLenum dst) {
+    cur.calls[(int)GLCall::BlendFunc]++;
+    setState(GLState::BlendFunc, funcSrc == src && funcDst == dst);
+    funcSrc = src;
+    funcDst = dst;
+    return fwd;
+}
+
+bool GLCallStats::lineWidth(float w) {
+    cur.calls[(int)GLCall::LineWidth]++;
+    setState(GLState::LineWidth, width == w);
+    width = w;
+    return fwd;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Budget files
+//////////////////////////////////////////////////////////////////////////
+bool checkGLCallBudget(const std::string& path, const std::vector<GLCallMetric>& metrics, std::string& error) {
+    std::ifstream in(path);
+    if(!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    int lineNo = 0, over = 0, checked = 0;
+    while(std::getline(in, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if(hash != std::string::npos) line.resize(hash);
+        std::istringstream fields(line);
+        std::string name;
+        double limit;
+        if(!(fields >> name)) continue;
+        if(!(fields >> limit)) {
+            error = path + ":" + std::to_string(lineNo) + ": expected 'metric limit'";
+            return false;
+        }
+        const GLCallMetric* m = nullptr;
+        for(const GLCallMetric& x: metrics) if(x.name == name) m = &x;
+        if(!m) {
+            error = path + ":" + std::to_string(lineNo) + ": unknown metric '" + name + "'";
+            return false;
+        }
+        checked++;
+        // Budgets are written rounded to 0.01.
+        if(m->perFrame > limit + 0.005) {
+            printf("  over budget: %-34s %10.2f per frame (budget %.2f)\n", name.c_str(), m->perFrame, limit);
+            over++;
+        }
+    }
+    if(over) {
+        error = std::to_string(over) + " of " + std::to_string(checked) + " budgeted metrics exceeded";
+        return false;
+    }
+    return true;
+}
+
+bool writeGLCallBudget(const std::string& path, const std::vector<GLCallMetric>& metrics, std::string& error) {
+    FILE* f = fopen(path.c_str(), "w");
+    if(!f) {
+        error = "cannot create " + path;
+        return false;
+    }
+    fprintf(f, "# GL calls per frame, engine_sim --gl-count; checked with --gl-budget\n");
+    for(const GLCallMetric& m: metrics) fprintf(f, "%s %.2f\n", m.name.c_str(), m.perFrame);
+    if(fclose(f) != 0) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,182 @@
+// gl_call_stats.h
+// Counting layer over the GL calls the window issues per frame. GLBackend
+// and the retained renderer call the gl* wrappers below instead of GL; while
+// glCallStats is enabled each call is counted per entry point, vertices
+// are counted, and state setters (colour, GL_BLEND, blend function, line
+// width) are tracked against the last value set, so a change that sets what
+// is already current shows up as redundant. Totals accumulate per frame
+// between beginFrame() and endFrame().
+//
+// setForward(false) drops the calls after counting, which lets the
+// immediate-mode path run without a context: engine_sim --gl-count counts
+// the fixed frame sequence that way and can gate it against a budget file.
+//
+// Disabled, a wrapper costs one branch before the GL call.
+#pragma once
+
+#include "gl_ext.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define ENGINE_GL_COUNTED(X) \
+    X(ClearColor,  "glClearColor") \
+    X(Clear,       "glClear") \
+    X(Color,       "glColor4f") \
+    X(Enable,      "glEnable") \
+    X(Disable,     "glDisable") \
+    X(BlendFunc,   "glBlendFunc") \
+    X(LineWidth,   "glLineWidth") \
+    X(PushMatrix,  "glPushMatrix") \
+    X(PopMatrix,   "glPopMatrix") \
+    X(Translate,   "glTranslatef") \
+    X(Scale,       "glScalef") \
+    X(Begin,       "glBegin") \
+    X(End,         "glEnd") \
+    X(Vertex,      "glVertex2f") \
+    X(RasterPos,   "glRasterPos2f") \
+    X(Bitmap,      "glutBitmapCharacter") \
+    X(DrawArrays,  "glDrawArrays") \
+    X(DrawArraysInstanced, "glDrawArraysInstanced")
+
+#define ENGINE_GL_COUNTED_ENUM(id, name) id,
+enum class GLCall : uint8_t { ENGINE_GL_COUNTED(ENGINE_GL_COUNTED_ENUM) Count };
+#undef ENGINE_GL_COUNTED_ENUM
+
+const int kGLCalls = (int)GLCall::Count;
+
+// Pipeline state whose setters are checked for redundancy.
+enum class GLState : uint8_t { Color, Blend, BlendFunc, LineWidth, Count };
+const int kGLStates = (int)GLState::Count;
+
+const char* glCallName(GLCall c);
+const char* glStateName(GLState s);
+
+struct GLCallFrame {
+    uint32_t calls[kGLCalls] = {};
+    uint32_t vertices = 0;             // glVertex2f plus glDrawArrays[Instanced] counts
+    uint32_t changes[kGLStates] = {};  // setter calls
+    uint32_t redundant[kGLStates] = {};// of those, set to the current value
+
+    uint32_t totalCalls() const;
+    uint32_t totalChanges() const;
+    uint32_t totalRedundant() const;
+};
+
+// One named per-frame figure, as printed and as compared with a budget.
+struct GLCallMetric {
+    std::string name;
+    double perFrame;
+};
+
+class GLCallStats {
+public:
+    void setEnabled(bool on);
+    bool enabled() const { return on; }
+    // False: counted calls do not reach GL.
+    void setForward(bool forward) { fwd = forward; }
+
+    void beginFrame();
+    void endFrame();
+    // Last completed frame, and the average over completed frames.
+    const GLCallFrame& lastFrame() const { return last; }
+    int frames() const { return frameCount; }
+    std::vector<GLCallMetric> averages() const;
+
+    // Called by the wrappers while enabled; the result says whether to
+    // forward the call to GL.
+    bool call(GLCall c) {
+        cur.calls[(int)c]++;
+        return fwd;
+    }
+    bool vertices(GLCall c, int n) {
+        cur.calls[(int)c]++;
+        cur.vertices += (uint32_t)n;
+        return fwd;
+    }
+    bool color(float r, float g, float b, float a);
+    bool blend(GLCall c, bool enable);
+    bool blendFunc(GLenum src, GLenum dst);
+    bool lineWidth(float w);
+
+private:
+    void setState(GLState s, bool same);
+
+    bool on = false, fwd = true;
+    GLCallFrame cur, last, sum;
+    int frameCount = 0;
+    // Last value set; known[] is false until the first set after enabling.
+    bool known[kGLStates] = {};
+    float colorRGBA[4] = {};
+    bool blendOn = false;
+    GLenum funcSrc = 0, funcDst = 0;
+    float width = 0.0f;
+};
+
+extern GLCallStats glCallStats;
+
+// Budget file: one "metric limit" per line, # comments; metrics as listed by
+// averages(). Exceeded metrics are printed; false if any (or on a bad file).
+bool checkGLCallBudget(const std::string& path, const std::vector<GLCallMetric>& metrics, std::string& error);
+bool writeGLCallBudget(const std::string& path, const std::vector<GLCallMetric>& metrics, std::string& error);
+
+//////////////////////////////////////////////////////////////////////////
+// Wrappers
+//////////////////////////////////////////////////////////////////////////
+inline void cglClearColor(float r, float g, float b, float a) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::ClearColor)) glClearColor(r, g, b, a);
+}
+inline void cglClear(GLbitfield mask) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::Clear)) glClear(mask);
+}
+inline void cglColor4f(float r, float g, float b, float a) {
+    if(!glCallStats.enabled() || glCallStats.color(r, g, b, a)) glColor4f(r, g, b, a);
+}
+inline void cglEnable(GLenum cap) {
+    if(!glCallStats.enabled() || (cap == GL_BLEND ? glCallStats.blend(GLCall::Enable, true) : glCallStats.call(GLCall::Enable)))
+        glEnable(cap);
+}
+inline void cglDisable(GLenum cap) {
+    if(!glCallStats.enabled() || (cap == GL_BLEND ? glCallStats.blend(GLCall::Disable, false) : glCallStats.call(GLCall::Disable)))
+        glDisable(cap);
+}
+inline void cglBlendFunc(GLenum src, GLenum dst) {
+    if(!glCallStats.enabled() || glCallStats.blendFunc(src, dst)) glBlendFunc(src, dst);
+}
+inline void cglLineWidth(float w) {
+    if(!glCallStats.enabled() || glCallStats.lineWidth(w)) glLineWidth(w);
+}
+inline void cglPushMatrix() {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::PushMatrix)) glPushMatrix();
+}
+inline void cglPopMatrix() {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::PopMatrix)) glPopMatrix();
+}
+inline void cglTranslatef(float x, float y, float z) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::Translate)) glTranslatef(x, y, z);
+}
+inline void cglScalef(float x, float y, float z) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::Scale)) glScalef(x, y, z);
+}
+inline void cglBegin(GLenum mode) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::Begin)) glBegin(mode);
+}
+inline void cglEnd() {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::End)) glEnd();
+}
+inline void cglVertex2f(float x, float y) {
+    if(!glCallStats.enabled() || glCallStats.vertices(GLCall::Vertex, 1)) glVertex2f(x, y);
+}
+inline void cglRasterPos2f(float x, float y) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::RasterPos)) glRasterPos2f(x, y);
+}
+inline void cglutBitmapCharacter(void* font, int c) {
+    if(!glCallStats.enabled() || glCallStats.call(GLCall::Bitmap)) glutBitmapCharacter(font, c);
+}
+inline void cglDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    if(!glCallStats.enabled() || glCallStats.vertices(GLCall::DrawArrays, count)) glDrawArrays(mode, first, count);
+}
+inline void cglDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+    if(!glCallStats.enabled() || glCallStats.vertices(GLCall::DrawArraysInstanced, count * instances))
+        pglDrawArraysInstanced(mode, first, count, instances);
+}
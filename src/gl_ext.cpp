@@ -0,0 +1,58 @@
+// gl_ext.cpp
+// Runtime loading of GL entry points (see gl_ext.h).
+
+#include "gl_ext.h"
+#include <GL/freeglut.h>
+#include <cstdio>
+#include <cstring>
+
+#define ENGINE_GL_DEFINE(type, name) type p##name = nullptr;
+ENGINE_GL_FUNCS(ENGINE_GL_DEFINE)
+#undef ENGINE_GL_DEFINE
+
+GLCaps glCaps;
+
+static bool hasExtension(const char* name) {
+    const char* ext = (const char*)glGetString(GL_EXTENSIONS);
+    if(!ext) return false;
+    size_t len = strlen(name);
+    for(const char* p = strstr(ext, name); p; p = strstr(p + len, name)) {
+        bool startOk = (p == ext || p[-1] == ' ');
+        bool endOk = (p[len] == ' ' || p[len] == '\0');
+        if(startOk && endOk) return true;
+    }
+    return false;
+}
+
+static bool versionAtLeast(int major, int minor) {
+    return glCaps.major > major || (glCaps.major == major && glCaps.minor >= minor);
+}
+
+bool loadGLExtensions() {
+    const char* ver = (const char*)glGetString(GL_VERSION);
+    if(!ver || sscanf(ver, "%d.%d", &glCaps.major, &glCaps.minor) != 2) {
+        glCaps.major = 1; glCaps.minor = 0;
+    }
+
+#define ENGINE_GL_LOAD(type, name) p##name = (type)glutGetProcAddress(#name);
+    ENGINE_GL_FUNCS(ENGINE_GL_LOAD)
+#undef ENGINE_GL_LOAD
+
+    // glXGetProcAddress happily returns stubs for unsupported names, so the
+    // version / extension string decides what is usable, not the pointer.
+    glCaps.vertexBuffers = (versionAtLeast(1, 5) || hasExtension("GL_ARB_vertex_buffer_object"))
+        && pglGenBuffers && pglBindBuffer && pglBufferData && pglBufferSubData;
+    glCaps.bufferStorage = (versionAtLeast(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+        && pglBufferStorage && pglMapBufferRange;
+    glCaps.sync = (versionAtLeast(3, 2) || hasExtension("GL_ARB_sync"))
+        && pglFenceSync && pglClientWaitSync && pglDeleteSync;
+    glCaps.timerQuery = (versionAtLeast(3, 3) || hasExtension("GL_ARB_timer_query"))
+        && pglGenQueries && pglDeleteQueries && pglQueryCounter && pglGetQueryObjectiv && pglGetQueryObjectui64v;
+    glCaps.instancing = versionAtLeast(3, 3) && pglCreateShader && pglShaderSource && pglCompileShader
+        && pglGetShaderiv && pglGetShaderInfoLog && pglDeleteShader && pglCreateProgram && pglAttachShader
+        && pglBindAttribLocation && pglLinkProgram && pglGetProgramiv && pglGetProgramInfoLog && pglDeleteProgram
+        && pglUseProgram && pglGetUniformLocation && pglUniform1f && pglVertexAttribPointer
+        && pglEnableVertexAttribArray && pglDisableVertexAttribArray && pglVertexAttribDivisor
+        && pglDrawArraysInstanced;
+    return glCaps.vertexBuffers;
+}
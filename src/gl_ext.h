@@ -0,0 +1,66 @@
+// gl_ext.h
+// Minimal runtime loader for the post-GL-1.1 entry points we use.
+// opengl32.lib on Windows only exports GL 1.1, so everything newer is fetched
+// through glutGetProcAddress and called through the pgl* pointers below.
+#pragma once
+
+#include <GL/glut.h>
+#include <GL/glext.h>
+
+#define ENGINE_GL_FUNCS(X) \
+    X(PFNGLGENBUFFERSPROC,        glGenBuffers) \
+    X(PFNGLDELETEBUFFERSPROC,     glDeleteBuffers) \
+    X(PFNGLBINDBUFFERPROC,        glBindBuffer) \
+    X(PFNGLBUFFERDATAPROC,        glBufferData) \
+    X(PFNGLBUFFERSUBDATAPROC,     glBufferSubData) \
+    X(PFNGLBUFFERSTORAGEPROC,     glBufferStorage) \
+    X(PFNGLMAPBUFFERRANGEPROC,    glMapBufferRange) \
+    X(PFNGLUNMAPBUFFERPROC,       glUnmapBuffer) \
+    X(PFNGLFENCESYNCPROC,         glFenceSync) \
+    X(PFNGLCLIENTWAITSYNCPROC,    glClientWaitSync) \
+    X(PFNGLDELETESYNCPROC,        glDeleteSync) \
+    X(PFNGLGENQUERIESPROC,        glGenQueries) \
+    X(PFNGLDELETEQUERIESPROC,     glDeleteQueries) \
+    X(PFNGLQUERYCOUNTERPROC,      glQueryCounter) \
+    X(PFNGLGETQUERYOBJECTIVPROC,  glGetQueryObjectiv) \
+    X(PFNGLGETQUERYOBJECTUI64VPROC, glGetQueryObjectui64v) \
+    X(PFNGLCREATESHADERPROC,      glCreateShader) \
+    X(PFNGLSHADERSOURCEPROC,      glShaderSource) \
+    X(PFNGLCOMPILESHADERPROC,     glCompileShader) \
+    X(PFNGLGETSHADERIVPROC,       glGetShaderiv) \
+    X(PFNGLGETSHADERINFOLOGPROC,  glGetShaderInfoLog) \
+    X(PFNGLDELETESHADERPROC,      glDeleteShader) \
+    X(PFNGLCREATEPROGRAMPROC,     glCreateProgram) \
+    X(PFNGLATTACHSHADERPROC,      glAttachShader) \
+    X(PFNGLBINDATTRIBLOCATIONPROC, glBindAttribLocation) \
+    X(PFNGLLINKPROGRAMPROC,       glLinkProgram) \
+    X(PFNGLGETPROGRAMIVPROC,      glGetProgramiv) \
+    X(PFNGLGETPROGRAMINFOLOGPROC, glGetProgramInfoLog) \
+    X(PFNGLDELETEPROGRAMPROC,     glDeleteProgram) \
+    X(PFNGLUSEPROGRAMPROC,        glUseProgram) \
+    X(PFNGLGETUNIFORMLOCATIONPROC, glGetUniformLocation) \
+    X(PFNGLUNIFORM1FPROC,         glUniform1f) \
+    X(PFNGLVERTEXATTRIBPOINTERPROC, glVertexAttribPointer) \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, glEnableVertexAttribArray) \
+    X(PFNGLDISABLEVERTEXATTRIBARRAYPROC, glDisableVertexAttribArray) \
+    X(PFNGLVERTEXATTRIBDIVISORPROC, glVertexAttribDivisor) \
+    X(PFNGLDRAWARRAYSINSTANCEDPROC, glDrawArraysInstanced)
+
+#define ENGINE_GL_DECLARE(type, name) extern type p##name;
+ENGINE_GL_FUNCS(ENGINE_GL_DECLARE)
+#undef ENGINE_GL_DECLARE
+
+struct GLCaps {
+    int major = 1, minor = 0;
+    bool vertexBuffers = false;   // GL 1.5 / ARB_vertex_buffer_object
+    bool bufferStorage = false;   // GL 4.4 / ARB_buffer_storage (persistent mapping)
+    bool sync = false;            // GL 3.2 / ARB_sync
+    bool timerQuery = false;      // GL 3.3 / ARB_timer_query (GL_TIMESTAMP counters)
+    bool instancing = false;      // GL 3.3: GLSL 3.30 shaders, instanced draws, attribute divisors
+};
+
+extern GLCaps glCaps;
+
+// Must be called with a current context (after glutCreateWindow).
+// Returns false when vertex buffers are unavailable.
+bool loadGLExtensions();
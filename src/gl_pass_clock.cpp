@@ -0,0 +1,60 @@
+// gl_pass_clock.cpp
+// GL timestamp queries for the frame profiler (see gl_pass_clock.h).
+
+#include "gl_pass_clock.h"
+
+bool GLPassClock::init() {
+    if(ready()) return true;
+    loadGLExtensions();
+    if(!glCaps.timerQuery) return false;
+    queries.resize((size_t)kSlots * kMarks);
+    pglGenQueries((GLsizei)queries.size(), queries.data());
+    for(Slot& s: slots) s = Slot();
+    return true;
+}
+
+void GLPassClock::shutdown() {
+    if(!ready()) return;
+    pglDeleteQueries((GLsizei)queries.size(), queries.data());
+    queries.clear();
+    open = nullptr;
+}
+
+void GLPassClock::beginFrame(uint64_t frame) {
+    if(!ready()) return;
+    // A slot still pending here lost its results to a GPU 4 frames behind.
+    open = &slots[frame % kSlots];
+    open->frame = frame;
+    open->marks = 0;
+    open->pending = false;
+}
+
+int GLPassClock::mark() {
+    if(!open || open->marks >= kMarks) return -1;
+    pglQueryCounter(queries[(size_t)(open - slots) * kMarks + open->marks], GL_TIMESTAMP);
+    return open->marks++;
+}
+
+void GLPassClock::endFrame() {
+    if(!open) return;
+    open->pending = true;
+    open = nullptr;
+}
+
+bool GLPassClock::poll(uint64_t& frame, std::vector<uint64_t>& markNs) {
+    Slot* oldest = nullptr;
+    for(Slot& s: slots)
+        if(s.pending && (!oldest || s.frame < oldest->frame)) oldest = &s;
+    if(!oldest) return false;
+    const GLuint* q = &queries[(size_t)(oldest - slots) * kMarks];
+    if(oldest->marks > 0) {
+        GLint available = 0;
+        pglGetQueryObjectiv(q[oldest->marks - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) return false;
+    }
+    markNs.resize(oldest->marks);
+    for(int i=0;i<oldest->marks;i++) pglGetQueryObjectui64v(q[i], GL_QUERY_RESULT, (GLuint64*)&markNs[i]);
+    frame = oldest->frame;
+    oldest->pending = false;
+    return true;
+}
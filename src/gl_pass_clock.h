@@ -0,0 +1,38 @@
+// gl_pass_clock.h
+// GpuPassClock on GL timestamp queries (GL 3.3 / ARB_timer_query): each
+// mark is a glQueryCounter(GL_TIMESTAMP), and a frame is read back once its
+// last query reports available, typically two or three frames later, so
+// the profiler never waits on the GPU.
+#pragma once
+
+#include <vector>
+#include "frame_profiler.h"
+#include "gl_ext.h"
+
+class GLPassClock : public GpuPassClock {
+public:
+    // Needs a current context; false when timer queries are unsupported.
+    // Queries left at exit go with the context, so there is no destructor.
+    bool init();
+    void shutdown();
+    bool ready() const { return !queries.empty(); }
+
+    void beginFrame(uint64_t frame) override;
+    int mark() override;
+    void endFrame() override;
+    bool poll(uint64_t& frame, std::vector<uint64_t>& markNs) override;
+
+private:
+    static const int kSlots = 4;                       // frames in flight
+    static const int kMarks = 2 * kProfileGpuIntervals;
+
+    struct Slot {
+        uint64_t frame = 0;
+        int marks = 0;
+        bool pending = false;                          // ended, not yet polled
+    };
+
+    std::vector<GLuint> queries;                       // kSlots x kMarks
+    Slot slots[kSlots];
+    Slot* open = nullptr;
+};
@@ -0,0 +1,153 @@
+// image_io.cpp
+// PPM / PNG frame writers (see image_io.h).
+
+#include "image_io.h"
+#include "soft_raster.h"
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_PNM
+#include "stb_image.h"
+
+bool writePPM(const std::string& path, const Framebuffer& fb) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return false;
+    fprintf(f, "P6\n%d %d\n255\n", fb.width, fb.height);
+    std::vector<uint8_t> line((size_t)fb.width * 3);
+    for(int y=fb.height-1;y>=0;y--){
+        const uint8_t* src = fb.row(y);
+        for(int x=0;x<fb.width;x++){
+            line[3*x+0] = src[4*x+0];
+            line[3*x+1] = src[4*x+1];
+            line[3*x+2] = src[4*x+2];
+        }
+        fwrite(line.data(), 1, line.size(), f);
+    }
+    return fclose(f) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// PNG
+//////////////////////////////////////////////////////////////////////////
+static uint32_t crcTable[256];
+
+static void initCrcTable() {
+    if(crcTable[1]) return;
+    for(uint32_t n=0;n<256;n++){
+        uint32_t c = n;
+        for(int k=0;k<8;k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crcTable[n] = c;
+    }
+}
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    for(size_t i=0;i<len;i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+static void writeChunk(FILE* f, const char type[4], const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> buf;
+    putU32(buf, (uint32_t)data.size());
+    buf.insert(buf.end(), type, type + 4);
+    buf.insert(buf.end(), data.begin(), data.end());
+    uint32_t crc = crc32Update(0xFFFFFFFFu, buf.data() + 4, buf.size() - 4) ^ 0xFFFFFFFFu;
+    putU32(buf, crc);
+    fwrite(buf.data(), 1, buf.size(), f);
+}
+
+bool writePNG(const std::string& path, const Framebuffer& fb) {
+    initCrcTable();
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return false;
+    static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    fwrite(signature, 1, 8, f);
+
+    std::vector<uint8_t> ihdr;
+    putU32(ihdr, (uint32_t)fb.width);
+    putU32(ihdr, (uint32_t)fb.height);
+    ihdr.push_back(8);   // bit depth
+    ihdr.push_back(6);   // RGBA
+    ihdr.push_back(0); ihdr.push_back(0); ihdr.push_back(0);
+    writeChunk(f, "IHDR", ihdr);
+
+    // Raw scanlines (filter byte 0), top row first.
+    size_t stride = (size_t)fb.width * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * fb.height);
+    for(int y=fb.height-1;y>=0;y--){
+        raw.push_back(0);
+        const uint8_t* src = fb.row(y);
+        raw.insert(raw.end(), src, src + stride);
+    }
+
+    // zlib stream made of stored deflate blocks (max 65535 bytes each).
+    std::vector<uint8_t> z;
+    z.push_back(0x78); z.push_back(0x01);
+    size_t pos = 0;
+    do {
+        size_t n = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + n == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back((uint8_t)n); z.push_back((uint8_t)(n >> 8));
+        z.push_back((uint8_t)~n); z.push_back((uint8_t)(~n >> 8));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        pos += n;
+    } while(pos < raw.size());
+    uint32_t a = 1, b = 0;
+    for(uint8_t v: raw) { a = (a + v) % 65521; b = (b + a) % 65521; }
+    putU32(z, (b << 16) | a);
+    writeChunk(f, "IDAT", z);
+
+    writeChunk(f, "IEND", std::vector<uint8_t>());
+    return fclose(f) == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Reading / comparison
+//////////////////////////////////////////////////////////////////////////
+bool readImage(const std::string& path, Framebuffer& fb) {
+    int w = 0, h = 0, comp = 0;
+    stbi_uc* data = stbi_load(path.c_str(), &w, &h, &comp, 4);
+    if(!data) return false;
+    fb.resize(w, h);
+    for(int y=0;y<h;y++){
+        const stbi_uc* src = data + (size_t)(h - 1 - y) * w * 4;
+        std::copy(src, src + (size_t)w * 4, fb.row(y));
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+ImageDiff compareImages(const Framebuffer& a, const Framebuffer& b, int tolerance) {
+    ImageDiff d;
+    if(a.width != b.width || a.height != b.height) return d;
+    d.sizeMatches = true;
+    size_t pixels = (size_t)a.width * a.height;
+    if(pixels == 0) return d;
+    unsigned long long sum = 0;
+    size_t over = 0;
+    for(size_t i=0;i<pixels;i++){
+        int worst = 0;
+        for(int c=0;c<3;c++){
+            int diff = abs((int)a.rgba[4*i+c] - (int)b.rgba[4*i+c]);
+            sum += diff;
+            worst = std::max(worst, diff);
+        }
+        d.maxChannelDiff = std::max(d.maxChannelDiff, worst);
+        if(worst > tolerance) over++;
+    }
+    d.meanChannelDiff = (double)sum / (pixels * 3);
+    d.pctPixelsOver = 100.0 * over / pixels;
+    return d;
+}
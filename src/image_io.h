@@ -0,0 +1,24 @@
+// image_io.h
+// Writers for headless frame dumps. Both take a bottom-up RGBA framebuffer
+// (GL row order) and write it top-down.
+#pragma once
+
+#include <string>
+
+struct Framebuffer;
+
+bool writePPM(const std::string& path, const Framebuffer& fb);
+// Uncompressed (stored-deflate) RGBA PNG: no zlib dependency, larger files.
+bool writePNG(const std::string& path, const Framebuffer& fb);
+
+// Loads any format stb_image understands into fb (converted to bottom-up RGBA).
+bool readImage(const std::string& path, Framebuffer& fb);
+
+struct ImageDiff {
+    bool sizeMatches = false;
+    int maxChannelDiff = 0;
+    double meanChannelDiff = 0.0;
+    double pctPixelsOver = 0.0;   // % of pixels with any channel differing by more than the tolerance
+};
+
+ImageDiff compareImages(const Framebuffer& a, const Framebuffer& b, int tolerance);
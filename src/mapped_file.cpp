@@ -0,0 +1,175 @@
+// mapped_file.cpp
+// File mappings (see mapped_file.h).
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFileWriter::~MappedFileWriter() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path) {
+    close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(f == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER len;
+    if(!GetFileSizeEx(f, &len) || len.QuadPart <= 0) {
+        CloseHandle(f);
+        return false;
+    }
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!m) {
+        CloseHandle(f);
+        return false;
+    }
+    void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if(!view) {
+        CloseHandle(m);
+        CloseHandle(f);
+        return false;
+    }
+    fileHandle = f;
+    mapHandle = m;
+    base = (const uint8_t*)view;
+    bytes = (size_t)len.QuadPart;
+    return true;
+}
+
+void MappedFile::close() {
+    if(base) UnmapViewOfFile(base);
+    if(mapHandle) CloseHandle((HANDLE)mapHandle);
+    if(fileHandle) CloseHandle((HANDLE)fileHandle);
+    base = nullptr;
+    bytes = 0;
+    mapHandle = fileHandle = nullptr;
+}
+
+bool MappedFileWriter::create(const std::string& path) {
+    close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(f == INVALID_HANDLE_VALUE) return false;
+    fileHandle = f;
+    fileBytes = 0;
+    return true;
+}
+
+bool MappedFileWriter::isOpen() const {
+    return fileHandle != nullptr;
+}
+
+bool MappedFileWriter::close() {
+    if(!fileHandle) return true;
+    bool ok = CloseHandle((HANDLE)fileHandle) != 0;
+    fileHandle = nullptr;
+    fileBytes = 0;
+    return ok;
+}
+
+bool MappedFileWriter::reserve(uint64_t bytes) {
+    return bytes <= fileBytes ? fileHandle != nullptr : truncate(bytes);
+}
+
+bool MappedFileWriter::truncate(uint64_t bytes) {
+    if(!fileHandle) return false;
+    LARGE_INTEGER at;
+    at.QuadPart = (LONGLONG)bytes;
+    if(!SetFilePointerEx((HANDLE)fileHandle, at, nullptr, FILE_BEGIN) || !SetEndOfFile((HANDLE)fileHandle))
+        return false;
+    fileBytes = bytes;
+    return true;
+}
+
+uint8_t* MappedFileWriter::map(uint64_t offset, size_t bytes) {
+    if(!reserve(offset + bytes)) return nullptr;
+    uint64_t end = offset + bytes;
+    HANDLE m = CreateFileMappingA((HANDLE)fileHandle, nullptr, PAGE_READWRITE, (DWORD)(end >> 32),
+                                  (DWORD)(end & 0xffffffffu), nullptr);
+    if(!m) return nullptr;
+    void* view = MapViewOfFile(m, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)(offset & 0xffffffffu), bytes);
+    CloseHandle(m);   // the view keeps the mapping alive
+    return (uint8_t*)view;
+}
+
+void MappedFileWriter::unmap(uint8_t* view, size_t) {
+    if(view) UnmapViewOfFile(view);
+}
+#else
+bool MappedFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // the mapping keeps the file referenced
+    if(p == MAP_FAILED) return false;
+    base = (const uint8_t*)p;
+    bytes = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if(base) munmap((void*)base, bytes);
+    base = nullptr;
+    bytes = 0;
+}
+
+bool MappedFileWriter::create(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    fileBytes = 0;
+    return fd >= 0;
+}
+
+bool MappedFileWriter::isOpen() const {
+    return fd >= 0;
+}
+
+bool MappedFileWriter::close() {
+    if(fd < 0) return true;
+    bool ok = ::close(fd) == 0;
+    fd = -1;
+    fileBytes = 0;
+    return ok;
+}
+
+bool MappedFileWriter::reserve(uint64_t bytes) {
+    return bytes <= fileBytes ? fd >= 0 : truncate(bytes);
+}
+
+bool MappedFileWriter::truncate(uint64_t bytes) {
+    if(fd < 0) return false;
+    if(ftruncate(fd, (off_t)bytes) != 0) return false;
+    fileBytes = bytes;
+    return true;
+}
+
+uint8_t* MappedFileWriter::map(uint64_t offset, size_t bytes) {
+    if(!reserve(offset + bytes)) return nullptr;
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)offset);
+    return p == MAP_FAILED ? nullptr : (uint8_t*)p;
+}
+
+void MappedFileWriter::unmap(uint8_t* view, size_t bytes) {
+    if(view) munmap(view, bytes);
+}
+#endif
@@ -0,0 +1,71 @@
+// mapped_file.h
+// Memory-mapped file access (mmap on POSIX, file mapping views on Windows).
+// MappedFile maps a whole file read-only; pages are faulted in on first
+// touch, so opening a large file costs the same as opening a small one.
+// MappedFileWriter maps read-write windows of a file it grows on demand, for
+// append-only formats written in place (telemetry_log.h).
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps path, replacing any current mapping. Empty files fail.
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return base != nullptr; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return bytes; }
+
+private:
+    const uint8_t* base = nullptr;
+    size_t bytes = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+};
+
+class MappedFileWriter {
+public:
+    MappedFileWriter() {}
+    ~MappedFileWriter();
+    MappedFileWriter(const MappedFileWriter&) = delete;
+    MappedFileWriter& operator=(const MappedFileWriter&) = delete;
+
+    // Creates or truncates path.
+    bool create(const std::string& path);
+    // Closes the file; views must be unmapped first.
+    bool close();
+    bool isOpen() const;
+
+    // Grows the file to at least bytes (new space reads as zero).
+    bool reserve(uint64_t bytes);
+    // Sets the file size exactly; views beyond it must be unmapped first.
+    bool truncate(uint64_t bytes);
+    uint64_t size() const { return fileBytes; }
+    // Maps [offset, offset + bytes) read-write, growing the file to cover it.
+    // offset must be a multiple of kMappingGranularity.
+    uint8_t* map(uint64_t offset, size_t bytes);
+    void unmap(uint8_t* view, size_t bytes);
+
+    // Mapping offsets are aligned to this on every platform (the Windows
+    // allocation granularity; a multiple of any POSIX page size in use).
+    static constexpr size_t kMappingGranularity = 65536;
+
+private:
+    uint64_t fileBytes = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
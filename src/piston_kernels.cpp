@@ -0,0 +1,246 @@
+// piston_kernels.cpp
+// Scalar / AVX2 / NEON piston position and phase (see piston_kernels.h).
+//
+// Angle reduction, for a in [0, 720):
+//   t = a mod 360, x = t - 180            cos(a) = -cos(x), x in [-180, 180)
+//   y = |x|, z = min(y, 180 - y)          cos(y) = -cos(180 - y) past 90
+//   cos(a) = (y > 90 ? +1 : -1) * P(z)    P = Taylor cosine to z^12 on [0, pi/2]
+
+#include "piston_kernels.h"
+#include "cpu_features.h"
+#include <cmath>
+
+#ifdef ENGINE_X86
+#include <immintrin.h>
+#endif
+#ifdef ENGINE_NEON
+#include <arm_neon.h>
+#endif
+
+static const float kDegToRad = 0.017453292519943295f;
+static const float kC2 = -1.0f / 2.0f;
+static const float kC4 = 1.0f / 24.0f;
+static const float kC6 = -1.0f / 720.0f;
+static const float kC8 = 1.0f / 40320.0f;
+static const float kC10 = -1.0f / 3628800.0f;
+static const float kC12 = 1.0f / 479001600.0f;
+
+//////////////////////////////////////////////////////////////////////////
+// Scalar
+//////////////////////////////////////////////////////////////////////////
+static inline float cosPoly(float z) {
+    float z2 = z * z;
+    float p = kC12;
+    p = p * z2 + kC10;
+    p = p * z2 + kC8;
+    p = p * z2 + kC6;
+    p = p * z2 + kC4;
+    p = p * z2 + kC2;
+    return p * z2 + 1.0f;
+}
+
+static void evaluateScalar(const float* crankAngleDeg, const float* phaseOffsetDeg, int n,
+                           float R, float L, float* pos, uint8_t* kind) {
+    float L2 = L * L, R2 = R * R;
+    for(int i=0;i<n;i++){
+        float a = crankAngleDeg[i] + phaseOffsetDeg[i];
+        a -= 720.0f * (float)(a >= 720.0f);
+        int q = (int)(a * (1.0f / 180.0f));
+        kind[i] = (uint8_t)(q < 3 ? q : 3);
+
+        float t = a - 360.0f * (float)(a >= 360.0f);
+        float y = fabsf(t - 180.0f);
+        float z = fminf(y, 180.0f - y);
+        float c = cosPoly(z * kDegToRad);
+        c = y > 90.0f ? c : -c;
+        float q2 = L2 - R2 * (1.0f - c * c);
+        pos[i] = R - R * c + L - sqrtf(q2 > 0.0f ? q2 : 0.0f);
+    }
+}
+
+#ifdef ENGINE_X86
+//////////////////////////////////////////////////////////////////////////
+// AVX2 (2 x 8 cylinders per iteration)
+//////////////////////////////////////////////////////////////////////////
+struct AVX2Consts {
+    __m256 c720, c360, c180, c90, inv180, degToRad, absMask, signMask, zero;
+    __m256 R, L, L2, R2, one;
+    __m256i three;
+};
+
+ENGINE_TARGET_AVX2 static inline __m256 cosPolyAVX2(__m256 z) {
+    __m256 z2 = _mm256_mul_ps(z, z);
+    __m256 p = _mm256_set1_ps(kC12);
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(kC10));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(kC8));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(kC6));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(kC4));
+    p = _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(kC2));
+    return _mm256_add_ps(_mm256_mul_ps(p, z2), _mm256_set1_ps(1.0f));
+}
+
+// 8 cylinders: returns positions, writes 8 phase bytes.
+ENGINE_TARGET_AVX2 static inline __m256 piston8AVX2(const AVX2Consts& k, __m256 crank, __m256 offset, uint8_t* kind) {
+    __m256 a = _mm256_add_ps(crank, offset);
+    a = _mm256_sub_ps(a, _mm256_and_ps(_mm256_cmp_ps(a, k.c720, _CMP_GE_OQ), k.c720));
+
+    __m256i q = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(a, k.inv180)), k.three);
+    __m128i q16 = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+    _mm_storel_epi64((__m128i*)kind, _mm_packus_epi16(q16, q16));
+
+    __m256 t = _mm256_sub_ps(a, _mm256_and_ps(_mm256_cmp_ps(a, k.c360, _CMP_GE_OQ), k.c360));
+    __m256 y = _mm256_and_ps(_mm256_sub_ps(t, k.c180), k.absMask);
+    __m256 z = _mm256_min_ps(y, _mm256_sub_ps(k.c180, y));
+    __m256 c = cosPolyAVX2(_mm256_mul_ps(z, k.degToRad));
+    // negate where y <= 90
+    c = _mm256_xor_ps(c, _mm256_andnot_ps(_mm256_cmp_ps(y, k.c90, _CMP_GT_OQ), k.signMask));
+
+    __m256 sin2 = _mm256_sub_ps(k.one, _mm256_mul_ps(c, c));
+    __m256 q2 = _mm256_max_ps(_mm256_sub_ps(k.L2, _mm256_mul_ps(k.R2, sin2)), k.zero);
+    __m256 s = _mm256_sub_ps(k.R, _mm256_mul_ps(k.R, c));
+    return _mm256_sub_ps(_mm256_add_ps(s, k.L), _mm256_sqrt_ps(q2));
+}
+
+ENGINE_TARGET_AVX2 static void evaluateAVX2(const float* crankAngleDeg, const float* phaseOffsetDeg, int n,
+                                            float R, float L, float* pos, uint8_t* kind) {
+    AVX2Consts k;
+    k.c720 = _mm256_set1_ps(720.0f);
+    k.c360 = _mm256_set1_ps(360.0f);
+    k.c180 = _mm256_set1_ps(180.0f);
+    k.c90 = _mm256_set1_ps(90.0f);
+    k.inv180 = _mm256_set1_ps(1.0f / 180.0f);
+    k.degToRad = _mm256_set1_ps(kDegToRad);
+    k.absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    k.signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000u));
+    k.zero = _mm256_setzero_ps();
+    k.R = _mm256_set1_ps(R);
+    k.L = _mm256_set1_ps(L);
+    k.L2 = _mm256_set1_ps(L * L);
+    k.R2 = _mm256_set1_ps(R * R);
+    k.one = _mm256_set1_ps(1.0f);
+    k.three = _mm256_set1_epi32(3);
+
+    int i = 0;
+    for(;i+16<=n;i+=16){
+        __m256 p0 = piston8AVX2(k, _mm256_loadu_ps(crankAngleDeg + i), _mm256_loadu_ps(phaseOffsetDeg + i), kind + i);
+        __m256 p1 = piston8AVX2(k, _mm256_loadu_ps(crankAngleDeg + i + 8), _mm256_loadu_ps(phaseOffsetDeg + i + 8), kind + i + 8);
+        _mm256_storeu_ps(pos + i, p0);
+        _mm256_storeu_ps(pos + i + 8, p1);
+    }
+    for(;i+8<=n;i+=8)
+        _mm256_storeu_ps(pos + i, piston8AVX2(k, _mm256_loadu_ps(crankAngleDeg + i), _mm256_loadu_ps(phaseOffsetDeg + i), kind + i));
+    // Avoid AVX/SSE transition stalls in the caller (see span_kernels.cpp).
+    _mm256_zeroupper();
+    evaluateScalar(crankAngleDeg + i, phaseOffsetDeg + i, n - i, R, L, pos + i, kind + i);
+}
+#endif // ENGINE_X86
+
+#ifdef ENGINE_NEON
+//////////////////////////////////////////////////////////////////////////
+// NEON (4 x 4 cylinders per iteration)
+//////////////////////////////////////////////////////////////////////////
+static inline float32x4_t cosPolyNEON(float32x4_t z) {
+    float32x4_t z2 = vmulq_f32(z, z);
+    float32x4_t p = vdupq_n_f32(kC12);
+    p = vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(kC10));
+    p = vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(kC8));
+    p = vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(kC6));
+    p = vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(kC4));
+    p = vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(kC2));
+    return vaddq_f32(vmulq_f32(p, z2), vdupq_n_f32(1.0f));
+}
+
+// 4 cylinders: returns positions and the phase as 16-bit lanes.
+static inline float32x4_t piston4NEON(float32x4_t a, float R, float L, uint16x4_t& kind) {
+    const float32x4_t c720 = vdupq_n_f32(720.0f), c360 = vdupq_n_f32(360.0f);
+    const float32x4_t c180 = vdupq_n_f32(180.0f);
+    a = vsubq_f32(a, vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(a, c720), vreinterpretq_u32_f32(c720))));
+
+    uint32x4_t q = vminq_u32(vcvtq_u32_f32(vmulq_n_f32(a, 1.0f / 180.0f)), vdupq_n_u32(3));
+    kind = vmovn_u32(q);
+
+    float32x4_t t = vsubq_f32(a, vreinterpretq_f32_u32(vandq_u32(vcgeq_f32(a, c360), vreinterpretq_u32_f32(c360))));
+    float32x4_t y = vabsq_f32(vsubq_f32(t, c180));
+    float32x4_t z = vminq_f32(y, vsubq_f32(c180, y));
+    float32x4_t c = cosPolyNEON(vmulq_n_f32(z, kDegToRad));
+    c = vbslq_f32(vcgtq_f32(y, vdupq_n_f32(90.0f)), c, vnegq_f32(c));
+
+    float32x4_t sin2 = vsubq_f32(vdupq_n_f32(1.0f), vmulq_f32(c, c));
+    float32x4_t q2 = vmaxq_f32(vsubq_f32(vdupq_n_f32(L * L), vmulq_n_f32(sin2, R * R)), vdupq_n_f32(0.0f));
+    float32x4_t s = vsubq_f32(vdupq_n_f32(R), vmulq_n_f32(c, R));
+    return vsubq_f32(vaddq_f32(s, vdupq_n_f32(L)), vsqrtq_f32(q2));
+}
+
+static void evaluateNEON(const float* crankAngleDeg, const float* phaseOffsetDeg, int n,
+                         float R, float L, float* pos, uint8_t* kind) {
+    int i = 0;
+    for(;i+16<=n;i+=16){
+        uint16x4_t k[4];
+        for(int j=0;j<4;j++){
+            float32x4_t a = vaddq_f32(vld1q_f32(crankAngleDeg + i + 4*j), vld1q_f32(phaseOffsetDeg + i + 4*j));
+            vst1q_f32(pos + i + 4*j, piston4NEON(a, R, L, k[j]));
+        }
+        uint8x8_t lo = vmovn_u16(vcombine_u16(k[0], k[1]));
+        uint8x8_t hi = vmovn_u16(vcombine_u16(k[2], k[3]));
+        vst1q_u8(kind + i, vcombine_u8(lo, hi));
+    }
+    evaluateScalar(crankAngleDeg + i, phaseOffsetDeg + i, n - i, R, L, pos + i, kind + i);
+}
+#endif // ENGINE_NEON
+
+//////////////////////////////////////////////////////////////////////////
+// Dispatch
+//////////////////////////////////////////////////////////////////////////
+static const PistonKernels scalarKernels = { PistonIsa::Scalar, evaluateScalar };
+#ifdef ENGINE_X86
+static const PistonKernels avx2Kernels = { PistonIsa::AVX2, evaluateAVX2 };
+#endif
+#ifdef ENGINE_NEON
+static const PistonKernels neonKernels = { PistonIsa::NEON, evaluateNEON };
+#endif
+
+static const PistonKernels* forced = nullptr;
+
+bool pistonIsaSupported(PistonIsa isa) {
+    if(isa == PistonIsa::Scalar) return true;
+#ifdef ENGINE_X86
+    if(isa == PistonIsa::AVX2) return cpuHasAVX2();
+#endif
+#ifdef ENGINE_NEON
+    if(isa == PistonIsa::NEON) return true;
+#endif
+    return false;
+}
+
+static const PistonKernels& bestPistonKernels() {
+#ifdef ENGINE_X86
+    if(cpuHasAVX2()) return avx2Kernels;
+#endif
+#ifdef ENGINE_NEON
+    return neonKernels;
+#endif
+    return scalarKernels;
+}
+
+const PistonKernels& pistonKernelsFor(PistonIsa isa) {
+    if(isa == PistonIsa::Scalar) return scalarKernels;
+    return bestPistonKernels();   // at most one SIMD variant exists per target
+}
+
+const PistonKernels& pistonKernels() {
+    if(forced) return *forced;
+    static const PistonKernels& best = bestPistonKernels();
+    return best;
+}
+
+void forcePistonIsa(PistonIsa isa) {
+    forced = &pistonKernelsFor(isa);
+}
+
+const char* pistonIsaName(PistonIsa isa) {
+    switch(isa) {
+        case PistonIsa::AVX2: return "avx2";
+        case PistonIsa::NEON: return "neon";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,33 @@
+// piston_kernels.h
+// Vectorized piston position and stroke phase for many cylinders at once,
+// with AVX2 (16 per iteration) and NEON (16 per iteration) variants picked at
+// startup and a scalar fallback running the same arithmetic.
+//
+// Position is the exact slider-crank displacement below TDC. Cosine comes
+// from a polynomial (|error| < 1e-7 over a full turn) and sin^2 = 1 - cos^2,
+// so no libm call or table gather is needed; phase is the quarter of the
+// 720-degree cycle, computed without branches.
+#pragma once
+
+#include <cstdint>
+
+enum class PistonIsa { Scalar, AVX2, NEON };
+
+struct PistonKernels {
+    PistonIsa isa;
+    // For i < n: cycle angle a = crankAngleDeg[i] + phaseOffsetDeg[i], both in
+    // [0, 720). pos[i] = displacement below TDC for crank radius R and rod
+    // length L (L > R); kind[i] = 0 intake, 1 compression, 2 power, 3 exhaust.
+    void (*evaluate)(const float* crankAngleDeg, const float* phaseOffsetDeg, int n,
+                     float R, float L, float* pos, uint8_t* kind);
+};
+
+// Best variant supported by this CPU (detected on first call).
+const PistonKernels& pistonKernels();
+// Specific variant; falls back to the best supported one if isa is unavailable.
+const PistonKernels& pistonKernelsFor(PistonIsa isa);
+bool pistonIsaSupported(PistonIsa isa);
+const char* pistonIsaName(PistonIsa isa);
+
+// Overrides what pistonKernels() returns (benchmarks, comparisons).
+void forcePistonIsa(PistonIsa isa);
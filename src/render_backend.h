@@ -0,0 +1,38 @@
+// render_backend.h
+// The small set of 2D primitives the scene is drawn with. The GL backend maps
+// them onto immediate-mode calls; the software backend rasterizes them into an
+// RGBA framebuffer for headless rendering.
+//
+// Coordinates follow the window projection set up in reshape(): origin at the
+// bottom-left, one unit per pixel.
+#pragma once
+
+enum TextFont { FONT_HELVETICA_12, FONT_HELVETICA_18, FONT_TIMES_ROMAN_24 };
+
+class RenderBackend {
+public:
+    virtual ~RenderBackend() {}
+
+    virtual void clear(float r, float g, float b, float a) = 0;
+    virtual void color(float r, float g, float b, float a = 1.0f) = 0;
+    // Alpha blending with (SRC_ALPHA, ONE_MINUS_SRC_ALPHA).
+    virtual void blend(bool enabled) = 0;
+    virtual void lineWidth(float w) = 0;
+    // Painter's-order layer of the draws that follow, for backends that
+    // reorder draws (RenderQueue): lower passes land first, draws within a
+    // pass may be reordered. Backends drawing in submission order ignore it.
+    virtual void pass(int p) { (void)p; }
+
+    // Scale about the current origin, then offset by (x, y) in the outer space;
+    // line widths and text size are not scaled.
+    virtual void pushTransform(float x, float y, float scale = 1.0f) = 0;
+    virtual void popTransform() = 0;
+
+    virtual void fillRect(float x0, float y0, float x1, float y1) = 0;
+    // Convex polygon as a triangle fan; xy holds count interleaved points.
+    virtual void fillFan(const float* xy, int count) = 0;
+    // Independent segments, two points per segment.
+    virtual void lines(const float* xy, int count) = 0;
+    virtual void lineLoop(const float* xy, int count) = 0;
+    virtual void text(float x, float y, const char* s, TextFont font) = 0;
+};
@@ -0,0 +1,212 @@
+// render_queue.cpp
+// Recording, sorting and flushing of the render queue (see render_queue.h).
+
+#include "render_queue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Sort key, most significant first: pass 5 | blend 1 | transform 3 |
+// line width 8 (lines only) | colour RGBA8 32 | submission index 15.
+static const int kSeqBits = 15;
+static const size_t kMaxDraws = (size_t)1 << kSeqBits;
+static const size_t kMaxTransforms = 8;
+static const int kMaxPass = 31;
+
+RenderQueue::RenderQueue() {
+    // Room for a frame of the animation several times over.
+    draws.reserve(1024);
+    xy.reserve(16384);
+    chars.reserve(1024);
+    keys.reserve(1024);
+    transforms.reserve(kMaxTransforms);
+    stack.reserve(8);
+}
+
+void RenderQueue::begin(RenderBackend* to) {
+    target = to;
+    draws.clear();
+    xy.clear();
+    chars.clear();
+    transforms.assign(1, Transform{ 0.0f, 0.0f, 1.0f });
+    stack.clear();
+    stackXform = 0;
+    rgba[0] = rgba[1] = rgba[2] = rgba[3] = 1.0f;
+    blendOn = false;
+    width = 1.0f;
+    passId = 0;
+    frameStats = RenderQueueStats();
+}
+
+static uint64_t packColor(const float c[4]) {
+    uint64_t v = 0;
+    for(int i=0;i<4;i++){
+        float x = std::min(std::max(c[i], 0.0f), 1.0f);
+        v = v << 8 | (uint64_t)lrintf(x * 255.0f);
+    }
+    return v;
+}
+
+void RenderQueue::flush() {
+    if(draws.empty() || !target) return;
+    keys.clear();
+    for(size_t i=0;i<draws.size();i++){
+        const Draw& d = draws[i];
+        uint64_t w = lineDraw(d.kind) ? (uint64_t)std::min(lrintf(d.width * 8.0f), 255L) : 0;
+        keys.push_back((uint64_t)d.pass << 59 | (uint64_t)d.blend << 58 | (uint64_t)d.xform << 55 | w << 47
+                       | packColor(d.rgba) << kSeqBits | (uint64_t)i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    // Issued state; a frame starts and ends with blend off and line width 1.
+    int xf = 0;
+    bool b = false;
+    float w = 1.0f;
+    bool haveColor = false;
+    float c[4] = {};
+    for(uint64_t key: keys){
+        const Draw& d = draws[key & (kMaxDraws - 1)];
+        if(d.xform != xf) {
+            if(xf) target->popTransform();
+            if(d.xform) {
+                const Transform& t = transforms[d.xform];
+                target->pushTransform(t.x, t.y, t.scale);
+            }
+            xf = d.xform;
+        }
+        if(d.blend != b) {
+            target->blend(d.blend);
+            b = d.blend;
+            frameStats.stateChanges++;
+        }
+        if(lineDraw(d.kind) && d.width != w) {
+            target->lineWidth(d.width);
+            w = d.width;
+            frameStats.stateChanges++;
+        }
+        if(!haveColor || memcmp(c, d.rgba, sizeof(c)) != 0) {
+            target->color(d.rgba[0], d.rgba[1], d.rgba[2], d.rgba[3]);
+            memcpy(c, d.rgba, sizeof(c));
+            haveColor = true;
+            frameStats.stateChanges++;
+        }
+        const float* p = xy.data() + d.first;
+        switch(d.kind) {
+        case DRAW_RECT: target->fillRect(p[0], p[1], p[2], p[3]); break;
+        case DRAW_FAN: target->fillFan(p, (int)d.count); break;
+        case DRAW_LINES: target->lines(p, (int)d.count); break;
+        case DRAW_LINE_LOOP: target->lineLoop(p, (int)d.count); break;
+        case DRAW_TEXT: target->text(p[0], p[1], chars.data() + d.count, (TextFont)d.font); break;
+        }
+    }
+    if(xf) target->popTransform();
+    if(b) {
+        target->blend(false);
+        frameStats.stateChanges++;
+    }
+    if(w != 1.0f) {
+        target->lineWidth(1.0f);
+        frameStats.stateChanges++;
+    }
+
+    draws.clear();
+    xy.clear();
+    chars.clear();
+    transforms.resize(1);
+    stackXform = stack.empty() ? 0 : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Submission
+//////////////////////////////////////////////////////////////////////////
+void RenderQueue::clear(float r, float g, float b, float a) {
+    // Clears are not reordered: what came before lands first.
+    flush();
+    if(target) target->clear(r, g, b, a);
+}
+
+void RenderQueue::color(float r, float g, float b, float a) {
+    rgba[0] = r; rgba[1] = g; rgba[2] = b; rgba[3] = a;
+    frameStats.stateCalls++;
+}
+
+void RenderQueue::blend(bool enabled) {
+    blendOn = enabled;
+    frameStats.stateCalls++;
+}
+
+void RenderQueue::lineWidth(float w) {
+    width = w;
+    frameStats.stateCalls++;
+}
+
+void RenderQueue::pass(int p) {
+    passId = std::min(std::max(p, 0), kMaxPass);
+}
+
+void RenderQueue::pushTransform(float x, float y, float scale) {
+    Transform t{ x, y, scale };
+    if(!stack.empty()) {
+        const Transform& o = stack.back();
+        t = Transform{ o.scale * x + o.x, o.scale * y + o.y, o.scale * scale };
+    }
+    stack.push_back(t);
+    stackXform = -1;
+}
+
+void RenderQueue::popTransform() {
+    if(!stack.empty()) stack.pop_back();
+    stackXform = stack.empty() ? 0 : -1;
+}
+
+uint8_t RenderQueue::currentTransform() {
+    if(stackXform < 0) {
+        if(transforms.size() == kMaxTransforms) flush();
+        transforms.push_back(stack.back());
+        stackXform = (int)transforms.size() - 1;
+    }
+    return (uint8_t)stackXform;
+}
+
+void RenderQueue::submit(DrawKind kind, const float* p, int points) {
+    if(draws.size() == kMaxDraws) flush();
+    Draw d;
+    d.kind = kind;
+    d.pass = (uint8_t)passId;
+    d.font = 0;
+    d.blend = blendOn;
+    d.xform = currentTransform();
+    memcpy(d.rgba, rgba, sizeof(d.rgba));
+    d.width = width;
+    d.first = (uint32_t)xy.size();
+    d.count = (uint32_t)points;
+    xy.insert(xy.end(), p, p + 2 * points);
+    draws.push_back(d);
+    frameStats.draws++;
+}
+
+void RenderQueue::fillRect(float x0, float y0, float x1, float y1) {
+    const float p[4] = { x0, y0, x1, y1 };
+    submit(DRAW_RECT, p, 2);
+}
+
+void RenderQueue::fillFan(const float* p, int count) {
+    submit(DRAW_FAN, p, count);
+}
+
+void RenderQueue::lines(const float* p, int count) {
+    submit(DRAW_LINES, p, count);
+}
+
+void RenderQueue::lineLoop(const float* p, int count) {
+    submit(DRAW_LINE_LOOP, p, count);
+}
+
+void RenderQueue::text(float x, float y, const char* s, TextFont font) {
+    const float p[2] = { x, y };
+    submit(DRAW_TEXT, p, 1);
+    Draw& d = draws.back();
+    d.font = (uint8_t)font;
+    d.count = (uint32_t)chars.size();   // text: offset of the string
+    chars.insert(chars.end(), s, s + strlen(s) + 1);
+}
@@ -0,0 +1,88 @@
+// render_queue.h
+// State-sorted render queue: a RenderBackend that records a frame's draws
+// instead of issuing them, then flushes them to another backend sorted by
+// (pass, blend, transform, line width, colour), so each state is set once
+// per run of draws that share it rather than once per draw. The scene
+// marks its painter's-order layers with pass(); draws within one pass may
+// be reordered, draws in a lower pass always land first, and submission
+// order breaks ties, so the flushed frame is the submitted one.
+//
+// Draws, vertices and text are kept in vectors reused from frame to frame:
+// after the first frames a queue allocates nothing.
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "render_backend.h"
+
+struct RenderQueueStats {
+    uint32_t draws = 0;
+    uint32_t stateCalls = 0;       // colour / blend / line width calls submitted
+    uint32_t stateChanges = 0;     // of those, issued to the target after sorting
+};
+
+class RenderQueue : public RenderBackend {
+public:
+    RenderQueue();
+
+    // Starts a frame drawn to target; state is as after a frame (blend off,
+    // line width 1, no transform).
+    void begin(RenderBackend* target);
+    // Sorts and issues everything submitted since begin() (or the last flush).
+    void flush();
+    // Totals since begin().
+    const RenderQueueStats& stats() const { return frameStats; }
+
+    void clear(float r, float g, float b, float a) override;
+    void color(float r, float g, float b, float a = 1.0f) override;
+    void blend(bool enabled) override;
+    void lineWidth(float w) override;
+    void pass(int p) override;
+
+    void pushTransform(float x, float y, float scale = 1.0f) override;
+    void popTransform() override;
+
+    void fillRect(float x0, float y0, float x1, float y1) override;
+    void fillFan(const float* xy, int count) override;
+    void lines(const float* xy, int count) override;
+    void lineLoop(const float* xy, int count) override;
+    void text(float x, float y, const char* s, TextFont font) override;
+
+private:
+    enum DrawKind : uint8_t { DRAW_RECT, DRAW_FAN, DRAW_LINES, DRAW_LINE_LOOP, DRAW_TEXT };
+
+    struct Draw {
+        DrawKind kind;
+        uint8_t pass;
+        uint8_t font;
+        bool blend;
+        uint8_t xform;
+        float rgba[4];
+        float width;
+        uint32_t first;            // into xy (text: its position)
+        uint32_t count;            // points (text: offset of the string in chars)
+    };
+    struct Transform {
+        float x, y, scale;         // composed from the root
+    };
+
+    static bool lineDraw(DrawKind k) { return k == DRAW_LINES || k == DRAW_LINE_LOOP; }
+    void submit(DrawKind kind, const float* xy, int points);
+    uint8_t currentTransform();
+
+    RenderBackend* target = nullptr;
+    std::vector<Draw> draws;
+    std::vector<float> xy;
+    std::vector<char> chars;
+    std::vector<uint64_t> keys;
+    std::vector<Transform> transforms;      // [0] is the identity
+    std::vector<Transform> stack;           // pushed transforms, composed
+    int stackXform = 0;                     // transforms[] entry of stack.back(), -1 if not entered
+
+    // Submission state
+    float rgba[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    bool blendOn = false;
+    float width = 1.0f;
+    int passId = 0;
+    RenderQueueStats frameStats;
+};
@@ -0,0 +1,516 @@
+// retained_renderer.cpp
+// Vertex-buffer renderer for the animation view (see retained_renderer.h).
+
+#include "retained_renderer.h"
+#include "circle_table.h"
+#include "engine_geometry.h"
+#include "frame_profiler.h"
+#include "gl_call_stats.h"
+#include "gl_ext.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+// Vertex generation
+//////////////////////////////////////////////////////////////////////////
+struct RVertex {
+    float x, y;
+    GLubyte r, g, b, a;
+};
+
+// Appends triangles / lines to a vertex array with a current colour,
+// mirroring the glColor + glVertex style of the immediate helpers.
+struct VertexWriter {
+    RVertex* out = nullptr;
+    int count = 0;
+    int capacity = 0;
+    GLubyte col[4] = {255, 255, 255, 255};
+
+    void color(float r, float g, float b, float a = 1.0f) {
+        col[0] = (GLubyte)(r * 255.0f + 0.5f);
+        col[1] = (GLubyte)(g * 255.0f + 0.5f);
+        col[2] = (GLubyte)(b * 255.0f + 0.5f);
+        col[3] = (GLubyte)(a * 255.0f + 0.5f);
+    }
+    void vert(float x, float y) {
+        if(count >= capacity) return;
+        RVertex& v = out[count++];
+        v.x = x; v.y = y;
+        v.r = col[0]; v.g = col[1]; v.b = col[2]; v.a = col[3];
+    }
+    void rect(float cx, float cy, float w, float h) {
+        float x0 = cx - w/2.0f, y0 = cy - h/2.0f;
+        float x1 = x0 + w,      y1 = y0 + h;
+        vert(x0, y0); vert(x1, y0); vert(x1, y1);
+        vert(x0, y0); vert(x1, y1); vert(x0, y1);
+    }
+    // Triangle-list equivalent of drawCircle's GL_TRIANGLE_FAN.
+    void circle(float cx, float cy, float r, int segments) {
+        if(segments < kMinCircleSegments) segments = kMinCircleSegments;
+        UnitCircleTable t = unitCircle(segments);
+        float px = cx + r, py = cy;
+        for(int i=1;i<=segments;i++){
+            float nx = cx + t.cosv[i]*r, ny = cy + t.sinv[i]*r;
+            vert(cx, cy); vert(px, py); vert(nx, ny);
+            px = nx; py = ny;
+        }
+    }
+    // rect() centred on (dx, y) in the upright frame of cylinder p.
+    void cylRect(const CylinderPlacement& p, float dx, float y, float w, float h) {
+        if(p.upright) {
+            rect(p.crankX + dx, y, w, h);
+            return;
+        }
+        float x[4], yy[4];
+        cylinderToEngine(p, dx - w/2.0f, y - h/2.0f, x[0], yy[0]);
+        cylinderToEngine(p, dx + w/2.0f, y - h/2.0f, x[1], yy[1]);
+        cylinderToEngine(p, dx + w/2.0f, y + h/2.0f, x[2], yy[2]);
+        cylinderToEngine(p, dx - w/2.0f, y + h/2.0f, x[3], yy[3]);
+        vert(x[0], yy[0]); vert(x[1], yy[1]); vert(x[2], yy[2]);
+        vert(x[0], yy[0]); vert(x[2], yy[2]); vert(x[3], yy[3]);
+    }
+    void line(float x0, float y0, float x1, float y1) {
+        vert(x0, y0); vert(x1, y1);
+    }
+    // line() between two points of cylinder p's upright frame.
+    void cylLine(const CylinderPlacement& p, float dx0, float y0, float dx1, float y1) {
+        float ax, ay, bx, by;
+        cylinderToEngine(p, dx0, y0, ax, ay);
+        cylinderToEngine(p, dx1, y1, bx, by);
+        line(ax, ay, bx, by);
+    }
+    // Wide line as a quad, replacing glLineWidth(w) + GL_LINES.
+    void thickLine(float x0, float y0, float x1, float y1, float w) {
+        float dx = x1 - x0, dy = y1 - y0;
+        float len = sqrtf(dx*dx + dy*dy);
+        if(len <= 0.0f) return;
+        float nx = -dy / len * w * 0.5f, ny = dx / len * w * 0.5f;
+        vert(x0 + nx, y0 + ny); vert(x0 - nx, y0 - ny); vert(x1 - nx, y1 - ny);
+        vert(x0 + nx, y0 + ny); vert(x1 - nx, y1 - ny); vert(x1 + nx, y1 + ny);
+    }
+};
+
+struct DrawRange {
+    GLint first = 0;
+    GLsizei count = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Renderer state
+//////////////////////////////////////////////////////////////////////////
+static const int kFramesInFlight = 3;
+static const int kCloudLayers = 6;              // combustion cloud circles per cylinder
+static const int kCloudSegments = 22;
+// pistons + grooves + cloud layers + crank pin (20 segs) + rod
+static const int kDynVertsPerCyl = 6 + 4 + kCloudLayers*kCloudSegments*3 + 20*3 + 6;
+static const int kDynCapacity = kDynVertsPerCyl * kMaxRetainedCylinders;
+
+static bool ready = false;
+static EngineLayout layout;                     // copy taken by retainedInit()
+static GLuint staticVbo = 0, dynamicVbo = 0;
+static DrawRange staticBackTris, staticBackLines, staticFrontTris;
+static DrawRange cloudMesh;                     // unit circle, for the instanced clouds
+
+static bool persistent = false;
+static RVertex* mappedBase = nullptr;          // persistent mapping, kFramesInFlight regions
+static GLsync regionFence[kFramesInFlight] = {};
+static int region = 0;
+static std::vector<RVertex> scratch;            // used when persistent mapping is unavailable
+
+// Instanced combustion clouds (GL 3.3): one instance per cloud layer, the
+// layer's jitter, radius and alpha computed by the vertex shader.
+struct CloudInstance {
+    float centreY, size, kind, unused;          // centre in the cylinder's upright frame
+};
+static GLuint cloudProgram = 0, cloudPlaceVbo = 0, cloudVbo = 0;
+static GLint cloudTimeLoc = -1;
+enum { kAttrUnit, kAttrPlace, kAttrCloud };
+
+static void buildStaticGeometry() {
+    std::vector<RVertex> verts(4096);
+    VertexWriter w;
+    w.out = verts.data();
+    w.capacity = (int)verts.size();
+
+    // block, crankshaft and bore fills (drawn behind everything)
+    staticBackTris.first = w.count;
+    w.color(0.58f, 0.58f, 0.58f);
+    if(layout.layout == BankLayout::Inline) {
+        float blockW = layout.blockX1 - layout.blockX0;
+        w.rect(layout.blockX0 + blockW/2.0f, blockTopY - blockH/2.0f + 20.0f, blockW, blockH);
+    } else {
+        float cy = (layout.housingY0 + layout.housingY1) / 2.0f;
+        for(int i=0;i<layout.cylinders;i++)
+            w.cylRect(layout.cyl[i], 0.0f, cy, 2.0f * layout.housingHalfW, layout.housingY1 - layout.housingY0);
+    }
+    w.color(0.35f, 0.35f, 0.35f);
+    float shaftLen = layout.crankshaftX1 - layout.crankshaftX0;
+    w.rect(layout.crankshaftX0 + shaftLen/2.0f, crankY, shaftLen, 16.0f);
+    float cyTop = blockTopY - cylinderHeight/2.0f;
+    w.color(0.33f, 0.33f, 0.33f);
+    for(int i=0;i<layout.cylinders;i++) w.cylRect(layout.cyl[i], 0.0f, cyTop, boreInnerW, boreInnerH);
+    staticBackTris.count = w.count - staticBackTris.first;
+
+    // bore outlines
+    staticBackLines.first = w.count;
+    w.color(0.18f, 0.18f, 0.18f);
+    for(int i=0;i<layout.cylinders;i++){
+        const CylinderPlacement& p = layout.cyl[i];
+        float x0 = -boreInnerW/2.0f, x1 = boreInnerW/2.0f;
+        float y0 = cyTop - boreInnerH/2.0f, y1 = cyTop + boreInnerH/2.0f;
+        w.cylLine(p, x0, y0, x1, y0); w.cylLine(p, x1, y0, x1, y1);
+        w.cylLine(p, x1, y1, x0, y1); w.cylLine(p, x0, y1, x0, y0);
+    }
+    staticBackLines.count = w.count - staticBackLines.first;
+
+    // crank webs, drawn over the rods
+    staticFrontTris.first = w.count;
+    w.color(0.28f, 0.28f, 0.28f);
+    for(int s=0;s<layout.slots;s++){
+        float webX = layout.slotX[s];
+        w.rect(webX - 6.0f, crankY, 28.0f, 10.0f);
+        w.circle(webX, crankY, 12.0f, 24);
+    }
+    staticFrontTris.count = w.count - staticFrontTris.first;
+
+    cloudMesh.first = w.count;
+    w.circle(0.0f, 0.0f, 1.0f, kCloudSegments);
+    cloudMesh.count = w.count - cloudMesh.first;
+
+    pglGenBuffers(1, &staticVbo);
+    pglBindBuffer(GL_ARRAY_BUFFER, staticVbo);
+    pglBufferData(GL_ARRAY_BUFFER, w.count * sizeof(RVertex), verts.data(), GL_STATIC_DRAW);
+}
+
+static void createDynamicBuffer() {
+    pglGenBuffers(1, &dynamicVbo);
+    pglBindBuffer(GL_ARRAY_BUFFER, dynamicVbo);
+    persistent = glCaps.bufferStorage && glCaps.sync;
+    if(persistent) {
+        GLsizeiptr bytes = (GLsizeiptr)kDynCapacity * kFramesInFlight * sizeof(RVertex);
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        pglBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        mappedBase = (RVertex*)pglMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+        if(!mappedBase) {
+            // storage is immutable once allocated; start over with a mutable buffer
+            persistent = false;
+            pglDeleteBuffers(1, &dynamicVbo);
+            pglGenBuffers(1, &dynamicVbo);
+            pglBindBuffer(GL_ARRAY_BUFFER, dynamicVbo);
+        }
+    }
+    if(!persistent) {
+        pglBufferData(GL_ARRAY_BUFFER, kDynCapacity * sizeof(RVertex), nullptr, GL_STREAM_DRAW);
+        scratch.resize(kDynCapacity);
+    }
+}
+
+// Mirrors the cloud loop of retainedDrawEngine (and drawCombustionEffect):
+// instance n is layer n % LAYERS of cylinder n / LAYERS, whose attributes
+// advance once per LAYERS instances.
+static const char* const kCloudVertexShader = R"(
+uniform float uTime;
+in vec2 aUnit;
+in vec4 aPlace;     // crank X, crank Y, sin tilt, cos tilt
+in vec3 aCloud;     // centre Y, size, phase kind
+out vec4 vColor;
+
+void main() {
+    float i = float(gl_InstanceID % LAYERS);
+    float t = i / float(LAYERS);
+    float r = aCloud.y * (0.6 + t*0.8);
+    float ox = sin(uTime*1.5 + i*1.7) * 6.0 * t + i*2.0;
+    float oy = cos(uTime*1.1 + i*2.9) * 8.0 * t + i*4.0;
+    float along = aCloud.x + oy - aPlace.y;
+    vec2 c = vec2(aPlace.x + ox*aPlace.w + along*aPlace.z, aPlace.y - ox*aPlace.z + along*aPlace.w);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(c + aUnit*r, 0.0, 1.0);
+
+    int kind = int(aCloud.z);
+    vec3 rgb = kind == 0 ? vec3(0.95, 0.95, 0.55) : kind == 2 ? vec3(1.0, 0.45, 0.05) : vec3(0.6);
+    vColor = vec4(rgb, 0.18*(1.0 - t) + 0.02);
+}
+)";
+
+static const char* const kCloudFragmentShader = R"(
+in vec4 vColor;
+
+void main() {
+    gl_FragColor = vColor;
+}
+)";
+
+static GLuint compileShader(GLenum type, const char* body) {
+    char header[64];
+    snprintf(header, sizeof(header), "#version 330 compatibility\n#define LAYERS %d\n", kCloudLayers);
+    const char* src[2] = { header, body };
+    GLuint sh = pglCreateShader(type);
+    pglShaderSource(sh, 2, src, nullptr);
+    pglCompileShader(sh);
+    GLint ok = 0;
+    pglGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
+    if(!ok) {
+        char log[1024] = "";
+        pglGetShaderInfoLog(sh, sizeof(log), nullptr, log);
+        fprintf(stderr, "retained renderer: combustion shader: %s\n", log);
+        pglDeleteShader(sh);
+        return 0;
+    }
+    return sh;
+}
+
+// Builds the cloud program and the per-cylinder placement buffer; on any
+// failure the clouds stay on the streamed-vertex path.
+static void createCloudProgram() {
+    if(!glCaps.instancing) return;
+    GLuint vs = compileShader(GL_VERTEX_SHADER, kCloudVertexShader);
+    GLuint fs = vs ? compileShader(GL_FRAGMENT_SHADER, kCloudFragmentShader) : 0;
+    if(!fs) {
+        if(vs) pglDeleteShader(vs);
+        return;
+    }
+    GLuint prog = pglCreateProgram();
+    pglAttachShader(prog, vs);
+    pglAttachShader(prog, fs);
+    pglBindAttribLocation(prog, kAttrUnit, "aUnit");
+    pglBindAttribLocation(prog, kAttrPlace, "aPlace");
+    pglBindAttribLocation(prog, kAttrCloud, "aCloud");
+    pglLinkProgram(prog);
+    pglDeleteShader(vs);
+    pglDeleteShader(fs);
+    GLint ok = 0;
+    pglGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if(!ok) {
+        char log[1024] = "";
+        pglGetProgramInfoLog(prog, sizeof(log), nullptr, log);
+        fprintf(stderr, "retained renderer: combustion program: %s\n", log);
+        pglDeleteProgram(prog);
+        return;
+    }
+    cloudProgram = prog;
+    cloudTimeLoc = pglGetUniformLocation(prog, "uTime");
+
+    float place[4 * kMaxRetainedCylinders];
+    for(int i=0;i<layout.cylinders;i++){
+        const CylinderPlacement& p = layout.cyl[i];
+        // upright placements use the identity rotation, as in cylinderToEngine()
+        place[4*i+0] = p.crankX;
+        place[4*i+1] = p.crankY;
+        place[4*i+2] = p.upright ? 0.0f : p.sinTilt;
+        place[4*i+3] = p.upright ? 1.0f : p.cosTilt;
+    }
+    pglGenBuffers(1, &cloudPlaceVbo);
+    pglBindBuffer(GL_ARRAY_BUFFER, cloudPlaceVbo);
+    pglBufferData(GL_ARRAY_BUFFER, layout.cylinders * 4 * sizeof(float), place, GL_STATIC_DRAW);
+    pglGenBuffers(1, &cloudVbo);
+    pglBindBuffer(GL_ARRAY_BUFFER, cloudVbo);
+    pglBufferData(GL_ARRAY_BUFFER, kMaxRetainedCylinders * sizeof(CloudInstance), nullptr, GL_STREAM_DRAW);
+}
+
+bool retainedInit(const EngineLayout& engine) {
+    if(ready) return true;
+    if(!loadGLExtensions()) return false;
+    layout = engine;
+    buildStaticGeometry();
+    createDynamicBuffer();
+    createCloudProgram();
+    pglBindBuffer(GL_ARRAY_BUFFER, 0);
+    ready = true;
+    return true;
+}
+
+bool retainedReady() {
+    return ready;
+}
+
+void retainedShutdown() {
+    if(!ready) return;
+    for(GLsync& f: regionFence) {
+        if(f) pglDeleteSync(f);
+        f = nullptr;
+    }
+    if(mappedBase) {
+        pglBindBuffer(GL_ARRAY_BUFFER, dynamicVbo);
+        pglUnmapBuffer(GL_ARRAY_BUFFER);
+        pglBindBuffer(GL_ARRAY_BUFFER, 0);
+        mappedBase = nullptr;
+    }
+    if(cloudProgram) {
+        pglDeleteProgram(cloudProgram);
+        pglDeleteBuffers(1, &cloudPlaceVbo);
+        pglDeleteBuffers(1, &cloudVbo);
+        cloudProgram = cloudPlaceVbo = cloudVbo = 0;
+    }
+    pglDeleteBuffers(1, &staticVbo);
+    pglDeleteBuffers(1, &dynamicVbo);
+    staticVbo = dynamicVbo = 0;
+    ready = false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Per-frame streaming
+//////////////////////////////////////////////////////////////////////////
+static void combustionColor(int kind, VertexWriter& w, float alpha) {
+    if(kind==0) w.color(0.95f, 0.95f, 0.55f, alpha);      // faint yellow
+    else if(kind==2) w.color(1.0f, 0.45f, 0.05f, alpha);  // orange flame
+    else w.color(0.6f, 0.6f, 0.6f, alpha);                // compression / exhaust grey
+}
+
+static void setVertexPointers(GLuint vbo, size_t baseVertex) {
+    pglBindBuffer(GL_ARRAY_BUFFER, vbo);
+    const char* base = (const char*)0 + baseVertex * sizeof(RVertex);
+    glVertexPointer(2, GL_FLOAT, sizeof(RVertex), base + offsetof(RVertex, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(RVertex), base + offsetof(RVertex, r));
+}
+
+static void drawRange(GLenum mode, const DrawRange& r) {
+    if(r.count <= 0) return;
+    cglDrawArrays(mode, r.first, r.count);
+    frameProfiler.countDraw(r.count);
+}
+
+// All cloud layers of all cylinders in one instanced draw. The fixed-function
+// arrays are off meanwhile, so generic attribute 0 carries the vertex. Where
+// attribute 0 aliases gl_Vertex, pointing it at the cloud mesh replaces the
+// vertex pointer, so the dynamic buffer's pointers are set again afterwards.
+static void drawCloudsInstanced(const EngineFrame& frame, int cyl, size_t dynBase) {
+    CloudInstance clouds[kMaxRetainedCylinders];
+    for(int c=0;c<cyl;c++){
+        clouds[c].centreY = frame.pistonY[c] + pistonHeight/2.0f + 12.0f;
+        clouds[c].size = frame.effectSize[c];
+        clouds[c].kind = (float)frame.phaseKind[c];
+        clouds[c].unused = 0.0f;
+    }
+    pglBindBuffer(GL_ARRAY_BUFFER, cloudVbo);
+    pglBufferData(GL_ARRAY_BUFFER, kMaxRetainedCylinders * sizeof(CloudInstance), nullptr, GL_STREAM_DRAW);
+    pglBufferSubData(GL_ARRAY_BUFFER, 0, cyl * sizeof(CloudInstance), clouds);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    pglUseProgram(cloudProgram);
+    pglUniform1f(cloudTimeLoc, frame.timeSec);
+
+    pglBindBuffer(GL_ARRAY_BUFFER, staticVbo);
+    pglVertexAttribPointer(kAttrUnit, 2, GL_FLOAT, GL_FALSE, sizeof(RVertex),
+                           (const char*)0 + cloudMesh.first * sizeof(RVertex) + offsetof(RVertex, x));
+    pglBindBuffer(GL_ARRAY_BUFFER, cloudPlaceVbo);
+    pglVertexAttribPointer(kAttrPlace, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
+    pglVertexAttribDivisor(kAttrPlace, kCloudLayers);
+    pglBindBuffer(GL_ARRAY_BUFFER, cloudVbo);
+    pglVertexAttribPointer(kAttrCloud, 3, GL_FLOAT, GL_FALSE, sizeof(CloudInstance), nullptr);
+    pglVertexAttribDivisor(kAttrCloud, kCloudLayers);
+    for(GLuint a: { kAttrUnit, kAttrPlace, kAttrCloud }) pglEnableVertexAttribArray(a);
+
+    cglDrawArraysInstanced(GL_TRIANGLES, 0, cloudMesh.count, cyl * kCloudLayers);
+    frameProfiler.countDraw(cloudMesh.count * cyl * kCloudLayers);
+
+    for(GLuint a: { kAttrUnit, kAttrPlace, kAttrCloud }) pglDisableVertexAttribArray(a);
+    pglUseProgram(0);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    setVertexPointers(dynamicVbo, dynBase);
+}
+
+void retainedDrawEngine(const EngineFrame& frame) {
+    if(!ready) return;
+    ProfileScope scope(ProfPass::Retained);
+
+    // Pick the write target: the next persistent region (after its fence
+    // retires) or the CPU scratch copy that gets orphaned into the buffer.
+    RVertex* dst = scratch.data();
+    if(persistent) {
+        region = (region + 1) % kFramesInFlight;
+        if(regionFence[region]) {
+            pglClientWaitSync(regionFence[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            pglDeleteSync(regionFence[region]);
+            regionFence[region] = nullptr;
+        }
+        dst = mappedBase + (size_t)region * kDynCapacity;
+    }
+
+    VertexWriter w;
+    w.out = dst;
+    w.capacity = kDynCapacity;
+    int cyl = frame.cylinders < layout.cylinders ? frame.cylinders : layout.cylinders;
+
+    DrawRange pistons, grooves, combustion, pinsAndRods;
+    pistons.first = w.count;
+    w.color(0.15f, 0.15f, 0.15f);
+    for(int i=0;i<cyl;i++) w.cylRect(layout.cyl[i], 0.0f, frame.pistonY[i], pistonWidth, pistonHeight);
+    pistons.count = w.count - pistons.first;
+
+    grooves.first = w.count;
+    w.color(0.05f, 0.05f, 0.05f);
+    for(int i=0;i<cyl;i++){
+        const CylinderPlacement& p = layout.cyl[i];
+        float py = frame.pistonY[i];
+        w.cylLine(p, -pistonWidth/2.0f + 6.0f, py + pistonHeight/4.0f, pistonWidth/2.0f - 6.0f, py + pistonHeight/4.0f);
+        w.cylLine(p, -pistonWidth/2.0f + 8.0f, py, pistonWidth/2.0f - 8.0f, py);
+    }
+    grooves.count = w.count - grooves.first;
+
+    combustion.first = w.count;
+    const int layers = kCloudLayers;
+    int streamedClouds = cloudProgram ? 0 : cyl;    // with the shader, drawn instanced
+    for(int c=0;c<streamedClouds;c++){
+        float cy = frame.pistonY[c] + pistonHeight/2.0f + 12.0f;
+        for(int i=0;i<layers;i++){
+            float t = (float)i/layers;
+            float r = frame.effectSize[c] * (0.6f + t*0.8f);
+            combustionColor(frame.phaseKind[c], w, 0.18f * (1.0f - t) + 0.02f);
+            float ox = (sinf(frame.timeSec*1.5f + i*1.7f) * 6.0f * t) + (i*2.0f);
+            float oy = (cosf(frame.timeSec*1.1f + i*2.9f) * 8.0f * t) + (i*4.0f);
+            float x, y;
+            cylinderToEngine(layout.cyl[c], ox, cy + oy, x, y);
+            w.circle(x, y, r, kCloudSegments);
+        }
+    }
+    combustion.count = w.count - combustion.first;
+
+    pinsAndRods.first = w.count;
+    for(int i=0;i<cyl;i++){
+        float wx, wy;
+        cylinderToEngine(layout.cyl[i], 0.0f, frame.pistonY[i] - wristPinOffset, wx, wy);
+        w.color(0.20f, 0.20f, 0.20f);
+        w.circle(frame.crankPinX[i], frame.crankPinY[i], 8.0f, 20);
+        w.color(0.22f, 0.22f, 0.22f);
+        w.thickLine(frame.crankPinX[i], frame.crankPinY[i], wx, wy, 6.0f);
+    }
+    pinsAndRods.count = w.count - pinsAndRods.first;
+
+    size_t dynBase = 0;
+    if(persistent) {
+        dynBase = (size_t)region * kDynCapacity;
+    } else {
+        pglBindBuffer(GL_ARRAY_BUFFER, dynamicVbo);
+        pglBufferData(GL_ARRAY_BUFFER, kDynCapacity * sizeof(RVertex), nullptr, GL_STREAM_DRAW);
+        pglBufferSubData(GL_ARRAY_BUFFER, 0, w.count * sizeof(RVertex), dst);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    setVertexPointers(staticVbo, 0);
+    drawRange(GL_TRIANGLES, staticBackTris);
+    drawRange(GL_LINES, staticBackLines);
+
+    setVertexPointers(dynamicVbo, dynBase);
+    drawRange(GL_TRIANGLES, pistons);
+    drawRange(GL_LINES, grooves);
+    cglEnable(GL_BLEND);
+    cglBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if(cloudProgram) drawCloudsInstanced(frame, cyl, dynBase);
+    else drawRange(GL_TRIANGLES, combustion);
+    cglDisable(GL_BLEND);
+    drawRange(GL_TRIANGLES, pinsAndRods);
+
+    setVertexPointers(staticVbo, 0);
+    drawRange(GL_TRIANGLES, staticFrontTris);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    pglBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if(persistent) regionFence[region] = pglFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
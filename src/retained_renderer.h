@@ -0,0 +1,36 @@
+// retained_renderer.h
+// Vertex-buffer renderer for the animation view.
+// Static geometry (block, bores, crankshaft, crank webs) is uploaded once; the
+// moving parts are streamed each frame into one dynamic buffer (persistently
+// mapped when GL 4.4 / ARB_buffer_storage is available) and the whole engine
+// is drawn in a handful of glDrawArrays calls. With GL 3.3 the combustion
+// clouds are not streamed: one instanced draw covers every cloud layer of
+// every cylinder, and a vertex shader computes each layer's jitter, radius
+// and alpha from the frame time.
+#pragma once
+
+#include "engine_config.h"
+
+const int kMaxRetainedCylinders = kMaxCylinders;
+
+// Per-frame moving state, in engine-local coordinates.
+// Indices follow the layout passed to retainedInit().
+struct EngineFrame {
+    int cylinders = 0;
+    float pistonY[kMaxRetainedCylinders];     // piston center Y in the cylinder's upright frame
+    float crankPinX[kMaxRetainedCylinders];
+    float crankPinY[kMaxRetainedCylinders];
+    float effectSize[kMaxRetainedCylinders];  // combustion cloud radius
+    int phaseKind[kMaxRetainedCylinders];     // 0 intake, 1 compression, 2 power, 3 exhaust
+    float timeSec = 0.0f;                     // drives the combustion jitter
+};
+
+// Requires a current GL context; static geometry is built for layout. Returns
+// false (and leaves the renderer disabled) when vertex buffers are not
+// supported; callers then fall back to the immediate-mode helpers.
+bool retainedInit(const EngineLayout& layout);
+bool retainedReady();
+void retainedShutdown();
+
+// Draws the engine with the current modelview (display() applies the centering transform).
+void retainedDrawEngine(const EngineFrame& frame);
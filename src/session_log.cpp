@@ -0,0 +1,205 @@
+// session_log.cpp
+// Input session record / replay (see session_log.h).
+
+#include "session_log.h"
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<SessionHeader>::value, "SessionHeader is a file format");
+
+static const char kSessionMagic[8] = { 'E', 'N', 'G', 'S', 'E', 'S', 'S', 0 };
+
+// Payload values per event type, indexed by SessionEventType.
+static const int kPayloadValues[] = { 0, 0, 3, 4, 2, 2, 1, 0 };
+static const int kEventTypes = (int)(sizeof(kPayloadValues) / sizeof(kPayloadValues[0]));
+
+uint32_t sessionHash(const void* data, size_t bytes, uint32_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t h = seed;
+    for(size_t i=0;i<bytes;i++){
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while(v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Recorder
+//////////////////////////////////////////////////////////////////////////
+bool SessionRecorder::open(const std::string& path, const SessionHeader& header, std::string& error) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if(!file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    SessionHeader h = header;
+    memcpy(h.magic, kSessionMagic, sizeof(h.magic));
+    h.version = kSessionVersion;
+    if(fwrite(&h, sizeof(h), 1, file) != 1) {
+        fclose(file);
+        file = nullptr;
+        error = "cannot write " + path;
+        return false;
+    }
+    lastClock = 0;
+    count = 0;
+    return true;
+}
+
+bool SessionRecorder::close() {
+    if(!file) return true;
+    uint8_t end[2] = { (uint8_t)SessionEventType::End, 0 };
+    bool ok = fwrite(end, sizeof(end), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+void SessionRecorder::put(SessionEventType type, int clockMs, const int* payload, int n,
+                          const uint32_t* fingerprint) {
+    uint8_t buf[64];
+    uint8_t* p = buf;
+    *p++ = (uint8_t)type;
+    p = putVarint(p, zigzag((int64_t)clockMs - lastClock));
+    for(int i=0;i<n;i++) p = putVarint(p, zigzag(payload[i]));
+    if(fingerprint) {
+        memcpy(p, fingerprint, sizeof(*fingerprint));
+        p += sizeof(*fingerprint);
+    }
+    fwrite(buf, (size_t)(p - buf), 1, file);
+    lastClock = clockMs;
+    count++;
+}
+
+void SessionRecorder::key(int clockMs, int key, int x, int y) {
+    if(!file) return;
+    int v[] = { key, x, y };
+    put(SessionEventType::Key, clockMs, v, 3);
+}
+
+void SessionRecorder::mouse(int clockMs, int button, int state, int x, int y) {
+    if(!file) return;
+    int v[] = { button, state, x, y };
+    put(SessionEventType::Mouse, clockMs, v, 4);
+}
+
+void SessionRecorder::passive(int clockMs, int x, int y) {
+    if(!file) return;
+    int v[] = { x, y };
+    put(SessionEventType::Passive, clockMs, v, 2);
+}
+
+void SessionRecorder::reshape(int clockMs, int w, int h) {
+    if(!file) return;
+    int v[] = { w, h };
+    put(SessionEventType::Reshape, clockMs, v, 2);
+}
+
+void SessionRecorder::timer(int clockMs, int value) {
+    if(!file) return;
+    put(SessionEventType::Timer, clockMs, &value, 1);
+}
+
+void SessionRecorder::display(int clockMs, uint32_t fingerprint) {
+    if(!file) return;
+    put(SessionEventType::Display, clockMs, nullptr, 0, &fingerprint);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Replay
+//////////////////////////////////////////////////////////////////////////
+bool SessionReplay::open(const std::string& path, std::string& error) {
+    if(!file.open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    if(file.size() < sizeof(SessionHeader)) {
+        error = path + " is not a session log";
+        return false;
+    }
+    memcpy(&head, file.data(), sizeof(head));
+    if(memcmp(head.magic, kSessionMagic, sizeof(kSessionMagic)) != 0) {
+        error = path + " is not a session log";
+        return false;
+    }
+    if(head.version != kSessionVersion) {
+        error = path + ": unsupported session version " + std::to_string(head.version);
+        return false;
+    }
+    if(head.engine.cylinders < 1 || head.engine.cylinders > kMaxCylinders || !(head.simHz > 0.0)) {
+        error = path + ": corrupt session header";
+        return false;
+    }
+    pos = sizeof(SessionHeader);
+    clock = 0;
+    count = 0;
+    cut = bad = false;
+    return true;
+}
+
+bool SessionReplay::next(SessionEvent& ev) {
+    const uint8_t* p = file.data();
+    size_t end = file.size();
+    size_t at = pos;
+    auto varint = [&](uint64_t& v) {
+        v = 0;
+        for(int shift=0;shift<64;shift+=7){
+            if(at >= end) return false;
+            uint8_t b = p[at++];
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if(!(b & 0x80)) return true;
+        }
+        return false;
+    };
+
+    cut = true;
+    if(at >= end) return false;
+    if(p[at] >= kEventTypes) {
+        cut = false;
+        bad = true;
+        return false;
+    }
+    SessionEvent e;
+    e.type = (SessionEventType)p[at++];
+    uint64_t v;
+    if(!varint(v)) return false;
+    e.clockMs = clock + unzigzag(v);
+    if(e.type == SessionEventType::End) {
+        cut = false;
+        return false;
+    }
+    int32_t* out[] = { &e.a, &e.b, &e.c, &e.d };
+    for(int i=0;i<kPayloadValues[(int)e.type];i++){
+        if(!varint(v)) return false;
+        *out[i] = (int32_t)unzigzag(v);
+    }
+    if(e.type == SessionEventType::Display) {
+        if(end - at < sizeof(e.fingerprint)) return false;
+        memcpy(&e.fingerprint, p + at, sizeof(e.fingerprint));
+        at += sizeof(e.fingerprint);
+    }
+    cut = false;
+    pos = at;
+    clock = e.clockMs;
+    count++;
+    ev = e;
+    return true;
+}
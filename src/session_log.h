@@ -0,0 +1,110 @@
+// session_log.h
+// Input session record / replay. Recording captures everything the window
+// feeds the program from outside: every GLUT callback with its arguments and
+// every glutGet(GLUT_ELAPSED_TIME) result, in call order. Replaying the log
+// through the same handlers with the clock answered from it reproduces the
+// sim steps, scene state and frame sequence of the recorded run exactly, so
+// a session that showed a slowdown can be rerun headless at full speed and
+// profiled, or compared frame by frame between builds.
+//
+// File (little-endian):
+//   SessionHeader
+//   events back to back, each
+//     uint8_t  type (SessionEventType)
+//     varint   ms since the previous event, zigzag (wall clock when recorded)
+//     payload  zigzag varints per type, below; Display carries a
+//              uint32_t fingerprint of the state it drew
+//   End closes a complete log; a log cut short by a crash replays up to
+//   the last whole event.
+//
+//   Time      the value returned (also the event's clock)
+//   Key       key, x, y
+//   Mouse     button, state, x, y
+//   Passive   x, y
+//   Reshape   w, h
+//   Timer     value
+//   Display   fingerprint
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "engine_config.h"
+#include "mapped_file.h"
+
+const uint32_t kSessionVersion = 1;
+
+struct SessionHeader {
+    char magic[8];              // "ENGSESS" + NUL
+    uint32_t version;
+    uint32_t flags;             // SessionFlags
+    double simHz;
+    int32_t winW, winH;         // window size before the first Reshape
+    EngineConfig engine;        // the engine the session ran
+    uint64_t reserved[2];
+};
+
+enum SessionFlags : uint32_t {
+    SessionSoftBackend = 1u << 0,
+};
+
+enum class SessionEventType : uint8_t { End, Time, Key, Mouse, Passive, Reshape, Timer, Display };
+
+struct SessionEvent {
+    SessionEventType type = SessionEventType::End;
+    int64_t clockMs = 0;        // recording clock at the event
+    int32_t a = 0, b = 0, c = 0, d = 0;   // payload in the order listed above
+    uint32_t fingerprint = 0;   // Display
+};
+
+// 32-bit FNV-1a, chained through seed; the Display fingerprint.
+uint32_t sessionHash(const void* data, size_t bytes, uint32_t seed = 2166136261u);
+
+// Writes through stdio buffering; each call costs one branch when closed.
+class SessionRecorder {
+public:
+    ~SessionRecorder() { close(); }
+
+    bool open(const std::string& path, const SessionHeader& header, std::string& error);
+    bool close();
+    bool isOpen() const { return file != nullptr; }
+
+    void time(int ms) { if(file) put(SessionEventType::Time, ms, nullptr, 0); }
+    void key(int clockMs, int key, int x, int y);
+    void mouse(int clockMs, int button, int state, int x, int y);
+    void passive(int clockMs, int x, int y);
+    void reshape(int clockMs, int w, int h);
+    void timer(int clockMs, int value);
+    void display(int clockMs, uint32_t fingerprint);
+
+    uint64_t events() const { return count; }
+
+private:
+    void put(SessionEventType type, int clockMs, const int* payload, int n, const uint32_t* fingerprint = nullptr);
+
+    FILE* file = nullptr;
+    int64_t lastClock = 0;
+    uint64_t count = 0;
+};
+
+class SessionReplay {
+public:
+    bool open(const std::string& path, std::string& error);
+    const SessionHeader& header() const { return head; }
+
+    // Next event; false at End, at the end of the data (truncated()) or at
+    // an unknown event type (malformed()).
+    bool next(SessionEvent& ev);
+    bool truncated() const { return cut; }
+    bool malformed() const { return bad; }
+    uint64_t events() const { return count; }
+
+private:
+    MappedFile file;
+    SessionHeader head = {};
+    size_t pos = 0;
+    int64_t clock = 0;
+    uint64_t count = 0;
+    bool cut = false;
+    bool bad = false;
+};
@@ -0,0 +1,64 @@
+// sim_core.cpp
+// Fixed-timestep accumulator (see sim_core.h).
+
+#include "sim_core.h"
+#include <algorithm>
+#include <cmath>
+
+SimCore::SimCore(double stepHz) {
+    setStepHz(stepHz);
+    reset();
+}
+
+void SimCore::reset(const SimState& initial) {
+    prev = cur = initial;
+    pendingSpeed = initial.crankSpeedDegPerSec;
+    accumulator = 0.0;
+}
+
+void SimCore::setStepHz(double stepHz) {
+    hz = stepHz > 0.0 ? stepHz : 10000.0;
+    dt = 1.0 / hz;
+    accumulator = std::fmod(accumulator, dt);
+}
+
+void SimCore::step() {
+    prev = cur;
+    cur.crankSpeedDegPerSec = pendingSpeed;
+    cur.crankAngleDeg += cur.crankSpeedDegPerSec * dt;
+    cur.timeSec += dt;
+    cur.step++;
+    // Wrap both ends of the interpolation interval together so prev -> cur
+    // stays a short forward segment across the 720 degree seam.
+    if(cur.crankAngleDeg >= 720.0) {
+        cur.crankAngleDeg -= 720.0;
+        prev.crankAngleDeg -= 720.0;
+    }
+    if(onStep) onStep(cur);
+}
+
+int SimCore::advance(double elapsedSec) {
+    if(elapsedSec > 0.0) accumulator += std::min(elapsedSec, maxFrameSec);
+    int steps = 0;
+    while(accumulator >= dt) {
+        step();
+        accumulator -= dt;
+        steps++;
+    }
+    return steps;
+}
+
+void SimCore::runSteps(uint64_t n) {
+    for(uint64_t i=0;i<n;i++) step();
+}
+
+SimRenderState SimCore::renderState() const {
+    double a = alpha();
+    double angle = prev.crankAngleDeg + (cur.crankAngleDeg - prev.crankAngleDeg) * a;
+    if(angle < 0.0) angle += 720.0;
+    SimRenderState r;
+    r.crankAngleDeg = (float)angle;
+    if(r.crankAngleDeg >= 720.0f) r.crankAngleDeg = 0.0f;   // -epsilon wrapped, or rounded up by the cast
+    r.timeSec = (float)(prev.timeSec + (cur.timeSec - prev.timeSec) * a);
+    return r;
+}
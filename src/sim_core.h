@@ -0,0 +1,71 @@
+// sim_core.h
+// Fixed-timestep simulation core, independent of GLUT and GL.
+// Wall-clock time is fed into an accumulator and consumed in whole steps of
+// a configurable size (10 kHz by default, fine enough for crank-angle-resolved
+// physics), so the result depends only on the step size and the inputs, never
+// on frame timing. The renderer reads a state interpolated between the last
+// two steps, which keeps motion smooth when the display runs slower or faster
+// than the sim.
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+struct SimState {
+    double crankAngleDeg = 0.0;        // [0, 720) after each step (one 4-stroke cycle)
+    double crankSpeedDegPerSec = 90.0;
+    double timeSec = 0.0;              // simulated time
+    uint64_t step = 0;
+};
+
+// What the drawing code needs for one frame.
+struct SimRenderState {
+    float crankAngleDeg;   // [0, 720)
+    float timeSec;
+};
+
+class SimCore {
+public:
+    explicit SimCore(double stepHz = 10000.0);
+
+    // Restarts from the given state with an empty accumulator.
+    void reset(const SimState& initial = SimState());
+
+    void setStepHz(double hz);
+    double stepHz() const { return hz; }
+    double stepSeconds() const { return dt; }
+
+    // Longest wall-clock interval advance() will simulate; longer gaps (window
+    // drag, debugger) are dropped instead of stalling on a burst of catch-up steps.
+    void setMaxFrameSeconds(double sec) { maxFrameSec = sec; }
+
+    // Takes effect from the next step, so the change lands on a step boundary.
+    void setCrankSpeed(double degPerSec) { pendingSpeed = degPerSec; }
+    double crankSpeed() const { return pendingSpeed; }
+
+    // Adds elapsed wall-clock time and runs every whole step it covers.
+    // Returns the number of steps run.
+    int advance(double elapsedSec);
+    // Runs exactly n steps, ignoring the accumulator (headless / replay).
+    void runSteps(uint64_t n);
+
+    // Called with the new state after every step (telemetry logging); empty
+    // by default.
+    void setStepCallback(std::function<void(const SimState&)> fn) { onStep = std::move(fn); }
+
+    const SimState& previous() const { return prev; }
+    const SimState& current() const { return cur; }
+    // Fraction of a step left in the accumulator, in [0, 1).
+    double alpha() const { return accumulator / dt; }
+    SimRenderState renderState() const;
+
+private:
+    void step();
+
+    double hz, dt;
+    double maxFrameSec = 0.25;
+    double accumulator = 0.0;
+    double pendingSpeed;
+    SimState prev, cur;
+    std::function<void(const SimState&)> onStep;
+};
@@ -0,0 +1,173 @@
+// sim_snapshot.cpp
+// Fleet simulation snapshots (see sim_snapshot.h).
+
+#include "sim_snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include "mapped_file.h"
+
+static const char kSnapshotMagic[8] = { 'E', 'N', 'G', 'S', 'N', 'A', 'P', 0 };
+static const uint64_t kSnapshotAlign = 64;
+
+static uint64_t alignUp(uint64_t v) {
+    return (v + kSnapshotAlign - 1) & ~(kSnapshotAlign - 1);
+}
+
+SimSnapshot::Section* SimSnapshot::section(int shard, const char* name) {
+    for(Section& s: sections)
+        if(s.shard == shard && strncmp(s.name, name, sizeof(s.name)) == 0) return &s;
+    return nullptr;
+}
+
+const SimSnapshot::Section* SimSnapshot::section(int shard, const char* name) const {
+    return const_cast<SimSnapshot*>(this)->section(shard, name);
+}
+
+void SimSnapshot::capture(int shard, const std::vector<StateArray>& arrays) {
+    for(const StateArray& a: arrays){
+        auto buf = std::make_shared<std::vector<uint8_t>>((const uint8_t*)a.data, (const uint8_t*)a.data + a.bytes);
+        Section* s = section(shard, a.name);
+        if(!s) {
+            sections.push_back(Section());
+            s = &sections.back();
+            memset(s->name, 0, sizeof(s->name));
+            snprintf(s->name, sizeof(s->name), "%s", a.name);
+            s->shard = shard;
+        }
+        s->data = buf->data();
+        s->bytes = a.bytes;
+        s->owner = std::move(buf);
+        s->writable = true;
+    }
+    if(shard >= (int)head.shards) head.shards = (uint32_t)shard + 1;
+}
+
+bool SimSnapshot::restore(int shard, const std::vector<StateArray>& arrays, std::string& error) const {
+    // Check everything first so a failed restore leaves the state alone.
+    for(const StateArray& a: arrays){
+        const Section* s = section(shard, a.name);
+        if(!s) {
+            error = "shard " + std::to_string(shard) + " has no " + a.name;
+            return false;
+        }
+        if(s->bytes != a.bytes) {
+            error = "shard " + std::to_string(shard) + " " + a.name + " holds " + std::to_string(s->bytes)
+                  + " bytes, expected " + std::to_string(a.bytes);
+            return false;
+        }
+    }
+    for(const StateArray& a: arrays) memcpy(a.data, section(shard, a.name)->data, a.bytes);
+    return true;
+}
+
+const uint8_t* SimSnapshot::find(int shard, const char* name, size_t* bytes) const {
+    const Section* s = section(shard, name);
+    if(bytes) *bytes = s ? s->bytes : 0;
+    return s ? s->data : nullptr;
+}
+
+uint8_t* SimSnapshot::edit(int shard, const char* name, size_t* bytes) {
+    Section* s = section(shard, name);
+    if(bytes) *bytes = s ? s->bytes : 0;
+    if(!s) return nullptr;
+    if(!s->writable || s->owner.use_count() > 1) {
+        auto buf = std::make_shared<std::vector<uint8_t>>(s->data, s->data + s->bytes);
+        s->data = buf->data();
+        s->owner = std::move(buf);
+        s->writable = true;
+    }
+    return const_cast<uint8_t*>(s->data);
+}
+
+size_t SimSnapshot::bytes() const {
+    size_t n = 0;
+    for(const Section& s: sections) n += s.bytes;
+    return n;
+}
+
+size_t SimSnapshot::sharedBytes(const SimSnapshot& other) const {
+    size_t n = 0;
+    for(const Section& s: sections){
+        const Section* o = other.section(s.shard, s.name);
+        if(o && o->data == s.data) n += s.bytes;
+    }
+    return n;
+}
+
+bool SimSnapshot::save(const std::string& path, std::string& error) const {
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) {
+        error = "cannot create " + path;
+        return false;
+    }
+    SnapshotHeader h = head;
+    memcpy(h.magic, kSnapshotMagic, sizeof(h.magic));
+    h.version = kSnapshotVersion;
+    h.sectionCount = (uint32_t)sections.size();
+    std::vector<SnapshotSection> table(sections.size());
+    uint64_t offset = alignUp(sizeof(h) + table.size() * sizeof(SnapshotSection));
+    for(size_t i=0;i<sections.size();i++){
+        memcpy(table[i].name, sections[i].name, sizeof(table[i].name));
+        table[i].shard = (uint32_t)sections[i].shard;
+        table[i].reserved = 0;
+        table[i].offset = offset;
+        table[i].bytes = sections[i].bytes;
+        offset = alignUp(offset + sections[i].bytes);
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(!table.empty()) ok = ok && fwrite(table.data(), sizeof(SnapshotSection), table.size(), f) == table.size();
+    uint64_t at = sizeof(h) + table.size() * sizeof(SnapshotSection);
+    static const uint8_t zeros[kSnapshotAlign] = {};
+    for(size_t i=0;i<sections.size() && ok;i++){
+        ok = table[i].offset == at || fwrite(zeros, 1, (size_t)(table[i].offset - at), f) == table[i].offset - at;
+        ok = ok && (sections[i].bytes == 0 || fwrite(sections[i].data, 1, sections[i].bytes, f) == sections[i].bytes);
+        at = table[i].offset + sections[i].bytes;
+    }
+    ok = fclose(f) == 0 && ok;
+    if(!ok) error = "cannot write " + path;
+    return ok;
+}
+
+bool SimSnapshot::load(const std::string& path, std::string& error) {
+    auto file = std::make_shared<MappedFile>();
+    if(!file->open(path)) {
+        error = "cannot open " + path;
+        return false;
+    }
+    const uint8_t* base = file->data();
+    size_t size = file->size();
+    SnapshotHeader h;
+    if(size < sizeof(h) || memcmp(base, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        error = path + " is not a snapshot";
+        return false;
+    }
+    memcpy(&h, base, sizeof(h));
+    if(h.version != kSnapshotVersion) {
+        error = path + ": unsupported snapshot version " + std::to_string(h.version);
+        return false;
+    }
+    if((size - sizeof(h)) / sizeof(SnapshotSection) < h.sectionCount) {
+        error = path + ": truncated section table";
+        return false;
+    }
+    std::vector<Section> loaded(h.sectionCount);
+    for(uint32_t i=0;i<h.sectionCount;i++){
+        SnapshotSection t;
+        memcpy(&t, base + sizeof(h) + i * sizeof(t), sizeof(t));
+        if(t.offset > size || t.bytes > size - t.offset || t.shard >= h.shards) {
+            error = path + ": section " + std::to_string(i) + " is out of bounds";
+            return false;
+        }
+        Section& s = loaded[i];
+        memcpy(s.name, t.name, sizeof(s.name));
+        s.name[sizeof(s.name) - 1] = 0;
+        s.shard = (int)t.shard;
+        s.owner = file;
+        s.data = base + t.offset;
+        s.bytes = (size_t)t.bytes;
+        s.writable = false;
+    }
+    head = h;
+    sections = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,105 @@
+// sim_snapshot.h
+// Snapshot of a fleet simulation: every array of state the batch classes
+// carry from one step to the next (crank angles and speeds, phase offsets,
+// piston positions and phases, cylinder pressures, latched fuel, cycle
+// work, loads, torques), per shard, so a run can stop anywhere and resume
+// bit for bit. Sweeps start from a warmed-up steady state instead of
+// simulating the spin-up every time.
+//
+// EngineBatch, ThermoBatch and CrankDynamics list their state through
+// stateArrays(); a snapshot stores a copy of each array under its name.
+// Copies of a snapshot (fork()) share the arrays; edit() detaches only the
+// array it returns, so many variants of one warm fleet (different fuel or
+// load per variant) cost memory only for what differs. Loading a file maps
+// it and points the arrays into the mapping, so load is constant time and
+// restore is one copy per array.
+//
+// File (little-endian):
+//   SnapshotHeader
+//   SnapshotSection[sectionCount]
+//   array data, each at its section's offset, 64-byte aligned
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+const uint32_t kSnapshotVersion = 1;
+
+struct SnapshotHeader {
+    char magic[8];              // "ENGSNAP" + NUL
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t engines;           // whole fleet
+    uint32_t cylinders;
+    uint32_t shards;
+    uint32_t reserved0;
+    double timeSec;             // simulated time at the snapshot
+    uint64_t samples;           // steps taken to get there
+    char engineName[32];
+    uint64_t reserved[2];
+};
+
+struct SnapshotSection {
+    char name[16];
+    uint32_t shard;
+    uint32_t reserved;
+    uint64_t offset;            // from the start of the file
+    uint64_t bytes;
+};
+
+static_assert(sizeof(SnapshotHeader) == 96, "SnapshotHeader is a file format");
+static_assert(sizeof(SnapshotSection) == 40, "SnapshotSection is a file format");
+
+// One array of live state, as listed by stateArrays().
+struct StateArray {
+    const char* name;           // at most 15 characters
+    void* data;
+    size_t bytes;
+};
+
+class SimSnapshot {
+public:
+    // Engines, cylinders, time and engine name; shards and sectionCount are
+    // kept by the snapshot itself.
+    SnapshotHeader& info() { return head; }
+    const SnapshotHeader& info() const { return head; }
+    int shards() const { return (int)head.shards; }
+
+    // Stores a copy of arrays as shard, replacing what was stored under it.
+    void capture(int shard, const std::vector<StateArray>& arrays);
+    // Copies shard's stored arrays into arrays. False if an array is missing
+    // or its size differs; error names it.
+    bool restore(int shard, const std::vector<StateArray>& arrays, std::string& error) const;
+
+    // A snapshot sharing every array with this one.
+    SimSnapshot fork() const { return *this; }
+    // The stored array, or nullptr.
+    const uint8_t* find(int shard, const char* name, size_t* bytes = nullptr) const;
+    // A writable array, copied first if it is shared with a fork or a file.
+    uint8_t* edit(int shard, const char* name, size_t* bytes = nullptr);
+    // Bytes of array data held, and of those shared with other.
+    size_t bytes() const;
+    size_t sharedBytes(const SimSnapshot& other) const;
+
+    bool save(const std::string& path, std::string& error) const;
+    bool load(const std::string& path, std::string& error);
+
+private:
+    struct Section {
+        char name[16];
+        int shard;
+        std::shared_ptr<const void> owner;   // keeps data alive: a buffer or the mapped file
+        const uint8_t* data;
+        size_t bytes;
+        bool writable;                       // owner is a buffer of ours
+    };
+
+    Section* section(int shard, const char* name);
+    const Section* section(int shard, const char* name) const;
+
+    SnapshotHeader head = {};
+    std::vector<Section> sections;
+};
@@ -0,0 +1,245 @@
+// soft_raster.cpp
+// CPU rasterizer (see soft_raster.h).
+
+#include "soft_raster.h"
+#include "bitmap_font.h"
+#include "frame_profiler.h"
+#include "span_kernels.h"
+#include <algorithm>
+#include <cmath>
+
+void Framebuffer::resize(int w, int h) {
+    width = w;
+    height = h;
+    rgba.assign((size_t)w * h * 4, 0);
+}
+
+static uint8_t toByte(float c) {
+    if(c <= 0.0f) return 0;
+    if(c >= 1.0f) return 255;
+    return (uint8_t)(c * 255.0f + 0.5f);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Rasterization
+//////////////////////////////////////////////////////////////////////////
+static void fillSpan(Framebuffer& fb, int y, int xBegin, int xEnd, const uint8_t col[4], bool blend) {
+    uint8_t* p = fb.row(y) + (size_t)xBegin * 4;
+    const SpanKernels& k = spanKernels();
+    if(!blend || col[3] == 255) k.fill(p, xEnd - xBegin, col);
+    else k.blend(p, xEnd - xBegin, col);
+}
+
+void rasterClear(Framebuffer& fb, const RasterClip& clip, const uint8_t col[4]) {
+    const SpanKernels& k = spanKernels();
+    for(int y=clip.y0;y<clip.y1;y++) k.fill(fb.row(y) + (size_t)clip.x0 * 4, clip.x1 - clip.x0, col);
+}
+
+void rasterPixelRect(Framebuffer& fb, const RasterClip& clip,
+                     int x0, int y0, int x1, int y1, const uint8_t col[4], bool blend) {
+    x0 = std::max(x0, clip.x0); y0 = std::max(y0, clip.y0);
+    x1 = std::min(x1, clip.x1); y1 = std::min(y1, clip.y1);
+    if(x0 >= x1) return;
+    for(int y=y0;y<y1;y++) fillSpan(fb, y, x0, x1, col, blend);
+}
+
+// Edge function E(p) = A*px + B*py + C, positive inside a CCW triangle.
+struct RasterEdge {
+    double A, B, C;
+    bool inclusive;   // top-left rule: left and top edges own pixels on the edge
+};
+
+static RasterEdge makeEdge(double ax, double ay, double bx, double by) {
+    RasterEdge e;
+    e.A = ay - by;
+    e.B = bx - ax;
+    e.C = -(e.A * ax + e.B * ay);
+    e.inclusive = e.A > 0.0 || (e.A == 0.0 && e.B < 0.0);
+    return e;
+}
+
+void rasterTriangle(Framebuffer& fb, const RasterClip& clip,
+                    float x0, float y0, float x1, float y1, float x2, float y2,
+                    const uint8_t col[4], bool blend) {
+    double area = ((double)x1 - x0) * ((double)y2 - y0) - ((double)x2 - x0) * ((double)y1 - y0);
+    if(area == 0.0) return;
+    if(area < 0.0) { std::swap(x1, x2); std::swap(y1, y2); }
+
+    RasterEdge edges[3] = {
+        makeEdge(x0, y0, x1, y1),
+        makeEdge(x1, y1, x2, y2),
+        makeEdge(x2, y2, x0, y0)
+    };
+
+    float minY = std::min(y0, std::min(y1, y2));
+    float maxY = std::max(y0, std::max(y1, y2));
+    int yBegin = std::max(clip.y0, (int)std::ceil(minY - 0.5f));
+    int yEnd = std::min(clip.y1 - 1, (int)std::floor(maxY - 0.5f));
+
+    for(int y=yBegin;y<=yEnd;y++){
+        double py = y + 0.5;
+        int lo = clip.x0, hi = clip.x1;
+        bool empty = false;
+        for(const RasterEdge& e: edges){
+            double k = e.B * py + e.C;
+            if(e.A > 0.0) {
+                // x + 0.5 >= -k/A (clamped: near-horizontal edges give huge bounds)
+                double t = std::max(-1e9, std::min(1e9, -k / e.A - 0.5));
+                int xl = e.inclusive ? (int)std::ceil(t) : (int)std::floor(t) + 1;
+                lo = std::max(lo, xl);
+            } else if(e.A < 0.0) {
+                double t = std::max(-1e9, std::min(1e9, -k / e.A - 0.5));
+                int xr = e.inclusive ? (int)std::floor(t) : (int)std::ceil(t) - 1;
+                hi = std::min(hi, xr + 1);
+            } else if(k < 0.0 || (k == 0.0 && !e.inclusive)) {
+                empty = true;
+                break;
+            }
+        }
+        if(!empty && lo < hi) fillSpan(fb, y, lo, hi, col, blend);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SoftGeometry
+//////////////////////////////////////////////////////////////////////////
+void SoftGeometry::setViewScale(float sx, float sy) {
+    viewSx = sx;
+    viewSy = sy;
+}
+
+void SoftGeometry::resetState() {
+    col[0] = col[1] = col[2] = col[3] = 255;
+    blending = false;
+    curLineWidth = 1.0f;
+    tx = ty = 0.0f;
+    ms = 1.0f;
+    transformStack.clear();
+}
+
+void SoftGeometry::clear(float r, float g, float b, float a) {
+    uint8_t c[4] = { toByte(r), toByte(g), toByte(b), toByte(a) };
+    emitClear(c);
+}
+
+void SoftGeometry::color(float r, float g, float b, float a) {
+    col[0] = toByte(r); col[1] = toByte(g); col[2] = toByte(b); col[3] = toByte(a);
+}
+
+void SoftGeometry::blend(bool enabled) {
+    blending = enabled;
+}
+
+void SoftGeometry::lineWidth(float w) {
+    curLineWidth = w;
+}
+
+void SoftGeometry::pushTransform(float x, float y, float scale) {
+    transformStack.push_back(tx);
+    transformStack.push_back(ty);
+    transformStack.push_back(ms);
+    tx += x * ms;
+    ty += y * ms;
+    ms *= scale;
+}
+
+void SoftGeometry::popTransform() {
+    if(transformStack.size() < 3) return;
+    ms = transformStack.back(); transformStack.pop_back();
+    ty = transformStack.back(); transformStack.pop_back();
+    tx = transformStack.back(); transformStack.pop_back();
+}
+
+void SoftGeometry::fillRect(float x0, float y0, float x1, float y1) {
+    frameProfiler.countDraw(4);
+    float wx0 = toWindowX(x0), wy0 = toWindowY(y0);
+    float wx1 = toWindowX(x1), wy1 = toWindowY(y1);
+    emitTriangle(wx0, wy0, wx1, wy0, wx1, wy1);
+    emitTriangle(wx0, wy0, wx1, wy1, wx0, wy1);
+}
+
+void SoftGeometry::fillFan(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    float cx = toWindowX(xy[0]), cy = toWindowY(xy[1]);
+    for(int i=1;i+1<count;i++){
+        emitTriangle(cx, cy,
+                     toWindowX(xy[2*i]), toWindowY(xy[2*i+1]),
+                     toWindowX(xy[2*i+2]), toWindowY(xy[2*i+3]));
+    }
+}
+
+void SoftGeometry::lines(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    for(int i=0;i+1<count;i+=2){
+        emitLine(toWindowX(xy[2*i]), toWindowY(xy[2*i+1]),
+                 toWindowX(xy[2*i+2]), toWindowY(xy[2*i+3]), curLineWidth * viewSx);
+    }
+}
+
+void SoftGeometry::lineLoop(const float* xy, int count) {
+    frameProfiler.countDraw(count);
+    for(int i=0;i<count;i++){
+        int j = (i + 1) % count;
+        emitLine(toWindowX(xy[2*i]), toWindowY(xy[2*i+1]),
+                 toWindowX(xy[2*j]), toWindowY(xy[2*j+1]), curLineWidth * viewSx);
+    }
+}
+
+// Glyph pixel size per font, chosen so cap heights land near GLUT's
+// Helvetica 12 / Helvetica 18 / Times Roman 24.
+static int fontPixelScale(TextFont font) {
+    if(font == FONT_HELVETICA_12) return 1;
+    if(font == FONT_TIMES_ROMAN_24) return 3;
+    return 2;
+}
+
+void SoftGeometry::text(float x, float y, const char* s, TextFont font) {
+    frameProfiler.countDraw(0);
+    float cell = fontPixelScale(font) * viewSx;
+    float cellY = fontPixelScale(font) * viewSy;
+    float penX = toWindowX(x), baseY = toWindowY(y);
+    for(const unsigned char* p = (const unsigned char*)s; *p; ++p) {
+        unsigned char ch = *p;
+        if((ch & 0xC0) == 0x80) continue;   // UTF-8 continuation: one cell per code point
+        if(ch >= 0x20 && ch < 0x7F) {
+            const uint8_t* glyph = kFont5x7[ch - 0x20];
+            for(int c=0;c<kFontGlyphW;c++){
+                for(int r=0;r<kFontGlyphH;r++){
+                    if(!(glyph[c] >> r & 1)) continue;
+                    float gx = penX + c * cell;
+                    float gy = baseY + (kFontGlyphH - 1 - r) * cellY;
+                    emitPixelRect((int)lroundf(gx), (int)lroundf(gy),
+                                  (int)lroundf(gx + cell), (int)lroundf(gy + cellY));
+                }
+            }
+        }
+        penX += kFontAdvance * cell;
+    }
+}
+
+void SoftGeometry::emitLine(float x0, float y0, float x1, float y1, float width) {
+    float dx = x1 - x0, dy = y1 - y0;
+    float len = sqrtf(dx*dx + dy*dy);
+    if(len <= 0.0f) return;
+    float w = std::max(width, 1.0f) * 0.5f;
+    float nx = -dy / len * w, ny = dx / len * w;
+    emitTriangle(x0 + nx, y0 + ny, x0 - nx, y0 - ny, x1 - nx, y1 - ny);
+    emitTriangle(x0 + nx, y0 + ny, x1 - nx, y1 - ny, x1 + nx, y1 + ny);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SoftBackend
+//////////////////////////////////////////////////////////////////////////
+SoftBackend::SoftBackend(Framebuffer& target) : fb(target) {}
+
+void SoftBackend::emitClear(const uint8_t c[4]) {
+    rasterClear(fb, fullClip(), c);
+}
+
+void SoftBackend::emitTriangle(float x0, float y0, float x1, float y1, float x2, float y2) {
+    rasterTriangle(fb, fullClip(), x0, y0, x1, y1, x2, y2, col, blending);
+}
+
+void SoftBackend::emitPixelRect(int x0, int y0, int x1, int y1) {
+    rasterPixelRect(fb, fullClip(), x0, y0, x1, y1, col, blending);
+}
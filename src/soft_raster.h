@@ -0,0 +1,93 @@
+// soft_raster.h
+// CPU rasterizer used for headless rendering and the --backend soft window.
+// Triangles are filled by span with GL's pixel-centre sampling and a top-left
+// fill rule, so shared edges of fans and quads are neither doubled nor
+// dropped; lines are rendered as width-w quads along the segment. Spans are
+// written with the SIMD kernels from span_kernels.h and text uses a built-in
+// 5x7 font sized to approximate the GLUT bitmap fonts.
+//
+// SoftGeometry turns RenderBackend calls into window-space triangles, pixel
+// rects and clears. SoftBackend rasterizes them immediately; CommandList
+// (command_list.h) records them for the tile-parallel renderer.
+#pragma once
+
+#include "render_backend.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Framebuffer {
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgba;   // 4 bytes per pixel, row 0 is the bottom row (GL order)
+
+    void resize(int w, int h);
+    uint8_t* row(int y) { return rgba.data() + (size_t)y * width * 4; }
+    const uint8_t* row(int y) const { return rgba.data() + (size_t)y * width * 4; }
+};
+
+// Pixel rectangle [x0, x1) x [y0, y1) that rasterization is limited to.
+// Pixels are only ever sampled at their own centres, so rasterizing a
+// primitive tile by tile writes exactly the bytes a full-screen pass would.
+struct RasterClip {
+    int x0, y0, x1, y1;
+};
+
+void rasterClear(Framebuffer& fb, const RasterClip& clip, const uint8_t col[4]);
+void rasterTriangle(Framebuffer& fb, const RasterClip& clip,
+                    float x0, float y0, float x1, float y1, float x2, float y2,
+                    const uint8_t col[4], bool blend);
+void rasterPixelRect(Framebuffer& fb, const RasterClip& clip,
+                     int x0, int y0, int x1, int y1, const uint8_t col[4], bool blend);
+
+class SoftGeometry : public RenderBackend {
+public:
+    // Scale from scene units to pixels (1 = one unit per pixel, like the window).
+    void setViewScale(float sx, float sy);
+
+    void clear(float r, float g, float b, float a) override;
+    void color(float r, float g, float b, float a = 1.0f) override;
+    void blend(bool enabled) override;
+    void lineWidth(float w) override;
+
+    void pushTransform(float x, float y, float scale = 1.0f) override;
+    void popTransform() override;
+
+    void fillRect(float x0, float y0, float x1, float y1) override;
+    void fillFan(const float* xy, int count) override;
+    void lines(const float* xy, int count) override;
+    void lineLoop(const float* xy, int count) override;
+    void text(float x, float y, const char* s, TextFont font) override;
+
+protected:
+    // Window-space output, drawn with the current colour and blend state.
+    virtual void emitClear(const uint8_t c[4]) = 0;
+    virtual void emitTriangle(float x0, float y0, float x1, float y1, float x2, float y2) = 0;
+    virtual void emitPixelRect(int x0, int y0, int x1, int y1) = 0;
+
+    void emitLine(float x0, float y0, float x1, float y1, float width);
+    void resetState();
+    float toWindowX(float x) const { return (x * ms + tx) * viewSx; }
+    float toWindowY(float y) const { return (y * ms + ty) * viewSy; }
+
+    uint8_t col[4] = {255, 255, 255, 255};
+    bool blending = false;
+    float curLineWidth = 1.0f;
+    float tx = 0.0f, ty = 0.0f, ms = 1.0f;   // model transform: x * ms + tx
+    float viewSx = 1.0f, viewSy = 1.0f;
+    std::vector<float> transformStack;
+};
+
+class SoftBackend : public SoftGeometry {
+public:
+    explicit SoftBackend(Framebuffer& target);
+
+protected:
+    void emitClear(const uint8_t c[4]) override;
+    void emitTriangle(float x0, float y0, float x1, float y1, float x2, float y2) override;
+    void emitPixelRect(int x0, int y0, int x1, int y1) override;
+
+private:
+    RasterClip fullClip() const { return { 0, 0, fb.width, fb.height }; }
+
+    Framebuffer& fb;
+};
@@ -0,0 +1,164 @@
+// span_kernels.cpp
+// Scalar / SSE2 / AVX2 span fill and blend (see span_kernels.h).
+
+#include "span_kernels.h"
+#include "cpu_features.h"
+#include <cstring>
+
+#ifdef ENGINE_X86
+#include <immintrin.h>
+#endif
+
+// Exact x/255 for x < 65536 - 256, usable on 16-bit SIMD lanes.
+static inline unsigned div255(unsigned x) {
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Scalar
+//////////////////////////////////////////////////////////////////////////
+static void fillScalar(uint8_t* dst, int n, const uint8_t col[4]) {
+    for(int i=0;i<n;i++, dst+=4) {
+        dst[0] = col[0]; dst[1] = col[1]; dst[2] = col[2]; dst[3] = col[3];
+    }
+}
+
+static void blendScalar(uint8_t* dst, int n, const uint8_t col[4]) {
+    unsigned a = col[3], ia = 255 - a;
+    unsigned s0 = col[0]*a + 127, s1 = col[1]*a + 127, s2 = col[2]*a + 127, s3 = col[3]*a + 127;
+    for(int i=0;i<n;i++, dst+=4) {
+        dst[0] = (uint8_t)div255(s0 + dst[0]*ia);
+        dst[1] = (uint8_t)div255(s1 + dst[1]*ia);
+        dst[2] = (uint8_t)div255(s2 + dst[2]*ia);
+        dst[3] = (uint8_t)div255(s3 + dst[3]*ia);
+    }
+}
+
+#ifdef ENGINE_X86
+//////////////////////////////////////////////////////////////////////////
+// SSE2 (4 pixels per iteration)
+//////////////////////////////////////////////////////////////////////////
+static void fillSSE2(uint8_t* dst, int n, const uint8_t col[4]) {
+    int32_t packed;
+    memcpy(&packed, col, 4);
+    __m128i v = _mm_set1_epi32(packed);
+    int i = 0;
+    for(;i+4<=n;i+=4) _mm_storeu_si128((__m128i*)(dst + 4*i), v);
+    fillScalar(dst + 4*i, n - i, col);
+}
+
+static inline __m128i blend8x16(__m128i d16, __m128i src127, __m128i ia, __m128i one) {
+    __m128i x = _mm_add_epi16(src127, _mm_mullo_epi16(d16, ia));
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+}
+
+static void blendSSE2(uint8_t* dst, int n, const uint8_t col[4]) {
+    unsigned a = col[3];
+    // two pixels' worth of 16-bit channel constants
+    __m128i src127 = _mm_setr_epi16(
+        (short)(col[0]*a + 127), (short)(col[1]*a + 127), (short)(col[2]*a + 127), (short)(col[3]*a + 127),
+        (short)(col[0]*a + 127), (short)(col[1]*a + 127), (short)(col[2]*a + 127), (short)(col[3]*a + 127));
+    __m128i ia = _mm_set1_epi16((short)(255 - a));
+    __m128i one = _mm_set1_epi16(1);
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for(;i+4<=n;i+=4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + 4*i));
+        __m128i lo = blend8x16(_mm_unpacklo_epi8(d, zero), src127, ia, one);
+        __m128i hi = blend8x16(_mm_unpackhi_epi8(d, zero), src127, ia, one);
+        _mm_storeu_si128((__m128i*)(dst + 4*i), _mm_packus_epi16(lo, hi));
+    }
+    blendScalar(dst + 4*i, n - i, col);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// AVX2 (8 pixels per iteration)
+//////////////////////////////////////////////////////////////////////////
+ENGINE_TARGET_AVX2 static void fillAVX2(uint8_t* dst, int n, const uint8_t col[4]) {
+    int32_t packed;
+    memcpy(&packed, col, 4);
+    __m256i v = _mm256_set1_epi32(packed);
+    int i = 0;
+    for(;i+8<=n;i+=8) _mm256_storeu_si256((__m256i*)(dst + 4*i), v);
+    _mm256_zeroupper();
+    fillScalar(dst + 4*i, n - i, col);
+}
+
+ENGINE_TARGET_AVX2 static inline __m256i blend16x16(__m256i d16, __m256i src127, __m256i ia, __m256i one) {
+    __m256i x = _mm256_add_epi16(src127, _mm256_mullo_epi16(d16, ia));
+    return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, one), _mm256_srli_epi16(x, 8)), 8);
+}
+
+ENGINE_TARGET_AVX2 static void blendAVX2(uint8_t* dst, int n, const uint8_t col[4]) {
+    unsigned a = col[3];
+    short s0 = (short)(col[0]*a + 127), s1 = (short)(col[1]*a + 127);
+    short s2 = (short)(col[2]*a + 127), s3 = (short)(col[3]*a + 127);
+    __m256i src127 = _mm256_setr_epi16(s0, s1, s2, s3, s0, s1, s2, s3,
+                                       s0, s1, s2, s3, s0, s1, s2, s3);
+    __m256i ia = _mm256_set1_epi16((short)(255 - a));
+    __m256i one = _mm256_set1_epi16(1);
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for(;i+8<=n;i+=8) {
+        // unpack / pack work per 128-bit lane, so pixel order is preserved
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + 4*i));
+        __m256i lo = blend16x16(_mm256_unpacklo_epi8(d, zero), src127, ia, one);
+        __m256i hi = blend16x16(_mm256_unpackhi_epi8(d, zero), src127, ia, one);
+        _mm256_storeu_si256((__m256i*)(dst + 4*i), _mm256_packus_epi16(lo, hi));
+    }
+    // GCC does not always emit vzeroupper before a tail call out of a
+    // target("avx2") function; dirty upper YMM state then stalls every SSE
+    // instruction in the rasterizer (AVX/SSE transition penalty).
+    _mm256_zeroupper();
+    blendSSE2(dst + 4*i, n - i, col);
+}
+
+#endif // ENGINE_X86
+
+//////////////////////////////////////////////////////////////////////////
+// Dispatch
+//////////////////////////////////////////////////////////////////////////
+static const SpanKernels scalarKernels = { SpanIsa::Scalar, fillScalar, blendScalar };
+#ifdef ENGINE_X86
+static const SpanKernels sse2Kernels = { SpanIsa::SSE2, fillSSE2, blendSSE2 };
+static const SpanKernels avx2Kernels = { SpanIsa::AVX2, fillAVX2, blendAVX2 };
+#endif
+
+static const SpanKernels* forced = nullptr;
+
+bool spanIsaSupported(SpanIsa isa) {
+#ifdef ENGINE_X86
+    if(isa == SpanIsa::AVX2) return cpuHasAVX2();
+    return true;   // SSE2 is baseline on every x86 target we build for
+#else
+    return isa == SpanIsa::Scalar;
+#endif
+}
+
+const SpanKernels& spanKernelsFor(SpanIsa isa) {
+#ifdef ENGINE_X86
+    if(isa == SpanIsa::AVX2 && spanIsaSupported(SpanIsa::AVX2)) return avx2Kernels;
+    if(isa == SpanIsa::AVX2 || isa == SpanIsa::SSE2) return sse2Kernels;
+#else
+    (void)isa;
+#endif
+    return scalarKernels;
+}
+
+const SpanKernels& spanKernels() {
+    if(forced) return *forced;
+    static const SpanKernels& best = spanKernelsFor(SpanIsa::AVX2);
+    return best;
+}
+
+void forceSpanIsa(SpanIsa isa) {
+    forced = &spanKernelsFor(isa);
+}
+
+const char* spanIsaName(SpanIsa isa) {
+    switch(isa) {
+        case SpanIsa::AVX2: return "avx2";
+        case SpanIsa::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
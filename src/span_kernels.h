@@ -0,0 +1,29 @@
+// span_kernels.h
+// Horizontal span writers used by the software rasterizer, with SSE2 / AVX2
+// variants picked once at startup from the running CPU.
+//
+// Blending is (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) on 8-bit channels, rounded as
+// (s*a + d*(255-a) + 127) / 255; every variant produces identical bytes.
+#pragma once
+
+#include <cstdint>
+
+enum class SpanIsa { Scalar, SSE2, AVX2 };
+
+struct SpanKernels {
+    SpanIsa isa;
+    // Writes n RGBA pixels of colour col (4 bytes, memory order).
+    void (*fill)(uint8_t* dst, int n, const uint8_t col[4]);
+    // Blends col over n RGBA pixels using col[3] as source alpha.
+    void (*blend)(uint8_t* dst, int n, const uint8_t col[4]);
+};
+
+// Best variant supported by this CPU (detected on first call).
+const SpanKernels& spanKernels();
+// Specific variant; falls back to the best supported one if isa is unavailable.
+const SpanKernels& spanKernelsFor(SpanIsa isa);
+bool spanIsaSupported(SpanIsa isa);
+const char* spanIsaName(SpanIsa isa);
+
+// Overrides what spanKernels() returns (benchmarks, pixel comparisons).
+void forceSpanIsa(SpanIsa isa);
@@ -0,0 +1,522 @@
+// telemetry_codec.cpp
+// Delta / delta-of-delta bit-packing for telemetry columns (see
+// telemetry_codec.h).
+
+#include "telemetry_codec.h"
+#include "cpu_features.h"
+#include "telemetry_stream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef ENGINE_X86
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef ENGINE_NEON
+#include <arm_neon.h>
+#endif
+
+static const int kFrameWords = kTelemetryFrameValues / 32;   // words per bit of width
+
+static size_t align4(size_t v) {
+    return (v + 3) & ~(size_t)3;
+}
+
+static inline uint32_t zigzag(uint32_t v) {
+    return (v << 1) ^ (uint32_t)((int32_t)v >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t z) {
+    return (z >> 1) ^ (0u - (z & 1));
+}
+
+static inline int bitWidth(uint32_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? 32 - __builtin_clz(v) : 0;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    return _BitScanReverse(&i, v) ? (int)i + 1 : 0;
+#else
+    int b = 0;
+    while(v) { b++; v >>= 1; }
+    return b;
+#endif
+}
+
+size_t telemetryEncodedBound(size_t values) {
+    size_t frames = (values + kTelemetryFrameValues - 1) / kTelemetryFrameValues;
+    return sizeof(TelemetryCodecHeader) + 2 * align4(frames) + frames * kTelemetryFrameValues * 4;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Frame packing: 8 lanes x 32 values, lane l's bits in words k * 8 + l
+//////////////////////////////////////////////////////////////////////////
+template<int B>
+static void packFrameB(const uint32_t* in, uint32_t* out) {
+    memset(out, 0, (size_t)B * kFrameWords * 4);
+    for(int j=0;j<32;j++){
+        const int bit = j * B, k = bit >> 5, s = bit & 31;
+        for(int l=0;l<8;l++){
+            uint32_t v = in[j * 8 + l];
+            out[k * 8 + l] |= v << s;
+            if(s + B > 32) out[(k + 1) * 8 + l] |= v >> (32 - s);
+        }
+    }
+}
+
+template<>
+void packFrameB<0>(const uint32_t*, uint32_t*) {}
+
+template<int B>
+static void unpackScalarB(const uint32_t* in, uint32_t* out) {
+    const uint32_t mask = B == 32 ? 0xffffffffu : (1u << B) - 1;
+    for(int j=0;j<32;j++){
+        const int bit = j * B, k = bit >> 5, s = bit & 31;
+        for(int l=0;l<8;l++){
+            uint32_t v = in[k * 8 + l] >> s;
+            if(s + B > 32) v |= in[(k + 1) * 8 + l] << (32 - s);
+            out[j * 8 + l] = v & mask;
+        }
+    }
+}
+
+template<>
+void unpackScalarB<0>(const uint32_t*, uint32_t* out) {
+    memset(out, 0, kTelemetryFrameValues * 4);
+}
+
+#ifdef ENGINE_X86
+template<int B>
+ENGINE_TARGET_AVX2 static void unpackAVX2B(const uint32_t* in, uint32_t* out) {
+    const __m256i mask = _mm256_set1_epi32(B == 32 ? -1 : (int)((1u << B) - 1));
+    for(int j=0;j<32;j++){
+        const int bit = j * B, k = bit >> 5, s = bit & 31;
+        __m256i v = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i*)(in + k * 8)), s);
+        if(s + B > 32)
+            v = _mm256_or_si256(v, _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(in + (k + 1) * 8)), 32 - s));
+        _mm256_storeu_si256((__m256i*)(out + j * 8), _mm256_and_si256(v, mask));
+    }
+}
+
+template<>
+ENGINE_TARGET_AVX2 void unpackAVX2B<0>(const uint32_t*, uint32_t* out) {
+    memset(out, 0, kTelemetryFrameValues * 4);
+}
+#endif
+
+#ifdef ENGINE_NEON
+template<int B>
+static void unpackNEONB(const uint32_t* in, uint32_t* out) {
+    const uint32x4_t mask = vdupq_n_u32(B == 32 ? 0xffffffffu : (1u << B) - 1);
+    for(int j=0;j<32;j++){
+        const int bit = j * B, k = bit >> 5, s = bit & 31;
+        for(int h=0;h<8;h+=4){
+            uint32x4_t v = vshlq_u32(vld1q_u32(in + k * 8 + h), vdupq_n_s32(-s));
+            if(s + B > 32) v = vorrq_u32(v, vshlq_u32(vld1q_u32(in + (k + 1) * 8 + h), vdupq_n_s32(32 - s)));
+            vst1q_u32(out + j * 8 + h, vandq_u32(v, mask));
+        }
+    }
+}
+
+template<>
+void unpackNEONB<0>(const uint32_t*, uint32_t* out) {
+    memset(out, 0, kTelemetryFrameValues * 4);
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////
+// Residual integration: r[j] = v[j] += unzigzag(r[j]) (order 1), with a
+// running delta d[j] in between for order 2, across a run of lanes
+//////////////////////////////////////////////////////////////////////////
+static void integrate1Scalar(uint32_t* r, uint32_t* v, size_t n) {
+    for(size_t j=0;j<n;j++) r[j] = v[j] += unzigzag(r[j]);
+}
+
+static void integrate2Scalar(uint32_t* r, uint32_t* v, uint32_t* d, size_t n) {
+    for(size_t j=0;j<n;j++) r[j] = v[j] += d[j] += unzigzag(r[j]);
+}
+
+static void dequantizeScalar(const uint32_t* q, float* out, size_t n, float quantum) {
+    for(size_t i=0;i<n;i++) out[i] = (float)(int32_t)q[i] * quantum;
+}
+
+#ifdef ENGINE_X86
+ENGINE_TARGET_AVX2 static inline __m256i unzigzag8(__m256i z) {
+    __m256i sign = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(z, _mm256_set1_epi32(1)));
+    return _mm256_xor_si256(_mm256_srli_epi32(z, 1), sign);
+}
+
+ENGINE_TARGET_AVX2 static void integrate1AVX2(uint32_t* r, uint32_t* v, size_t n) {
+    size_t j = 0;
+    for(;j+8<=n;j+=8){
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(v + j)),
+                                     unzigzag8(_mm256_loadu_si256((const __m256i*)(r + j))));
+        _mm256_storeu_si256((__m256i*)(v + j), x);
+        _mm256_storeu_si256((__m256i*)(r + j), x);
+    }
+    integrate1Scalar(r + j, v + j, n - j);
+}
+
+ENGINE_TARGET_AVX2 static void integrate2AVX2(uint32_t* r, uint32_t* v, uint32_t* d, size_t n) {
+    size_t j = 0;
+    for(;j+8<=n;j+=8){
+        __m256i dd = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(d + j)),
+                                      unzigzag8(_mm256_loadu_si256((const __m256i*)(r + j))));
+        __m256i x = _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(v + j)), dd);
+        _mm256_storeu_si256((__m256i*)(d + j), dd);
+        _mm256_storeu_si256((__m256i*)(v + j), x);
+        _mm256_storeu_si256((__m256i*)(r + j), x);
+    }
+    integrate2Scalar(r + j, v + j, d + j, n - j);
+}
+
+ENGINE_TARGET_AVX2 static void dequantizeAVX2(const uint32_t* q, float* out, size_t n, float quantum) {
+    __m256 s = _mm256_set1_ps(quantum);
+    size_t i = 0;
+    for(;i+8<=n;i+=8)
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(q + i))), s));
+    dequantizeScalar(q + i, out + i, n - i, quantum);
+}
+#endif
+
+#ifdef ENGINE_NEON
+static inline uint32x4_t unzigzag4(uint32x4_t z) {
+    uint32x4_t sign = vsubq_u32(vdupq_n_u32(0), vandq_u32(z, vdupq_n_u32(1)));
+    return veorq_u32(vshrq_n_u32(z, 1), sign);
+}
+
+static void integrate1NEON(uint32_t* r, uint32_t* v, size_t n) {
+    size_t j = 0;
+    for(;j+4<=n;j+=4){
+        uint32x4_t x = vaddq_u32(vld1q_u32(v + j), unzigzag4(vld1q_u32(r + j)));
+        vst1q_u32(v + j, x);
+        vst1q_u32(r + j, x);
+    }
+    integrate1Scalar(r + j, v + j, n - j);
+}
+
+static void integrate2NEON(uint32_t* r, uint32_t* v, uint32_t* d, size_t n) {
+    size_t j = 0;
+    for(;j+4<=n;j+=4){
+        uint32x4_t dd = vaddq_u32(vld1q_u32(d + j), unzigzag4(vld1q_u32(r + j)));
+        uint32x4_t x = vaddq_u32(vld1q_u32(v + j), dd);
+        vst1q_u32(d + j, dd);
+        vst1q_u32(v + j, x);
+        vst1q_u32(r + j, x);
+    }
+    integrate2Scalar(r + j, v + j, d + j, n - j);
+}
+
+static void dequantizeNEON(const uint32_t* q, float* out, size_t n, float quantum) {
+    size_t i = 0;
+    for(;i+4<=n;i+=4) vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(vld1q_u32(q + i))), quantum));
+    dequantizeScalar(q + i, out + i, n - i, quantum);
+}
+#endif
+
+typedef void (*UnpackFn)(const uint32_t* in, uint32_t* out);
+
+struct CodecKernels {
+    CodecIsa isa;
+    UnpackFn unpack[33];        // by frame bit width
+    void (*integrate1)(uint32_t* r, uint32_t* v, size_t n);
+    void (*integrate2)(uint32_t* r, uint32_t* v, uint32_t* d, size_t n);
+    void (*dequantize)(const uint32_t* q, float* out, size_t n, float quantum);
+};
+
+#define ENGINE_UNPACK_TABLE(fn) { \
+    fn<0>,  fn<1>,  fn<2>,  fn<3>,  fn<4>,  fn<5>,  fn<6>,  fn<7>,  fn<8>,  fn<9>,  fn<10>, \
+    fn<11>, fn<12>, fn<13>, fn<14>, fn<15>, fn<16>, fn<17>, fn<18>, fn<19>, fn<20>, fn<21>, \
+    fn<22>, fn<23>, fn<24>, fn<25>, fn<26>, fn<27>, fn<28>, fn<29>, fn<30>, fn<31>, fn<32> }
+
+static const UnpackFn packFrame[33] = ENGINE_UNPACK_TABLE(packFrameB);   // same shape: frame in, words out
+
+static const CodecKernels scalarKernels = {
+    CodecIsa::Scalar, ENGINE_UNPACK_TABLE(unpackScalarB), integrate1Scalar, integrate2Scalar, dequantizeScalar };
+#ifdef ENGINE_X86
+static const CodecKernels avx2Kernels = {
+    CodecIsa::AVX2, ENGINE_UNPACK_TABLE(unpackAVX2B), integrate1AVX2, integrate2AVX2, dequantizeAVX2 };
+#endif
+#ifdef ENGINE_NEON
+static const CodecKernels neonKernels = {
+    CodecIsa::NEON, ENGINE_UNPACK_TABLE(unpackNEONB), integrate1NEON, integrate2NEON, dequantizeNEON };
+#endif
+
+static const CodecKernels* forced = nullptr;
+
+bool codecIsaSupported(CodecIsa isa) {
+    if(isa == CodecIsa::AVX2) return cpuHasAVX2();
+#ifdef ENGINE_NEON
+    if(isa == CodecIsa::NEON) return true;
+#else
+    if(isa == CodecIsa::NEON) return false;
+#endif
+    return true;
+}
+
+static const CodecKernels& bestCodecKernels() {
+#ifdef ENGINE_X86
+    if(cpuHasAVX2()) return avx2Kernels;
+#endif
+#ifdef ENGINE_NEON
+    return neonKernels;
+#else
+    return scalarKernels;
+#endif
+}
+
+static const CodecKernels& codecKernels() {
+    if(forced) return *forced;
+    static const CodecKernels& best = bestCodecKernels();
+    return best;
+}
+
+CodecIsa codecIsa() {
+    return codecKernels().isa;
+}
+
+void forceCodecIsa(CodecIsa isa) {
+    if(!codecIsaSupported(isa)) isa = bestCodecKernels().isa;
+    switch(isa) {
+#ifdef ENGINE_X86
+    case CodecIsa::AVX2: forced = &avx2Kernels; break;
+#endif
+#ifdef ENGINE_NEON
+    case CodecIsa::NEON: forced = &neonKernels; break;
+#endif
+    default: forced = &scalarKernels; break;
+    }
+}
+
+const char* codecIsaName(CodecIsa isa) {
+    switch(isa) {
+    case CodecIsa::AVX2: return "avx2";
+    case CodecIsa::NEON: return "neon";
+    default: return "scalar";
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Encoder
+//////////////////////////////////////////////////////////////////////////
+// Integer form of value i of a column (see header).
+static void columnIntegers(const TelemetryColumn& col, const uint8_t* values, size_t n, uint32_t* x) {
+    if(col.type == (uint8_t)TelemetryType::U8) {
+        for(size_t i=0;i<n;i++) x[i] = values[i];
+    } else if(col.quantum > 0.0f) {
+        const float* v = (const float*)values;
+        // Nearest multiple, rounded in double so only the decoder's float
+        // product adds to the quantum / 2 error.
+        double inv = 1.0 / col.quantum;
+        for(size_t i=0;i<n;i++) x[i] = (uint32_t)(int32_t)llrint(v[i] * inv);
+    } else {
+        memcpy(x, values, n * 4);
+    }
+}
+
+// Bit width for a frame of zigzagged residuals: values wider than it are
+// stored as exceptions, costing a byte of index and a word of high bits each,
+// so a rare outlier (the 720 degree wrap, a combustion edge) does not widen
+// the whole frame. Returns the frame's encoded bytes.
+static size_t frameWidth(const uint32_t* z, size_t count, int& bits, int& exceptions) {
+    // Four interleaved histograms keep consecutive increments independent.
+    int part[4][33] = {};
+    size_t i = 0;
+    for(;i+4<=count;i+=4){
+        part[0][bitWidth(z[i])]++;
+        part[1][bitWidth(z[i + 1])]++;
+        part[2][bitWidth(z[i + 2])]++;
+        part[3][bitWidth(z[i + 3])]++;
+    }
+    for(;i<count;i++) part[0][bitWidth(z[i])]++;
+    int hist[33];
+    for(int b=0;b<33;b++) hist[b] = part[0][b] + part[1][b] + part[2][b] + part[3][b];
+    size_t best = 0;
+    int above = 0;
+    bits = 32;
+    exceptions = 0;
+    for(int b=32;b>=0;b--){
+        if(b < 32) above += hist[b + 1];
+        if(above > 255) break;
+        size_t bytes = (size_t)b * kFrameWords * 4 + (above ? align4(above) + above * 4 : 0);
+        if(b == 32 || bytes <= best) {
+            best = bytes;
+            bits = b;
+            exceptions = above;
+        }
+    }
+    return best;
+}
+
+// Encoded bytes of n zigzagged residuals, frame headers aside; each frame's
+// width and exception count go to widths (two bytes per frame).
+static size_t packedBytes(const uint32_t* z, size_t n, uint8_t* widths) {
+    size_t bytes = 0;
+    for(size_t f=0;f<n;f+=kTelemetryFrameValues, widths+=2){
+        int bits, exceptions;
+        bytes += frameWidth(z + f, std::min(n - f, (size_t)kTelemetryFrameValues), bits, exceptions);
+        widths[0] = (uint8_t)bits;
+        widths[1] = (uint8_t)exceptions;
+    }
+    return bytes;
+}
+
+size_t TelemetryEncoder::encode(const TelemetryColumn& col, const uint8_t* values, size_t rows, size_t width,
+                                uint8_t* dst) {
+    size_t n = rows * width;
+    for(std::vector<uint32_t>& r: residual) r.resize(n);
+    uint32_t* x = residual[0].data();
+    uint32_t* d1 = residual[1].data();
+    uint32_t* d2 = residual[2].data();
+    columnIntegers(col, values, n, x);
+    // Differences against the same lane one row back (zero before the first row).
+    for(size_t i=0;i<n;i++) d1[i] = x[i] - (i >= width ? x[i - width] : 0);
+    for(size_t i=0;i<n;i++) d2[i] = d1[i] - (i >= width ? d1[i - width] : 0);
+    for(size_t i=0;i<n;i++){
+        x[i] = zigzag(x[i]);
+        d1[i] = zigzag(d1[i]);
+        d2[i] = zigzag(d2[i]);
+    }
+    size_t frames = (n + kTelemetryFrameValues - 1) / kTelemetryFrameValues;
+    int order = 0;
+    size_t best = 0;
+    for(int o=0;o<3;o++){
+        widths[o].resize(frames * 2);
+        size_t bytes = packedBytes(residual[o].data(), n, widths[o].data());
+        if(o == 0 || bytes < best) { best = bytes; order = o; }
+    }
+
+    const uint32_t* z = residual[order].data();
+    const uint8_t* chosen = widths[order].data();
+    TelemetryCodecHeader* h = (TelemetryCodecHeader*)dst;
+    memset(h, 0, sizeof(*h));
+    h->values = (uint32_t)n;
+    h->order = (uint8_t)order;
+    uint8_t* bits = dst + sizeof(TelemetryCodecHeader);
+    uint8_t* exceptions = bits + align4(frames);
+    memset(bits, 0, 2 * align4(frames));
+    uint32_t* words = (uint32_t*)(exceptions + align4(frames));
+    // Frame words first, so the exception lists go after all of them.
+    uint32_t frame[kTelemetryFrameValues];
+    for(size_t f=0;f<frames;f++){
+        size_t first = f * kTelemetryFrameValues;
+        size_t count = std::min(n - first, (size_t)kTelemetryFrameValues);
+        int b = chosen[f * 2], e = chosen[f * 2 + 1];
+        bits[f] = (uint8_t)b;
+        exceptions[f] = (uint8_t)e;
+        uint32_t mask = b == 32 ? 0xffffffffu : (1u << b) - 1;
+        for(size_t i=0;i<count;i++) frame[i] = z[first + i] & mask;
+        memset(frame + count, 0, (kTelemetryFrameValues - count) * 4);
+        packFrame[b](frame, words);
+        words += b * kFrameWords;
+    }
+    uint8_t* out = (uint8_t*)words;
+    for(size_t f=0;f<frames;f++){
+        if(!exceptions[f]) continue;
+        size_t first = f * kTelemetryFrameValues;
+        size_t count = std::min(n - first, (size_t)kTelemetryFrameValues);
+        int b = bits[f], e = exceptions[f];
+        uint8_t* index = out;
+        uint32_t* high = (uint32_t*)(out + align4(e));
+        memset(index, 0, align4(e));
+        int k = 0;
+        for(size_t i=0;i<count;i++){
+            if(b < 32 && (z[first + i] >> b)) {
+                index[k] = (uint8_t)i;
+                high[k++] = z[first + i] >> b;
+            }
+        }
+        out += align4(e) + e * 4;
+    }
+    h->bytes = (uint32_t)(out - dst);
+    return h->bytes;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Decoder
+//////////////////////////////////////////////////////////////////////////
+// Undoes zigzag and the row differences for one frame in place, lane by
+// lane; lane is the lane of t[0] and is advanced past the frame.
+static void integrateFrame(const CodecKernels& k, uint32_t* t, size_t count, int order, size_t width, size_t& lane,
+                           uint32_t* delta, uint32_t* value) {
+    if(order == 0) {
+        for(size_t i=0;i<count;i++) t[i] = unzigzag(t[i]);
+    } else if(width == 1) {
+        // One lane: a serial prefix sum.
+        uint32_t d = delta[0], x = value[0];
+        if(order == 1) {
+            for(size_t i=0;i<count;i++) t[i] = x += unzigzag(t[i]);
+        } else {
+            for(size_t i=0;i<count;i++) t[i] = x += d += unzigzag(t[i]);
+        }
+        delta[0] = d;
+        value[0] = x;
+    } else {
+        // Runs of consecutive lanes vectorize across the row.
+        for(size_t i=0;i<count;){
+            size_t run = std::min(width - lane, count - i);
+            if(order == 1) k.integrate1(t + i, value + lane, run);
+            else k.integrate2(t + i, value + lane, delta + lane, run);
+            i += run;
+            lane += run;
+            if(lane == width) lane = 0;
+        }
+        return;
+    }
+    lane = (lane + count) % width;
+}
+
+bool TelemetryDecoder::decode(const TelemetryColumn& col, const uint8_t* src, size_t srcBytes, size_t rows,
+                              size_t width, uint8_t* out) {
+    if(srcBytes < sizeof(TelemetryCodecHeader)) return false;
+    const TelemetryCodecHeader* h = (const TelemetryCodecHeader*)src;
+    size_t n = rows * width;
+    size_t frames = (n + kTelemetryFrameValues - 1) / kTelemetryFrameValues;
+    if(h->values != n || h->order > 2 || h->bytes > srcBytes || width == 0) return false;
+    const uint8_t* bits = src + sizeof(TelemetryCodecHeader);
+    const uint8_t* exceptions = bits + align4(frames);
+    if(sizeof(TelemetryCodecHeader) + 2 * align4(frames) > h->bytes) return false;
+    const uint32_t* words = (const uint32_t*)(exceptions + align4(frames));
+    size_t dataBytes = 0;
+    for(size_t f=0;f<frames;f++){
+        // Full-width frames never carry exceptions, and high << 32 is undefined.
+        if(bits[f] > 32 || (bits[f] == 32 && exceptions[f])) return false;
+        dataBytes += (size_t)bits[f] * kFrameWords * 4;
+        if(exceptions[f]) dataBytes += align4(exceptions[f]) + exceptions[f] * 4;
+    }
+    if(sizeof(TelemetryCodecHeader) + 2 * align4(frames) + dataBytes != h->bytes) return false;
+    const uint8_t* patches = (const uint8_t*)words;
+    for(size_t f=0;f<frames;f++) patches += (size_t)bits[f] * kFrameWords * 4;
+
+    delta.assign(width, 0);
+    value.assign(width, 0);
+    const CodecKernels& k = codecKernels();
+    bool u8 = col.type == (uint8_t)TelemetryType::U8;
+    float quantum = col.quantum;
+    alignas(32) uint32_t t[kTelemetryFrameValues];
+    size_t lane = 0;
+    for(size_t f=0;f<frames;f++){
+        size_t first = f * kTelemetryFrameValues;
+        size_t count = std::min(n - first, (size_t)kTelemetryFrameValues);
+        k.unpack[bits[f]](words, t);
+        words += bits[f] * kFrameWords;
+        if(int e = exceptions[f]) {
+            const uint8_t* index = patches;
+            const uint32_t* high = (const uint32_t*)(patches + align4(e));
+            for(int j=0;j<e;j++) t[index[j]] |= high[j] << bits[f];
+            patches += align4(e) + e * 4;
+        }
+        integrateFrame(k, t, count, h->order, width, lane, delta.data(), value.data());
+        if(u8) {
+            for(size_t i=0;i<count;i++) out[first + i] = (uint8_t)t[i];
+        } else if(quantum > 0.0f) {
+            k.dequantize(t, (float*)out + first, count, quantum);
+        } else {
+            memcpy(out + first * 4, t, count * 4);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+// telemetry_codec.h
+// Column compression for telemetry blocks and log chunks. Crank angle, speed
+// and piston position are smooth, so each value is predicted from the same
+// lane (engine or cylinder) one or two rows back and only the residual is
+// stored:
+//
+//   x      the value as an integer: float bits (lossless), round(v / quantum)
+//          (quantized, |error| <= quantum / 2), or the byte (U8)
+//   order  0 raw x, 1 delta x[r] - x[r-1], 2 delta of delta; chosen per
+//          column per block as whichever packs smallest
+//
+// Residuals are zigzag-mapped and bit-packed in frames of 256 values with one
+// bit width per frame; the few values wider than that (the crank angle
+// wrapping at 720, a combustion edge) are patched in afterwards from an
+// exception list instead of widening the frame. A frame stores 8 interleaved lanes of 32 values
+// (value v in lane v % 8), so a decoder unpacks 8 values per 256-bit vector
+// with constant shifts; the AVX2 and NEON unpackers and the scalar fallback
+// read the same bytes.
+//
+// Encoded column (little-endian):
+//   TelemetryCodecHeader
+//   uint8_t  frameBits[frames], zero-padded to 4 bytes
+//   uint8_t  frameExceptions[frames], zero-padded to 4 bytes
+//   uint32_t frame data: frameBits[f] * 8 words per frame
+//   per frame with exceptions e > 0: uint8_t index[e] zero-padded to 4
+//   bytes, then uint32_t high[e], the bits above frameBits[f]
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TelemetryColumn;   // telemetry_stream.h
+
+struct TelemetryCodecHeader {
+    uint32_t bytes;             // encoded size including this header, multiple of 4
+    uint32_t values;            // rows * width
+    uint8_t order;              // 0, 1 or 2
+    uint8_t reserved[7];
+};
+
+static_assert(sizeof(TelemetryCodecHeader) == 16, "TelemetryCodecHeader is a file format");
+
+const int kTelemetryFrameValues = 256;
+
+enum class CodecIsa { Scalar, AVX2, NEON };
+
+// Worst-case encoded size of n values.
+size_t telemetryEncodedBound(size_t values);
+
+// Encodes rows x width values of col laid out as in a block
+// (values[rows][width]). Scratch is kept between calls.
+class TelemetryEncoder {
+public:
+    // Writes at most telemetryEncodedBound(rows * width) bytes to dst and
+    // returns the count.
+    size_t encode(const TelemetryColumn& col, const uint8_t* values, size_t rows, size_t width, uint8_t* dst);
+
+private:
+    std::vector<uint32_t> residual[3];
+    std::vector<uint8_t> widths[3];     // per frame: bit width, exceptions
+};
+
+class TelemetryDecoder {
+public:
+    // Decodes into rows x width values of col; false if src is malformed or
+    // does not hold exactly rows x width values.
+    bool decode(const TelemetryColumn& col, const uint8_t* src, size_t srcBytes, size_t rows, size_t width,
+                uint8_t* out);
+
+private:
+    std::vector<uint32_t> delta, value;
+};
+
+// Frame unpacker in use (detected on first call) and overrides for the
+// benchmark's scalar / SIMD comparison.
+CodecIsa codecIsa();
+bool codecIsaSupported(CodecIsa isa);
+void forceCodecIsa(CodecIsa isa);
+const char* codecIsaName(CodecIsa isa);
@@ -0,0 +1,277 @@
+// telemetry_log.cpp
+// Chunked, memory-mapped telemetry log (see telemetry_log.h).
+
+#include "telemetry_log.h"
+#include <algorithm>
+#include <cstring>
+
+static const char kLogMagic[8] = { 'E', 'N', 'G', 'T', 'L', 'O', 'G', 0 };
+
+static uint64_t alignUp(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+// Start of column data in a chunk: after the header, ranges and column table.
+static uint64_t chunkDataStart(size_t columns) {
+    return alignUp(sizeof(TelemetryChunkHeader) + columns * (sizeof(TelemetryRange) + sizeof(TelemetryChunkColumn)), 64);
+}
+
+static size_t columnValues(const TelemetryColumn& c, size_t rowBytes) {
+    return c.type == (uint8_t)TelemetryType::U8 ? rowBytes : rowBytes / 4;
+}
+
+void telemetryChunkLayout(const TelemetryLogHeader& h, const std::vector<TelemetryColumn>& columns,
+                          std::vector<uint64_t>& columnOffsets, uint64_t& chunkBytes) {
+    uint64_t at = chunkDataStart(columns.size());
+    columnOffsets.clear();
+    for(const TelemetryColumn& c: columns){
+        columnOffsets.push_back(at);
+        at = alignUp(at + (uint64_t)telemetryRowBytes(c, (int)h.engines, (int)h.cylinders) * h.chunkRows, 64);
+    }
+    chunkBytes = alignUp(at, MappedFileWriter::kMappingGranularity);
+}
+
+// Min / max over n values of one column.
+static TelemetryRange columnRange(const TelemetryColumn& c, const uint8_t* data, size_t n) {
+    TelemetryRange r = { 0.0f, 0.0f };
+    if(n == 0) return r;
+    if(c.type == (uint8_t)TelemetryType::U8) {
+        uint8_t lo = 255, hi = 0;
+        for(size_t i=0;i<n;i++){
+            lo = std::min(lo, data[i]);
+            hi = std::max(hi, data[i]);
+        }
+        r.min = lo;
+        r.max = hi;
+        return r;
+    }
+    const float* v = (const float*)data;
+    float lo = v[0], hi = v[0];
+    for(size_t i=0;i<n;i++){
+        lo = std::min(lo, v[i]);
+        hi = std::max(hi, v[i]);
+    }
+    r.min = lo;
+    r.max = hi;
+    return r;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Writer
+//////////////////////////////////////////////////////////////////////////
+TelemetryLogWriter::~TelemetryLogWriter() {
+    close();
+}
+
+bool TelemetryLogWriter::open(const std::string& path, const TelemetryHeader& header,
+                              const std::vector<TelemetryColumn>& columns, int chunkRows, std::string& error) {
+    close();
+    size_t headerBytes = sizeof(TelemetryLogHeader) + columns.size() * sizeof(TelemetryColumn);
+    uint64_t dataOffset = alignUp(headerBytes, MappedFileWriter::kMappingGranularity);
+    if(!file.create(path) || !(head = (TelemetryLogHeader*)file.map(0, (size_t)dataOffset))) {
+        error = "cannot write " + path;
+        file.close();
+        return false;
+    }
+    memset(head, 0, (size_t)dataOffset);
+    memcpy(head->magic, kLogMagic, sizeof(kLogMagic));
+    head->version = kTelemetryLogVersion;
+    head->engines = header.engines;
+    head->cylinders = header.cylinders;
+    head->columnCount = (uint32_t)columns.size();
+    head->sampleHz = header.sampleHz;
+    memcpy(head->engineName, header.engineName, sizeof(head->engineName));
+    head->chunkRows = (uint32_t)std::max(chunkRows, 1);
+    head->dataOffset = dataOffset;
+    head->dataEnd = dataOffset;
+    if(!columns.empty()) memcpy(head + 1, columns.data(), columns.size() * sizeof(TelemetryColumn));
+    cols = columns;
+    telemetryChunkLayout(*head, cols, offsets, head->chunkBytes);
+    rowBytes.clear();
+    compressed = false;
+    chunkBound = chunkDataStart(cols.size());
+    for(const TelemetryColumn& c: cols){
+        rowBytes.push_back(telemetryRowBytes(c, (int)head->engines, (int)head->cylinders));
+        compressed = compressed || c.codec == (uint8_t)TelemetryCodec::Delta;
+        chunkBound += alignUp(telemetryEncodedBound(columnValues(c, rowBytes.back()) * head->chunkRows), 64);
+    }
+    if(compressed) scratch.assign((size_t)head->chunkBytes, 0);
+    else chunkBound = head->chunkBytes;
+    rows = 0;
+    written = 0;
+    if(!mapChunk()) {
+        error = "cannot grow " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TelemetryLogWriter::mapChunk() {
+    // Compressed chunks start wherever the last one ended; map from the
+    // granularity boundary below.
+    uint64_t at = head->dataEnd;
+    uint64_t base = at / MappedFileWriter::kMappingGranularity * MappedFileWriter::kMappingGranularity;
+    viewBytes = (size_t)(at - base + chunkBound);
+    view = file.map(base, viewBytes);
+    if(!view) return false;
+    chunk = view + (at - base);
+    fill = compressed ? scratch.data() : chunk;
+    return true;
+}
+
+bool TelemetryLogWriter::seal() {
+    TelemetryChunkHeader* ch = (TelemetryChunkHeader*)chunk;
+    ch->firstRow = head->rows;
+    ch->rows = (uint32_t)rows;
+    ch->timeFirst = head->rows / head->sampleHz;
+    ch->timeLast = (head->rows + rows - 1) / head->sampleHz;
+    TelemetryRange* ranges = (TelemetryRange*)(ch + 1);
+    TelemetryChunkColumn* entries = (TelemetryChunkColumn*)(ranges + cols.size());
+    uint64_t at = chunkDataStart(cols.size());
+    for(size_t c=0;c<cols.size();c++){
+        size_t values = columnValues(cols[c], rowBytes[c]);
+        ranges[c] = columnRange(cols[c], fill + offsets[c], values * rows);
+        if(!compressed) {
+            entries[c].offset = (uint32_t)offsets[c];
+            entries[c].bytes = (uint32_t)(rowBytes[c] * rows);
+            continue;
+        }
+        entries[c].offset = (uint32_t)at;
+        if(cols[c].codec == (uint8_t)TelemetryCodec::Delta) {
+            entries[c].bytes = (uint32_t)encoder.encode(cols[c], fill + offsets[c], rows, values, chunk + at);
+        } else {
+            entries[c].bytes = (uint32_t)(rowBytes[c] * rows);
+            memcpy(chunk + at, fill + offsets[c], entries[c].bytes);
+        }
+        at = alignUp(at + entries[c].bytes, 64);
+    }
+    uint64_t bytes = compressed ? at : head->chunkBytes;
+    ch->bytes = bytes;
+    file.unmap(view, viewBytes);
+    view = chunk = fill = nullptr;
+    // Publish only after the chunk is complete.
+    head->rows += rows;
+    head->dataEnd += bytes;
+    head->chunkCount++;
+    rows = 0;
+    return true;
+}
+
+bool TelemetryLogWriter::endRows(int n) {
+    rows += n;
+    if(rows < (int)head->chunkRows) return true;
+    return seal() && mapChunk();
+}
+
+bool TelemetryLogWriter::close() {
+    if(!head) return true;
+    bool ok = true;
+    if(view && rows > 0) ok = seal();
+    if(view) file.unmap(view, viewBytes);
+    view = chunk = fill = nullptr;
+    // Drop the room mapped ahead of the data.
+    uint64_t end = head->dataEnd;
+    written = end;
+    file.unmap((uint8_t*)head, (size_t)head->dataOffset);
+    head = nullptr;
+    ok = file.truncate(end) && ok;
+    ok = file.close() && ok;
+    return ok;
+}
+
+uint64_t TelemetryLogWriter::bytesWritten() const {
+    return head ? head->dataEnd : written;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Reader
+//////////////////////////////////////////////////////////////////////////
+bool TelemetryLog::open(const std::string& path, std::string& error) {
+    close();
+    if(!file.open(path)) {
+        error = "cannot map " + path;
+        return false;
+    }
+    const TelemetryLogHeader* h = (const TelemetryLogHeader*)file.data();
+    const char* why = nullptr;
+    if(file.size() < sizeof(TelemetryLogHeader) || memcmp(h->magic, kLogMagic, sizeof(kLogMagic)) != 0)
+        why = "not a telemetry log";
+    else if(h->version != kTelemetryLogVersion) why = "unsupported telemetry log version";
+    else if(h->dataOffset < sizeof(TelemetryLogHeader) + (uint64_t)h->columnCount * sizeof(TelemetryColumn))
+        why = "bad header";
+    if(!why) {
+        cols.assign((const TelemetryColumn*)(h + 1), (const TelemetryColumn*)(h + 1) + h->columnCount);
+        uint64_t chunkBytes = 0;
+        telemetryChunkLayout(*h, cols, offsets, chunkBytes);
+        if(chunkBytes != h->chunkBytes) why = "chunk layout does not match its columns";
+        else if(h->dataEnd > file.size()) why = "truncated";
+    }
+    // Chunk offsets, from each chunk's size.
+    uint64_t at = why ? 0 : h->dataOffset;
+    for(uint64_t i=0;!why && i<h->chunkCount;i++){
+        if(at + chunkDataStart(cols.size()) > h->dataEnd) {
+            why = "truncated";
+            break;
+        }
+        chunkOffsets.push_back(at);
+        uint64_t bytes = ((const TelemetryChunkHeader*)(file.data() + at))->bytes;
+        if(bytes == 0 || bytes % 64 != 0) why = "bad chunk size";
+        at += bytes;
+    }
+    if(!why && at != h->dataEnd) why = "chunk sizes do not match the header";
+    if(why) {
+        error = path + ": " + why;
+        close();
+        return false;
+    }
+    head = h;
+    return true;
+}
+
+void TelemetryLog::close() {
+    file.close();
+    head = nullptr;
+    cols.clear();
+    offsets.clear();
+    chunkOffsets.clear();
+}
+
+bool TelemetryLog::readColumn(uint64_t i, int c, uint8_t* out) {
+    const TelemetryChunkColumn& e = columnEntry(i, c);
+    uint32_t rows = chunk(i).rows;
+    size_t rowBytes = telemetryRowBytes(cols[c], (int)head->engines, (int)head->cylinders);
+    if(i + 1 < chunkOffsets.size() ? chunkOffsets[i] + e.offset + e.bytes > chunkOffsets[i + 1]
+                                   : chunkOffsets[i] + e.offset + e.bytes > head->dataEnd)
+        return false;
+    if(cols[c].codec == (uint8_t)TelemetryCodec::Delta)
+        return decoder.decode(cols[c], column(i, c), e.bytes, rows, columnValues(cols[c], rowBytes), out);
+    if(e.bytes != rowBytes * rows) return false;
+    memcpy(out, column(i, c), e.bytes);
+    return true;
+}
+
+int TelemetryLog::findColumn(const char* name) const {
+    for(size_t i=0;i<cols.size();i++)
+        if(strncmp(cols[i].name, name, sizeof(cols[i].name)) == 0) return (int)i;
+    return -1;
+}
+
+void TelemetryLog::chunksInTime(double t0, double t1, uint64_t& first, uint64_t& last) const {
+    // Chunks are in time order: first chunk ending at or after t0, first
+    // starting after t1.
+    uint64_t lo = 0, hi = chunkCount();
+    while(lo < hi) {
+        uint64_t mid = (lo + hi) / 2;
+        if(chunk(mid).timeLast < t0) lo = mid + 1;
+        else hi = mid;
+    }
+    first = lo;
+    hi = chunkCount();
+    while(lo < hi) {
+        uint64_t mid = (lo + hi) / 2;
+        if(chunk(mid).timeFirst <= t1) lo = mid + 1;
+        else hi = mid;
+    }
+    last = lo;
+}
@@ -0,0 +1,165 @@
+// telemetry_log.h
+// Append-only, chunked, columnar telemetry log, written and read through
+// memory mappings so neither side copies rows through stdio buffers.
+// Same columns as the stream format (telemetry_stream.h), but laid out for
+// random access into logs of tens of GB:
+//
+//   [0, dataOffset)         TelemetryLogHeader, TelemetryColumn[columnCount]
+//   chunks back to back from dataOffset, each 64-byte aligned:
+//     TelemetryChunkHeader
+//     TelemetryRange[columnCount]       min / max of every column in the chunk
+//     TelemetryChunkColumn[columnCount] where each column's data sits
+//     column data: values[rows][width], the row layout of the stream
+//     format, or the column encoded as in telemetry_codec.h when its codec
+//     is Delta
+//
+// Chunks hold chunkRows consecutive samples each, so sample n is in chunk
+// n / chunkRows. Without compressed columns every chunk is chunkBytes long
+// and its columns sit at the telemetryChunkLayout() offsets; compressed
+// chunks are as long as their data. Chunk time spans and value ranges are an
+// index: a reader finds the chunks covering a time window by binary search,
+// and skips chunks whose range cannot match a value query, without touching
+// their data pages.
+//
+// The writer maps the header and one chunk at a time, growing the file a
+// chunk ahead. Raw chunks are filled in place; compressed ones are filled in
+// memory and encoded into the mapping when full. Only after a chunk is
+// complete, ranges included, is the header's chunk count bumped, so a reader
+// (or a crash) sees whole chunks.
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+#include "telemetry_stream.h"
+
+const uint32_t kTelemetryLogVersion = 2;   // 1: fixed-size raw chunks only
+
+struct TelemetryLogHeader {
+    char magic[8];              // "ENGTLOG" + NUL
+    uint32_t version;
+    uint32_t engines;
+    uint32_t cylinders;
+    uint32_t columnCount;
+    double sampleHz;
+    char engineName[32];
+    uint32_t chunkRows;
+    uint32_t reserved0;
+    uint64_t chunkBytes;        // multiple of MappedFileWriter::kMappingGranularity
+    uint64_t dataOffset;
+    uint64_t chunkCount;        // complete chunks, including a final partial one
+    uint64_t rows;              // samples in those chunks
+    uint64_t dataEnd;           // end of the last complete chunk
+    uint64_t reserved[3];
+};
+
+struct TelemetryChunkHeader {
+    uint64_t firstRow;
+    uint32_t rows;
+    uint32_t reserved;
+    double timeFirst, timeLast; // seconds of the first and last row
+    uint64_t bytes;             // whole chunk, multiple of 64
+    uint64_t reserved2;
+};
+
+struct TelemetryChunkColumn {
+    uint32_t offset;            // from the chunk header
+    uint32_t bytes;
+};
+
+struct TelemetryRange {
+    float min, max;             // over every value of the column in the chunk
+};
+
+static_assert(sizeof(TelemetryLogHeader) == 136, "TelemetryLogHeader is a file format");
+static_assert(sizeof(TelemetryChunkHeader) == 48, "TelemetryChunkHeader is a file format");
+
+// Byte offsets of each column within an uncompressed chunk (64-byte aligned)
+// and that chunk's size, both sides computing the same layout from the header.
+void telemetryChunkLayout(const TelemetryLogHeader& h, const std::vector<TelemetryColumn>& columns,
+                          std::vector<uint64_t>& columnOffsets, uint64_t& chunkBytes);
+
+class TelemetryLogWriter : public TelemetrySink {
+public:
+    TelemetryLogWriter() {}
+    ~TelemetryLogWriter() override;
+
+    // chunkRows is also blockSamples(): callers fill one chunk per block.
+    // Columns with codec Delta are compressed chunk by chunk.
+    bool open(const std::string& path, const TelemetryHeader& header, const std::vector<TelemetryColumn>& columns,
+              int chunkRows, std::string& error);
+    bool close() override;
+
+    int blockSamples() const override { return (int)head->chunkRows; }
+    int pendingRows() const override { return rows; }
+    uint8_t* column(int i, int r = 0) override { return fill + offsets[i] + (size_t)(rows + r) * rowBytes[i]; }
+    // Seals the chunk once full and maps the next.
+    bool endRows(int n) override;
+    uint64_t bytesWritten() const override;
+
+private:
+    bool seal();
+    bool mapChunk();
+
+    MappedFileWriter file;
+    TelemetryLogHeader* head = nullptr;
+    uint8_t* view = nullptr;        // mapping holding the chunk being filled
+    size_t viewBytes = 0;
+    uint8_t* chunk = nullptr;       // its start within view
+    uint8_t* fill = nullptr;        // where rows go: chunk, or scratch when compressing
+    bool compressed = false;
+    uint64_t chunkBound = 0;        // room mapped per chunk
+    std::vector<uint8_t> scratch;
+    TelemetryEncoder encoder;
+    std::vector<TelemetryColumn> cols;
+    std::vector<uint64_t> offsets;
+    std::vector<size_t> rowBytes;
+    int rows = 0;
+    uint64_t written = 0;       // file size once closed
+};
+
+class TelemetryLog {
+public:
+    // Maps path read-only; sees the chunks committed when it was opened.
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const TelemetryLogHeader& header() const { return *head; }
+    const std::vector<TelemetryColumn>& columns() const { return cols; }
+    int findColumn(const char* name) const;
+
+    uint64_t chunkCount() const { return head ? head->chunkCount : 0; }
+    const TelemetryChunkHeader& chunk(uint64_t i) const {
+        return *(const TelemetryChunkHeader*)(chunkBase(i));
+    }
+    const TelemetryRange& range(uint64_t i, int column) const {
+        return ((const TelemetryRange*)(chunkBase(i) + sizeof(TelemetryChunkHeader)))[column];
+    }
+    const TelemetryChunkColumn& columnEntry(uint64_t i, int column) const {
+        return ((const TelemetryChunkColumn*)(chunkBase(i) + sizeof(TelemetryChunkHeader) +
+                                              cols.size() * sizeof(TelemetryRange)))[column];
+    }
+    // Stored bytes of a column in chunk i: values for raw columns, encoded
+    // otherwise.
+    const uint8_t* column(uint64_t i, int column) const { return chunkBase(i) + columnEntry(i, column).offset; }
+    // Values of column in chunk i (rows x width), decoded if compressed.
+    bool readColumn(uint64_t i, int column, uint8_t* out);
+
+    // Chunks [first, last) holding samples with time in [t0, t1].
+    void chunksInTime(double t0, double t1, uint64_t& first, uint64_t& last) const;
+    // False when no value of column in chunk i can lie in [lo, hi].
+    bool mayContain(uint64_t i, int column, float lo, float hi) const {
+        const TelemetryRange& r = range(i, column);
+        return r.max >= lo && r.min <= hi;
+    }
+
+private:
+    const uint8_t* chunkBase(uint64_t i) const { return file.data() + chunkOffsets[i]; }
+
+    MappedFile file;
+    const TelemetryLogHeader* head = nullptr;
+    std::vector<TelemetryColumn> cols;
+    std::vector<uint64_t> offsets, chunkOffsets;
+    TelemetryDecoder decoder;
+};
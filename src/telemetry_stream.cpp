@@ -0,0 +1,231 @@
+// telemetry_stream.cpp
+// Columnar telemetry stream writer and reader (see telemetry_stream.h).
+
+#include "telemetry_stream.h"
+#include <algorithm>
+#include <cstring>
+
+static const char kTelemetryMagic[8] = { 'E', 'N', 'G', 'T', 'L', 'M', 0, 0 };
+
+static size_t align8(size_t v) {
+    return (v + 7) & ~(size_t)7;
+}
+
+size_t telemetryRowBytes(const TelemetryColumn& col, int engines, int cylinders) {
+    size_t width = (size_t)engines * (col.scope == (uint8_t)TelemetryScope::Cylinder ? cylinders : 1);
+    return width * (col.type == (uint8_t)TelemetryType::U8 ? 1 : 4);
+}
+
+// Values in rowBytes of col.
+static size_t columnValues(const TelemetryColumn& col, size_t rowBytes) {
+    return col.type == (uint8_t)TelemetryType::U8 ? rowBytes : rowBytes / 4;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Writer
+//////////////////////////////////////////////////////////////////////////
+TelemetryWriter::~TelemetryWriter() {
+    close();
+}
+
+bool TelemetryWriter::open(const std::string& path, const TelemetryHeader& header,
+                           const std::vector<TelemetryColumn>& columns, int blockSamples, std::string& error) {
+    close();
+    if(path == "-") {
+        f = stdout;
+        ownsFile = false;
+    } else {
+        f = fopen(path.c_str(), "wb");
+        ownsFile = true;
+        if(!f) {
+            error = "cannot write " + path;
+            return false;
+        }
+    }
+    setvbuf(f, nullptr, _IOFBF, 1 << 20);
+
+    TelemetryHeader h = header;
+    memcpy(h.magic, kTelemetryMagic, sizeof(h.magic));
+    h.version = kTelemetryVersion;
+    h.columnCount = (uint32_t)columns.size();
+    blockCap = blockSamples > 0 ? blockSamples : 1;
+    cols = columns;
+    rows = 0;
+    nextSample = 0;
+    rowBytes.clear();
+    offsets.clear();
+    size_t total = 0;
+    for(const TelemetryColumn& c: columns){
+        rowBytes.push_back(telemetryRowBytes(c, (int)h.engines, (int)h.cylinders));
+        offsets.push_back(total);
+        total += align8(rowBytes.back() * blockCap);
+    }
+    buffer.assign(total, 0);
+    // Compressed columns are encoded into their own slots before a block is written.
+    size_t bound = 0;
+    encodedOffsets.clear();
+    for(size_t i=0;i<cols.size();i++){
+        encodedOffsets.push_back(bound);
+        if(cols[i].codec == (uint8_t)TelemetryCodec::Delta)
+            bound += align8(telemetryEncodedBound(columnValues(cols[i], rowBytes[i]) * blockCap));
+    }
+    encoded.assign(bound, 0);
+    colData.assign(cols.size(), nullptr);
+    colBytes.assign(cols.size(), 0);
+
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(!columns.empty()) ok = ok && fwrite(columns.data(), sizeof(TelemetryColumn), columns.size(), f) == columns.size();
+    written = sizeof(h) + columns.size() * sizeof(TelemetryColumn);
+    if(!ok) error = "error writing " + path;
+    return ok;
+}
+
+bool TelemetryWriter::endRows(int n) {
+    rows += n;
+    return rows < blockCap || flush();
+}
+
+bool TelemetryWriter::flush() {
+    if(!f || rows == 0) return true;
+    static const uint8_t zeros[8] = {};
+    TelemetryBlockHeader b;
+    b.magic = kTelemetryBlockMagic;
+    b.samples = (uint32_t)rows;
+    b.firstSample = nextSample;
+    b.bytes = 0;
+    for(size_t i=0;i<cols.size();i++){
+        if(cols[i].codec == (uint8_t)TelemetryCodec::Delta) {
+            uint8_t* dst = encoded.data() + encodedOffsets[i];
+            colBytes[i] = encoder.encode(cols[i], buffer.data() + offsets[i], rows, columnValues(cols[i], rowBytes[i]), dst);
+            colData[i] = dst;
+        } else {
+            colBytes[i] = rowBytes[i] * rows;
+            colData[i] = buffer.data() + offsets[i];
+        }
+        b.bytes += align8(colBytes[i]);
+    }
+    bool ok = fwrite(&b, sizeof(b), 1, f) == 1;
+    for(size_t i=0;i<cols.size();i++){
+        size_t pad = align8(colBytes[i]) - colBytes[i];
+        ok = ok && fwrite(colData[i], 1, colBytes[i], f) == colBytes[i];
+        ok = ok && fwrite(zeros, 1, pad, f) == pad;
+    }
+    written += sizeof(b) + b.bytes;
+    nextSample += rows;
+    rows = 0;
+    return ok;
+}
+
+bool TelemetryWriter::close() {
+    if(!f) return true;
+    bool ok = flush();
+    ok = fflush(f) == 0 && ok;
+    if(ownsFile) ok = fclose(f) == 0 && ok;
+    f = nullptr;
+    return ok;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Reader
+//////////////////////////////////////////////////////////////////////////
+TelemetryReader::~TelemetryReader() {
+    close();
+}
+
+void TelemetryReader::close() {
+    if(f && f != stdin) fclose(f);
+    f = nullptr;
+}
+
+bool TelemetryReader::open(const std::string& path, std::string& error) {
+    close();
+    f = path == "-" ? stdin : fopen(path.c_str(), "rb");
+    if(!f) {
+        error = "cannot read " + path;
+        return false;
+    }
+    if(fread(&head, sizeof(head), 1, f) != 1 || memcmp(head.magic, kTelemetryMagic, sizeof(head.magic)) != 0) {
+        error = path + ": not a telemetry stream";
+        return false;
+    }
+    if(head.version < 1 || head.version > kTelemetryVersion) {
+        error = path + ": unsupported telemetry version";
+        return false;
+    }
+    cols.resize(head.columnCount);
+    if(head.columnCount && fread(cols.data(), sizeof(TelemetryColumn), cols.size(), f) != cols.size()) {
+        error = path + ": truncated header";
+        return false;
+    }
+    return true;
+}
+
+int TelemetryReader::findColumn(const char* name) const {
+    for(size_t i=0;i<cols.size();i++)
+        if(strncmp(cols[i].name, name, sizeof(cols[i].name)) == 0) return (int)i;
+    return -1;
+}
+
+bool TelemetryReader::nextBlock(std::string& error) {
+    if(!f) return false;
+    if(fread(&blk, sizeof(blk), 1, f) != 1) return false;
+    if(blk.magic != kTelemetryBlockMagic) {
+        error = "bad block marker";
+        return false;
+    }
+    offsets.clear();
+    size_t total = 0;
+    bool compressed = false;
+    for(const TelemetryColumn& c: cols){
+        offsets.push_back(total);
+        total += align8(telemetryRowBytes(c, (int)head.engines, (int)head.cylinders) * blk.samples);
+        compressed = compressed || c.codec == (uint8_t)TelemetryCodec::Delta;
+    }
+    if(!compressed) {
+        if(total != blk.bytes) {
+            error = "block size does not match its columns";
+            return false;
+        }
+        data.resize(total);
+        if(total && fread(data.data(), 1, total, f) != total) {
+            error = "truncated block";
+            return false;
+        }
+        return true;
+    }
+
+    // Compressed columns are decoded into the same layout as raw blocks.
+    encoded.resize(blk.bytes);
+    if(blk.bytes && fread(encoded.data(), 1, blk.bytes, f) != blk.bytes) {
+        error = "truncated block";
+        return false;
+    }
+    data.resize(total);
+    size_t at = 0;
+    for(size_t i=0;i<cols.size();i++){
+        size_t rowBytes = telemetryRowBytes(cols[i], (int)head.engines, (int)head.cylinders);
+        size_t bytes = rowBytes * blk.samples;
+        if(cols[i].codec == (uint8_t)TelemetryCodec::Delta) {
+            if(at + sizeof(TelemetryCodecHeader) > encoded.size()) bytes = 0;
+            else bytes = ((const TelemetryCodecHeader*)(encoded.data() + at))->bytes;
+            if(!bytes || at + bytes > encoded.size() ||
+               !decoder.decode(cols[i], encoded.data() + at, bytes, blk.samples, columnValues(cols[i], rowBytes),
+                               data.data() + offsets[i])) {
+                error = "bad compressed column";
+                return false;
+            }
+        } else {
+            if(at + bytes > encoded.size()) {
+                error = "block size does not match its columns";
+                return false;
+            }
+            memcpy(data.data() + offsets[i], encoded.data() + at, bytes);
+        }
+        at += align8(bytes);
+    }
+    if(at != blk.bytes) {
+        error = "block size does not match its columns";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,154 @@
+// telemetry_stream.h
+// Columnar binary telemetry for engine fleets, written as a forward-only
+// stream (a file or a pipe). A header names the columns; the body is a
+// sequence of blocks, each holding a run of consecutive samples with every
+// column stored contiguously, so a reader that wants one signal skips the
+// others with a seek instead of parsing them.
+//
+// Layout (little-endian):
+//   TelemetryHeader
+//   TelemetryColumn[columnCount]
+//   repeated until end of stream:
+//     TelemetryBlockHeader
+//     for each column: values[samples][width], or the column encoded as in
+//       telemetry_codec.h when its codec is Delta, zero-padded to 8 bytes
+// width is the engine count for per-engine columns and cylinders x engines
+// for per-cylinder ones, cylinder-major as in EngineBatch rows: value
+// (sample s, cylinder c, engine e) is at (s * cylinders + c) * engines + e.
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "telemetry_codec.h"
+
+const uint32_t kTelemetryVersion = 2;   // 1: no column codecs
+
+enum class TelemetryType : uint8_t { F32, U8 };
+enum class TelemetryScope : uint8_t { Engine, Cylinder };
+enum class TelemetryCodec : uint8_t { None, Delta };
+
+struct TelemetryHeader {
+    char magic[8];              // "ENGTLM" + 2 NUL
+    uint32_t version;
+    uint32_t engines;
+    uint32_t cylinders;
+    uint32_t columnCount;
+    double sampleHz;            // samples per simulated second
+    char engineName[32];
+    uint64_t reserved[2];
+};
+
+struct TelemetryColumn {
+    char name[24];              // NUL-padded, unit suffixed: crank_angle_deg
+    uint8_t type;               // TelemetryType
+    uint8_t scope;              // TelemetryScope
+    uint8_t codec;              // TelemetryCodec
+    uint8_t reserved;
+    float quantum;              // Delta on F32: 0 lossless, else stored as multiples of quantum
+};
+
+struct TelemetryBlockHeader {
+    uint32_t magic;             // kTelemetryBlockMagic
+    uint32_t samples;
+    uint64_t firstSample;       // sample index of the block's first row
+    uint64_t bytes;             // column data following this header
+};
+
+const uint32_t kTelemetryBlockMagic = 0x4b4c4254u;   // "TBLK"
+
+static_assert(sizeof(TelemetryHeader) == 80, "TelemetryHeader is a file format");
+static_assert(sizeof(TelemetryColumn) == 32, "TelemetryColumn is a file format");
+static_assert(sizeof(TelemetryBlockHeader) == 24, "TelemetryBlockHeader is a file format");
+
+// Bytes of one sample row of a column, before block padding.
+size_t telemetryRowBytes(const TelemetryColumn& col, int engines, int cylinders);
+
+// Destination for telemetry rows: this stream or a mapped log
+// (telemetry_log.h). Rows are produced a block at a time: producers fill
+// rows in place through column() (any order, from any thread as long as
+// they touch disjoint ranges), then commit them with endRows().
+class TelemetrySink {
+public:
+    virtual ~TelemetrySink() {}
+    // Rows per block; a block is never split across endRows() calls.
+    virtual int blockSamples() const = 0;
+    // Rows committed to the current, unfinished block.
+    virtual int pendingRows() const = 0;
+    // Start of row (pendingRows() + r) of column i.
+    virtual uint8_t* column(int i, int r = 0) = 0;
+    // Commits n rows, at most blockSamples() - pendingRows().
+    virtual bool endRows(int n) = 0;
+    virtual bool close() = 0;
+    virtual uint64_t bytesWritten() const = 0;
+};
+
+// Accumulates up to blockSamples rows per column and writes whole blocks.
+class TelemetryWriter : public TelemetrySink {
+public:
+    TelemetryWriter() {}
+    ~TelemetryWriter() override;
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    // path "-" writes to stdout.
+    bool open(const std::string& path, const TelemetryHeader& header, const std::vector<TelemetryColumn>& columns,
+              int blockSamples, std::string& error);
+    bool close() override;
+
+    int blockSamples() const override { return blockCap; }
+    int pendingRows() const override { return rows; }
+    uint8_t* column(int i, int r = 0) override {
+        return buffer.data() + offsets[i] + (size_t)(rows + r) * rowBytes[i];
+    }
+    // Writes the block once full.
+    bool endRows(int n) override;
+    bool flush();
+
+    uint64_t bytesWritten() const override { return written; }
+    uint64_t samplesWritten() const { return nextSample; }
+
+private:
+    FILE* f = nullptr;
+    bool ownsFile = false;
+    int blockCap = 0, rows = 0;
+    std::vector<size_t> rowBytes, offsets;
+    std::vector<uint8_t> buffer;
+    std::vector<TelemetryColumn> cols;
+    std::vector<uint8_t> encoded;
+    std::vector<size_t> encodedOffsets, colBytes;
+    std::vector<const uint8_t*> colData;
+    TelemetryEncoder encoder;
+    uint64_t nextSample = 0, written = 0;
+};
+
+// Sequential reader for the same stream.
+class TelemetryReader {
+public:
+    TelemetryReader() {}
+    ~TelemetryReader();
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const TelemetryHeader& header() const { return head; }
+    const std::vector<TelemetryColumn>& columns() const { return cols; }
+    int findColumn(const char* name) const;
+
+    // Reads the next block; false at end of stream (error set if malformed).
+    bool nextBlock(std::string& error);
+    const TelemetryBlockHeader& block() const { return blk; }
+    const uint8_t* column(int i) const { return data.data() + offsets[i]; }
+
+private:
+    FILE* f = nullptr;
+    TelemetryHeader head = {};
+    std::vector<TelemetryColumn> cols;
+    TelemetryBlockHeader blk = {};
+    std::vector<uint8_t> data, encoded;
+    std::vector<size_t> offsets;
+    TelemetryDecoder decoder;
+};
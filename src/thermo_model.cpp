@@ -0,0 +1,167 @@
+// thermo_model.cpp
+// Single-zone cylinder model and fleet state (see thermo_model.h).
+
+#include "thermo_model.h"
+#include "crank_kinematics.h"
+#include "engine_batch.h"
+#include "engine_config.h"
+#include "sim_snapshot.h"
+#include <algorithm>
+#include <cmath>
+
+// MSVC does not always define M_PI — define manually if missing
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const double kIntakeCloseDeg = 180.0;
+
+ThermoSpec engineThermoSpec(const EngineConfig& cfg) {
+    ThermoSpec s;
+    s.bore = cfg.bore;
+    s.stroke = cfg.stroke;
+    s.rodLength = cfg.rodLength;
+    s.compressionRatio = cfg.compressionRatio;
+    return s;
+}
+
+// Wiebe mass fraction burned at cycle angle deg.
+static double wiebe(const ThermoSpec& s, double deg) {
+    double x = (deg - s.combustionStartDeg) / s.combustionDurationDeg;
+    if(x <= 0.0) return 0.0;
+    if(x >= 1.0) x = 1.0;
+    return 1.0 - exp(-s.wiebeA * pow(x, s.wiebeM + 1.0));
+}
+
+ThermoModel::ThermoModel(const ThermoSpec& spec) : sp(spec) {
+    if(sp.resolutionDeg <= 0.0) sp.resolutionDeg = 0.1;
+    n = (int)lround(720.0 / sp.resolutionDeg);
+    if(n < 720) n = 720;
+    double stepDeg = 720.0 / n;
+    res = (float)stepDeg;
+
+    double area = M_PI * 0.25 * sp.bore * sp.bore;
+    vd = area * sp.stroke;
+    double vc = vd / (sp.compressionRatio - 1.0);
+    SliderCrank crank = { (float)(sp.stroke * 0.5), (float)sp.rodLength };
+    const double toRad = M_PI / 180.0;
+
+    vol.resize(n + 1);
+    for(int k=0;k<=n;k++) vol[k] = vc + area * sliderCrankDisplacement(crank, k * stepDeg * toRad);
+
+    double blowKeep = exp(-5.0 * stepDeg / std::max(sp.blowdownDurationDeg, stepDeg));
+    double blowEnd = sp.exhaustOpenDeg + sp.blowdownDurationDeg;
+    table.resize(n);
+    for(int k=0;k<n;k++){
+        double deg = k * stepDeg;
+        ThermoStep& t = table[k];
+        t.dVolume = (float)(vol[k+1] - vol[k]);
+        t.torqueArm = (float)(area * sliderCrankVelocity(crank, deg * toRad));
+        t.heat = 0.0f;
+        if(deg < kIntakeCloseDeg) {
+            t.keep = 0.0f;
+            t.target = (float)sp.intakePressure;
+        } else if(deg < sp.exhaustOpenDeg) {
+            double poly = deg < 360.0 ? sp.polyCompression : sp.polyExpansion;
+            t.keep = (float)pow(vol[k] / vol[k+1], poly);
+            t.target = 0.0f;
+            double burned = wiebe(sp, deg + stepDeg) - wiebe(sp, deg);
+            t.heat = (float)((poly - 1.0) * burned / vol[k+1]);
+        } else if(deg < blowEnd) {
+            t.keep = (float)blowKeep;
+            t.target = (float)(sp.exhaustPressure * (1.0 - blowKeep));
+        } else {
+            t.keep = 0.0f;
+            t.target = (float)sp.exhaustPressure;
+        }
+    }
+
+    // Two passes so sample 0 holds what the end of the previous cycle left there.
+    p0.assign(n, 0.0f);
+    p1.assign(n, 0.0f);
+    double a = sp.exhaustPressure, b = 0.0;
+    for(int pass=0;pass<2;pass++){
+        for(int k=0;k<n;k++){
+            p0[k] = (float)a;
+            p1[k] = (float)b;
+            a = a * table[k].keep + table[k].target;
+            b = b * table[k].keep + table[k].heat;
+        }
+    }
+    // Trapezoidal p dV over the cycle, split the same way.
+    w0 = w1 = 0.0;
+    for(int k=0;k<n;k++){
+        int k1 = (k + 1) % n;
+        w0 += 0.5 * ((double)p0[k] + p0[k1]) * table[k].dVolume;
+        w1 += 0.5 * ((double)p1[k] + p1[k1]) * table[k].dVolume;
+    }
+}
+
+int ThermoModel::sampleIndex(float cycleAngleDeg) const {
+    int k = (int)(cycleAngleDeg * (1.0f / res));
+    return k < 0 ? 0 : (k >= n ? n - 1 : k);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// ThermoBatch
+//////////////////////////////////////////////////////////////////////////
+ThermoBatch::ThermoBatch(const ThermoModel& m, const EngineBatch& engines, float fuelJ) : model(m) {
+    engineCount = engines.size();
+    cylCount = engines.cylinders();
+    stride = engines.stride();
+    size_t cells = (size_t)cylCount * stride;
+    fuel.assign(stride, fuelJ);
+    torque.assign(stride, 0.0f);
+    pressure.assign(cells, 0.0f);
+    latchedFuel.assign(cells, fuelJ);
+    lastWork.assign(cells, (float)model.steadyWork(fuelJ));
+    sample.assign(cells, 0);
+    // Place every cylinder at its current sample without crossing IVC or the cycle end.
+    const float* angle = engines.crankAngles();
+    for(int c=0;c<cylCount;c++){
+        const float* ph = engines.phaseOffsets(c);
+        for(int e=0;e<stride;e++){
+            float a = angle[e] + ph[e];
+            a -= 720.0f * (float)(a >= 720.0f);
+            sample[(size_t)c * stride + e] = model.sampleIndex(a);
+        }
+    }
+    advance(engines);
+}
+
+void ThermoBatch::advance(const EngineBatch& engines) {
+    const int ivc = model.sampleIndex((float)kIntakeCloseDeg);
+    const float* angle = engines.crankAngles();
+    std::fill(torque.begin(), torque.end(), 0.0f);
+    for(int c=0;c<cylCount;c++){
+        size_t row = (size_t)c * stride;
+        const float* ph = engines.phaseOffsets(c);
+        float* p = pressure.data() + row;
+        float* latched = latchedFuel.data() + row;
+        float* work = lastWork.data() + row;
+        int32_t* k = sample.data() + row;
+        for(int e=0;e<stride;e++){
+            float a = angle[e] + ph[e];
+            a -= 720.0f * (float)(a >= 720.0f);
+            int next = model.sampleIndex(a);
+            int prev = k[e];
+            bool wrapped = next < prev;
+            // The finished cycle is booked before a new charge is latched.
+            if(wrapped) work[e] = (float)model.steadyWork(latched[e]);
+            bool crossedIvc = wrapped ? (prev < ivc || next >= ivc) : (prev < ivc && next >= ivc);
+            if(crossedIvc) latched[e] = fuel[e];
+            k[e] = next;
+            p[e] = model.steadyPressure(next, latched[e]);
+            torque[e] += model.torque(next, p[e]);
+        }
+    }
+}
+
+void ThermoBatch::stateArrays(std::vector<StateArray>& out) {
+    out.push_back({ "thermo.fuel", fuel.data(), fuel.size() * sizeof(float) });
+    out.push_back({ "thermo.torque", torque.data(), torque.size() * sizeof(float) });
+    out.push_back({ "thermo.pressure", pressure.data(), pressure.size() * sizeof(float) });
+    out.push_back({ "thermo.latched", latchedFuel.data(), latchedFuel.size() * sizeof(float) });
+    out.push_back({ "thermo.work", lastWork.data(), lastWork.size() * sizeof(float) });
+    out.push_back({ "thermo.sample", sample.data(), sample.size() * sizeof(int32_t) });
+}
@@ -0,0 +1,128 @@
+// thermo_model.h
+// Crank-angle-resolved single-zone cylinder model.
+// Cycle angle follows getPhaseKindForCylinder: 0 = TDC at the start of
+// intake, 360 = firing TDC, 720 = end of exhaust. Per resolution step
+// (0.1 degree by default):
+//   intake        p = intake pressure
+//   compression   p' = p (V/V')^nc                       polytropic
+//   combustion    p' = p (V/V')^n + (n-1) dQ / V'         Wiebe heat release
+//   expansion     p' = p (V/V')^ne
+//   blowdown      p relaxes exponentially to exhaust pressure after EVO
+//   exhaust       p = exhaust pressure
+// Volume comes from the exact slider-crank (crank_kinematics.h).
+//
+// Every step is affine in pressure and fuel energy, p' = p*keep + target +
+// fuel*heat, and intake resets the pressure, so a whole cycle is affine in
+// the fuel energy burned in it: p(k) = p0(k) + fuel * p1(k), with cycle work
+// W = w0 + fuel * w1. ThermoModel integrates p0 and p1 once per spec at full
+// resolution; ThermoBatch latches each cylinder's fuel at intake valve
+// closing (BDC, 180 degrees) and then reads pressure and torque with one
+// multiply-add per cylinder, however fine the resolution.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class EngineBatch;
+struct EngineConfig;
+struct StateArray;
+
+struct ThermoSpec {
+    // SI units; defaults are a 0.5 l spark-ignition cylinder.
+    double bore = 0.086;                 // m
+    double stroke = 0.086;               // m
+    double rodLength = 0.143;            // m
+    double compressionRatio = 10.5;
+    double polyCompression = 1.32;
+    double polyExpansion = 1.27;
+    double intakePressure = 0.95e5;      // Pa
+    double exhaustPressure = 1.05e5;     // Pa
+    double crankcasePressure = 1.0e5;    // Pa, acts on the piston underside
+    double combustionStartDeg = 345.0;   // cycle angle (15 degrees before firing TDC)
+    double combustionDurationDeg = 55.0;
+    double wiebeA = 5.0;
+    double wiebeM = 2.0;
+    double exhaustOpenDeg = 490.0;       // EVO, 130 degrees after firing TDC
+    double blowdownDurationDeg = 50.0;
+    double resolutionDeg = 0.1;
+};
+
+// Geometry from an engine description; combustion and valve timing stay default.
+ThermoSpec engineThermoSpec(const EngineConfig& cfg);
+
+// Coefficients for the step from sample k to k + 1.
+struct ThermoStep {
+    float keep;        // pressure carried over
+    float target;      // Pa added independent of state
+    float heat;        // Pa per J of fuel energy released this step
+    float dVolume;     // V(k+1) - V(k), m^3
+    float torqueArm;   // crank torque per Pa of net pressure at sample k, N m / Pa
+};
+
+class ThermoModel {
+public:
+    explicit ThermoModel(const ThermoSpec& spec = ThermoSpec());
+
+    const ThermoSpec& spec() const { return sp; }
+    int samples() const { return n; }                 // per 720-degree cycle
+    float resolutionDeg() const { return res; }
+    const ThermoStep* steps() const { return table.data(); }
+    double displacedVolume() const { return vd; }
+    double volume(int k) const { return vol[k]; }
+
+    // Sample at or before cycle angle a in [0, 720).
+    int sampleIndex(float cycleAngleDeg) const;
+
+    // Steady-state cycle for a constant fuel energy per cycle.
+    float steadyPressure(int k, float fuelJ) const { return p0[k] + fuelJ * p1[k]; }
+    double steadyWork(float fuelJ) const { return w0 + fuelJ * w1; }   // indicated J per cycle
+    double imep(float fuelJ) const { return steadyWork(fuelJ) / vd; } // Pa
+    // Net cylinder pressure times lever arm, N m, at sample k.
+    float torque(int k, float pressure) const {
+        return (pressure - (float)sp.crankcasePressure) * table[k].torqueArm;
+    }
+
+private:
+    ThermoSpec sp;
+    int n;
+    float res;
+    double vd;
+    std::vector<double> vol;
+    std::vector<ThermoStep> table;
+    std::vector<float> p0, p1;   // steady pressure = p0 + fuel * p1
+    double w0, w1;
+};
+
+// Pressure state for every cylinder of an EngineBatch (same size, cylinder
+// count and row stride), following each cylinder's cycle angle.
+class ThermoBatch {
+public:
+    // Every cylinder starts on the steady cycle for fuelJ.
+    ThermoBatch(const ThermoModel& model, const EngineBatch& engines, float fuelJ);
+
+    // Fuel energy per cycle; each cylinder takes it at its next intake valve closing.
+    void setFuel(int e, float fuelJ) { fuel[e] = fuelJ; }
+
+    // Moves every cylinder to its engine's current angle (forward, less than
+    // one cycle per call) and refreshes pressures, cycle work and crank torque.
+    void advance(const EngineBatch& engines);
+
+    const float* pressures(int cylinder) const { return pressure.data() + (size_t)cylinder * stride; }
+    // Fuel energy each cylinder latched at its last intake valve closing, J.
+    const float* latchedFuels(int cylinder) const { return latchedFuel.data() + (size_t)cylinder * stride; }
+    // Indicated work of each cylinder's last completed cycle, J.
+    const float* cycleWork(int cylinder) const { return lastWork.data() + (size_t)cylinder * stride; }
+    // Sum over cylinders of instantaneous gas torque, N m.
+    const float* torques() const { return torque.data(); }
+
+    // Every array of state, for snapshots (sim_snapshot.h).
+    void stateArrays(std::vector<StateArray>& out);
+
+private:
+    const ThermoModel& model;
+    int engineCount, cylCount, stride;
+    std::vector<float> fuel, torque;                      // [stride]
+    std::vector<float> pressure, latchedFuel, lastWork;   // [cylinders * stride]
+    std::vector<int32_t> sample;                          // [cylinders * stride]
+};
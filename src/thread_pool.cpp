@@ -0,0 +1,97 @@
+// thread_pool.cpp
+// Work-stealing pool (see thread_pool.h).
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int threads) {
+    if(threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    threadCount = threads > 0 ? threads : 1;
+    queues.reset(new WorkQueue[threadCount]);
+    // slot 0 is the caller of parallelFor
+    for(int i=1;i<threadCount;i++) workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> g(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& t: workers) t.join();
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& fn) {
+    if(count <= 0) return;
+    if(threadCount == 1 || count == 1) {
+        for(int i=0;i<count;i++) fn(i);
+        return;
+    }
+
+    // Publish the job before any index becomes visible: a worker still
+    // draining the previous generation may pick the new indices up directly.
+    job = &fn;
+    remaining.store(count, std::memory_order_relaxed);
+    // Contiguous blocks per thread keep neighbouring tiles on one core;
+    // stealing takes over from there.
+    for(int s=0;s<threadCount;s++){
+        int begin = (int)((int64_t)count * s / threadCount);
+        int end = (int)((int64_t)count * (s + 1) / threadCount);
+        std::lock_guard<std::mutex> g(queues[s].lock);
+        for(int i=begin;i<end;i++) queues[s].items.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> g(stateLock);
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> g(stateLock);
+    finished.wait(g, [this]{ return remaining.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::popLocal(int slot, int& item) {
+    WorkQueue& q = queues[slot];
+    std::lock_guard<std::mutex> g(q.lock);
+    if(q.items.empty()) return false;
+    item = q.items.back();
+    q.items.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int slot, int& item) {
+    for(int k=1;k<threadCount;k++){
+        WorkQueue& q = queues[(slot + k) % threadCount];
+        std::lock_guard<std::mutex> g(q.lock);
+        if(q.items.empty()) continue;
+        item = q.items.front();
+        q.items.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::runTasks(int slot) {
+    int item;
+    while(popLocal(slot, item) || steal(slot, item)) {
+        (*job)(item);
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> g(stateLock);
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::workerLoop(int slot) {
+    uint64_t seen = 0;
+    for(;;) {
+        {
+            std::unique_lock<std::mutex> g(stateLock);
+            wake.wait(g, [&]{ return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+        }
+        runTasks(slot);
+    }
+}
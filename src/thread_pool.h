@@ -0,0 +1,56 @@
+// thread_pool.h
+// Small work-stealing pool for data-parallel loops (tile rasterization,
+// parameter sweeps). Each thread owns a deque of task indices: it pops from
+// the back of its own and steals from the front of the others', so uneven
+// tasks (a tile full of combustion blends next to an empty one) even out
+// without a shared queue becoming the bottleneck.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // threads counts the calling thread, which works inside parallelFor;
+    // 0 picks std::thread::hardware_concurrency().
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return threadCount; }
+
+    // Runs fn(0) .. fn(count - 1) across the pool and returns when all are done.
+    // Not reentrant: call from one thread at a time, and not from inside fn.
+    void parallelFor(int count, const std::function<void(int)>& fn);
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<int> items;
+    };
+
+    bool popLocal(int slot, int& item);
+    bool steal(int slot, int& item);
+    void runTasks(int slot);
+    void workerLoop(int slot);
+
+    int threadCount;
+    std::unique_ptr<WorkQueue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateLock;
+    std::condition_variable wake, finished;
+    uint64_t generation = 0;
+    bool stopping = false;
+    const std::function<void(int)>* job = nullptr;
+    std::atomic<int> remaining{0};
+};
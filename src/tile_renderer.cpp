@@ -0,0 +1,76 @@
+// tile_renderer.cpp
+// Binning and tile-parallel rasterization (see tile_renderer.h).
+
+#include "tile_renderer.h"
+#include <algorithm>
+#include <cmath>
+#include "trace_export.h"
+
+TileRenderer::TileRenderer(ThreadPool& p, int tileSize) : pool(p), tile(tileSize > 0 ? tileSize : 64) {}
+
+void TileRenderer::bin(const CommandList& list, int fbWidth, int fbHeight) {
+    tilesX = (fbWidth + tile - 1) / tile;
+    tilesY = (fbHeight + tile - 1) / tile;
+    size_t count = (size_t)tilesX * tilesY;
+    if(bins.size() < count) bins.resize(count);
+    for(size_t i=0;i<count;i++) bins[i].clear();
+
+    const std::vector<RasterCmd>& cmds = list.commands();
+    for(uint32_t ci=0;ci<(uint32_t)cmds.size();ci++){
+        const RasterCmd& c = cmds[ci];
+        int px0, py0, px1, py1;   // inclusive pixel bounds
+        if(c.kind == RASTER_CLEAR) {
+            px0 = 0; py0 = 0; px1 = fbWidth - 1; py1 = fbHeight - 1;
+        } else if(c.kind == RASTER_PIXEL_RECT) {
+            px0 = (int)c.v[0]; py0 = (int)c.v[1];
+            px1 = (int)c.v[2] - 1; py1 = (int)c.v[3] - 1;
+        } else {
+            // a pixel is covered only if its centre (p + 0.5) is inside
+            float minX = std::min(c.v[0], std::min(c.v[2], c.v[4]));
+            float maxX = std::max(c.v[0], std::max(c.v[2], c.v[4]));
+            float minY = std::min(c.v[1], std::min(c.v[3], c.v[5]));
+            float maxY = std::max(c.v[1], std::max(c.v[3], c.v[5]));
+            float w = (float)fbWidth, h = (float)fbHeight;
+            px0 = (int)std::min(w, std::max(-1.0f, std::floor(minX)));
+            py0 = (int)std::min(h, std::max(-1.0f, std::floor(minY)));
+            px1 = (int)std::min(w, std::max(-1.0f, std::ceil(maxX)));
+            py1 = (int)std::min(h, std::max(-1.0f, std::ceil(maxY)));
+        }
+        int tx0 = std::max(px0, 0) / tile, ty0 = std::max(py0, 0) / tile;
+        int tx1 = std::min(px1, fbWidth - 1), ty1 = std::min(py1, fbHeight - 1);
+        if(tx1 < 0 || ty1 < 0 || px0 >= fbWidth || py0 >= fbHeight) continue;
+        tx1 /= tile; ty1 /= tile;
+        for(int ty=ty0;ty<=ty1;ty++)
+            for(int tx=tx0;tx<=tx1;tx++) bins[(size_t)ty * tilesX + tx].push_back(ci);
+    }
+}
+
+void TileRenderer::renderTile(int index, const std::vector<RasterCmd>& cmds, Framebuffer& fb) const {
+    int tx = index % tilesX, ty = index / tilesX;
+    RasterClip clip = { tx * tile, ty * tile,
+                        std::min((tx + 1) * tile, fb.width), std::min((ty + 1) * tile, fb.height) };
+    for(uint32_t ci: bins[index]) {
+        const RasterCmd& c = cmds[ci];
+        switch(c.kind) {
+            case RASTER_CLEAR:
+                rasterClear(fb, clip, c.col);
+                break;
+            case RASTER_TRIANGLE:
+                rasterTriangle(fb, clip, c.v[0], c.v[1], c.v[2], c.v[3], c.v[4], c.v[5], c.col, c.blend);
+                break;
+            case RASTER_PIXEL_RECT:
+                rasterPixelRect(fb, clip, (int)c.v[0], (int)c.v[1], (int)c.v[2], (int)c.v[3], c.col, c.blend);
+                break;
+        }
+    }
+}
+
+void TileRenderer::render(const CommandList& list, Framebuffer& fb) {
+    if(fb.width <= 0 || fb.height <= 0) return;
+    bin(list, fb.width, fb.height);
+    const std::vector<RasterCmd>& cmds = list.commands();
+    pool.parallelFor(tilesX * tilesY, [&](int index) {
+        TraceScope scope("tile");
+        renderTile(index, cmds, fb);
+    });
+}
@@ -0,0 +1,32 @@
+// tile_renderer.h
+// Tile-parallel replay of a CommandList. Commands are binned by bounding box
+// into fixed-size screen tiles, then every tile is rasterized on the thread
+// pool with its commands in submission order. A tile is written by exactly
+// one thread and pixels are sampled only at their own centres, so the output
+// is byte-identical to SoftBackend drawing the same scene.
+#pragma once
+
+#include "command_list.h"
+#include "soft_raster.h"
+#include "thread_pool.h"
+#include <cstdint>
+#include <vector>
+
+class TileRenderer {
+public:
+    explicit TileRenderer(ThreadPool& pool, int tileSize = 64);
+
+    void render(const CommandList& list, Framebuffer& fb);
+
+    int tileSize() const { return tile; }
+
+private:
+    void bin(const CommandList& list, int fbWidth, int fbHeight);
+    void renderTile(int index, const std::vector<RasterCmd>& cmds, Framebuffer& fb) const;
+
+    ThreadPool& pool;
+    int tile;
+    int tilesX = 0, tilesY = 0;
+    // Per-tile command indices; cleared, not freed, between frames.
+    std::vector<std::vector<uint32_t>> bins;
+};
@@ -0,0 +1,334 @@
+// trace_export.cpp
+// Per-thread span buffers and the Chrome JSON / Perfetto writers (see
+// trace_export.h).
+
+#include "trace_export.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+std::atomic<uint8_t> profileSinks{0};
+
+namespace {
+
+const int kTraceChunkEvents = 4096;
+
+enum class TraceKind : uint8_t { Span, Counter };
+
+struct TraceEvent {
+    const char* name;
+    int64_t ts;                 // steady clock ns
+    union {
+        int64_t durNs;          // Span
+        double value;           // Counter
+    };
+    TraceKind kind;
+};
+
+// Filled by one thread front to back. Once it links next it never touches
+// this chunk again, so the flushing thread may write and free it.
+struct TraceChunk {
+    TraceEvent events[kTraceChunkEvents];
+    std::atomic<uint32_t> used{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+struct TraceThread {
+    int tid;
+    TraceChunk* head;           // oldest unwritten; flushing thread only
+    TraceChunk* tail;           // being filled; owning thread only
+    bool described = false;     // name written to the file
+    TraceThread* nextThread;
+};
+
+struct TraceFile {
+    FILE* file = nullptr;
+    TraceFormat format = TraceFormat::Chrome;
+    int64_t originNs = 0;
+    bool firstEvent = true;
+    bool firstPacket = true;
+    std::vector<const char*> counters;   // counter names with a track written
+    std::string packet, body;
+};
+
+TraceFile out;
+std::atomic<TraceThread*> threads{nullptr};
+std::atomic<int> threadCount{0};
+std::atomic<uint32_t> generation{1};     // bumped on close; stale thread_locals re-register
+
+struct ThreadSlot {
+    TraceThread* thread = nullptr;
+    uint32_t generation = 0;
+};
+thread_local ThreadSlot self;
+
+TraceThread* selfThread() {
+    uint32_t gen = generation.load(std::memory_order_acquire);
+    if(self.thread && self.generation == gen) return self.thread;
+    TraceThread* t = new TraceThread();
+    t->tid = threadCount.fetch_add(1) + 1;
+    t->head = t->tail = new TraceChunk();
+    t->nextThread = threads.load(std::memory_order_relaxed);
+    while(!threads.compare_exchange_weak(t->nextThread, t, std::memory_order_release, std::memory_order_relaxed)) {}
+    self.thread = t;
+    self.generation = gen;
+    return t;
+}
+
+void append(const TraceEvent& ev) {
+    TraceThread* t = selfThread();
+    TraceChunk* c = t->tail;
+    uint32_t n = c->used.load(std::memory_order_relaxed);
+    if(n == kTraceChunkEvents) {
+        TraceChunk* fresh = new TraceChunk();
+        c->next.store(fresh, std::memory_order_release);
+        t->tail = c = fresh;
+        n = 0;
+    }
+    c->events[n] = ev;
+    c->used.store(n + 1, std::memory_order_release);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Perfetto protobuf (perfetto/trace/trace_packet.proto, track_event.proto)
+//////////////////////////////////////////////////////////////////////////
+void putVarint(std::string& s, uint64_t v) {
+    while(v >= 0x80) {
+        s += (char)(uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    s += (char)(uint8_t)v;
+}
+
+void putTag(std::string& s, int field, int wireType) {
+    putVarint(s, (uint64_t)(field << 3 | wireType));
+}
+
+void putUint(std::string& s, int field, uint64_t v) {
+    putTag(s, field, 0);
+    putVarint(s, v);
+}
+
+void putBytes(std::string& s, int field, const char* data, size_t n) {
+    putTag(s, field, 2);
+    putVarint(s, n);
+    s.append(data, n);
+}
+
+void putString(std::string& s, int field, const char* str) {
+    putBytes(s, field, str, strlen(str));
+}
+
+void putDouble(std::string& s, int field, double v) {
+    putTag(s, field, 1);
+    char b[8];
+    memcpy(b, &v, 8);
+    s.append(b, 8);
+}
+
+const uint64_t kProcessTrack = 1;
+const uint32_t kPacketSequence = 1;
+
+uint64_t threadTrack(int tid) { return 0x1000 + (uint64_t)tid; }
+uint64_t counterTrack(size_t index) { return 0x100000 + (uint64_t)index; }
+
+// Wraps out.packet as one Trace.packet and writes it.
+void writePacket() {
+    putUint(out.packet, 10, kPacketSequence);                 // trusted_packet_sequence_id
+    if(out.firstPacket) putUint(out.packet, 13, 1);           // SEQ_INCREMENTAL_STATE_CLEARED
+    out.firstPacket = false;
+    std::string framed;
+    putBytes(framed, 1, out.packet.data(), out.packet.size());
+    fwrite(framed.data(), 1, framed.size(), out.file);
+    out.packet.clear();
+}
+
+void writeTrackDescriptor(uint64_t uuid, const char* name, int tid, bool counter) {
+    std::string& d = out.body;
+    d.clear();
+    putUint(d, 1, uuid);
+    if(tid) {
+        putUint(d, 5, kProcessTrack);                         // parent_uuid
+        std::string thread;
+        putUint(thread, 1, 1);                                // pid
+        putUint(thread, 2, (uint64_t)tid);
+        putString(thread, 5, name);                           // thread_name
+        putBytes(d, 4, thread.data(), thread.size());
+    } else if(counter) {
+        putUint(d, 5, kProcessTrack);
+        putString(d, 2, name);
+        putBytes(d, 8, "", 0);                                // CounterDescriptor
+    } else {
+        std::string process;
+        putUint(process, 1, 1);                               // pid
+        putString(process, 6, name);                          // process_name
+        putBytes(d, 3, process.data(), process.size());
+    }
+    putBytes(out.packet, 60, d.data(), d.size());             // track_descriptor
+    writePacket();
+}
+
+void writeTrackEvent(int64_t ts, int type, uint64_t track, const char* name, const double* value) {
+    std::string& e = out.body;
+    e.clear();
+    putUint(e, 9, (uint64_t)type);
+    putUint(e, 11, track);
+    if(name) putString(e, 23, name);
+    if(value) putDouble(e, 44, *value);                       // double_counter_value
+    putUint(out.packet, 8, (uint64_t)(ts - out.originNs));    // timestamp
+    putBytes(out.packet, 11, e.data(), e.size());             // track_event
+    writePacket();
+}
+
+size_t counterIndex(const char* name) {
+    for(size_t i=0;i<out.counters.size();i++)
+        if(out.counters[i] == name || strcmp(out.counters[i], name) == 0) return i;
+    out.counters.push_back(name);
+    if(out.format == TraceFormat::Perfetto) writeTrackDescriptor(counterTrack(out.counters.size() - 1), name, 0, true);
+    return out.counters.size() - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Writing
+//////////////////////////////////////////////////////////////////////////
+void writeChromeEvent(const char* json) {
+    fputs(out.firstEvent ? "\n" : ",\n", out.file);
+    fputs(json, out.file);
+    out.firstEvent = false;
+}
+
+void describeThread(TraceThread* t) {
+    t->described = true;
+    char name[32];
+    if(t->tid == 1) snprintf(name, sizeof(name), "main");
+    else snprintf(name, sizeof(name), "worker %d", t->tid - 1);
+    if(out.format == TraceFormat::Perfetto) {
+        writeTrackDescriptor(threadTrack(t->tid), name, t->tid, false);
+        return;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+             t->tid, name);
+    writeChromeEvent(line);
+}
+
+void writeEvent(const TraceThread* t, const TraceEvent& ev) {
+    if(out.format == TraceFormat::Perfetto) {
+        if(ev.kind == TraceKind::Counter) {
+            writeTrackEvent(ev.ts, 4, counterTrack(counterIndex(ev.name)), nullptr, &ev.value);   // TYPE_COUNTER
+        } else {
+            writeTrackEvent(ev.ts, 1, threadTrack(t->tid), ev.name, nullptr);                     // TYPE_SLICE_BEGIN
+            writeTrackEvent(ev.ts + ev.durNs, 2, threadTrack(t->tid), nullptr, nullptr);          // TYPE_SLICE_END
+        }
+        return;
+    }
+    char line[256];
+    double tsUs = (ev.ts - out.originNs) * 1e-3;
+    if(ev.kind == TraceKind::Counter)
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%.4f}}",
+                 ev.name, tsUs, t->tid, ev.value);
+    else
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                 ev.name, tsUs, ev.durNs * 1e-3, t->tid);
+    writeChromeEvent(line);
+}
+
+void writeChunk(TraceThread* t, const TraceChunk* c) {
+    if(!t->described) describeThread(t);
+    uint32_t n = c->used.load(std::memory_order_acquire);
+    for(uint32_t i=0;i<n;i++) writeEvent(t, c->events[i]);
+}
+
+// Writes and frees each thread's filled chunks; with all, also the chunk
+// being filled (only once the threads are done).
+void drain(bool all) {
+    for(TraceThread* t = threads.load(std::memory_order_acquire); t; t = t->nextThread){
+        while(TraceChunk* next = t->head->next.load(std::memory_order_acquire)) {
+            writeChunk(t, t->head);
+            delete t->head;
+            t->head = next;
+        }
+        if(all) writeChunk(t, t->head);
+    }
+}
+
+} // namespace
+
+TraceFormat traceFormatForPath(const std::string& path) {
+    size_t n = path.size();
+    return n >= 5 && path.compare(n - 5, 5, ".json") == 0 ? TraceFormat::Chrome : TraceFormat::Perfetto;
+}
+
+int64_t traceNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool traceOpen(const std::string& path, TraceFormat format, std::string& error) {
+    if(out.file) traceClose();
+    out = TraceFile();
+    out.file = fopen(path.c_str(), "wb");
+    if(!out.file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    out.format = format;
+    out.originNs = traceNowNs();
+    if(format == TraceFormat::Chrome) fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out.file);
+    else writeTrackDescriptor(kProcessTrack, "engine_sim", 0, false);
+    selfThread();   // the opening thread is tid 1, "main"
+    profileSinks.fetch_or(kSinkTrace);
+    return true;
+}
+
+void traceFlush() {
+    if(!out.file) return;
+    int64_t start = traceNowNs();
+    drain(false);
+    traceSpan("trace flush", start, traceNowNs());
+}
+
+void traceClose() {
+    if(!out.file) return;
+    profileSinks.fetch_and((uint8_t)~kSinkTrace);
+    drain(true);
+    if(out.format == TraceFormat::Chrome) fputs("\n]}\n", out.file);
+    fclose(out.file);
+    out.file = nullptr;
+
+    TraceThread* t = threads.exchange(nullptr);
+    while(t) {
+        TraceThread* next = t->nextThread;
+        for(TraceChunk* c = t->head; c; ) {
+            TraceChunk* n = c->next.load(std::memory_order_relaxed);
+            delete c;
+            c = n;
+        }
+        delete t;
+        t = next;
+    }
+    threadCount = 0;
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+void traceSpan(const char* name, int64_t startNs, int64_t endNs) {
+    if(!traceEnabled()) return;   // closed since the span began
+    TraceEvent ev;
+    ev.name = name;
+    ev.ts = startNs;
+    ev.durNs = endNs - startNs;
+    ev.kind = TraceKind::Span;
+    append(ev);
+}
+
+void traceCounter(const char* name, double value) {
+    if(!traceEnabled()) return;
+    TraceEvent ev;
+    ev.name = name;
+    ev.ts = traceNowNs();
+    ev.value = value;
+    ev.kind = TraceKind::Counter;
+    append(ev);
+}
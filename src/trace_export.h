@@ -0,0 +1,59 @@
+// trace_export.h
+// Span trace of a run for a trace viewer: every ProfileScope (display,
+// landing, block, combustion, retained, sim step, swap) plus the TraceScope
+// spans (timer tick, tile rasterization, trace flushes) and counters (timer
+// interval) go to a file in Chrome JSON (open in chrome://tracing or
+// ui.perfetto.dev) or Perfetto protobuf, so a long session can be scanned
+// for hitches and lined up against glutTimerFunc jitter.
+//
+// Each thread appends to its own chunked buffer without locks or atomic
+// read-modify-writes; traceFlush() (one thread, the main loop) writes out
+// and frees the chunks threads have filled, and traceClose() the rest.
+// Disabled, a scope costs one test of profileSinks.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Collectors listening to ProfileScope / TraceScope, one bit each; zero
+// when none is, so a disabled scope is one predictable branch.
+const uint8_t kSinkOverlay = 1;    // FrameProfiler
+const uint8_t kSinkTrace = 2;
+extern std::atomic<uint8_t> profileSinks;
+
+enum class TraceFormat : uint8_t { Chrome, Perfetto };
+
+// Chrome JSON for paths ending in .json, Perfetto otherwise.
+TraceFormat traceFormatForPath(const std::string& path);
+
+// Starts tracing to path. The calling thread is named "main" in the trace.
+bool traceOpen(const std::string& path, TraceFormat format, std::string& error);
+// Writes the chunks threads have filled so far. Call from one thread.
+void traceFlush();
+// Writes everything left and closes the file; other threads must be done
+// tracing by then.
+void traceClose();
+
+inline bool traceEnabled() {
+    return (profileSinks.load(std::memory_order_relaxed) & kSinkTrace) != 0;
+}
+int64_t traceNowNs();
+// name must outlive the trace (a string literal).
+void traceSpan(const char* name, int64_t startNs, int64_t endNs);
+void traceCounter(const char* name, double value);
+
+// Records the enclosing scope as a span named name while tracing.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : n(name), startNs(traceEnabled() ? traceNowNs() : 0) {}
+    ~TraceScope() {
+        if(startNs) traceSpan(n, startNs, traceNowNs());
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* n;
+    int64_t startNs;
+};